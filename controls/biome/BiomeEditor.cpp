@@ -0,0 +1,187 @@
+#include "BiomeEditor.h"
+#include <QtWidgets/QComboBox>
+#include <QtWidgets/QDialogButtonBox>
+#include <QtWidgets/QFormLayout>
+#include <QtWidgets/QGroupBox>
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QPushButton>
+#include "../../legend/QColorButton.h"
+
+using namespace calenhad::controls::biome;
+using namespace calenhad::controls::legend;
+
+BiomeEditor::BiomeEditor (QWidget* parent) : QDialog (parent) {
+    setWindowTitle ("Biomes");
+    setLayout (new QVBoxLayout());
+
+    QGroupBox* classBox = new QGroupBox ("Classes", this);
+    classBox -> setLayout (new QVBoxLayout());
+    _classContent = new QWidget (classBox);
+    _classLayout = new QVBoxLayout (_classContent);
+    _classLayout -> setContentsMargins (0, 0, 0, 0);
+    classBox -> layout() -> addWidget (_classContent);
+    QPushButton* addButton = new QPushButton ("Add class", classBox);
+    classBox -> layout() -> addWidget (addButton);
+    connect (addButton, &QPushButton::pressed, this, &BiomeEditor::addClass);
+    layout() -> addWidget (classBox);
+
+    QGroupBox* bandBox = new QGroupBox ("Bands", this);
+    QFormLayout* bandLayout = new QFormLayout (bandBox);
+    _heightsText = new QLineEdit (bandBox);
+    _heightsText -> setToolTip ("Boundaries between the height bands, separated by commas");
+    _moisturesText = new QLineEdit (bandBox);
+    _moisturesText -> setToolTip ("Boundaries between the moisture bands, separated by commas");
+    bandLayout -> addRow ("Height", _heightsText);
+    bandLayout -> addRow ("Moisture", _moisturesText);
+    connect (_heightsText, &QLineEdit::editingFinished, this, &BiomeEditor::updateBands);
+    connect (_moisturesText, &QLineEdit::editingFinished, this, &BiomeEditor::updateBands);
+    layout() -> addWidget (bandBox);
+
+    QGroupBox* cellBox = new QGroupBox ("Table", this);
+    cellBox -> setLayout (new QVBoxLayout());
+    _cellContent = new QWidget (cellBox);
+    _cellLayout = new QGridLayout (_cellContent);
+    cellBox -> layout() -> addWidget (_cellContent);
+    layout() -> addWidget (cellBox);
+
+    QDialogButtonBox* buttonBox = new QDialogButtonBox (QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect (buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect (buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout() -> addWidget (buttonBox);
+}
+
+BiomeEditor::~BiomeEditor () {
+
+}
+
+BiomeTable BiomeEditor::table () {
+    return _table;
+}
+
+void BiomeEditor::setTable (const BiomeTable& table) {
+    _table = table;
+    populate();
+}
+
+void BiomeEditor::populate () {
+    _heightsText -> setText (bandsText (_table.heights()));
+    _moisturesText -> setText (bandsText (_table.moistures()));
+    populateClasses();
+    populateCells();
+}
+
+void BiomeEditor::populateClasses () {
+    QLayoutItem* item;
+    while ((item = _classLayout -> takeAt (0))) {
+        if (item -> widget()) { item -> widget() -> deleteLater(); }
+        delete item;
+    }
+
+    for (int i = 0; i < _table.classes().size(); i++) {
+        BiomeClass biomeClass = _table.classes().at (i);
+        QWidget* row = new QWidget (_classContent);
+        QHBoxLayout* rowLayout = new QHBoxLayout (row);
+        rowLayout -> setContentsMargins (0, 0, 0, 0);
+        rowLayout -> addWidget (new QLabel (QString::number (i), row));
+
+        QLineEdit* nameText = new QLineEdit (biomeClass.name(), row);
+        rowLayout -> addWidget (nameText);
+        connect (nameText, &QLineEdit::editingFinished, this, [=] () {
+            BiomeClass c = _table.classes().value (i);
+            c.setName (nameText -> text());
+            _table.setClass (i, c);
+            populateCells();
+        });
+
+        QColorButton* colorButton = new QColorButton (row);
+        colorButton -> setFixedSize (24, 24);
+        colorButton -> setColor (biomeClass.color());
+        rowLayout -> addWidget (colorButton);
+        connect (colorButton, &QPushButton::clicked, this, [=] () {
+            BiomeClass c = _table.classes().value (i);
+            c.setColor (colorButton -> color());
+            _table.setClass (i, c);
+        });
+
+        QPushButton* removeButton = new QPushButton ("Remove", row);
+        removeButton -> setEnabled (_table.classes().size() > 1);
+        rowLayout -> addWidget (removeButton);
+        connect (removeButton, &QPushButton::pressed, this, [=] () {
+            _table.removeClass (i);
+            populateClasses();
+            populateCells();
+        });
+
+        _classLayout -> addWidget (row);
+    }
+}
+
+void BiomeEditor::populateCells () {
+    QLayoutItem* item;
+    while ((item = _cellLayout -> takeAt (0))) {
+        if (item -> widget()) { item -> widget() -> deleteLater(); }
+        delete item;
+    }
+
+    // column headings along the top, row headings down the left, with the highest band first
+    int rows = _table.rows(), columns = _table.columns();
+    QVector<double> h = _table.heights(), m = _table.moistures();
+    for (int column = 0; column < columns; column++) {
+        QString from = column == 0 ? "" : QString::number (m [column - 1]);
+        QString to = column == columns - 1 ? "" : QString::number (m [column]);
+        _cellLayout -> addWidget (new QLabel (from + " .. " + to, _cellContent), 0, column + 1, Qt::AlignCenter);
+    }
+    for (int row = 0; row < rows; row++) {
+        int gridRow = rows - row;
+        QString from = row == 0 ? "" : QString::number (h [row - 1]);
+        QString to = row == rows - 1 ? "" : QString::number (h [row]);
+        _cellLayout -> addWidget (new QLabel (from + " .. " + to, _cellContent), gridRow, 0, Qt::AlignRight);
+        for (int column = 0; column < columns; column++) {
+            QComboBox* combo = new QComboBox (_cellContent);
+            for (const BiomeClass& c : _table.classes()) {
+                combo -> addItem (c.name());
+            }
+            combo -> setCurrentIndex (_table.classAt (row, column));
+            connect (combo, static_cast<void (QComboBox::*) (int)> (&QComboBox::currentIndexChanged), this, [=] (int index) {
+                _table.setClassAt (row, column, index);
+            });
+            _cellLayout -> addWidget (combo, gridRow, column + 1);
+        }
+    }
+}
+
+void BiomeEditor::addClass () {
+    _table.addClass (BiomeClass ("Biome " + QString::number (_table.classes().size()), Qt::gray));
+    populateClasses();
+    populateCells();
+}
+
+void BiomeEditor::updateBands () {
+    QVector<double> heights, moistures;
+    if (parseBands (_heightsText -> text(), heights) && parseBands (_moisturesText -> text(), moistures)) {
+        _table.setBands (heights, moistures);
+        populateCells();
+    }
+    _heightsText -> setText (bandsText (_table.heights()));
+    _moisturesText -> setText (bandsText (_table.moistures()));
+}
+
+QString BiomeEditor::bandsText (const QVector<double>& bands) {
+    QStringList text;
+    for (double b : bands) {
+        text << QString::number (b);
+    }
+    return text.join (", ");
+}
+
+bool BiomeEditor::parseBands (const QString& text, QVector<double>& bands) {
+    bands.clear();
+    for (const QString& part : text.split (",", QString::SkipEmptyParts)) {
+        bool ok;
+        double value = part.trimmed().toDouble (&ok);
+        if (! ok) { return false; }
+        bands.append (value);
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef CALENHAD_BIOMEEDITOR_H
+#define CALENHAD_BIOMEEDITOR_H
+
+#include <QtWidgets/QDialog>
+#include <QtWidgets/QGridLayout>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QVBoxLayout>
+#include "BiomeTable.h"
+
+namespace calenhad {
+    namespace controls {
+        namespace biome {
+
+            // Dialog for editing a biome module's table. Classes are listed with a name and colour, as the entries of a
+            // legend are; below them, the bands of each axis are given as lists of boundaries and each cell of the
+            // table is assigned a class, with the highest height band at the top and the driest moisture band at the left.
+            class BiomeEditor : public QDialog {
+            Q_OBJECT
+
+            public:
+                BiomeEditor (QWidget* parent = 0);
+
+                ~BiomeEditor ();
+
+                BiomeTable table ();
+
+            public slots:
+
+                void setTable (const BiomeTable& table);
+
+            protected:
+                BiomeTable _table;
+                QVBoxLayout* _classLayout;
+                QWidget* _classContent;
+                QGridLayout* _cellLayout;
+                QWidget* _cellContent;
+                QLineEdit* _heightsText, * _moisturesText;
+
+                void populate ();
+                void populateClasses ();
+                void populateCells ();
+
+                static QString bandsText (const QVector<double>& bands);
+                static bool parseBands (const QString& text, QVector<double>& bands);
+
+            protected slots:
+                void addClass ();
+                void updateBands ();
+            };
+        }
+    }
+}
+
+
+#endif //CALENHAD_BIOMEEDITOR_H
@@ -0,0 +1,200 @@
+#include "BiomeTable.h"
+#include <algorithm>
+
+using namespace calenhad::controls::biome;
+
+BiomeClass::BiomeClass () : _name ("Biome"), _color (Qt::black) {
+
+}
+
+BiomeClass::BiomeClass (const QString& name, const QColor& color) : _name (name), _color (color) {
+
+}
+
+QString BiomeClass::name () const {
+    return _name;
+}
+
+QColor BiomeClass::color () const {
+    return _color;
+}
+
+void BiomeClass::setName (const QString& name) {
+    _name = name;
+}
+
+void BiomeClass::setColor (const QColor& color) {
+    _color = color;
+}
+
+BiomeTable::BiomeTable () : _cells (1, 0) {
+    _classes.append (BiomeClass());
+}
+
+BiomeTable BiomeTable::whittaker () {
+    BiomeTable table;
+    table.setClasses ({
+        BiomeClass ("Desert", QColor ("#E0C98A")), BiomeClass ("Grassland", QColor ("#A4C56B")), BiomeClass ("Rainforest", QColor ("#2F7D32")),
+        BiomeClass ("Shrubland", QColor ("#B5A262")), BiomeClass ("Forest", QColor ("#4E8F3A")),
+        BiomeClass ("Tundra", QColor ("#9FA88F")), BiomeClass ("Snow", QColor ("#F4F6F8"))
+    });
+    table.setBands ({ 0.0, 0.5 }, { -0.3, 0.3 });
+    const int cells [3][3] = { { 0, 1, 2 }, { 3, 4, 4 }, { 5, 5, 6 } };
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            table.setClassAt (row, column, cells [row][column]);
+        }
+    }
+    return table;
+}
+
+const QVector<BiomeClass>& BiomeTable::classes () const {
+    return _classes;
+}
+
+void BiomeTable::setClasses (const QVector<BiomeClass>& classes) {
+    _classes = classes;
+
+    // cells of a class that has gone fall back to the first class
+    for (int& cell : _cells) {
+        if (cell >= _classes.size()) { cell = 0; }
+    }
+}
+
+void BiomeTable::setClass (const int& index, const BiomeClass& biomeClass) {
+    if (index >= 0 && index < _classes.size()) {
+        _classes [index] = biomeClass;
+    }
+}
+
+void BiomeTable::addClass (const BiomeClass& biomeClass) {
+    _classes.append (biomeClass);
+}
+
+void BiomeTable::removeClass (const int& index) {
+    if (index < 0 || index >= _classes.size() || _classes.size() < 2) { return; }
+    _classes.remove (index);
+    for (int& cell : _cells) {
+        if (cell == index) {
+            cell = 0;
+        } else if (cell > index) {
+            cell--;
+        }
+    }
+}
+
+const QVector<double>& BiomeTable::heights () const {
+    return _heights;
+}
+
+const QVector<double>& BiomeTable::moistures () const {
+    return _moistures;
+}
+
+void BiomeTable::setBands (const QVector<double>& heights, const QVector<double>& moistures) {
+    QVector<double> h = heights, m = moistures;
+    std::sort (h.begin(), h.end());
+    std::sort (m.begin(), m.end());
+    QVector<int> cells ((h.size() + 1) * (m.size() + 1), 0);
+    for (int row = 0; row < std::min (rows(), h.size() + 1); row++) {
+        for (int column = 0; column < std::min (columns(), m.size() + 1); column++) {
+            cells [row * (m.size() + 1) + column] = classAt (row, column);
+        }
+    }
+    _heights = h;
+    _moistures = m;
+    _cells = cells;
+}
+
+int BiomeTable::rows () const {
+    return _heights.size() + 1;
+}
+
+int BiomeTable::columns () const {
+    return _moistures.size() + 1;
+}
+
+int BiomeTable::classAt (const int& row, const int& column) const {
+    return _cells.value (row * columns() + column, 0);
+}
+
+void BiomeTable::setClassAt (const int& row, const int& column, const int& index) {
+    if (row >= 0 && row < rows() && column >= 0 && column < columns() && index >= 0 && index < _classes.size()) {
+        _cells [row * columns() + column] = index;
+    }
+}
+
+int BiomeTable::lookup (const double& height, const double& moisture) const {
+    int row = (int) (std::upper_bound (_heights.begin(), _heights.end(), height) - _heights.begin());
+    int column = (int) (std::upper_bound (_moistures.begin(), _moistures.end(), moisture) - _moistures.begin());
+    return classAt (row, column);
+}
+
+bool BiomeTable::isValid () const {
+    return ! _classes.isEmpty() && _cells.size() == rows() * columns();
+}
+
+void BiomeTable::inflate (const QDomElement& element) {
+    QVector<BiomeClass> classes;
+    QDomNodeList classNodes = element.elementsByTagName ("class");
+    for (int i = 0; i < classNodes.size(); i++) {
+        QDomElement e = classNodes.at (i).toElement();
+        classes.append (BiomeClass (e.attribute ("name"), QColor (e.attribute ("color"))));
+    }
+    if (classes.isEmpty()) {
+        classes.append (BiomeClass());
+    }
+
+    QVector<double> heights, moistures;
+    QDomNodeList bandNodes = element.elementsByTagName ("band");
+    for (int i = 0; i < bandNodes.size(); i++) {
+        QDomElement e = bandNodes.at (i).toElement();
+        bool ok;
+        double value = e.attribute ("value").toDouble (&ok);
+        if (! ok) { continue; }
+        if (e.attribute ("axis") == "height") { heights.append (value); }
+        if (e.attribute ("axis") == "moisture") { moistures.append (value); }
+    }
+
+    _classes = classes;
+    _heights.clear();
+    _moistures.clear();
+    _cells = QVector<int> (1, 0);
+    setBands (heights, moistures);
+
+    QDomNodeList cellNodes = element.elementsByTagName ("cell");
+    for (int i = 0; i < cellNodes.size(); i++) {
+        QDomElement e = cellNodes.at (i).toElement();
+        setClassAt (e.attribute ("row").toInt(), e.attribute ("column").toInt(), e.attribute ("class").toInt());
+    }
+}
+
+void BiomeTable::serialize (QDomDocument& doc, QDomElement& element) const {
+    for (const BiomeClass& c : _classes) {
+        QDomElement classElement = doc.createElement ("class");
+        classElement.setAttribute ("name", c.name());
+        classElement.setAttribute ("color", c.color().name());
+        element.appendChild (classElement);
+    }
+    for (double h : _heights) {
+        QDomElement bandElement = doc.createElement ("band");
+        bandElement.setAttribute ("axis", "height");
+        bandElement.setAttribute ("value", h);
+        element.appendChild (bandElement);
+    }
+    for (double m : _moistures) {
+        QDomElement bandElement = doc.createElement ("band");
+        bandElement.setAttribute ("axis", "moisture");
+        bandElement.setAttribute ("value", m);
+        element.appendChild (bandElement);
+    }
+    for (int row = 0; row < rows(); row++) {
+        for (int column = 0; column < columns(); column++) {
+            QDomElement cellElement = doc.createElement ("cell");
+            cellElement.setAttribute ("row", row);
+            cellElement.setAttribute ("column", column);
+            cellElement.setAttribute ("class", classAt (row, column));
+            element.appendChild (cellElement);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CALENHAD_BIOMETABLE_H
+#define CALENHAD_BIOMETABLE_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtGui/QColor>
+#include <QtXml/QDomElement>
+
+namespace calenhad {
+    namespace controls {
+        namespace biome {
+
+            // One class of a biome table: a name and the colour it shows in when the table's module outputs colours.
+            class BiomeClass {
+            public:
+                BiomeClass ();
+                BiomeClass (const QString& name, const QColor& color);
+                QString name () const;
+                QColor color () const;
+                void setName (const QString& name);
+                void setColor (const QColor& color);
+
+            protected:
+                QString _name;
+                QColor _color;
+            };
+
+            // A two dimensional classification table for a biome module, indexed by height and moisture. Each axis is
+            // divided into bands by a list of ascending boundaries; a value on a boundary goes in the band above it.
+            // Rows are height bands, from the lowest up, and columns are moisture bands, from the driest, and each
+            // cell holds the index of a class.
+            class BiomeTable {
+            public:
+                BiomeTable ();
+
+                // a Whittaker-style table of three height bands by three moisture bands
+                static BiomeTable whittaker ();
+
+                const QVector<BiomeClass>& classes () const;
+                void setClasses (const QVector<BiomeClass>& classes);
+                void setClass (const int& index, const BiomeClass& biomeClass);
+                void addClass (const BiomeClass& biomeClass);
+
+                // cells of the class removed go to the first class; there is always at least one class
+                void removeClass (const int& index);
+
+                const QVector<double>& heights () const;
+                const QVector<double>& moistures () const;
+
+                // change the bands, keeping the classes of any cells that are still in the table
+                void setBands (const QVector<double>& heights, const QVector<double>& moistures);
+
+                int rows () const;
+                int columns () const;
+                int classAt (const int& row, const int& column) const;
+                void setClassAt (const int& row, const int& column, const int& index);
+
+                // class index for a height and moisture
+                int lookup (const double& height, const double& moisture) const;
+
+                bool isValid () const;
+
+                void inflate (const QDomElement& element);
+                void serialize (QDomDocument& doc, QDomElement& element) const;
+
+            protected:
+                QVector<BiomeClass> _classes;
+                QVector<double> _heights;
+                QVector<double> _moistures;
+                QVector<int> _cells;
+            };
+        }
+    }
+}
+
+
+#endif //CALENHAD_BIOMETABLE_H
@@ -29,6 +29,10 @@ CalenhadStatsPanel::CalenhadStatsPanel (Module* source, CalenhadGlobeDialog* par
 
     worldForm -> addRow ("Mean value in world", _worldMeanLabel);
 
+    _boundsLabel = new QLabel (this);
+    _boundsLabel -> setToolTip ("Limits on the module's value, worked out from its parameters and those of its inputs");
+    worldForm -> addRow ("Bounds of values", _boundsLabel);
+
     _renderSizeLabel = new QLabel (this);
     worldForm -> addRow ("Render size", _renderSizeLabel);
     _renderTimeLabel = new QLabel (this);
@@ -55,6 +59,14 @@ void CalenhadStatsPanel::refresh() {
     _worldExtremesLabel -> setText ("");
     _worldExtremesLabel -> setEnabled (false);
     _worldMeanLabel -> setText ("");
+    double min, max;
+    if (_source -> bounds (min, max)) {
+        _boundsLabel -> setText (QString::number (min) + " to " + QString::number (max));
+        _boundsLabel -> setEnabled (true);
+    } else {
+        _boundsLabel -> setText ("");
+        _boundsLabel -> setEnabled (false);
+    }
     if (worldStats.ok()) {
         _worldExtremesLabel->setText (QString::number (worldStats._min) + " to " + QString::number (worldStats._max));
         _worldExtremesLabel->setEnabled (true);
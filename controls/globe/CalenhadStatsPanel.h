@@ -37,6 +37,7 @@ namespace calenhad {
                 CalenhadGlobeDialog* dialog;
                 QLabel* _mapExtremesLabel, * _worldExtremesLabel;
                 QLabel* _worldMeanLabel;
+                QLabel* _boundsLabel;
                 calenhad::controls::globe::HypsographyWidget* _hypsography;
                 calenhad::qmodule::Module* _source;
 
@@ -0,0 +1,203 @@
+#include "Bake.h"
+#include "ComputeGraph.h"
+#include "CpuEvaluator.h"
+#include "CpuFunctions.h"
+#include "../icosphere/Dataset.h"
+#include <cmath>
+#include <functional>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+
+using namespace calenhad::graph;
+using namespace calenhad::graph::cpu;
+using namespace calenhad::icosphere;
+
+namespace {
+    class BakeTask : public QRunnable {
+    public:
+        BakeTask (std::function<void()> work) : _work (work) { }
+        void run() override { _work(); }
+    protected:
+        std::function<void()> _work;
+    };
+}
+
+Bake::Bake() : _height (0), _min (0.0f), _max (0.0f) {
+
+}
+
+Bake Bake::make (const ComputeGraph& graph, const int& height) {
+    Bake bake;
+    if (! graph.isValid() || height <= 0) { return bake; }
+    bake._height = height;
+    bake._hash = graph.hash();
+    int width = bake.width();
+    bake._values.resize (width * height);
+
+    // a row at a time, each row on whichever thread is free
+    CpuEvaluator evaluator (&graph);
+    QThreadPool pool;
+    float* values = bake._values.data();
+    for (int row = 0; row < height; row++) {
+        pool.start (new BakeTask ([&evaluator, values, row, width, height] () {
+            std::vector<float> lonlat (width * 2);
+            float lat = (float) (M_PI / 2 - (row + 0.5) * M_PI / height);
+            for (int i = 0; i < width; i++) {
+                lonlat [i * 2] = (float) ((i + 0.5) * 2 * M_PI / width - M_PI);
+                lonlat [i * 2 + 1] = lat;
+            }
+            evaluator.evaluateGeolocations (lonlat.data(), values + row * width, width);
+        }));
+    }
+    pool.waitForDone();
+    bake.findRange();
+    return bake;
+}
+
+Bake Bake::make (std::shared_ptr<Dataset> dataset, const QString& column, const int& height, const QByteArray& hash) {
+    Bake bake;
+    if (! dataset || ! dataset -> contains (column) || height <= 0) { return bake; }
+    bake._height = height;
+    bake._hash = hash;
+    bake._dataset = dataset;
+    bake._column = column;
+    int width = bake.width();
+    bake._values.resize (width * height);
+
+    QThreadPool pool;
+    float* values = bake._values.data();
+    for (int row = 0; row < height; row++) {
+        pool.start (new BakeTask ([&dataset, &column, values, row, width, height] () {
+            std::vector<float> xyz (width * 3);
+            double lat = M_PI / 2 - (row + 0.5) * M_PI / height;
+            for (int i = 0; i < width; i++) {
+                double lon = (i + 0.5) * 2 * M_PI / width - M_PI;
+                xyz [i * 3] = (float) (std::cos (lat) * std::cos (lon));
+                xyz [i * 3 + 1] = (float) std::sin (lat);
+                xyz [i * 3 + 2] = (float) (std::cos (lat) * std::sin (lon));
+            }
+            dataset -> sample (column, xyz.data(), values + row * width, width);
+        }));
+    }
+    pool.waitForDone();
+    Dataset::Summary summary = dataset -> summarise (column);
+    bake._min = (float) summary.minimum;
+    bake._max = (float) summary.maximum;
+    return bake;
+}
+
+void Bake::findRange() {
+    _min = _max = _values.first();
+    for (float v : _values) {
+        _min = std::min (_min, v);
+        _max = std::max (_max, v);
+    }
+}
+
+bool Bake::isValid() const {
+    return _height > 0 && _values.size() == width() * _height;
+}
+
+int Bake::height() const {
+    return _height;
+}
+
+int Bake::width() const {
+    return _height * 2;
+}
+
+float Bake::minimum() const {
+    return _min;
+}
+
+float Bake::maximum() const {
+    return _max;
+}
+
+const QVector<float>& Bake::values() const {
+    return _values;
+}
+
+QByteArray Bake::hash() const {
+    return _hash;
+}
+
+std::shared_ptr<const Dataset> Bake::dataset() const {
+    return _dataset;
+}
+
+QString Bake::column() const {
+    return _column;
+}
+
+float Bake::value (const float& lon, const float& lat) const {
+    int w = width(), h = _height;
+    float x = (float) ((lon + M_PI) / (2 * M_PI) * w - 0.5);
+    float y = (float) ((M_PI / 2 - lat) / M_PI * h - 0.5);
+    int x0 = (int) std::floor (x), y0 = (int) std::floor (y);
+    float fx = x - x0, fy = y - y0;
+    auto at = [this, w, h] (int col, int row) {
+        col = ((col % w) + w) % w;
+        row = std::min (std::max (row, 0), h - 1);
+        return _values [row * w + col];
+    };
+    return glslMix (glslMix (at (x0, y0), at (x0 + 1, y0), fx), glslMix (at (x0, y0 + 1), at (x0 + 1, y0 + 1), fx), fy);
+}
+
+QImage Bake::image (const int& size) const {
+    if (! _image.isNull() && _image.width() == size) { return _image; }
+    QImage image (size, size, QImage::Format_RGBA8888);
+    float range = _max - _min;
+    for (int j = 0; j < size; j++) {
+        uchar* line = image.scanLine (j);
+        float lat = (float) (M_PI / 2 - (j + 0.5) * M_PI / size);
+        for (int i = 0; i < size; i++) {
+            float lon = (float) ((i + 0.5) * 2 * M_PI / size - M_PI);
+            float t = range > 0.0f ? (value (lon, lat) - _min) / range : 0.0f;
+            int sum = (int) std::lround (glslClamp (t, 0.0f, 1.0f) * 765.0f);
+            line [i * 4] = (uchar) (sum / 3 + (sum % 3 > 0 ? 1 : 0));
+            line [i * 4 + 1] = (uchar) (sum / 3 + (sum % 3 > 1 ? 1 : 0));
+            line [i * 4 + 2] = (uchar) (sum / 3);
+            line [i * 4 + 3] = 255;
+        }
+    }
+    _image = image;
+    return image;
+}
+
+float Bake::scale() const {
+    return (_max - _min) / 2.0f;
+}
+
+float Bake::bias() const {
+    return (_max + _min) / 2.0f;
+}
+
+void Bake::serialize (QDomDocument& doc, QDomElement& element) const {
+    QDomElement bakeElement = doc.createElement ("bake");
+    bakeElement.setAttribute ("height", _height);
+    bakeElement.setAttribute ("min", QString::number (_min, 'g', 9));
+    bakeElement.setAttribute ("max", QString::number (_max, 'g', 9));
+    bakeElement.setAttribute ("hash", QString (_hash));
+    QByteArray data ((const char*) _values.constData(), _values.size() * (int) sizeof (float));
+    bakeElement.appendChild (doc.createTextNode (qCompress (data).toBase64()));
+    element.appendChild (bakeElement);
+}
+
+bool Bake::inflate (const QDomElement& element) {
+    QDomElement bakeElement = element.firstChildElement ("bake");
+    if (bakeElement.isNull()) { return false; }
+    QByteArray data = qUncompress (QByteArray::fromBase64 (bakeElement.text().toLatin1()));
+    int height = bakeElement.attribute ("height").toInt();
+    if (height <= 0 || data.size() != height * height * 2 * (int) sizeof (float)) { return false; }
+    _height = height;
+    _min = bakeElement.attribute ("min").toFloat();
+    _max = bakeElement.attribute ("max").toFloat();
+    _hash = bakeElement.attribute ("hash").toLatin1();
+    _image = QImage();
+    _dataset = nullptr;
+    _column = QString();
+    _values.resize (width() * _height);
+    std::copy (data.constData(), data.constData() + data.size(), (char*) _values.data());
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef CALENHAD_BAKE_H
+#define CALENHAD_BAKE_H
+
+#include <memory>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <QtXml/QDomElement>
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+    }
+    namespace graph {
+        class ComputeGraph;
+
+        // A module's output evaluated once over the whole planet and kept, so that the modules downstream of a frozen
+        // module read it back from a raster instead of evaluating everything upstream of it again. Values are kept as
+        // floats in an equirectangular grid, twice as wide as it is high, row by row from the north, and are saved
+        // with the project. The hash of the graph it was made from tells when anything upstream has changed since.
+        //
+        // The shader's rasters are eight bit RGBA textures, read by raster () as the mean of the colour channels. To
+        // get more out of them than 256 levels, image () spreads each value over the three channels, so that their sum
+        // takes one of 766 levels between the bake's minimum and maximum; the graph scales it back from there.
+        class Bake {
+        public:
+            Bake();
+
+            // evaluate the graph's first layer at the centre of each cell of a grid height cells high, in parallel
+            static Bake make (const ComputeGraph& graph, const int& height);
+
+            // a column of a dataset sampled at the centre of each cell, interpolated between the corners of the triangle
+            // of the dataset's icosphere holding it, with the given hash. The bake keeps the dataset, for the CPU to
+            // sample directly (see ComputeRaster), and its range is the column's, so that covers every sample.
+            static Bake make (std::shared_ptr<calenhad::icosphere::Dataset> dataset, const QString& column, const int& height, const QByteArray& hash);
+
+            bool isValid () const;
+            int height () const;
+            int width () const;
+            float minimum () const;
+            float maximum () const;
+            const QVector<float>& values () const;
+            QByteArray hash () const;
+
+            // the dataset and column the bake was made from, if it was made from one
+            std::shared_ptr<const calenhad::icosphere::Dataset> dataset () const;
+            QString column () const;
+
+            // value at a point, interpolated between the cells around it
+            float value (const float& lon, const float& lat) const;
+
+            // the values encoded for raster () in a square RGBA8888 image, size pixels each way, covering the planet. The
+            // last image made is kept, since every graph built with the bake asks for it again; like those graphs, this is
+            // for the GUI thread only.
+            QImage image (const int& size) const;
+
+            // scale and bias that take raster ()'s output, in [-1, 1], back to the bake's values
+            float scale () const;
+            float bias () const;
+
+            void serialize (QDomDocument& doc, QDomElement& element) const;
+            bool inflate (const QDomElement& element);
+
+        protected:
+            int _height;
+            float _min, _max;
+            QVector<float> _values;
+            QByteArray _hash;
+            mutable QImage _image;
+            std::shared_ptr<const calenhad::icosphere::Dataset> _dataset;
+            QString _column;
+
+            void findRange ();
+        };
+    }
+}
+
+
+#endif //CALENHAD_BAKE_H
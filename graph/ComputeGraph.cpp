@@ -0,0 +1,650 @@
+#include "ComputeGraph.h"
+#include "RangeAnalysis.h"
+#include "Bake.h"
+#include <algorithm>
+#include <cmath>
+#include <CalenhadServices.h>
+#include <QtCore/QCryptographicHash>
+#include "preferences/preferences.h"
+#include "qmodule/Module.h"
+#include "qmodule/AltitudeMap.h"
+#include "qmodule/RasterModule.h"
+#include "qmodule/BiomeModule.h"
+#include "qmodule/NodeGroup.h"
+#include "nodeedit/Port.h"
+#include "nodeedit/Connection.h"
+#include "../legend/Legend.h"
+#include "../controls/altitudemap/AltitudeMapping.h"
+
+using namespace calenhad;
+using namespace calenhad::graph;
+using namespace calenhad::qmodule;
+using namespace calenhad::nodeedit;
+using namespace calenhad::legend;
+using namespace calenhad::controls::altitudemap;
+
+namespace {
+    // module type names from modules.xml; altitude maps and rasters are named in the preferences
+    const QMap<QString, ComputeOperation>& operations() {
+        static const QMap<QString, ComputeOperation> map = {
+            { "constant", OpConstant }, { "abs", OpAbs }, { "invert", OpInvert }, { "add", OpAdd }, { "max", OpMax },
+            { "min", OpMin }, { "multiply", OpMultiply }, { "power", OpPower }, { "diff", OpDiff }, { "blend", OpBlend },
+            { "translate", OpTranslate }, { "rotate", OpRotate }, { "scalepoint", OpScalePoint },
+            { "cylinders", OpCylinders }, { "spheres", OpSpheres }, { "clamp", OpClamp },
+            { "perlin", OpPerlin }, { "simplex", OpSimplex }, { "billow", OpBillow },
+            { "ridgedmultifractal", OpRidgedMulti }, { "scaleandbias", OpScaleAndBias }, { "select", OpSelect },
+            { "turbulence", OpTurbulence }, { "voronoi", OpVoronoi }
+        };
+        return map;
+    }
+
+    // makes step the affine transform which applies step, then m (row by row), then adds offset
+    void compose (ComputeWarpStep& step, const double* m, const double* offset) {
+        ComputeWarpStep result;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                result.matrix [r * 3 + c] = m [r * 3] * step.matrix [c] + m [r * 3 + 1] * step.matrix [3 + c] + m [r * 3 + 2] * step.matrix [6 + c];
+            }
+            result.offset [r] = m [r * 3] * step.offset [0] + m [r * 3 + 1] * step.offset [1] + m [r * 3 + 2] * step.offset [2] + offset [r];
+        }
+        step = result;
+    }
+}
+
+ComputeGraph::ComputeGraph (Module* module, const bool& thaw) : ComputeGraph (QList<Module*> { module }, thaw) {
+
+}
+
+ComputeGraph::ComputeGraph (const QList<Module*>& modules, const bool& thaw) : _pruned (0) {
+    if (thaw) {
+        _thawed = QSet<Module*>::fromList (modules);
+    }
+    for (Module* module : modules) {
+        _layerNames.append (module -> name());
+        _outputs.append (add (module));
+    }
+    _index.clear();
+    _thawed.clear();
+    _groups.clear();
+    if (modules.isEmpty()) {
+        _error = "No modules to evaluate";
+    }
+    if (_error.isEmpty()) {
+        prune();
+        makeFunctions();
+        makeWarps();
+        makeColorTable (modules.first());
+    } else {
+        _nodes.clear();
+        _outputs.clear();
+    }
+}
+
+ComputeGraph::~ComputeGraph() {
+
+}
+
+int ComputeGraph::add (Module* module) {
+    if (_index.contains (module)) { return _index.value (module); }
+    if (! _error.isEmpty()) { return -1; }
+
+    // a frozen module is read back from its bake, so nothing upstream of it is needed
+    const Bake* bake = _thawed.contains (module) ? nullptr : module -> bake();
+    if (bake) {
+        return addBake (module, *bake);
+    }
+
+    if (! module -> isComplete()) {
+        _error = "Module " + module -> name() + " is incomplete";
+        return -1;
+    }
+
+    ComputeNode node;
+    node.name = module -> name();
+    node.group = groupIndex (module);
+    QString type = module -> nodeType();
+    if (type == CalenhadServices::preferences() -> calenhad_module_altitudemap) {
+        node.operation = OpAltitudeMap;
+    } else if (type == CalenhadServices::preferences() -> calenhad_module_raster) {
+        node.operation = OpRaster;
+    } else if (type == CalenhadServices::preferences() -> calenhad_module_biome) {
+        node.operation = OpBiome;
+    } else if (operations().contains (type)) {
+        node.operation = operations().value (type);
+    } else {
+        _error = "Module " + module -> name() + " is of type " + type + ", which can't be evaluated on the CPU";
+        return -1;
+    }
+
+    // inputs first, so that nodes end up in dependency order
+    for (Port* port : module -> inputs()) {
+        ComputeInput input;
+        if (port -> connections().isEmpty()) {
+            input.value = (float) module -> parameterValue (port -> portName());
+        } else {
+            Module* source = dynamic_cast<Module*> (port -> connections() [0] -> otherEnd (port) -> owner());
+            input.node = source ? add (source) : -1;
+            if (input.node < 0) {
+                if (_error.isEmpty()) { _error = "Module " + module -> name() + " has an input which is not a module"; }
+                return -1;
+            }
+        }
+        node.inputs.append (input);
+    }
+
+    // the glsl templates give these modules' source as "$0" - a function, not a value - so it has to be connected
+    if (isCoordinateTransform (node.operation) && (node.inputs.isEmpty() || node.inputs.first().node < 0)) {
+        _error = "Module " + module -> name() + " has no source connected";
+        return -1;
+    }
+
+    for (const QString& param : parameterNames (node.operation)) {
+        node.parameters.append ((float) module -> parameterValue (param));
+    }
+
+    // constants written into the glsl template for ridged multifractal
+    if (node.operation == OpRidgedMulti) {
+        node.parameters << 1.0f << 1.0f << 2.0f << 2.0f;
+    }
+
+    if (node.operation == OpAltitudeMap) {
+        AltitudeMap* am = static_cast<AltitudeMap*> (module);
+        ComputeCurve curve;
+        for (const AltitudeMapping& entry : am -> entries()) {
+            curve.entries.append (QPointF (entry.x(), entry.y()));
+        }
+        if (curve.entries.isEmpty()) {
+            _error = "Altitude map " + module -> name() + " has no entries";
+            return -1;
+        }
+        curve.terrace = am -> curveFunction() == "terrace";
+        curve.inverted = am -> isFunctionInverted();
+        node.table = _curves.size();
+        _curves.append (curve);
+    }
+
+    if (node.operation == OpRaster) {
+        RasterModule* rm = static_cast<RasterModule*> (module);
+        ComputeRaster raster;
+        QImage* image = rm -> raster();
+        raster.image = image ? image -> convertToFormat (QImage::Format_RGBA8888) : QImage();
+        icosphere::Bounds bounds = rm -> bounds();
+        raster.north = (float) bounds.north();
+        raster.south = (float) bounds.south();
+        raster.east = (float) bounds.east();
+        raster.west = (float) bounds.west();
+        node.table = _rasters.size();
+        _rasters.append (raster);
+    }
+
+    if (node.operation == OpBiome) {
+        node.table = _biomes.size();
+        _biomes.append (biomeTable (static_cast<BiomeModule*> (module)));
+    }
+
+    _nodes.append (node);
+    _index.insert (module, _nodes.size() - 1);
+    return _nodes.size() - 1;
+}
+
+// The bake covers the whole planet and is opaque, so the raster's default value is never used. The image is made at the
+// size the shader's raster textures are, for the GPU; the CPU reads the bake's values, which share the bake's storage,
+// or a field's dataset.
+int ComputeGraph::addBake (Module* module, const Bake& bake) {
+    ComputeNode raster;
+    raster.operation = OpRaster;
+    raster.name = module -> name() + "_bake";
+    raster.inputs.append (ComputeInput());
+    raster.group = groupIndex (module);
+    ComputeRaster r;
+    r.image = bake.image (CalenhadServices::preferences() -> calenhad_globe_texture_height);
+    r.north = (float) (M_PI / 2);
+    r.south = (float) (- M_PI / 2);
+    r.east = (float) M_PI;
+    r.west = (float) - M_PI;
+    r.dataset = bake.dataset();
+    r.column = bake.column();
+    if (! r.dataset) { r.values = bake.values(); }
+    r.width = bake.width();
+    r.height = bake.height();
+    r.bias = bake.bias();
+    r.scale = bake.scale();
+    raster.table = _rasters.size();
+    _rasters.append (r);
+    _nodes.append (raster);
+
+    ComputeNode node;
+    node.operation = OpScaleAndBias;
+    node.name = module -> name();
+    node.group = raster.group;
+    ComputeInput source, scale, bias;
+    source.node = _nodes.size() - 1;
+    scale.value = bake.scale();
+    bias.value = bake.bias();
+    node.inputs << source << scale << bias;
+    _nodes.append (node);
+    _index.insert (module, _nodes.size() - 1);
+    return _nodes.size() - 1;
+}
+
+// Works out each node's range in dependency order. Where a node always gives one of its inputs, judged only by proven
+// bounds, the nodes that use it are connected straight to that input instead, or, if the input is a value rather than a
+// node, the node becomes a constant. Nothing refers to a node once it is cut out, so evaluators never reach it.
+void ComputeGraph::prune() {
+    QVector<int> forward (_nodes.size(), -1);
+    _ranges.resize (_nodes.size());
+    _proven.resize (_nodes.size());
+    for (int i = 0; i < _nodes.size(); i++) {
+        ComputeNode& node = _nodes [i];
+        QVector<Interval> inputs;
+        QVector<bool> proven;
+        _proven [i] = ! RangeAnalysis::isMeasured (node.operation);
+        for (ComputeInput& input : node.inputs) {
+            if (input.node >= 0 && forward [input.node] >= 0) {
+                input.node = forward [input.node];
+            }
+            inputs.append (input.node >= 0 ? _ranges.at (input.node) : Interval (input.value));
+            proven.append (input.node < 0 || _proven.at (input.node));
+            if (! proven.last()) { _proven [i] = false; }
+        }
+        _ranges [i] = RangeAnalysis::range (*this, node, inputs);
+
+        int k = RangeAnalysis::passThrough (node, inputs, proven);
+        if (k >= 0) {
+            ComputeInput kept = node.inputs.at (k);
+            _ranges [i] = inputs.at (k);
+            _proven [i] = proven.at (k);
+            if (kept.node >= 0) {
+                forward [i] = kept.node;
+            } else {
+                node.operation = OpConstant;
+                node.inputs.clear();
+                node.parameters = { kept.value };
+                node.table = -1;
+            }
+            _pruned++;
+        }
+    }
+    for (int& output : _outputs) {
+        if (forward [output] >= 0) { output = forward [output]; }
+    }
+}
+
+int ComputeGraph::groupIndex (Module* module) {
+    NodeGroup* group = module -> group();
+    if (! group) { return -1; }
+    int index = _groups.indexOf (group);
+    if (index < 0) {
+        index = _groups.size();
+        _groups.append (group);
+        _groupNames.append (group -> name());
+    }
+    return index;
+}
+
+// Finds the groups that can be functions, after pruning, since pruning can leave a group with a different shape. A
+// group's nodes must all be reached through its one output, so that a call has a single result, and any node of the
+// group evaluated at coordinates a transform in the group makes must take all its inputs from inside the group or
+// from port values, since anything from outside it is evaluated at the coordinates the group is called with.
+void ComputeGraph::makeFunctions() {
+    QVector<bool> live (_nodes.size(), false);
+    QVector<QVector<int>> users (_nodes.size());
+    for (int output : _outputs) { live [output] = true; }
+    for (int i = _nodes.size() - 1; i >= 0; i--) {
+        if (! live [i]) { continue; }
+        for (const ComputeInput& input : _nodes.at (i).inputs) {
+            if (input.node >= 0) {
+                live [input.node] = true;
+                users [input.node].append (i);
+            }
+        }
+    }
+
+    QMap<QString, int> signatures;
+    for (int g = 0; g < _groupNames.size(); g++) {
+        int output = -1, size = 0;
+        bool ok = true;
+        for (int i = 0; i < _nodes.size() && ok; i++) {
+            if (! live [i] || _nodes.at (i).group != g) { continue; }
+            size++;
+            bool used = _outputs.contains (i);
+            for (int user : users.at (i)) {
+                used |= _nodes.at (user).group != g;
+            }
+            if (used) {
+                ok = output < 0;
+                output = i;
+            }
+        }
+        // a function of a single node would only call the node's own function
+        if (! ok || output < 0 || size < 2) { continue; }
+
+        ComputeCall call;
+        QVector<QPair<int, int>> arguments;
+        QString signature;
+        QMap<int, int> positions;
+        gather (g, output, call, arguments, signature, positions);
+
+        // nodes at transformed coordinates: everything upstream of a transform's source inside the group
+        QVector<int> transformed;
+        for (int i : call.nodes) {
+            if (isCoordinateTransform (_nodes.at (i).operation)) { transformed.append (_nodes.at (i).inputs.first().node); }
+        }
+        QSet<int> seen;
+        while (ok && ! transformed.isEmpty()) {
+            int i = transformed.takeLast();
+            if (seen.contains (i)) { continue; }
+            seen.insert (i);
+            ok = _nodes.at (i).group == g;
+            for (const ComputeInput& input : _nodes.at (i).inputs) {
+                if (input.node >= 0) { transformed.append (input.node); }
+            }
+        }
+        if (! ok) { continue; }
+
+        call.function = signatures.value (signature, -1);
+        if (call.function < 0) {
+            call.function = _functions.size();
+            signatures.insert (signature, call.function);
+            ComputeFunction function;
+            function.name = _groupNames.at (g);
+            function.nodes = call.nodes;
+            function.arguments = arguments;
+            _functions.append (function);
+        }
+        _callAt.insert (output, _calls.size());
+        _calls.append (call);
+    }
+}
+
+// Follows each chain of transforms with fixed settings upstream from its last transform, building its warp, where the
+// chain fuses at least two of them. Transforms part way along a chain, used only by the next one, get no warp of their
+// own. The rotation is the same one as rotate () in the shader: about z, then y, then x, by angles in degrees.
+void ComputeGraph::makeWarps() {
+    QSet<int> called;
+    for (const ComputeCall& call : _calls) {
+        for (int i : call.nodes) { called.insert (i); }
+    }
+    auto fixed = [this, &called] (const int& i) {
+        if (i < 0 || called.contains (i) || ! isCoordinateTransform (_nodes.at (i).operation)) { return false; }
+        for (int k = 1; k < _nodes.at (i).inputs.size(); k++) {
+            if (_nodes.at (i).inputs.at (k).node >= 0) { return false; }
+        }
+        return _nodes.at (i).inputs.size() >= 4;
+    };
+
+    // a transform used by anything but another fixed transform, or which is an output, ends a chain
+    QVector<bool> last (_nodes.size(), false);
+    for (int output : _outputs) { last [output] = true; }
+    for (int i = 0; i < _nodes.size(); i++) {
+        for (int k = 0; k < _nodes.at (i).inputs.size(); k++) {
+            int input = _nodes.at (i).inputs.at (k).node;
+            if (input >= 0 && (k > 0 || ! fixed (i))) { last [input] = true; }
+        }
+    }
+
+    for (int i = 0; i < _nodes.size(); i++) {
+        if (! fixed (i) || ! last.at (i) || ! fixed (_nodes.at (i).inputs.first().node)) { continue; }
+        ComputeWarp warp;
+        int t = i;
+        while (fixed (t)) {
+            const ComputeNode& node = _nodes.at (t);
+            double v [3] = { node.inputs.at (1).value, node.inputs.at (2).value, node.inputs.at (3).value };
+            const double zero [3] = { 0.0, 0.0, 0.0 };
+            if (node.operation == OpTurbulence) {
+                ComputeWarpStep step;
+                step.turbulence = t;
+                warp.steps.append (step);
+            } else {
+                if (warp.steps.isEmpty() || warp.steps.last().turbulence >= 0) {
+                    warp.steps.append (ComputeWarpStep());
+                }
+                ComputeWarpStep& step = warp.steps.last();
+                if (node.operation == OpTranslate) {
+                    const double identity [9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+                    compose (step, identity, v);
+                } else if (node.operation == OpScalePoint) {
+                    const double scale [9] = { v [0], 0.0, 0.0, 0.0, v [1], 0.0, 0.0, 0.0, v [2] };
+                    compose (step, scale, zero);
+                } else {
+                    double cz = std::cos (v [2] * M_PI / 180.0), sz = std::sin (v [2] * M_PI / 180.0);
+                    double cy = std::cos (v [1] * M_PI / 180.0), sy = std::sin (v [1] * M_PI / 180.0);
+                    double cx = std::cos (v [0] * M_PI / 180.0), sx = std::sin (v [0] * M_PI / 180.0);
+                    const double rz [9] = { cz, - sz, 0.0, sz, cz, 0.0, 0.0, 0.0, 1.0 };
+                    const double ry [9] = { cy, 0.0, sy, 0.0, 1.0, 0.0, - sy, 0.0, cy };
+                    const double rx [9] = { 1.0, 0.0, 0.0, 0.0, cx, - sx, 0.0, sx, cx };
+                    compose (step, rz, zero);
+                    compose (step, ry, zero);
+                    compose (step, rx, zero);
+                }
+            }
+            t = node.inputs.first().node;
+        }
+        warp.source = t;
+        _warpAt.insert (i, _warps.size());
+        _warps.append (warp);
+    }
+}
+
+// Visits the group's nodes upstream of a node, depth first, numbering them as they are found and describing each one,
+// so that groups of the same shape and settings are described in the same way whatever nodes they are made of. An
+// input from outside the group becomes an argument, described only by whether it is a node or a value.
+void ComputeGraph::gather (const int& group, const int& index, ComputeCall& call, QVector<QPair<int, int>>& arguments, QString& signature, QMap<int, int>& positions) const {
+    const ComputeNode& node = _nodes.at (index);
+    int position = call.nodes.size();
+    positions.insert (index, position);
+    call.nodes.append (index);
+    signature += "(" + QString::number (node.operation) + " [";
+    for (float p : node.parameters) {
+        signature += QString::number (p, 'g', 9) + " ";
+    }
+    signature += "]" + tableDescription (node);
+    if (node.operation == OpRaster) {
+        signature += " raster " + QString::number (node.table);
+    }
+    for (int k = 0; k < node.inputs.size(); k++) {
+        const ComputeInput& input = node.inputs.at (k);
+        if (input.node >= 0 && _nodes.at (input.node).group == group) {
+            if (positions.contains (input.node)) {
+                signature += " @" + QString::number (positions.value (input.node));
+            } else {
+                signature += " ";
+                gather (group, input.node, call, arguments, signature, positions);
+            }
+        } else {
+            signature += input.node >= 0 ? " node" : " value";
+            arguments.append (QPair<int, int> (position, k));
+            call.arguments.append (input);
+        }
+    }
+    signature += ")";
+}
+
+void ComputeGraph::makeColorTable (Module* module) {
+    int size = std::max (2, (int) CalenhadServices::preferences() -> calenhad_colormap_buffersize);
+    _colors.resize (size);
+    Legend* legend = module -> legend();
+    for (int i = 0; i < size; i++) {
+        _colors [i] = legend ? legend -> lookup (-1.0 + 2.0 * i / (size - 1)).rgba() : qRgba (0, 0, 0, 255);
+    }
+}
+
+QRgb ComputeGraph::color (const float& value) const {
+    if (_colors.isEmpty() || std::isnan (value)) { return qRgba (0, 0, 0, 255); }
+    float index = std::min (std::max ((value + 1.0f) / 2.0f, 0.0f), 1.0f) * (_colors.size() - 1);
+    int i0 = (int) index;
+    int i1 = std::min (i0 + 1, _colors.size() - 1);
+    float alpha = index - i0;
+    QRgb c0 = _colors [i0], c1 = _colors [i1];
+    return qRgba ((int) (qRed (c0) + (qRed (c1) - qRed (c0)) * alpha),
+                  (int) (qGreen (c0) + (qGreen (c1) - qGreen (c0)) * alpha),
+                  (int) (qBlue (c0) + (qBlue (c1) - qBlue (c0)) * alpha),
+                  255);
+}
+
+bool ComputeGraph::isValid() const {
+    return _error.isEmpty() && ! _outputs.isEmpty();
+}
+
+QString ComputeGraph::error() const {
+    return _error;
+}
+
+QString ComputeGraph::moduleName() const {
+    return _layerNames.value (0);
+}
+
+QStringList ComputeGraph::layerNames() const {
+    return _layerNames;
+}
+
+const QVector<ComputeNode>& ComputeGraph::nodes() const {
+    return _nodes;
+}
+
+int ComputeGraph::output() const {
+    return _outputs.value (0, -1);
+}
+
+const QVector<int>& ComputeGraph::outputs() const {
+    return _outputs;
+}
+
+int ComputeGraph::layerCount() const {
+    return _outputs.size();
+}
+
+const ComputeCurve& ComputeGraph::curve (const int& index) const {
+    return _curves.at (index);
+}
+
+const ComputeRaster& ComputeGraph::raster (const int& index) const {
+    return _rasters.at (index);
+}
+
+int ComputeGraph::rasterCount() const {
+    return _rasters.size();
+}
+
+const ComputeBiome& ComputeGraph::biome (const int& index) const {
+    return _biomes.at (index);
+}
+
+const Interval& ComputeGraph::range (const int& node) const {
+    return _ranges.at (node);
+}
+
+bool ComputeGraph::isProven (const int& node) const {
+    return _proven.at (node);
+}
+
+Interval ComputeGraph::layerRange (const int& layer) const {
+    return layer >= 0 && layer < _outputs.size() ? _ranges.at (_outputs.at (layer)) : Interval::unbounded();
+}
+
+int ComputeGraph::prunedCount() const {
+    return _pruned;
+}
+
+const QVector<ComputeFunction>& ComputeGraph::functions() const {
+    return _functions;
+}
+
+const QVector<ComputeCall>& ComputeGraph::calls() const {
+    return _calls;
+}
+
+int ComputeGraph::callAt (const int& node) const {
+    return _callAt.value (node, -1);
+}
+
+const QVector<ComputeWarp>& ComputeGraph::warps() const {
+    return _warps;
+}
+
+int ComputeGraph::warpAt (const int& node) const {
+    return _warpAt.value (node, -1);
+}
+
+ComputeBiome ComputeGraph::biomeTable (BiomeModule* module) {
+    ComputeBiome biome;
+    for (double h : module -> table().heights()) { biome.heights.append ((float) h); }
+    for (double m : module -> table().moistures()) { biome.moistures.append ((float) m); }
+    biome.values = module -> cellValues();
+    return biome;
+}
+
+QStringList ComputeGraph::parameterNames (const ComputeOperation& operation) {
+    switch (operation) {
+        case OpConstant: return { "value" };
+        case OpPerlin:
+        case OpSimplex:
+        case OpBillow:
+        case OpRidgedMulti: return { "octaves", "seed" };
+        case OpSelect: return { "lowerBound", "upperBound", "falloff" };
+        case OpTurbulence: return { "seed" };
+        case OpVoronoi: return { "scale", "seed" };
+        default: return { };
+    }
+}
+
+bool ComputeGraph::isCoordinateTransform (const ComputeOperation& operation) {
+    return operation == OpTranslate || operation == OpRotate || operation == OpScalePoint || operation == OpTurbulence;
+}
+
+QString ComputeGraph::description() const {
+    QString text;
+    for (int i = 0; i < _nodes.size(); i++) {
+        const ComputeNode& node = _nodes.at (i);
+        text += QString::number (i) + " " + node.name + " op " + QString::number (node.operation) + " (";
+        for (const ComputeInput& input : node.inputs) {
+            text += input.node >= 0 ? "#" + QString::number (input.node) : QString::number (input.value, 'g', 9);
+            text += " ";
+        }
+        text += ") [";
+        for (float p : node.parameters) {
+            text += QString::number (p, 'g', 9) + " ";
+        }
+        text += "]" + tableDescription (node) + "\n";
+    }
+    text += "output";
+    for (int output : _outputs) {
+        text += " " + QString::number (output);
+    }
+    text += "\n";
+    return text;
+}
+
+// a curve or biome table is described by its contents
+QString ComputeGraph::tableDescription (const ComputeNode& node) const {
+    QString text;
+    if (node.operation == OpAltitudeMap) {
+        const ComputeCurve& curve = _curves.at (node.table);
+        text += curve.terrace ? " terrace" : " spline";
+        text += curve.inverted ? " inverted" : "";
+        for (const QPointF& e : curve.entries) {
+            text += " " + QString::number (e.x(), 'g', 9) + "," + QString::number (e.y(), 'g', 9);
+        }
+    }
+    if (node.operation == OpBiome) {
+        const ComputeBiome& biome = _biomes.at (node.table);
+        for (const QVector<float>* list : { &biome.heights, &biome.moistures, &biome.values }) {
+            text += " :";
+            for (float v : *list) {
+                text += " " + QString::number (v, 'g', 9);
+            }
+        }
+    }
+    return text;
+}
+
+QByteArray ComputeGraph::hash() const {
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    hash.addData (description().toUtf8());
+    for (const ComputeRaster& raster : _rasters) {
+        hash.addData ((const char*) raster.image.constBits(), raster.image.byteCount());
+        hash.addData ((const char*) raster.values.constData(), raster.values.size() * (int) sizeof (float));
+        hash.addData (QString ("%1 %2 %3 %4 %5").arg (raster.north).arg (raster.south).arg (raster.east).arg (raster.west).arg (raster.column).toUtf8());
+    }
+    return hash.result().toHex();
+}
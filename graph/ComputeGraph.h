@@ -0,0 +1,227 @@
+#ifndef CALENHAD_COMPUTEGRAPH_H
+#define CALENHAD_COMPUTEGRAPH_H
+
+#include <memory>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QMap>
+#include <QtCore/QSet>
+#include <QtCore/QPointF>
+#include <QtCore/QPair>
+#include <QtGui/QImage>
+#include "Interval.h"
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+    }
+    namespace qmodule {
+        class Module;
+        class BiomeModule;
+        class NodeGroup;
+    }
+    namespace graph {
+        class Bake;
+
+        // The module types that can be evaluated away from the GPU. Each one corresponds to a module in modules.xml
+        // and does exactly what that module's glsl template does in map_cs.glsl.
+        enum ComputeOperation {
+            OpConstant, OpAbs, OpInvert, OpAdd, OpMax, OpMin, OpMultiply, OpPower, OpDiff, OpBlend,
+            OpTranslate, OpRotate, OpScalePoint, OpCylinders, OpSpheres, OpClamp,
+            OpPerlin, OpSimplex, OpBillow, OpRidgedMulti, OpScaleAndBias, OpSelect, OpTurbulence, OpVoronoi,
+            OpAltitudeMap, OpRaster, OpBiome
+        };
+
+        // An input to a compute node: either the output of another node (by its index in the graph) or, where the
+        // port is not connected, the module's value for that port.
+        struct ComputeInput {
+            int node = -1;
+            float value = 0.0f;
+        };
+
+        // One module in a compute graph. Parameters are the module's non-port values, in the order given by
+        // ComputeGraph::parameterNames for the operation. Table indexes the graph's curves for an altitude map, its
+        // rasters for a raster module or its biome tables for a biome module. Group numbers the node group the module
+        // belongs to, if any, in the order the graph came across them.
+        struct ComputeNode {
+            ComputeOperation operation;
+            QString name;
+            QVector<ComputeInput> inputs;
+            QVector<float> parameters;
+            int table = -1;
+            int group = -1;
+        };
+
+        // The mapping curve of an altitude map module.
+        struct ComputeCurve {
+            QVector<QPointF> entries;
+            bool terrace = false;
+            bool inverted = false;
+        };
+
+        // A raster module's image and bounds (in radians). For a frozen module, values holds its bake (see Bake) at the
+        // bake's own resolution, width by height, which the CPU reads in full precision in place of the image; the image
+        // is only for the GPU. Subtracting bias and dividing by scale takes the values to the image's [-1, 1]. A field's
+        // bake (see FieldModule) has no values: the CPU samples the column of the dataset it was made from instead,
+        // between the corners of the triangle holding each point, so nothing is lost to the grid.
+        struct ComputeRaster {
+            QImage image;
+            float north, south, east, west;
+            QVector<float> values;
+            std::shared_ptr<const calenhad::icosphere::Dataset> dataset;
+            QString column;
+            int width = 0, height = 0;
+            float bias = 0.0f, scale = 1.0f;
+        };
+
+        // A biome module's table: the boundaries between its height bands and between its moisture bands, and the
+        // module's output in each cell, row by row from the lowest height band. A value on a boundary belongs to the
+        // band above it.
+        struct ComputeBiome {
+            QVector<float> heights;
+            QVector<float> moistures;
+            QVector<float> values;
+        };
+
+        // A node group which the graph can evaluate as a function of the point and of the group's arguments: the inputs
+        // its modules take from outside the group, whether from other modules or from the values of unconnected ports.
+        // Nodes holds the group's nodes in the order the function is written, starting with its output, as they are
+        // in the first call; arguments gives the node (by position in nodes) and input that each argument feeds.
+        struct ComputeFunction {
+            QString name;
+            QVector<int> nodes;
+            QVector<QPair<int, int>> arguments;
+        };
+
+        // One instance of a function: its nodes, which correspond one for one with the function's, and the inputs
+        // it is called with. The first of the nodes is the output, so it is where the call's result is used.
+        struct ComputeCall {
+            int function;
+            QVector<int> nodes;
+            QVector<ComputeInput> arguments;
+        };
+
+        // One step of a warp: either an affine transform of the point, p' = matrix p + offset with the matrix row by
+        // row, or the turbulence module given by turbulence, which displaces the point by noise.
+        struct ComputeWarpStep {
+            double matrix [9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+            double offset [3] = { 0.0, 0.0, 0.0 };
+            int turbulence = -1;
+        };
+
+        // A chain of transforms with fixed settings, applied to points from its source: each run of translations,
+        // rotations and point scales is one affine step, and each turbulence a step of its own.
+        struct ComputeWarp {
+            int source;
+            QVector<ComputeWarpStep> steps;
+        };
+
+        // A snapshot of a module and everything upstream of it as plain data, independent of the widgets. Graph turns
+        // a module into GLSL for the GPU; ComputeGraph is the equivalent for code that evaluates a module on the CPU
+        // or in another thread. It must be built on the GUI thread, but once built it is never modified, so any
+        // number of threads can read it at once, and it stays valid when the modules are edited or deleted.
+        //
+        // A frozen module (see Bake) is a raster node reading its bake, unless it is one the graph is made thawed for.
+        // Every node has bounds (see RangeAnalysis); a node which proven bounds show always gives one input is cut out.
+        // Node groups of the same shape and settings share one function (see ComputeFunction).
+        // Outside functions, a chain of two or more transforms with fixed settings is a warp (see ComputeWarp).
+        class ComputeGraph {
+        public:
+            ComputeGraph (calenhad::qmodule::Module* module, const bool& thaw = false);
+
+            // several modules evaluated together, as layers of the same points. Anything upstream of more than one of
+            // them appears in the graph only once, so it is evaluated once per point for all of the layers.
+            ComputeGraph (const QList<calenhad::qmodule::Module*>& modules, const bool& thaw = false);
+            ~ComputeGraph();
+
+            // false if the module or one of its inputs is incomplete or of a type the CPU can't evaluate
+            bool isValid () const;
+            QString error () const;
+            QString moduleName () const;
+            QStringList layerNames () const;
+
+            // nodes are in dependency order: every node comes after the nodes which feed its inputs
+            const QVector<ComputeNode>& nodes () const;
+            int output () const;
+
+            // the node for each layer; the first layer is output()
+            const QVector<int>& outputs () const;
+            int layerCount () const;
+            const ComputeCurve& curve (const int& index) const;
+            const ComputeRaster& raster (const int& index) const;
+            int rasterCount () const;
+            const ComputeBiome& biome (const int& index) const;
+
+            // bounds for a node's output, and for a layer's
+            const Interval& range (const int& node) const;
+            Interval layerRange (const int& layer = 0) const;
+
+            // whether a node's bounds follow from its parameters alone, rather than from the measured extremes of some
+            // noise generator upstream of it (see RangeAnalysis::isMeasured)
+            bool isProven (const int& node) const;
+
+            // number of nodes cut out because they always give the same one of their inputs
+            int prunedCount () const;
+
+            const QVector<ComputeFunction>& functions () const;
+            const QVector<ComputeCall>& calls () const;
+
+            // the call whose output is the given node, or -1 if there is none
+            int callAt (const int& node) const;
+
+            const QVector<ComputeWarp>& warps () const;
+
+            // the warp starting at the given node, or -1 if there is none
+            int warpAt (const int& node) const;
+
+            static ComputeBiome biomeTable (calenhad::qmodule::BiomeModule* module);
+
+            // colour for a value in the (first) module's legend, in the same way as findColor in the shader
+            QRgb color (const float& value) const;
+
+            // identifies the graph's structure and values, so that anything derived from a graph can be reused
+            // for an identical one
+            QByteArray hash () const;
+            QString description () const;
+
+            static QStringList parameterNames (const ComputeOperation& operation);
+            static bool isCoordinateTransform (const ComputeOperation& operation);
+
+        protected:
+            int add (calenhad::qmodule::Module* module);
+            int addBake (calenhad::qmodule::Module* module, const Bake& bake);
+            void makeColorTable (calenhad::qmodule::Module* module);
+            void prune ();
+            int groupIndex (calenhad::qmodule::Module* module);
+            void makeFunctions ();
+            void makeWarps ();
+            void gather (const int& group, const int& index, ComputeCall& call, QVector<QPair<int, int>>& arguments, QString& signature, QMap<int, int>& positions) const;
+            QString tableDescription (const ComputeNode& node) const;
+
+            QStringList _layerNames;
+            QString _error;
+            QVector<ComputeNode> _nodes;
+            QVector<ComputeCurve> _curves;
+            QVector<ComputeRaster> _rasters;
+            QVector<ComputeBiome> _biomes;
+            QVector<QRgb> _colors;
+            QMap<calenhad::qmodule::Module*, int> _index;
+            QSet<calenhad::qmodule::Module*> _thawed;
+            QVector<calenhad::qmodule::NodeGroup*> _groups;
+            QStringList _groupNames;
+            QVector<ComputeFunction> _functions;
+            QVector<ComputeCall> _calls;
+            QMap<int, int> _callAt;
+            QVector<ComputeWarp> _warps;
+            QMap<int, int> _warpAt;
+            QVector<int> _outputs;
+            QVector<Interval> _ranges;
+            QVector<bool> _proven;
+            int _pruned;
+        };
+    }
+}
+
+
+#endif //CALENHAD_COMPUTEGRAPH_H
@@ -0,0 +1,148 @@
+#include "CostModel.h"
+#include <cmath>
+
+using namespace calenhad::graph;
+
+CostModel::CostModel (const ComputeGraph* graph) : _graph (graph), _perPoint (0.0) {
+    if (! _graph -> isValid()) { return; }
+    const QVector<ComputeNode>& nodes = _graph -> nodes();
+    int n = nodes.size();
+    _costs.resize (n);
+    for (int i = 0; i < n; i++) {
+        _costs [i] = operationCost (*_graph, nodes.at (i));
+    }
+
+    // The nodes evaluated at a set of coordinates are those reachable from the roots without passing into the source
+    // of a coordinate transform; each transform reached starts a new set of coordinates of its own, evaluating its
+    // source and everything upstream of it again. The counts for a transform's coordinates depend only on the
+    // transform, and nodes come in dependency order, so they can be worked out from the first node up.
+    auto frame = [&nodes, n] (const QVector<int>& roots, const QMap<int, QVector<double>>& transforms) {
+        QVector<double> counts (n, 0.0);
+        QVector<bool> reached (n, false);
+        QVector<int> stack = roots;
+        while (! stack.isEmpty()) {
+            int i = stack.last();
+            stack.removeLast();
+            if (i < 0 || reached [i]) { continue; }
+            reached [i] = true;
+            counts [i] += 1.0;
+            const ComputeNode& node = nodes.at (i);
+            bool transform = ComputeGraph::isCoordinateTransform (node.operation);
+            for (int k = transform ? 1 : 0; k < node.inputs.size(); k++) {
+                stack.append (node.inputs.at (k).node);
+            }
+            auto inner = transforms.find (i);
+            if (transform && inner != transforms.end()) {
+                for (int j = 0; j < n; j++) { counts [j] += inner.value() [j]; }
+            }
+        }
+        return counts;
+    };
+
+    QMap<int, QVector<double>> transforms;
+    for (int i = 0; i < n; i++) {
+        const ComputeNode& node = nodes.at (i);
+        if (ComputeGraph::isCoordinateTransform (node.operation) && ! node.inputs.isEmpty()) {
+            transforms.insert (i, frame (QVector<int> { node.inputs.first().node }, transforms));
+        }
+    }
+    _evaluations = frame (_graph -> outputs(), transforms);
+
+    for (int i = 0; i < n; i++) {
+        _perPoint += share (i);
+    }
+}
+
+double CostModel::perPoint() const {
+    return _perPoint;
+}
+
+double CostModel::nodeCost (const int& node) const {
+    return node >= 0 && node < _costs.size() ? _costs [node] : 0.0;
+}
+
+double CostModel::evaluations (const int& node) const {
+    return node >= 0 && node < _evaluations.size() ? _evaluations [node] : 0.0;
+}
+
+double CostModel::share (const int& node) const {
+    return nodeCost (node) * evaluations (node);
+}
+
+QString CostModel::description() const {
+    return describe (_perPoint);
+}
+
+QString CostModel::describe (const double& perPoint) {
+    return QString::number (perPoint, 'g', perPoint < 10.0 ? 2 : 3) + " noise calls per point";
+}
+
+// Weights are relative to one call to snoise. Classic (Perlin) noise visits 16 lattice corners where simplex noise
+// visits 5, and cellular noise works out distances to 27 feature points; everything else is a few arithmetic
+// operations, which are cheap by comparison but add up in large graphs.
+double CostModel::operationCost (const ComputeGraph& graph, const ComputeNode& node) {
+    const double Simplex = 1.0, Classic = 1.6, Cellular = 3.0, Arithmetic = 0.02, Transcendental = 0.1;
+    const QVector<float>& p = node.parameters;
+    auto octaves = [&p] () { return p.isEmpty() ? 0.0 : std::max (0.0, (double) p [0]); };
+
+    switch (node.operation) {
+        case OpConstant: return 0.0;
+        case OpAbs:
+        case OpInvert:
+        case OpAdd:
+        case OpMax:
+        case OpMin:
+        case OpMultiply:
+        case OpDiff:
+        case OpClamp:
+        case OpScaleAndBias:
+        case OpTranslate:
+        case OpScalePoint: return Arithmetic;
+        case OpBlend: return 2 * Arithmetic;
+        case OpSelect: return 4 * Arithmetic;
+        case OpPower: return Transcendental;
+        case OpRotate: {
+            // with fixed angles, the rotation is worked into a warp's matrix (see ComputeWarp) and costs a multiply
+            for (int k = 1; k < node.inputs.size(); k++) {
+                if (node.inputs.at (k).node >= 0) { return 6 * Transcendental; }
+            }
+            return 3 * Arithmetic;
+        }
+        case OpCylinders:
+        case OpSpheres: return 4 * Arithmetic;
+        case OpPerlin:
+        case OpSimplex: return octaves() * Simplex;
+        case OpBillow: return octaves() * Classic;
+        case OpRidgedMulti: return std::min (octaves(), 30.0) * (Classic + 2 * Transcendental) + 30 * Transcendental;
+        case OpVoronoi: return Cellular;
+        case OpTurbulence: {
+            // three noise calls, each with as many octaves as the roughness, which may come from another module
+            double roughness = 0.0;
+            if (node.inputs.size() > 3) {
+                const ComputeInput& input = node.inputs.at (3);
+                Interval range = input.node >= 0 ? graph.range (input.node) : Interval (input.value);
+                roughness = range.isBounded() ? std::max (0.0, range.hi) : 30.0;
+            }
+            return 3 * std::min (roughness, 30.0) * Simplex;
+        }
+        case OpAltitudeMap: return Arithmetic * (5 + (node.table >= 0 ? graph.curve (node.table).entries.size() : 0));
+        case OpRaster: return 5 * Transcendental;
+        case OpBiome: return 4 * Arithmetic;
+        default: return Arithmetic;
+    }
+}
+
+int CostModel::tileSize (const double& perPoint, const int& preferred) {
+    int size = preferred;
+    if (perPoint > ReferenceCost) {
+        size = (int) (preferred * std::sqrt (ReferenceCost / perPoint));
+    }
+    return std::max (32, std::min (preferred, size / 32 * 32));
+}
+
+int CostModel::workers (const double& total, const int& tiles, const double& throughput, const int& maximum) {
+    int most = std::max (1, std::min (maximum, tiles));
+    if (throughput <= 0.0) { return most; }
+    double seconds = total / throughput;
+    return std::max (1, std::min (most, (int) (seconds / WorkerStartup)));
+}
@@ -0,0 +1,67 @@
+#ifndef CALENHAD_COSTMODEL_H
+#define CALENHAD_COSTMODEL_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include "ComputeGraph.h"
+
+namespace calenhad {
+    namespace graph {
+
+        // Estimates what a ComputeGraph costs to evaluate at each point, without evaluating it. Each node has a weight
+        // for the work one evaluation of it does, in units of one call to 4D simplex noise: a fractal costs one unit per
+        // octave (more for Perlin's gradient noise), a voronoi module its 27 cells, turbulence its three extra noise
+        // calls, a raster its texture fetch, and arithmetic next to nothing. Since a node shared by several others is
+        // evaluated once (see ComputeGraph), it is counted once; but whatever lies upstream of a coordinate transform
+        // is evaluated again at the transformed point, so it is counted again for each transform it is reached through.
+        //
+        // Select, blend, max and min are counted with all of their inputs, so for graphs which use them the estimate is
+        // an upper bound (see CpuEvaluator). The weights are relative costs on a GPU or a CPU alike, not timings;
+        // to turn an estimate into seconds, multiply by a throughput measured on the machine doing the work.
+        class CostModel {
+        public:
+            CostModel (const ComputeGraph* graph);
+
+            // cost of evaluating all of the graph's layers at one point
+            double perPoint () const;
+
+            // cost of one evaluation of a node, not counting its inputs
+            double nodeCost (const int& node) const;
+
+            // number of times a node is evaluated for each point
+            double evaluations (const int& node) const;
+
+            // cost per point which the node accounts for, over all of its evaluations
+            double share (const int& node) const;
+
+            // the estimate as text for display, such as "12.5 noise calls per point"
+            QString description () const;
+            static QString describe (const double& perPoint);
+
+            static double operationCost (const ComputeGraph& graph, const ComputeNode& node);
+
+            // Side of a square tile (a multiple of 32, for the compute shader's work groups) for rendering a graph costing
+            // perPoint, so that a tile takes about as long as one of size preferred would for a graph of ReferenceCost.
+            // Expensive graphs get smaller tiles so that no single dispatch runs for long enough to stall the display
+            // or trip the driver's watchdog, and so that the work spreads more evenly across workers.
+            static int tileSize (const double& perPoint, const int& preferred);
+
+            // Number of workers worth starting for a job costing total, in tiles, given a throughput (cost per second for
+            // one worker): enough for the job to be done in time, but none that would spend longer starting up than
+            // rendering.
+            static int workers (const double& total, const int& tiles, const double& throughput, const int& maximum);
+
+            static constexpr double ReferenceCost = 16.0;
+            static constexpr double WorkerStartup = 2.0;
+
+        protected:
+            const ComputeGraph* _graph;
+            QVector<double> _costs;
+            QVector<double> _evaluations;
+            double _perPoint;
+        };
+    }
+}
+
+
+#endif //CALENHAD_COSTMODEL_H
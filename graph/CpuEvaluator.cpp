@@ -0,0 +1,567 @@
+#include "CpuEvaluator.h"
+#include "CpuFunctions.h"
+#include "CpuPrecise.h"
+#include "../icosphere/Dataset.h"
+
+using namespace calenhad::graph;
+using namespace calenhad::graph::cpu;
+
+namespace {
+    template <class Frame> pvec3 point (const Frame& frame, const size_t& i) {
+        pvec3 offset (vec3 (frame.xyz [i * 3], frame.xyz [i * 3 + 1], frame.xyz [i * 3 + 2]));
+        return frame.precise ? pvec3 (frame.origin [0], frame.origin [1], frame.origin [2]) + offset : offset;
+    }
+
+    // a warp's matrices and offsets, twelve numbers to a step, in the precision the points are in
+    template <class T> std::vector<T> matrices (const ComputeWarp& warp) {
+        std::vector<T> result;
+        for (const ComputeWarpStep& step : warp.steps) {
+            result.insert (result.end(), step.matrix, step.matrix + 9);
+            result.insert (result.end(), step.offset, step.offset + 3);
+        }
+        return result;
+    }
+
+    template <class V, class T> V warped (const ComputeGraph& graph, const ComputeWarp& warp, const std::vector<T>& matrices, V p) {
+        for (int s = 0; s < warp.steps.size(); s++) {
+            int t = warp.steps.at (s).turbulence;
+            if (t >= 0) {
+                const ComputeNode& node = graph.nodes().at (t);
+                p = turbulence (p, node.inputs.at (1).value, node.inputs.at (2).value, (int) node.inputs.at (3).value, (int) node.parameters [0]);
+            } else {
+                p = affine (p, matrices.data() + s * 12, matrices.data() + s * 12 + 9);
+            }
+        }
+        return p;
+    }
+}
+
+CpuEvaluator::CpuEvaluator (const ComputeGraph* graph) : _graph (graph) {
+
+}
+
+CpuEvaluator::~CpuEvaluator() {
+
+}
+
+const ComputeGraph* CpuEvaluator::graph() const {
+    return _graph;
+}
+
+float CpuEvaluator::evaluate (const float& x, const float& y, const float& z) const {
+    float xyz [3] = { x, y, z };
+    float out;
+    evaluate (xyz, &out, 1);
+    return out;
+}
+
+void CpuEvaluator::evaluateGeolocations (const float* lonlat, float* out, const size_t& n) const {
+    std::vector<float> xyz (std::min (n, BatchSize) * 3);
+    for (size_t start = 0; start < n; start += BatchSize) {
+        size_t count = std::min (BatchSize, n - start);
+        for (size_t i = 0; i < count; i++) {
+            vec3 c = toCartesian (lonlat [(start + i) * 2], lonlat [(start + i) * 2 + 1]);
+            xyz [i * 3] = c.x;
+            xyz [i * 3 + 1] = c.y;
+            xyz [i * 3 + 2] = c.z;
+        }
+        evaluate (xyz.data(), out + start, count);
+    }
+}
+
+void CpuEvaluator::evaluate (const float* xyz, float* out, const size_t& n) const {
+    if (! _graph -> isValid()) {
+        std::fill (out, out + n, 0.0f);
+        return;
+    }
+    for (size_t start = 0; start < n; start += BatchSize) {
+        Frame frame;
+        frame.xyz = xyz + start * 3;
+        frame.n = std::min (BatchSize, n - start);
+        frame.values.resize (_graph -> nodes().size());
+        const float* result = value (frame, _graph -> output());
+        std::copy (result, result + frame.n, out + start);
+    }
+}
+
+void CpuEvaluator::evaluate (const double* origin, const float* offsets, float* out, const size_t& n) const {
+    if (! _graph -> isValid()) {
+        std::fill (out, out + n, 0.0f);
+        return;
+    }
+    for (size_t start = 0; start < n; start += BatchSize) {
+        Frame frame;
+        frame.xyz = offsets + start * 3;
+        frame.n = std::min (BatchSize, n - start);
+        frame.precise = true;
+        std::copy (origin, origin + 3, frame.origin);
+        frame.values.resize (_graph -> nodes().size());
+        const float* result = value (frame, _graph -> output());
+        std::copy (result, result + frame.n, out + start);
+    }
+}
+
+void CpuEvaluator::evaluateLayers (const float* xyz, float* out, const size_t& n) const {
+    size_t layers = (size_t) _graph -> layerCount();
+    if (! _graph -> isValid()) {
+        std::fill (out, out + n * layers, 0.0f);
+        return;
+    }
+    for (size_t start = 0; start < n; start += BatchSize) {
+        Frame frame;
+        frame.xyz = xyz + start * 3;
+        frame.n = std::min (BatchSize, n - start);
+        frame.values.resize (_graph -> nodes().size());
+        for (size_t k = 0; k < layers; k++) {
+            const float* result = value (frame, _graph -> outputs().at ((int) k));
+            for (size_t i = 0; i < frame.n; i++) {
+                out [(start + i) * layers + k] = result [i];
+            }
+        }
+    }
+}
+
+const float* CpuEvaluator::value (Frame& frame, const int& node) const {
+    std::vector<float>& values = frame.values [node];
+    if (values.empty()) {
+        values.resize (frame.n);
+        if (frame.parent && known (*frame.parent, node)) {
+            const float* all = value (*frame.parent, node);
+            for (size_t i = 0; i < frame.n; i++) {
+                values [i] = all [frame.indices [i]];
+            }
+        } else {
+            compute (frame, node, values.data());
+        }
+    }
+    return values.data();
+}
+
+bool CpuEvaluator::known (const Frame& frame, const int& node) const {
+    return ! frame.values [node].empty() || (frame.parent && known (*frame.parent, node));
+}
+
+// Evaluates an input only at the given points of the frame, writing each value at its point's place in out. A node
+// which is needed at every point, or which is already known, is taken from the frame itself; otherwise the points
+// are gathered into a subset frame of their own.
+void CpuEvaluator::valueAt (Frame& frame, const ComputeInput& input, const std::vector<size_t>& indices, float* out) const {
+    if (indices.empty()) { return; }
+    if (input.node < 0) {
+        for (size_t i : indices) { out [i] = input.value; }
+        return;
+    }
+    if (indices.size() == frame.n || known (frame, input.node)) {
+        const float* values = value (frame, input.node);
+        for (size_t i : indices) { out [i] = values [i]; }
+        return;
+    }
+
+    Frame subset;
+    subset.parent = &frame;
+    subset.indices = indices;
+    subset.n = indices.size();
+    subset.precise = frame.precise;
+    std::copy (frame.origin, frame.origin + 3, subset.origin);
+    subset.coordinates.resize (subset.n * 3);
+    for (size_t j = 0; j < subset.n; j++) {
+        std::copy (frame.xyz + indices [j] * 3, frame.xyz + indices [j] * 3 + 3, subset.coordinates.data() + j * 3);
+    }
+    subset.xyz = subset.coordinates.data();
+    subset.values.resize (_graph -> nodes().size());
+    const float* values = value (subset, input.node);
+    for (size_t j = 0; j < subset.n; j++) {
+        out [indices [j]] = values [j];
+    }
+}
+
+CpuEvaluator::Frame* CpuEvaluator::transformed (Frame& frame, const int& index) const {
+    auto found = frame.children.find (index);
+    if (found != frame.children.end()) { return found -> second.get(); }
+
+    const ComputeNode& node = _graph -> nodes().at (index);
+    size_t n = frame.n;
+    std::unique_ptr<Frame> child (new Frame());
+    child -> n = n;
+    child -> coordinates.resize (n * 3);
+    child -> values.resize (_graph -> nodes().size());
+
+    // in a subset of points, the transformed points are a subset of those the parent transformed, if it has
+    if (frame.parent) {
+        auto parentChild = frame.parent -> children.find (index);
+        if (parentChild != frame.parent -> children.end()) {
+            child -> parent = parentChild -> second.get();
+            child -> indices = frame.indices;
+            child -> precise = child -> parent -> precise;
+            std::copy (child -> parent -> origin, child -> parent -> origin + 3, child -> origin);
+            for (size_t i = 0; i < n; i++) {
+                std::copy (child -> parent -> xyz + frame.indices [i] * 3, child -> parent -> xyz + frame.indices [i] * 3 + 3, child -> coordinates.data() + i * 3);
+            }
+            child -> xyz = child -> coordinates.data();
+            Frame* result = child.get();
+            frame.children [index] = std::move (child);
+            return result;
+        }
+    }
+
+    // the transform's own inputs are sampled at the untransformed point, as they are in the shader. A warp's are all
+    // port values, already worked into its steps.
+    int w = _graph -> warpAt (index);
+    const ComputeWarp* warp = w >= 0 ? &_graph -> warps().at (w) : nullptr;
+    std::vector<float> constants [4];
+    const float* in [4] = { nullptr, nullptr, nullptr, nullptr };
+    for (int k = 1; ! warp && k < std::min (4, (int) node.inputs.size()); k++) {
+        const ComputeInput& input = node.inputs.at (k);
+        if (input.node >= 0) {
+            in [k] = value (frame, input.node);
+        } else {
+            constants [k].assign (n, input.value);
+            in [k] = constants [k].data();
+        }
+    }
+
+    const float* xyz = frame.xyz;
+    float* c = child -> coordinates.data();
+
+    // precise points are transformed in double precision, and become offsets from where the first of them goes
+    if (frame.precise) {
+        std::vector<pvec3> points (n);
+        std::vector<double> m = warp ? matrices<double> (*warp) : std::vector<double>();
+        for (size_t i = 0; i < n; i++) {
+            pvec3 p = point (frame, i);
+            if (warp) {
+                p = warped (*_graph, *warp, m, p);
+            } else {
+                vec3 v (in [1][i], in [2][i], in [3][i]);
+                switch (node.operation) {
+                    case OpTranslate: p = p + pvec3 (v); break;
+                    case OpRotate: p = rotate (p, v); break;
+                    case OpScalePoint: p = p * pvec3 (v); break;
+                    case OpTurbulence: p = turbulence (p, in [1][i], in [2][i], (int) in [3][i], (int) node.parameters [0]); break;
+                    default: break;
+                }
+            }
+            points [i] = p;
+        }
+        child -> precise = true;
+        pvec3 origin = n > 0 ? points [0] : pvec3();
+        child -> origin [0] = origin.x;
+        child -> origin [1] = origin.y;
+        child -> origin [2] = origin.z;
+        for (size_t i = 0; i < n; i++) {
+            vec3 offset = single (points [i] - origin);
+            c [i * 3] = offset.x;
+            c [i * 3 + 1] = offset.y;
+            c [i * 3 + 2] = offset.z;
+        }
+        child -> xyz = child -> coordinates.data();
+        Frame* result = child.get();
+        frame.children [index] = std::move (child);
+        return result;
+    }
+
+    // a warp's matrices are applied in single precision, as the shader has them
+    std::vector<float> m = warp ? matrices<float> (*warp) : std::vector<float>();
+    for (size_t i = 0; i < n; i++) {
+        vec3 p (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]);
+        if (warp) {
+            p = warped (*_graph, *warp, m, p);
+        } else {
+            switch (node.operation) {
+                case OpTranslate: p = p + vec3 (in [1][i], in [2][i], in [3][i]); break;
+                case OpRotate: p = rotate (p, vec3 (in [1][i], in [2][i], in [3][i])); break;
+                case OpScalePoint: p = p * vec3 (in [1][i], in [2][i], in [3][i]); break;
+                case OpTurbulence: p = turbulence (p, in [1][i], in [2][i], (int) in [3][i], (int) node.parameters [0]); break;
+                default: break;
+            }
+        }
+        c [i * 3] = p.x;
+        c [i * 3 + 1] = p.y;
+        c [i * 3 + 2] = p.z;
+    }
+    child -> xyz = child -> coordinates.data();
+
+    Frame* result = child.get();
+    frame.children [index] = std::move (child);
+    return result;
+}
+
+void CpuEvaluator::compute (Frame& frame, const int& index, float* out) const {
+    const ComputeNode& node = _graph -> nodes().at (index);
+    size_t n = frame.n;
+
+    if (ComputeGraph::isCoordinateTransform (node.operation)) {
+        Frame* child = transformed (frame, index);
+        int w = _graph -> warpAt (index);
+        const float* source = value (*child, w >= 0 ? _graph -> warps().at (w).source : node.inputs.first().node);
+        std::copy (source, source + n, out);
+        return;
+    }
+
+    if (computeLazily (frame, index, out)) {
+        return;
+    }
+
+    std::vector<float> constants [4];
+    const float* in [4] = { nullptr, nullptr, nullptr, nullptr };
+    for (int k = 0; k < std::min (4, (int) node.inputs.size()); k++) {
+        const ComputeInput& input = node.inputs.at (k);
+        if (input.node >= 0) {
+            in [k] = value (frame, input.node);
+        } else {
+            constants [k].assign (n, input.value);
+            in [k] = constants [k].data();
+        }
+    }
+    const float* xyz = frame.xyz;
+    const QVector<float>& p = node.parameters;
+    if (frame.precise && computePrecisely (frame, node, in, out)) {
+        return;
+    }
+
+    switch (node.operation) {
+        case OpConstant: std::fill (out, out + n, p [0]); break;
+        case OpAbs: for (size_t i = 0; i < n; i++) { out [i] = std::fabs (in [0][i]); } break;
+        case OpInvert: for (size_t i = 0; i < n; i++) { out [i] = - in [0][i]; } break;
+        case OpAdd: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] + in [1][i]; } break;
+        case OpMax: for (size_t i = 0; i < n; i++) { out [i] = std::max (in [0][i], in [1][i]); } break;
+        case OpMin: for (size_t i = 0; i < n; i++) { out [i] = std::min (in [0][i], in [1][i]); } break;
+        case OpMultiply: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] * in [1][i]; } break;
+        case OpPower: for (size_t i = 0; i < n; i++) { out [i] = std::pow (in [0][i], in [1][i]); } break;
+        case OpDiff: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] - in [1][i]; } break;
+        case OpBlend: for (size_t i = 0; i < n; i++) { out [i] = glslMix (in [0][i], in [1][i], in [2][i]); } break;
+        case OpClamp: for (size_t i = 0; i < n; i++) { out [i] = glslClamp (in [0][i], in [1][i], in [2][i]); } break;
+        case OpScaleAndBias: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] * in [1][i] + in [2][i]; } break;
+        case OpSelect:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = select (in [0][i], in [1][i], in [2][i], p [0], p [1], p [2]);
+            }
+            break;
+        case OpCylinders:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = cylinders (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i]);
+            }
+            break;
+        case OpSpheres:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = spheres (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i]);
+            }
+            break;
+        case OpPerlin:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = perlin (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpSimplex:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = simplex (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpBillow:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = billow (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpRidgedMulti:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = ridgedmulti (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i], in [1][i], (int) p [0], (int) p [1], p [2], p [3], p [4], p [5]);
+            }
+            break;
+        case OpVoronoi:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = voronoi (vec3 (xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2]), in [0][i], in [1][i], p [0], (int) p [1]);
+            }
+            break;
+        case OpAltitudeMap: {
+            const ComputeCurve& curve = _graph -> curve (node.table);
+            for (size_t i = 0; i < n; i++) {
+                out [i] = mapAltitude (curve, in [0][i]);
+            }
+            break;
+        }
+        case OpRaster: {
+            const ComputeRaster& raster = _graph -> raster (node.table);
+            if (raster.dataset) {
+                raster.dataset -> sample (raster.column, xyz, out, n);
+                for (size_t i = 0; i < n; i++) {
+                    out [i] = raster.scale > 0.0f ? (out [i] - raster.bias) / raster.scale : -1.0f;
+                }
+                break;
+            }
+            for (size_t i = 0; i < n; i++) {
+                out [i] = sampleRaster (raster, xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2], in [0][i]);
+            }
+            break;
+        }
+        case OpBiome: {
+            const ComputeBiome& b = _graph -> biome (node.table);
+            for (size_t i = 0; i < n; i++) {
+                out [i] = biome (in [0][i], in [1][i], b.heights.constData(), b.heights.size(), b.moistures.constData(), b.moistures.size(), b.values.constData());
+            }
+            break;
+        }
+        default:
+            std::fill (out, out + n, 0.0f);
+    }
+}
+
+// the operations which read the point, for a frame of precise points
+bool CpuEvaluator::computePrecisely (const Frame& frame, const ComputeNode& node, const float* const* in, float* out) const {
+    switch (node.operation) {
+        case OpCylinders: case OpSpheres: case OpPerlin: case OpSimplex: case OpBillow: case OpRidgedMulti: case OpVoronoi: case OpRaster: break;
+        default: return false;
+    }
+    const QVector<float>& p = node.parameters;
+    for (size_t i = 0; i < frame.n; i++) {
+        pvec3 c = point (frame, i);
+        switch (node.operation) {
+            case OpCylinders: out [i] = cylinders (c, in [0][i]); break;
+            case OpSpheres: out [i] = spheres (c, in [0][i]); break;
+            case OpPerlin: out [i] = perlin (c, in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]); break;
+            case OpSimplex: out [i] = simplex (c, in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]); break;
+            case OpBillow: out [i] = billow (c, in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]); break;
+            case OpRidgedMulti: out [i] = ridgedmulti (c, in [0][i], in [1][i], (int) p [0], (int) p [1], p [2], p [3], p [4], p [5]); break;
+            case OpVoronoi: out [i] = voronoi (c, in [0][i], in [1][i], p [0], (int) p [1]); break;
+            default: {
+                vec3 s = single (c);
+                out [i] = sampleRaster (_graph -> raster (node.table), s.x, s.y, s.z, in [0][i]);
+            }
+        }
+    }
+    return true;
+}
+
+// Select, blend, max and min, with each input evaluated only at the points that need it. Where an input is not
+// needed, the value left in its place makes the usual formula give the other input exactly, so the results are
+// the same as evaluating everything (except where the skipped input would have been infinite or NaN).
+bool CpuEvaluator::computeLazily (Frame& frame, const int& index, float* out) const {
+    const ComputeNode& node = _graph -> nodes().at (index);
+    size_t n = frame.n;
+    int control;
+    switch (node.operation) {
+        case OpSelect: control = 0; break;
+        case OpBlend: control = 2; break;
+        case OpMax:
+        case OpMin: control = 0; break;
+        default: return false;
+    }
+    if (node.inputs.size() < (node.operation == OpSelect || node.operation == OpBlend ? 3 : 2)) { return false; }
+
+    // max and min skip their second input by its bounds, and only proven bounds will do for that, since a value outside
+    // them would be lost without a trace
+    if ((node.operation == OpMax || node.operation == OpMin) && node.inputs.at (1).node >= 0 && ! _graph -> isProven (node.inputs.at (1).node)) {
+        return false;
+    }
+
+    std::vector<size_t> all (n);
+    for (size_t i = 0; i < n; i++) { all [i] = i; }
+    std::vector<float> c (n);
+    valueAt (frame, node.inputs.at (control), all, c.data());
+
+    std::vector<size_t> first, second;
+    std::vector<float> a (n, 0.0f), b (n, 0.0f);
+    const QVector<float>& p = node.parameters;
+    if (node.operation == OpSelect || node.operation == OpBlend) {
+        int in0 = node.operation == OpSelect ? 1 : 0, in1 = in0 + 1;
+        for (size_t i = 0; i < n; i++) {
+            float alpha = node.operation == OpSelect ? glslSmoothstep (-1.0f + p [2], 1.0f - p [2], c [i]) : c [i];
+            if (alpha != 1.0f) { first.push_back (i); }
+            if (alpha != 0.0f) { second.push_back (i); }
+        }
+        valueAt (frame, node.inputs.at (in0), first, a.data());
+        valueAt (frame, node.inputs.at (in1), second, b.data());
+        for (size_t i = 0; i < n; i++) {
+            out [i] = node.operation == OpSelect ? select (c [i], a [i], b [i], p [0], p [1], p [2]) : glslMix (a [i], b [i], c [i]);
+        }
+        return true;
+    }
+
+    // max and min: the second input only matters where it could beat the first
+    const ComputeInput& other = node.inputs.at (1);
+    Interval bounds = other.node >= 0 ? _graph -> range (other.node) : Interval (other.value);
+    for (size_t i = 0; i < n; i++) {
+        if (node.operation == OpMax ? c [i] < bounds.hi : c [i] > bounds.lo) { second.push_back (i); }
+    }
+    b = c;
+    valueAt (frame, other, second, b.data());
+    for (size_t i = 0; i < n; i++) {
+        out [i] = node.operation == OpMax ? std::max (c [i], b [i]) : std::min (c [i], b [i]);
+    }
+    return true;
+}
+
+// follows the decision tree which Graph::glsl writes for an altitude map
+float CpuEvaluator::mapAltitude (const ComputeCurve& curve, const float& value) const {
+    const QVector<QPointF>& e = curve.entries;
+    int last = e.size() - 1;
+    if (value < e.first().x()) { return (float) e.first().y(); }
+    for (int j = 0; j < e.size(); j++) {
+        if (curve.terrace) {
+            const QPointF& e0 = e.at (std::min (std::max (j - 1, 0), last));
+            const QPointF& e1 = e.at (std::min (j, last));
+            if (value > e0.x() && value <= e1.x()) {
+                float alpha = (float) ((value - e0.x()) / (e1.x() - e0.x()));
+                if (curve.inverted) { alpha = 1.0f - alpha; }
+                alpha *= alpha;
+                return curve.inverted ? glslMix ((float) e1.y(), (float) e0.y(), alpha) : glslMix ((float) e0.y(), (float) e1.y(), alpha);
+            }
+        } else {
+            const QPointF& e0 = e.at (std::min (std::max (j - 2, 0), last));
+            const QPointF& e1 = e.at (std::min (std::max (j - 1, 0), last));
+            const QPointF& e2 = e.at (std::min (j, last));
+            const QPointF& e3 = e.at (std::min (j + 1, last));
+            if (value > e1.x() && value <= e2.x()) {
+                float alpha = (float) ((value - e1.x()) / (e2.x() - e1.x()));
+                return cubicInterpolate ((float) e0.y(), (float) e1.y(), (float) e2.y(), (float) e3.y(), alpha);
+            }
+        }
+    }
+    if (value > e.last().x()) { return (float) e.last().y(); }
+
+    // the shader falls off the end of the function here; the first entry is the nearest sensible value
+    return (float) e.first().y();
+}
+
+// bilinear sample with wrapping, as the shader's texture() call does, or a field's dataset sampled between the corners
+// of the triangle holding the point
+float CpuEvaluator::sampleRaster (const ComputeRaster& raster, const float& x, const float& y, const float& z, const float& defaultValue) {
+    if (raster.dataset) {
+        float xyz [3] = { x, y, z }, v;
+        raster.dataset -> sample (raster.column, xyz, &v, 1);
+        return raster.scale > 0.0f ? (v - raster.bias) / raster.scale : -1.0f;
+    }
+    if (! raster.values.isEmpty()) {
+        float v = sampleGrid (raster.values.constData(), raster.width, raster.height, vec3 (x, y, z));
+        return raster.scale > 0.0f ? (v - raster.bias) / raster.scale : -1.0f;
+    }
+    const QImage& image = raster.image;
+    if (image.isNull()) { return defaultValue; }
+
+    float lon, lat;
+    toGeolocation (vec3 (x, y, z), lon, lat);
+    float west = raster.west, east = raster.east;
+    if (west > east) {
+        if (lon < west) { lon += M_PI_F * 2; }
+        east += M_PI_F * 2;
+    }
+    float rx = (lon - west) / (east - west);
+    float ry = (lat - raster.north) / (raster.south - raster.north);
+
+    int w = image.width(), h = image.height();
+    float u = rx * w - 0.5f, v = ry * h - 0.5f;
+    int u0 = (int) std::floor (u), v0 = (int) std::floor (v);
+    float fu = u - u0, fv = v - v0;
+    float texel [4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int dv = 0; dv < 2; dv++) {
+        int row = (((v0 + dv) % h) + h) % h;
+        const uchar* line = image.constScanLine (row);
+        for (int du = 0; du < 2; du++) {
+            int col = (((u0 + du) % w) + w) % w;
+            float weight = (du ? fu : 1.0f - fu) * (dv ? fv : 1.0f - fv);
+            for (int k = 0; k < 4; k++) {
+                texel [k] += weight * line [col * 4 + k] / 255.0f;
+            }
+        }
+    }
+    float foundValue = (((texel [0] + texel [1] + texel [2]) / 3.0f) * 2.0f) - 1.0f;
+    return glslMix (foundValue, defaultValue, 1.0f - texel [3]);
+}
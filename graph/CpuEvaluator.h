@@ -0,0 +1,90 @@
+#ifndef CALENHAD_CPUEVALUATOR_H
+#define CALENHAD_CPUEVALUATOR_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+#include "ComputeGraph.h"
+
+namespace calenhad {
+    namespace graph {
+
+        // Evaluates a ComputeGraph on the CPU, giving the same values as the module's shader on the GPU. Points are
+        // processed in batches: each node is evaluated for a whole batch before moving on to the next node, and each
+        // node's result is computed once per batch however many other nodes use it. Modules which move the sample
+        // point (translate, rotate, scale point, turbulence) evaluate their source at a second set of coordinates,
+        // which gets its own results.
+        //
+        // Select, blend, max and min evaluate their inputs lazily. The control (or the first input, for max and min)
+        // is evaluated for the whole batch first; each point then goes to the branch or branches it actually needs,
+        // and every branch is evaluated only for its own points, gathered into a dense subset of the batch so that
+        // the loops over it stay as tight as for a whole batch. Max and min use the bounds of their second input
+        // (see RangeAnalysis) to skip it wherever the first input already decides the result, but only where those
+        // bounds are proven (ComputeGraph::isProven); anything downstream of a noise generator is evaluated in full. Results already
+        // computed for the whole batch are copied into a subset rather than computed again.
+        //
+        // An evaluator holds no state between calls, so one evaluator can be used from any number of threads at once.
+        // The graph must outlive it.
+        class CpuEvaluator {
+        public:
+            CpuEvaluator (const ComputeGraph* graph);
+            ~CpuEvaluator();
+
+            // xyz holds n cartesian points (x0, y0, z0, x1, y1, z1 ...) on the unit sphere; out receives n values
+            void evaluate (const float* xyz, float* out, const size_t& n) const;
+            float evaluate (const float& x, const float& y, const float& z) const;
+
+            // all of the graph's layers at once: out receives n * layerCount values, the layers for each point together
+            // (point 0 layer 0, point 0 layer 1 ... point 1 layer 0 ...), which is how the shader writes them too
+            void evaluateLayers (const float* xyz, float* out, const size_t& n) const;
+
+            // same, for points given as longitude and latitude in radians (lon0, lat0, lon1, lat1 ...)
+            void evaluateGeolocations (const float* lonlat, float* out, const size_t& n) const;
+
+            // Deep zoom: points given as offsets (x0, y0, z0 ...) from an origin of three doubles near them, for points
+            // closer together than floats on the unit sphere can tell apart. Each point is the origin plus its offset
+            // in double precision, and stays in double precision through coordinate transforms and into the noise
+            // functions, which then reduce each octave to single precision (see CpuPrecise.h).
+            void evaluate (const double* origin, const float* offsets, float* out, const size_t& n) const;
+
+            const ComputeGraph* graph () const;
+
+            // a raster's value at a point, falling back on defaultValue where the raster is transparent. A field's raster
+            // is read from its dataset (see ComputeRaster).
+            static float sampleRaster (const ComputeRaster& raster, const float& x, const float& y, const float& z, const float& defaultValue);
+
+            static constexpr size_t BatchSize = 256;
+
+        protected:
+            // a set of points and the values of nodes computed for them. A subset frame holds some of its parent's
+            // points (indices gives which) and takes any values the parent already has. In a precise frame, xyz are
+            // offsets from origin.
+            struct Frame {
+                const float* xyz;
+                size_t n;
+                bool precise = false;
+                double origin [3] = { 0.0, 0.0, 0.0 };
+                std::vector<float> coordinates;
+                std::vector<std::vector<float>> values;
+                std::map<int, std::unique_ptr<Frame>> children;
+                Frame* parent = nullptr;
+                std::vector<size_t> indices;
+            };
+
+            const ComputeGraph* _graph;
+
+            const float* value (Frame& frame, const int& node) const;
+            void compute (Frame& frame, const int& index, float* out) const;
+            bool computePrecisely (const Frame& frame, const ComputeNode& node, const float* const* in, float* out) const;
+            bool computeLazily (Frame& frame, const int& index, float* out) const;
+            void valueAt (Frame& frame, const ComputeInput& input, const std::vector<size_t>& indices, float* out) const;
+            bool known (const Frame& frame, const int& node) const;
+            Frame* transformed (Frame& frame, const int& index) const;
+            float mapAltitude (const ComputeCurve& curve, const float& value) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_CPUEVALUATOR_H
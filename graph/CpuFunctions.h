@@ -0,0 +1,787 @@
+#ifndef CALENHAD_CPUFUNCTIONS_H
+#define CALENHAD_CPUFUNCTIONS_H
+
+// CPU implementations of the noise and helper functions in resources/shaders/map_cs.glsl. They are transcribed
+// line for line from the shader, with the same single-precision arithmetic, so that a module evaluated on the CPU
+// gives the same value as the GPU would (to within rounding). Change one, change the other.
+//
+// This header must stay self-contained (standard library only) because it is also compiled into the shared
+// libraries generated from graphs at run time.
+
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+
+namespace calenhad {
+    namespace graph {
+        namespace cpu {
+
+            const float M_PI_F = 3.1415926535898f;
+            const float SIMPLEX_SCALE = 0.62083034f;
+            const float RIDGED_MULTI_BIAS = 0.864406f;
+            const float RIDGED_MULTI_SCALE = 1.091014622f;
+            const float VORONOI_BIAS = 0.0f;
+            const float VORONOI_SCALE = 1.757700928f;
+            const float PERLIN_BIAS = 0.0f;
+            const float PERLIN_SCALE = 1.0f;
+            const float BILLOW_BIAS = 0.0f;
+            const float BILLOW_SCALE = 1.0f;
+
+            // GLSL built-ins
+
+            inline float glslFloor (const float& x) { return std::floor (x); }
+            inline float glslFract (const float& x) { return x - std::floor (x); }
+            inline float glslMod (const float& x, const float& y) { return x - y * std::floor (x / y); }
+            inline float glslStep (const float& edge, const float& x) { return x < edge ? 0.0f : 1.0f; }
+            inline float glslClamp (const float& x, const float& lo, const float& hi) { return std::min (std::max (x, lo), hi); }
+            inline float glslMix (const float& a, const float& b, const float& t) { return a * (1.0f - t) + b * t; }
+            inline float glslSmoothstep (const float& e0, const float& e1, const float& x) {
+                float t = glslClamp ((x - e0) / (e1 - e0), 0.0f, 1.0f);
+                return t * t * (3.0f - 2.0f * t);
+            }
+
+            struct vec3 {
+                float x, y, z;
+                vec3 () : x (0.0f), y (0.0f), z (0.0f) { }
+                vec3 (const float& a) : x (a), y (a), z (a) { }
+                vec3 (const float& a, const float& b, const float& c) : x (a), y (b), z (c) { }
+            };
+
+            inline vec3 operator+ (const vec3& a, const vec3& b) { return vec3 (a.x + b.x, a.y + b.y, a.z + b.z); }
+            inline vec3 operator- (const vec3& a, const vec3& b) { return vec3 (a.x - b.x, a.y - b.y, a.z - b.z); }
+            inline vec3 operator* (const vec3& a, const vec3& b) { return vec3 (a.x * b.x, a.y * b.y, a.z * b.z); }
+            inline vec3 operator+ (const vec3& a, const float& b) { return vec3 (a.x + b, a.y + b, a.z + b); }
+            inline vec3 operator- (const vec3& a, const float& b) { return vec3 (a.x - b, a.y - b, a.z - b); }
+            inline vec3 operator* (const vec3& a, const float& b) { return vec3 (a.x * b, a.y * b, a.z * b); }
+            inline vec3 operator+ (const float& a, const vec3& b) { return vec3 (a + b.x, a + b.y, a + b.z); }
+            inline vec3 operator* (const float& a, const vec3& b) { return vec3 (a * b.x, a * b.y, a * b.z); }
+            inline vec3 floor (const vec3& a) { return vec3 (std::floor (a.x), std::floor (a.y), std::floor (a.z)); }
+            inline vec3 fract (const vec3& a) { return vec3 (glslFract (a.x), glslFract (a.y), glslFract (a.z)); }
+            inline vec3 mod (const vec3& a, const float& m) { return vec3 (glslMod (a.x, m), glslMod (a.y, m), glslMod (a.z, m)); }
+            inline vec3 min (const vec3& a, const vec3& b) { return vec3 (std::min (a.x, b.x), std::min (a.y, b.y), std::min (a.z, b.z)); }
+            inline vec3 max (const vec3& a, const vec3& b) { return vec3 (std::max (a.x, b.x), std::max (a.y, b.y), std::max (a.z, b.z)); }
+
+            struct vec4 {
+                float x, y, z, w;
+                vec4 () : x (0.0f), y (0.0f), z (0.0f), w (0.0f) { }
+                vec4 (const float& a) : x (a), y (a), z (a), w (a) { }
+                vec4 (const float& a, const float& b, const float& c, const float& d) : x (a), y (b), z (c), w (d) { }
+            };
+
+            inline vec4 operator+ (const vec4& a, const vec4& b) { return vec4 (a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+            inline vec4 operator- (const vec4& a, const vec4& b) { return vec4 (a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+            inline vec4 operator* (const vec4& a, const vec4& b) { return vec4 (a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+            inline vec4 operator+ (const vec4& a, const float& b) { return vec4 (a.x + b, a.y + b, a.z + b, a.w + b); }
+            inline vec4 operator- (const vec4& a, const float& b) { return vec4 (a.x - b, a.y - b, a.z - b, a.w - b); }
+            inline vec4 operator* (const vec4& a, const float& b) { return vec4 (a.x * b, a.y * b, a.z * b, a.w * b); }
+            inline vec4 operator/ (const vec4& a, const float& b) { return vec4 (a.x / b, a.y / b, a.z / b, a.w / b); }
+            inline vec4 operator- (const float& a, const vec4& b) { return vec4 (a - b.x, a - b.y, a - b.z, a - b.w); }
+            inline vec4 floor (const vec4& a) { return vec4 (std::floor (a.x), std::floor (a.y), std::floor (a.z), std::floor (a.w)); }
+            inline vec4 fract (const vec4& a) { return vec4 (glslFract (a.x), glslFract (a.y), glslFract (a.z), glslFract (a.w)); }
+            inline vec4 mod (const vec4& a, const float& m) { return vec4 (glslMod (a.x, m), glslMod (a.y, m), glslMod (a.z, m), glslMod (a.w, m)); }
+            inline vec4 abs (const vec4& a) { return vec4 (std::fabs (a.x), std::fabs (a.y), std::fabs (a.z), std::fabs (a.w)); }
+            inline vec4 step (const vec4& e, const vec4& a) { return vec4 (glslStep (e.x, a.x), glslStep (e.y, a.y), glslStep (e.z, a.z), glslStep (e.w, a.w)); }
+            inline vec4 clamp (const vec4& a, const float& lo, const float& hi) { return vec4 (glslClamp (a.x, lo, hi), glslClamp (a.y, lo, hi), glslClamp (a.z, lo, hi), glslClamp (a.w, lo, hi)); }
+            inline vec4 mix (const vec4& a, const vec4& b, const float& t) { return vec4 (glslMix (a.x, b.x, t), glslMix (a.y, b.y, t), glslMix (a.z, b.z, t), glslMix (a.w, b.w, t)); }
+            inline float dot (const vec4& a, const vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+            // Classic Perlin 4D noise by Stefan Gustavson
+
+            inline vec4 permute (const vec4& x) { return mod (((x * 34.0f) + 1.0f) * x, 289.0f); }
+            inline vec4 taylorInvSqrt (const vec4& r) { return 1.79284291400159f - r * 0.85373472095314f; }
+            inline vec4 fade (const vec4& t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+            inline void cnoiseGradients (const vec4& ixy, vec4& gx, vec4& gy, vec4& gz, vec4& gw) {
+                gx = ixy / 7.0f;
+                gy = floor (gx) / 7.0f;
+                gz = floor (gy) / 6.0f;
+                gx = fract (gx) - 0.5f;
+                gy = fract (gy) - 0.5f;
+                gz = fract (gz) - 0.5f;
+                gw = vec4 (0.75f) - abs (gx) - abs (gy) - abs (gz);
+                vec4 sw = step (gw, vec4 (0.0f));
+                gx = gx - sw * (step (vec4 (0.0f), gx) - 0.5f);
+                gy = gy - sw * (step (vec4 (0.0f), gy) - 0.5f);
+            }
+
+            // the normalised gradients at the sixteen corners of the lattice cell containing P, in the order
+            // 0000, 1000, 0100, 1100, 0010, 1010, 0110, 1110, 0001, 1001, 0101, 1101, 0011, 1011, 0111, 1111 (xyzw), and
+            // P's position within the cell relative to its lower (Pf0) and upper (Pf1) corners
+            inline void cnoiseLattice (const vec4& P, vec4* g, vec4& Pf0, vec4& Pf1) {
+                vec4 Pi0 = floor (P);
+                vec4 Pi1 = Pi0 + 1.0f;
+                Pi0 = mod (Pi0, 289.0f);
+                Pi1 = mod (Pi1, 289.0f);
+                Pf0 = fract (P);
+                Pf1 = Pf0 - 1.0f;
+                vec4 ix = vec4 (Pi0.x, Pi1.x, Pi0.x, Pi1.x);
+                vec4 iy = vec4 (Pi0.y, Pi0.y, Pi1.y, Pi1.y);
+                vec4 iz0 = vec4 (Pi0.z);
+                vec4 iz1 = vec4 (Pi1.z);
+                vec4 iw0 = vec4 (Pi0.w);
+                vec4 iw1 = vec4 (Pi1.w);
+
+                vec4 ixy = permute (permute (ix) + iy);
+                vec4 ixy0 = permute (ixy + iz0);
+                vec4 ixy1 = permute (ixy + iz1);
+                vec4 ixy00 = permute (ixy0 + iw0);
+                vec4 ixy01 = permute (ixy0 + iw1);
+                vec4 ixy10 = permute (ixy1 + iw0);
+                vec4 ixy11 = permute (ixy1 + iw1);
+
+                vec4 gx00, gy00, gz00, gw00, gx01, gy01, gz01, gw01, gx10, gy10, gz10, gw10, gx11, gy11, gz11, gw11;
+                cnoiseGradients (ixy00, gx00, gy00, gz00, gw00);
+                cnoiseGradients (ixy01, gx01, gy01, gz01, gw01);
+                cnoiseGradients (ixy10, gx10, gy10, gz10, gw10);
+                cnoiseGradients (ixy11, gx11, gy11, gz11, gw11);
+
+                vec4 g0000 (gx00.x, gy00.x, gz00.x, gw00.x);
+                vec4 g1000 (gx00.y, gy00.y, gz00.y, gw00.y);
+                vec4 g0100 (gx00.z, gy00.z, gz00.z, gw00.z);
+                vec4 g1100 (gx00.w, gy00.w, gz00.w, gw00.w);
+                vec4 g0010 (gx10.x, gy10.x, gz10.x, gw10.x);
+                vec4 g1010 (gx10.y, gy10.y, gz10.y, gw10.y);
+                vec4 g0110 (gx10.z, gy10.z, gz10.z, gw10.z);
+                vec4 g1110 (gx10.w, gy10.w, gz10.w, gw10.w);
+                vec4 g0001 (gx01.x, gy01.x, gz01.x, gw01.x);
+                vec4 g1001 (gx01.y, gy01.y, gz01.y, gw01.y);
+                vec4 g0101 (gx01.z, gy01.z, gz01.z, gw01.z);
+                vec4 g1101 (gx01.w, gy01.w, gz01.w, gw01.w);
+                vec4 g0011 (gx11.x, gy11.x, gz11.x, gw11.x);
+                vec4 g1011 (gx11.y, gy11.y, gz11.y, gw11.y);
+                vec4 g0111 (gx11.z, gy11.z, gz11.z, gw11.z);
+                vec4 g1111 (gx11.w, gy11.w, gz11.w, gw11.w);
+
+                vec4 norm00 = taylorInvSqrt (vec4 (dot (g0000, g0000), dot (g0100, g0100), dot (g1000, g1000), dot (g1100, g1100)));
+                g0000 = g0000 * norm00.x;
+                g0100 = g0100 * norm00.y;
+                g1000 = g1000 * norm00.z;
+                g1100 = g1100 * norm00.w;
+
+                vec4 norm01 = taylorInvSqrt (vec4 (dot (g0001, g0001), dot (g0101, g0101), dot (g1001, g1001), dot (g1101, g1101)));
+                g0001 = g0001 * norm01.x;
+                g0101 = g0101 * norm01.y;
+                g1001 = g1001 * norm01.z;
+                g1101 = g1101 * norm01.w;
+
+                vec4 norm10 = taylorInvSqrt (vec4 (dot (g0010, g0010), dot (g0110, g0110), dot (g1010, g1010), dot (g1110, g1110)));
+                g0010 = g0010 * norm10.x;
+                g0110 = g0110 * norm10.y;
+                g1010 = g1010 * norm10.z;
+                g1110 = g1110 * norm10.w;
+
+                vec4 norm11 = taylorInvSqrt (vec4 (dot (g0011, g0011), dot (g0111, g0111), dot (g1011, g1011), dot (g1111, g1111)));
+                g0011 = g0011 * norm11.x;
+                g0111 = g0111 * norm11.y;
+                g1011 = g1011 * norm11.z;
+                g1111 = g1111 * norm11.w;
+
+                g [0] = g0000; g [1] = g1000; g [2] = g0100; g [3] = g1100;
+                g [4] = g0010; g [5] = g1010; g [6] = g0110; g [7] = g1110;
+                g [8] = g0001; g [9] = g1001; g [10] = g0101; g [11] = g1101;
+                g [12] = g0011; g [13] = g1011; g [14] = g0111; g [15] = g1111;
+            }
+
+            inline float cnoise (const vec4& P) {
+                vec4 g [16], Pf0, Pf1;
+                cnoiseLattice (P, g, Pf0, Pf1);
+                const vec4& g0000 = g [0], & g1000 = g [1], & g0100 = g [2], & g1100 = g [3];
+                const vec4& g0010 = g [4], & g1010 = g [5], & g0110 = g [6], & g1110 = g [7];
+                const vec4& g0001 = g [8], & g1001 = g [9], & g0101 = g [10], & g1101 = g [11];
+                const vec4& g0011 = g [12], & g1011 = g [13], & g0111 = g [14], & g1111 = g [15];
+
+                float n0000 = dot (g0000, Pf0);
+                float n1000 = dot (g1000, vec4 (Pf1.x, Pf0.y, Pf0.z, Pf0.w));
+                float n0100 = dot (g0100, vec4 (Pf0.x, Pf1.y, Pf0.z, Pf0.w));
+                float n1100 = dot (g1100, vec4 (Pf1.x, Pf1.y, Pf0.z, Pf0.w));
+                float n0010 = dot (g0010, vec4 (Pf0.x, Pf0.y, Pf1.z, Pf0.w));
+                float n1010 = dot (g1010, vec4 (Pf1.x, Pf0.y, Pf1.z, Pf0.w));
+                float n0110 = dot (g0110, vec4 (Pf0.x, Pf1.y, Pf1.z, Pf0.w));
+                float n1110 = dot (g1110, vec4 (Pf1.x, Pf1.y, Pf1.z, Pf0.w));
+                float n0001 = dot (g0001, vec4 (Pf0.x, Pf0.y, Pf0.z, Pf1.w));
+                float n1001 = dot (g1001, vec4 (Pf1.x, Pf0.y, Pf0.z, Pf1.w));
+                float n0101 = dot (g0101, vec4 (Pf0.x, Pf1.y, Pf0.z, Pf1.w));
+                float n1101 = dot (g1101, vec4 (Pf1.x, Pf1.y, Pf0.z, Pf1.w));
+                float n0011 = dot (g0011, vec4 (Pf0.x, Pf0.y, Pf1.z, Pf1.w));
+                float n1011 = dot (g1011, vec4 (Pf1.x, Pf0.y, Pf1.z, Pf1.w));
+                float n0111 = dot (g0111, vec4 (Pf0.x, Pf1.y, Pf1.z, Pf1.w));
+                float n1111 = dot (g1111, Pf1);
+
+                vec4 fade_xyzw = fade (Pf0);
+                vec4 n_0w = mix (vec4 (n0000, n1000, n0100, n1100), vec4 (n0001, n1001, n0101, n1101), fade_xyzw.w);
+                vec4 n_1w = mix (vec4 (n0010, n1010, n0110, n1110), vec4 (n0011, n1011, n0111, n1111), fade_xyzw.w);
+                vec4 n_zw = mix (n_0w, n_1w, fade_xyzw.z);
+                float n_yzw_x = glslMix (n_zw.x, n_zw.z, fade_xyzw.y);
+                float n_yzw_y = glslMix (n_zw.y, n_zw.w, fade_xyzw.y);
+                float n_xyzw = glslMix (n_yzw_x, n_yzw_y, fade_xyzw.x);
+                return 2.2f * n_xyzw;
+            }
+
+            // Simplex 4D noise by Ian McEwan, Ashima Arts
+
+            inline float permute (const float& x) { return std::floor (glslMod (((x * 34.0f) + 1.0f) * x, 289.0f)); }
+            inline float taylorInvSqrt (const float& r) { return 1.79284291400159f - 0.85373472095314f * r; }
+
+            inline vec4 grad4 (const float& j, const vec4& ip) {
+                vec4 p;
+                p.x = std::floor (glslFract (j * ip.x) * 7.0f) * ip.z - 1.0f;
+                p.y = std::floor (glslFract (j * ip.y) * 7.0f) * ip.z - 1.0f;
+                p.z = std::floor (glslFract (j * ip.z) * 7.0f) * ip.z - 1.0f;
+                p.w = 1.5f - (std::fabs (p.x) + std::fabs (p.y) + std::fabs (p.z));
+                vec4 s (p.x < 0.0f ? 1.0f : 0.0f, p.y < 0.0f ? 1.0f : 0.0f, p.z < 0.0f ? 1.0f : 0.0f, p.w < 0.0f ? 1.0f : 0.0f);
+                p.x = p.x + (s.x * 2.0f - 1.0f) * s.w;
+                p.y = p.y + (s.y * 2.0f - 1.0f) * s.w;
+                p.z = p.z + (s.z * 2.0f - 1.0f) * s.w;
+                return p;
+            }
+
+            // the offsets of a point from the five corners of its simplex, given its offset from the first (x0), and the
+            // steps from the first corner to the second, third and fourth
+            inline void snoiseSteps (const vec4& x0, vec4& i1, vec4& i2, vec4& i3, vec4* x) {
+                const float Cx = 0.138196601125010504f;  // (5 - sqrt(5))/20  G4
+
+                // Other corners - rank sorting originally contributed by Bill Licea-Kane, AMD (formerly ATI)
+                vec4 i0;
+                float isXx = glslStep (x0.y, x0.x), isXy = glslStep (x0.z, x0.x), isXz = glslStep (x0.w, x0.x);
+                float isYZx = glslStep (x0.z, x0.y), isYZy = glslStep (x0.w, x0.y), isYZz = glslStep (x0.w, x0.z);
+                i0.x = isXx + isXy + isXz;
+                i0.y = 1.0f - isXx;
+                i0.z = 1.0f - isXy;
+                i0.w = 1.0f - isXz;
+                i0.y += isYZx + isYZy;
+                i0.z += 1.0f - isYZx;
+                i0.w += 1.0f - isYZy;
+                i0.z += isYZz;
+                i0.w += 1.0f - isYZz;
+
+                // i0 now contains the unique values 0, 1, 2, 3 in each channel
+                i3 = clamp (i0, 0.0f, 1.0f);
+                i2 = clamp (i0 - 1.0f, 0.0f, 1.0f);
+                i1 = clamp (i0 - 2.0f, 0.0f, 1.0f);
+
+                x [0] = x0;
+                x [1] = x0 - i1 + vec4 (1.0f * Cx);
+                x [2] = x0 - i2 + vec4 (2.0f * Cx);
+                x [3] = x0 - i3 + vec4 (3.0f * Cx);
+                x [4] = x0 - 1.0f + vec4 (4.0f * Cx);
+            }
+
+            // the offsets of a point from the five corners of its simplex, and the normalised gradients at those
+            // corners, given the simplex's first corner (i) and the point's offset from it (x0)
+            inline void snoiseCorners (vec4 i, const vec4& x0, vec4* x, vec4* p) {
+                vec4 i1, i2, i3;
+                snoiseSteps (x0, i1, i2, i3, x);
+
+                // Permutations
+                i = mod (i, 289.0f);
+                float j0 = permute (permute (permute (permute (i.w) + i.z) + i.y) + i.x);
+                vec4 j1 = permute (permute (permute (permute (
+                            vec4 (i.w) + vec4 (i1.w, i2.w, i3.w, 1.0f))
+                            + vec4 (i.z) + vec4 (i1.z, i2.z, i3.z, 1.0f))
+                            + vec4 (i.y) + vec4 (i1.y, i2.y, i3.y, 1.0f))
+                            + vec4 (i.x) + vec4 (i1.x, i2.x, i3.x, 1.0f));
+
+                // Gradients: 7 * 7 * 6 points uniformly over a cube, mapped onto a 4-octahedron.
+                vec4 ip (1.0f / 294.0f, 1.0f / 49.0f, 1.0f / 7.0f, 0.0f);
+
+                vec4 p0 = grad4 (j0, ip);
+                vec4 p1 = grad4 (j1.x, ip);
+                vec4 p2 = grad4 (j1.y, ip);
+                vec4 p3 = grad4 (j1.z, ip);
+                vec4 p4 = grad4 (j1.w, ip);
+
+                // Normalise gradients
+                vec4 norm = taylorInvSqrt (vec4 (dot (p0, p0), dot (p1, p1), dot (p2, p2), dot (p3, p3)));
+                p0 = p0 * norm.x;
+                p1 = p1 * norm.y;
+                p2 = p2 * norm.z;
+                p3 = p3 * norm.w;
+                p4 = p4 * taylorInvSqrt (dot (p4, p4));
+
+                p [0] = p0; p [1] = p1; p [2] = p2; p [3] = p3; p [4] = p4;
+            }
+
+            // the same for the point v
+            inline void snoiseCorners (const vec4& v, vec4* x, vec4* p) {
+                const float Cx = 0.138196601125010504f;  // (5 - sqrt(5))/20  G4
+                const float Cy = 0.309016994374947451f;  // (sqrt(5) - 1)/4   F4
+
+                // First corner
+                vec4 i = floor (v + dot (v, vec4 (Cy)));
+                vec4 x0 = v - i + dot (i, vec4 (Cx));
+                snoiseCorners (i, x0, x, p);
+            }
+
+            // the noise from the corners' offsets and gradients
+            inline float snoiseSum (const vec4* x, const vec4* p) {
+                const vec4& x0 = x [0], & x1 = x [1], & x2 = x [2], & x3 = x [3], & x4 = x [4];
+                const vec4& p0 = p [0], & p1 = p [1], & p2 = p [2], & p3 = p [3], & p4 = p [4];
+
+                // Mix contributions from the five corners
+                float m00 = std::max (0.6f - dot (x0, x0), 0.0f);
+                float m01 = std::max (0.6f - dot (x1, x1), 0.0f);
+                float m02 = std::max (0.6f - dot (x2, x2), 0.0f);
+                float m10 = std::max (0.6f - dot (x3, x3), 0.0f);
+                float m11 = std::max (0.6f - dot (x4, x4), 0.0f);
+                m00 = m00 * m00; m01 = m01 * m01; m02 = m02 * m02; m10 = m10 * m10; m11 = m11 * m11;
+                return 49.0f * ((m00 * m00 * dot (p0, x0) + m01 * m01 * dot (p1, x1) + m02 * m02 * dot (p2, x2))
+                              + (m10 * m10 * dot (p3, x3) + m11 * m11 * dot (p4, x4)));
+            }
+
+            inline float snoise (const vec4& v) {
+                vec4 x [5], p [5];
+                snoiseCorners (v, x, p);
+                return snoiseSum (x, p);
+            }
+
+            // Cellular noise ("Worley noise") in 3D, copyright (c) Stefan Gustavson 2011-04-19, released under the MIT
+            // license. Returns F1 and F2.
+
+            inline vec3 permute (const vec3& x) { return mod ((34.0f * x + 1.0f) * x, 289.0f); }
+
+            // F1 and F2 from the squared distances to the feature points of the 27 cells around P
+            inline void cellularSort (vec3 d [3][3], float& f1, float& f2) {
+                vec3 d11 = d [0][0], d12 = d [0][1], d13 = d [0][2];
+                vec3 d21 = d [1][0], d22 = d [1][1], d23 = d [1][2];
+                vec3 d31 = d [2][0], d32 = d [2][1], d33 = d [2][2];
+
+                // Sort out both F1 and F2
+                vec3 d1a = min (d11, d12);
+                d12 = max (d11, d12);
+                d11 = min (d1a, d13);
+                d13 = max (d1a, d13);
+                d12 = min (d12, d13);
+                vec3 d2a = min (d21, d22);
+                d22 = max (d21, d22);
+                d21 = min (d2a, d23);
+                d23 = max (d2a, d23);
+                d22 = min (d22, d23);
+                vec3 d3a = min (d31, d32);
+                d32 = max (d31, d32);
+                d31 = min (d3a, d33);
+                d33 = max (d3a, d33);
+                d32 = min (d32, d33);
+                vec3 da = min (d11, d21);
+                d21 = max (d11, d21);
+                d11 = min (da, d31);
+                d31 = max (da, d31);
+                if (! (d11.x < d11.y)) { std::swap (d11.x, d11.y); }
+                if (! (d11.x < d11.z)) { std::swap (d11.x, d11.z); }
+                d12 = min (d12, d21);
+                d12 = min (d12, d22);
+                d12 = min (d12, d31);
+                d12 = min (d12, d32);
+                d11.y = std::min (d11.y, d12.x);
+                d11.z = std::min (d11.z, d12.y);
+                d11.y = std::min (d11.y, d12.z);
+                d11.y = std::min (d11.y, d11.z);
+                f1 = std::sqrt (d11.x);
+                f2 = std::sqrt (d11.y);
+            }
+
+            inline void cellular (vec3 P, const float& jitter, const float& seed, float& f1, float& f2) {
+                const float K = 0.142857142857f;     // 1/7
+                const float Ko = 0.428571428571f;    // 1/2-K/2
+                const float K2 = 0.020408163265306f; // 1/(7*7)
+                const float Kz = 0.166666666667f;    // 1/6
+                const float Kzo = 0.416666666667f;   // 1/2-1/6*2
+
+                P = P + seed;
+                vec3 Pi = mod (floor (P), 289.0f);
+                vec3 Pf = fract (P) - 0.5f;
+
+                vec3 Pfx = Pf.x + vec3 (1.0f, 0.0f, -1.0f);
+                vec3 Pfy = Pf.y + vec3 (1.0f, 0.0f, -1.0f);
+                vec3 Pfz = Pf.z + vec3 (1.0f, 0.0f, -1.0f);
+                float pfy [3] = { Pfy.x, Pfy.y, Pfy.z };
+                float pfz [3] = { Pfz.x, Pfz.y, Pfz.z };
+
+                vec3 p = permute (Pi.x + vec3 (-1.0f, 0.0f, 1.0f));
+                vec3 d [3][3];
+                for (int a = 0; a < 3; a++) {
+                    vec3 pa = permute (p + Pi.y + (float) (a - 1));
+                    for (int b = 0; b < 3; b++) {
+                        vec3 pab = permute (pa + Pi.z + (float) (b - 1));
+                        vec3 ox = fract (pab * K) - Ko;
+                        vec3 oy = mod (floor (pab * K), 7.0f) * K - Ko;
+                        vec3 oz = floor (pab * K2) * Kz - Kzo;
+                        vec3 dx = Pfx + jitter * ox;
+                        vec3 dy = pfy [a] + jitter * oy;
+                        vec3 dz = pfz [b] + jitter * oz;
+                        d [a][b] = dx * dx + dy * dy + dz * dz;
+                    }
+                }
+                cellularSort (d, f1, f2);
+            }
+
+            // Lookup tables. The shader hashes lattice points with permute (), a polynomial modulo 289 worked out in
+            // floats, and derives each gradient from the hash with a handful of divisions, floors and a normalisation.
+            // All of that depends only on integers below 578, so the CPU works it out once, with the functions above,
+            // and looks it up afterwards: hashes in a table of permutations, gradients (and cellular noise's feature
+            // point offsets) in tables indexed by hash. Since the tables hold exactly what the functions give, the
+            // noise from the tables is the same, bit for bit, as the noise from the transcriptions, for any lattice
+            // position a float can hold as an integer.
+            //
+            // Classic noise goes further. The modules always sample it in the plane w = seed, where the point's w is a
+            // whole number, so the corners with the next w carry no weight, and the last hash and the gradient depend
+            // only on the seed and the hash of x, y and z. Each seed (modulo 289, where the lattice repeats) gets a
+            // table of the gradients for every such hash, built the first time a module uses that seed and shared by
+            // every module which uses it afterwards, which leaves classic noise eight lookups and dot products in three
+            // dimensions where the transcription works out sixteen in four.
+            //
+            // The tables are built once, aligned to cache lines and never written afterwards, so any number of
+            // threads can read them at once. Built with CALENHAD_NOISE_COMPATIBLE defined, the modules use the
+            // transcriptions instead, as a reference for checking the tables against.
+
+            // a lattice coordinate modulo 289, as mod (floor (x), 289.0) gives it for any x a float holds exactly
+            inline int lattice (const float& x) {
+                if (! (std::fabs (x) < 1e18f)) { return 0; }
+                long long i = (long long) std::floor (x) % 289;
+                return (int) (i < 0 ? i + 289 : i);
+            }
+
+            struct alignas (64) NoiseTables {
+                // permute (x) for every x from -1 to 577, at permutations [x + 1]: every sum of a hash, a lattice
+                // coordinate and a step to the next one which the noise functions pass to it
+                int permutations [579];
+
+                // for each hash, classic noise's and simplex noise's normalised gradients, and cellular noise's offset
+                // of the feature point from the centre of its cell
+                vec4 classicGradients [289];
+                vec4 simplexGradients [289];
+                vec4 cellularOffsets [289];
+
+                int permute (const int& x) const { return permutations [x + 1]; }
+
+                NoiseTables () {
+                    for (int x = -1; x < 578; x++) {
+                        permutations [x + 1] = (int) cpu::permute ((float) x);
+                    }
+                    const vec4 ip (1.0f / 294.0f, 1.0f / 49.0f, 1.0f / 7.0f, 0.0f);
+                    for (int h = 0; h < 289; h++) {
+                        vec4 gx, gy, gz, gw;
+                        cnoiseGradients (vec4 ((float) h), gx, gy, gz, gw);
+                        vec4 g (gx.x, gy.x, gz.x, gw.x);
+                        classicGradients [h] = g * taylorInvSqrt (dot (g, g));
+                        vec4 p = grad4 ((float) h, ip);
+                        simplexGradients [h] = p * taylorInvSqrt (dot (p, p));
+                        const float K = 0.142857142857f, Ko = 0.428571428571f, K2 = 0.020408163265306f, Kz = 0.166666666667f, Kzo = 0.416666666667f;
+                        float pab = (float) h;
+                        cellularOffsets [h] = vec4 (glslFract (pab * K) - Ko, glslMod (std::floor (pab * K), 7.0f) * K - Ko, std::floor (pab * K2) * Kz - Kzo, 0.0f);
+                    }
+                }
+            };
+
+            inline const NoiseTables& noiseTables () {
+                static const NoiseTables tables;
+                return tables;
+            }
+
+            // classic noise's gradients in the plane w = seed, by the hash of x, y and z
+            struct alignas (64) SeedTable {
+                vec4 gradients [289];
+            };
+
+            inline const SeedTable& seedTable (const int& seed) {
+                static SeedTable tables [289];
+                static std::once_flag built [289];
+                int w = lattice ((float) seed);
+                std::call_once (built [w], [w] () {
+                    const NoiseTables& t = noiseTables();
+                    for (int h = 0; h < 289; h++) {
+                        tables [w].gradients [h] = t.classicGradients [t.permute (h + w)];
+                    }
+                });
+                return tables [w];
+            }
+
+            // classic noise at (P, seed), from the tables
+            inline float cnoiseFromTables (const vec3& P, const int& seed) {
+                const NoiseTables& t = noiseTables();
+                const SeedTable& s = seedTable (seed);
+                vec3 Pi0 = floor (P);
+                int ix [2] = { lattice (Pi0.x), lattice (Pi0.x + 1.0f) };
+                int iy [2] = { lattice (Pi0.y), lattice (Pi0.y + 1.0f) };
+                int iz [2] = { lattice (Pi0.z), lattice (Pi0.z + 1.0f) };
+                vec3 Pf [2] = { fract (P), fract (P) - 1.0f };
+
+                // n [z][y][x], the dot product of each corner's gradient with the point's offset from it
+                float n [2][2][2];
+                for (int y = 0; y < 2; y++) {
+                    for (int x = 0; x < 2; x++) {
+                        int ixy = t.permute (t.permute (ix [x]) + iy [y]);
+                        for (int z = 0; z < 2; z++) {
+                            const vec4& g = s.gradients [t.permute (ixy + iz [z])];
+                            n [z][y][x] = g.x * Pf [x].x + g.y * Pf [y].y + g.z * Pf [z].z;
+                        }
+                    }
+                }
+
+                vec3 fade_xyz = Pf [0] * Pf [0] * Pf [0] * (Pf [0] * (Pf [0] * 6.0f - 15.0f) + 10.0f);
+                vec4 n_zw = mix (vec4 (n [0][0][0], n [0][0][1], n [0][1][0], n [0][1][1]), vec4 (n [1][0][0], n [1][0][1], n [1][1][0], n [1][1][1]), fade_xyz.z);
+                float n_yzw_x = glslMix (n_zw.x, n_zw.z, fade_xyz.y);
+                float n_yzw_y = glslMix (n_zw.y, n_zw.w, fade_xyz.y);
+                float n_xyzw = glslMix (n_yzw_x, n_yzw_y, fade_xyz.x);
+                return 2.2f * n_xyzw;
+            }
+
+            // the same as snoiseCorners, from the tables
+            inline void snoiseCornersFromTables (const vec4& i, const vec4& x0, vec4* x, vec4* p) {
+                const NoiseTables& t = noiseTables();
+                vec4 i1, i2, i3;
+                snoiseSteps (x0, i1, i2, i3, x);
+                int iw = lattice (i.w), iz = lattice (i.z), iy = lattice (i.y), ix = lattice (i.x);
+                p [0] = t.simplexGradients [t.permute (t.permute (t.permute (t.permute (iw) + iz) + iy) + ix)];
+                const vec4* steps [4] = { &i1, &i2, &i3, nullptr };
+                for (int k = 0; k < 4; k++) {
+                    vec4 step = steps [k] ? *steps [k] : vec4 (1.0f);
+                    int j = t.permute (t.permute (t.permute (t.permute (iw + (int) step.w) + iz + (int) step.z) + iy + (int) step.y) + ix + (int) step.x);
+                    p [k + 1] = t.simplexGradients [j];
+                }
+            }
+
+            inline float snoiseFromTables (const vec4& v) {
+                const float Cx = 0.138196601125010504f;  // (5 - sqrt(5))/20  G4
+                const float Cy = 0.309016994374947451f;  // (sqrt(5) - 1)/4   F4
+                vec4 i = floor (v + dot (v, vec4 (Cy)));
+                vec4 x0 = v - i + dot (i, vec4 (Cx));
+                vec4 x [5], p [5];
+                snoiseCornersFromTables (i, x0, x, p);
+                return snoiseSum (x, p);
+            }
+
+            // the same as cellular, from the tables
+            inline void cellularFromTables (vec3 P, const float& jitter, const float& seed, float& f1, float& f2) {
+                const NoiseTables& t = noiseTables();
+                P = P + seed;
+                vec3 Pi = floor (P);
+                int ix = lattice (Pi.x), iy = lattice (Pi.y), iz = lattice (Pi.z);
+                vec3 Pf = fract (P) - 0.5f;
+                vec3 Pfx = Pf.x + vec3 (1.0f, 0.0f, -1.0f);
+                float pfy [3] = { Pf.y + 1.0f, Pf.y + 0.0f, Pf.y + -1.0f };
+                float pfz [3] = { Pf.z + 1.0f, Pf.z + 0.0f, Pf.z + -1.0f };
+                int p [3] = { t.permute (ix - 1), t.permute (ix), t.permute (ix + 1) };
+                vec3 d [3][3];
+                for (int a = 0; a < 3; a++) {
+                    int pa [3];
+                    for (int c = 0; c < 3; c++) { pa [c] = t.permute (p [c] + iy + a - 1); }
+                    for (int b = 0; b < 3; b++) {
+                        const vec4& o0 = t.cellularOffsets [t.permute (pa [0] + iz + b - 1)];
+                        const vec4& o1 = t.cellularOffsets [t.permute (pa [1] + iz + b - 1)];
+                        const vec4& o2 = t.cellularOffsets [t.permute (pa [2] + iz + b - 1)];
+                        vec3 dx = Pfx + jitter * vec3 (o0.x, o1.x, o2.x);
+                        vec3 dy = pfy [a] + jitter * vec3 (o0.y, o1.y, o2.y);
+                        vec3 dz = pfz [b] + jitter * vec3 (o0.z, o1.z, o2.z);
+                        d [a][b] = dx * dx + dy * dy + dz * dz;
+                    }
+                }
+                cellularSort (d, f1, f2);
+            }
+
+            // the noise the module functions use
+            inline float classicNoise (const vec3& P, const int& seed) {
+#ifdef CALENHAD_NOISE_COMPATIBLE
+                return cnoise (vec4 (P.x, P.y, P.z, (float) seed));
+#else
+                return cnoiseFromTables (P, seed);
+#endif
+            }
+
+            inline float simplexNoise (const vec4& v) {
+#ifdef CALENHAD_NOISE_COMPATIBLE
+                return snoise (v);
+#else
+                return snoiseFromTables (v);
+#endif
+            }
+
+            inline void simplexCorners (const vec4& i, const vec4& x0, vec4* x, vec4* p) {
+#ifdef CALENHAD_NOISE_COMPATIBLE
+                snoiseCorners (i, x0, x, p);
+#else
+                snoiseCornersFromTables (i, x0, x, p);
+#endif
+            }
+
+            inline void cellularNoise (const vec3& P, const float& jitter, const float& seed, float& f1, float& f2) {
+#ifdef CALENHAD_NOISE_COMPATIBLE
+                cellular (P, jitter, seed, f1, f2);
+#else
+                cellularFromTables (P, jitter, seed, f1, f2);
+#endif
+            }
+
+            // Module functions
+
+            inline vec3 toCartesian (const float& lon, const float& lat) {
+                return vec3 (std::cos (lon) * std::cos (lat), std::sin (lat), std::cos (lat) * std::sin (lon));
+            }
+
+            inline void toGeolocation (const vec3& c, float& lon, float& lat) {
+                lon = std::atan2 (c.z, c.x);
+                lat = - (std::acos (c.y) - (M_PI_F / 2));
+            }
+
+            // a grid of values covering the planet, twice as wide as it is high, row by row from the north (as a Bake
+            // keeps them), interpolated between the centres of its cells, wrapping east to west
+            inline float sampleGrid (const float* values, const int& width, const int& height, const vec3& c) {
+                float lon, lat;
+                toGeolocation (c, lon, lat);
+                float x = (lon + M_PI_F) / (2.0f * M_PI_F) * width - 0.5f;
+                float y = (M_PI_F / 2.0f - lat) / M_PI_F * height - 0.5f;
+                int x0 = (int) std::floor (x), y0 = (int) std::floor (y);
+                float fx = x - x0, fy = y - y0;
+                int c0 = ((x0 % width) + width) % width, c1 = (c0 + 1) % width;
+                int r0 = std::min (std::max (y0, 0), height - 1), r1 = std::min (std::max (y0 + 1, 0), height - 1);
+                const float* row0 = values + r0 * width;
+                const float* row1 = values + r1 * width;
+                return glslMix (glslMix (row0 [c0], row0 [c1], fx), glslMix (row1 [c0], row1 [c1], fx), fy);
+            }
+
+            inline float cubicInterpolate (const float& n0, const float& n1, const float& n2, const float& n3, const float& a) {
+                float p = (n3 - n2) - (n0 - n1);
+                float q = (n0 - n1) - p;
+                float r = n2 - n0;
+                float s = n1;
+                return p * a * a * a + q * a * a + r * a + s;
+            }
+
+            inline vec3 rotate (vec3 pos, const vec3& degrees) {
+                float rz = degrees.z * M_PI_F / 180.0f, ry = degrees.y * M_PI_F / 180.0f, rx = degrees.x * M_PI_F / 180.0f;
+                float c = std::cos (rz), s = std::sin (rz);
+                pos = vec3 (c * pos.x - s * pos.y, s * pos.x + c * pos.y, pos.z);
+                c = std::cos (ry); s = std::sin (ry);
+                pos = vec3 (c * pos.x + s * pos.z, pos.y, - s * pos.x + c * pos.z);
+                c = std::cos (rx); s = std::sin (rx);
+                pos = vec3 (pos.x, c * pos.y - s * pos.z, s * pos.y + c * pos.z);
+                return pos;
+            }
+
+            // p' = m p + offset, m row by row: a chain of transforms fused into one (see ComputeWarp)
+            inline vec3 affine (const vec3& p, const float* m, const float* offset) {
+                return vec3 (p.x * m [0] + p.y * m [1] + p.z * m [2] + offset [0],
+                             p.x * m [3] + p.y * m [4] + p.z * m [5] + offset [1],
+                             p.x * m [6] + p.y * m [7] + p.z * m [8] + offset [2]);
+            }
+
+            inline float voronoi (const vec3& cartesian, const float& frequency, const float& displacement, const float& voronoiScale, const int& seed) {
+                float f1, f2;
+                cellularNoise (cartesian * frequency, displacement, (float) seed, f1, f2);
+                return ((((f2 - f1) + VORONOI_BIAS) * VORONOI_SCALE) - 1.0f) * voronoiScale;
+            }
+
+            inline float noise (const vec3& cartesian, const float& frequency, const float& lacunarity, const float& persistence, const int& octaves, int seed) {
+                float value = 0.0f;
+                float curPersistence = 1.0f;
+                vec3 n = cartesian * frequency;
+                for (int curOctave = 0; curOctave < octaves; curOctave++) {
+                    seed = seed + curOctave;
+                    float signal = simplexNoise (vec4 (n.x, n.y, n.z, (float) seed));
+                    value += signal * curPersistence;
+                    n = n * lacunarity;
+                    curPersistence *= persistence;
+                }
+                return value;
+            }
+
+            inline float perlin (const vec3& cartesian, const float& frequency, const float& lacunarity, const float& persistence, const int& octaves, const int& seed) {
+                return (noise (cartesian, frequency, lacunarity, persistence, octaves, seed) + PERLIN_BIAS) * PERLIN_SCALE;
+            }
+
+            inline float simplex (const vec3& cartesian, const float& frequency, const float& lacunarity, const float& persistence, const int& octaves, const int& seed) {
+                return noise (cartesian, frequency, lacunarity, persistence, octaves, seed) * SIMPLEX_SCALE;
+            }
+
+            inline float billow (const vec3& cartesian, const float& frequency, const float& lacunarity, const float& persistence, const int& octaves, int seed) {
+                float value = 0.0f;
+                float curPersistence = 1.0f;
+                vec3 n = cartesian * frequency;
+                for (int curOctave = 0; curOctave < octaves; curOctave++) {
+                    seed = seed + curOctave;
+                    float signal = classicNoise (n, seed);
+                    signal = 2.0f * std::fabs (signal) - 1.0f;
+                    value += signal * curPersistence;
+                    n = n * lacunarity;
+                    curPersistence *= persistence;
+                }
+                return (value + 0.5f + BILLOW_BIAS) * BILLOW_SCALE;
+            }
+
+            inline vec3 turbulence (const vec3& cartesian, const float& frequency, const float& power, const int& roughness, const int& seed) {
+                // mat3 (12414.0, 26519.0, 53820.0, 65124.0, 18128.0, 11213.0, 31337.0, 60493.0, 44845.0) / 65536, column major
+                vec3 pos (
+                    (12414.0f * cartesian.x + 65124.0f * cartesian.y + 31337.0f * cartesian.z) / 65536.0f,
+                    (26519.0f * cartesian.x + 18128.0f * cartesian.y + 60493.0f * cartesian.z) / 65536.0f,
+                    (53820.0f * cartesian.x + 11213.0f * cartesian.y + 44845.0f * cartesian.z) / 65536.0f);
+                return vec3 (
+                    cartesian.x + noise (pos, frequency, 2.0f, 0.5f, roughness, seed) * power,
+                    cartesian.y + noise (pos, frequency, 2.0f, 0.5f, roughness, seed + 1) * power,
+                    cartesian.z + noise (pos, frequency, 2.0f, 0.5f, roughness, seed + 2) * power);
+            }
+
+            inline float ridgedmulti (vec3 cartesian, const float& frequency, const float& lacunarity, const int& octaves, const int& seed,
+                                      const float& exponent, const float& offset, const float& gain, const float& sharpness) {
+                float pSpectralWeights [30];
+                float f = 1.0f;
+                for (int i = 0; i < 30; i++) {
+                    pSpectralWeights [i] = std::pow (f, - exponent);
+                    f *= lacunarity;
+                }
+                cartesian = cartesian * frequency;
+                float value = 0.0f;
+                float weight = 1.0f;
+                for (int curOctave = 0; curOctave < octaves && curOctave < 30; curOctave++) {
+                    int octaveSeed = (seed + curOctave) & 0x7fffffff;
+                    float signal = classicNoise (cartesian, octaveSeed);
+                    signal = std::fabs (signal);
+                    signal = offset - signal;
+                    signal = std::pow (signal, sharpness);
+                    signal *= weight;
+
+                    // the shader calls clamp (0.0, 1.0, signal * gain), which comes to min (1.0, signal * gain)
+                    weight = glslClamp (0.0f, 1.0f, signal * gain);
+                    value += (signal * pSpectralWeights [curOctave]);
+                    cartesian = cartesian * lacunarity;
+                }
+                return (((value) - 1.0f + RIDGED_MULTI_BIAS) * RIDGED_MULTI_SCALE) - 1.0f;
+            }
+
+            inline float cylinders (const vec3& cartesian, const float& frequency) {
+                float x = cartesian.x * frequency;
+                float z = cartesian.z * frequency;
+                float distFromCenter = std::sqrt (x * x + z * z);
+                float distFromSmallerSphere = distFromCenter - std::floor (distFromCenter);
+                float distFromLargerSphere = 1.0f - distFromSmallerSphere;
+                float nearestDist = std::min (distFromSmallerSphere, distFromLargerSphere);
+                return 1.0f - (nearestDist * 4.0f);
+            }
+
+            inline float spheres (const vec3& cartesian, const float& frequency) {
+                vec3 c = cartesian * frequency;
+                float distFromCenter = std::sqrt (c.x * c.x + c.y * c.y + c.z * c.z);
+                float distFromSmallerSphere = distFromCenter - std::floor (distFromCenter);
+                float distFromLargerSphere = 1.0f - distFromSmallerSphere;
+                float nearestDist = std::min (distFromSmallerSphere, distFromLargerSphere);
+                return 1.0f - (nearestDist * 4.0f);
+            }
+
+            inline float select (const float& control, const float& in0, const float& in1, const float& lowerBound, const float& upperBound, const float& edgeFalloff) {
+                float alpha = glslSmoothstep (-1.0f + edgeFalloff, 1.0f - edgeFalloff, control);
+                return glslMix (in0, in1, alpha);
+            }
+
+            // the lookup the graph writes into the shader for a biome module: rows are height bands, columns moisture
+            // bands, and a value on a boundary belongs to the band above it
+            inline float biome (const float& height, const float& moisture, const float* heights, const int& boundaries,
+                                const float* moistures, const int& columnBoundaries, const float* values) {
+                int row = 0;
+                while (row < boundaries && height >= heights [row]) { row++; }
+                int column = 0;
+                while (column < columnBoundaries && moisture >= moistures [column]) { column++; }
+                return values [row * (columnBoundaries + 1) + column];
+            }
+        }
+    }
+}
+
+#endif //CALENHAD_CPUFUNCTIONS_H
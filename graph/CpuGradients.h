@@ -0,0 +1,323 @@
+#ifndef CALENHAD_CPUGRADIENTS_H
+#define CALENHAD_CPUGRADIENTS_H
+
+// Versions of the functions in CpuFunctions.h which carry the gradient of every value along with it, as dual numbers:
+// each value comes with its derivatives with respect to the x, y and z of the point being evaluated. A module's slope
+// then comes out of one evaluation, exactly, where finite differences would take several evaluations and depend on
+// the step size. Values are computed in the same order as the plain functions, so they come out the same.
+//
+// Like CpuFunctions.h, this header uses the standard library only.
+
+#include <limits>
+#include "CpuFunctions.h"
+
+namespace calenhad {
+    namespace graph {
+        namespace cpu {
+
+            inline float dot (const vec3& a, const vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+            // a value and its gradient
+            struct dual {
+                float v;
+                vec3 d;
+                dual () : v (0.0f), d () { }
+                dual (const float& value) : v (value), d () { }
+                dual (const float& value, const vec3& gradient) : v (value), d (gradient) { }
+            };
+
+            inline dual operator+ (const dual& a, const dual& b) { return dual (a.v + b.v, a.d + b.d); }
+            inline dual operator- (const dual& a, const dual& b) { return dual (a.v - b.v, a.d - b.d); }
+            inline dual operator- (const dual& a) { return dual (- a.v, vec3 () - a.d); }
+            inline dual operator* (const dual& a, const dual& b) { return dual (a.v * b.v, a.d * b.v + b.d * a.v); }
+            inline dual operator/ (const dual& a, const dual& b) { return dual (a.v / b.v, (a.d * b.v - b.d * a.v) * (1.0f / (b.v * b.v))); }
+
+            inline dual abs (const dual& a) { return a.v < 0.0f ? - a : a; }
+            inline dual sin (const dual& a) { return dual (std::sin (a.v), a.d * std::cos (a.v)); }
+            inline dual cos (const dual& a) { return dual (std::cos (a.v), a.d * - std::sin (a.v)); }
+            inline dual sqrt (const dual& a) {
+                float s = std::sqrt (a.v);
+                return dual (s, s > 0.0f ? a.d * (0.5f / s) : vec3 ());
+            }
+            inline dual pow (const dual& a, const dual& b) {
+                float v = std::pow (a.v, b.v);
+                vec3 d = a.d * (b.v * std::pow (a.v, b.v - 1.0f));
+                if (a.v > 0.0f && (b.d.x != 0.0f || b.d.y != 0.0f || b.d.z != 0.0f)) {
+                    d = d + b.d * (v * std::log (a.v));
+                }
+                return dual (v, d);
+            }
+
+            // these choose between their arguments as std::min and std::max do, and the gradient goes with the choice
+            inline dual min (const dual& a, const dual& b) { return b.v < a.v ? b : a; }
+            inline dual max (const dual& a, const dual& b) { return a.v < b.v ? b : a; }
+            inline dual clamp (const dual& x, const dual& lo, const dual& hi) { return min (max (x, lo), hi); }
+            inline dual mix (const dual& a, const dual& b, const dual& t) { return a * (1.0f - t) + b * t; }
+            inline dual smoothstep (const float& e0, const float& e1, const dual& x) {
+                dual t = clamp ((x - e0) / (e1 - e0), 0.0f, 1.0f);
+                return t * t * (3.0f - 2.0f * t);
+            }
+
+            // a point and the gradient of each of its coordinates
+            struct dvec3 {
+                dual x, y, z;
+                dvec3 () { }
+                dvec3 (const dual& a, const dual& b, const dual& c) : x (a), y (b), z (c) { }
+            };
+
+            inline dvec3 operator+ (const dvec3& a, const dvec3& b) { return dvec3 (a.x + b.x, a.y + b.y, a.z + b.z); }
+            inline dvec3 operator* (const dvec3& a, const dvec3& b) { return dvec3 (a.x * b.x, a.y * b.y, a.z * b.z); }
+            inline dvec3 operator* (const dvec3& a, const dual& b) { return dvec3 (a.x * b, a.y * b, a.z * b); }
+
+            // the point being evaluated, whose coordinates' gradients are the axes
+            inline dvec3 origin (const vec3& p) {
+                return dvec3 (dual (p.x, vec3 (1.0f, 0.0f, 0.0f)), dual (p.y, vec3 (0.0f, 1.0f, 0.0f)), dual (p.z, vec3 (0.0f, 0.0f, 1.0f)));
+            }
+
+            inline vec3 value (const dvec3& p) { return vec3 (p.x.v, p.y.v, p.z.v); }
+
+            // chain rule: the gradient, with respect to the point being evaluated, of a function whose gradient with
+            // respect to its own argument p is g
+            inline vec3 chain (const dvec3& p, const vec3& g) { return p.x.d * g.x + p.y.d * g.y + p.z.d * g.z; }
+
+            // classic noise at (n, w), with its gradient through n
+            inline dual cnoise (const dvec3& n, const float& w) {
+                vec4 g [16], Pf0, Pf1;
+                cnoiseLattice (vec4 (n.x.v, n.y.v, n.z.v, w), g, Pf0, Pf1);
+
+                // each corner's contribution is linear in P, with the corner's gradient as its derivative
+                auto corner = [&g] (const int& i, const vec4& p) { return dual (dot (g [i], p), vec3 (g [i].x, g [i].y, g [i].z)); };
+                dual n0000 = corner (0, Pf0);
+                dual n1000 = corner (1, vec4 (Pf1.x, Pf0.y, Pf0.z, Pf0.w));
+                dual n0100 = corner (2, vec4 (Pf0.x, Pf1.y, Pf0.z, Pf0.w));
+                dual n1100 = corner (3, vec4 (Pf1.x, Pf1.y, Pf0.z, Pf0.w));
+                dual n0010 = corner (4, vec4 (Pf0.x, Pf0.y, Pf1.z, Pf0.w));
+                dual n1010 = corner (5, vec4 (Pf1.x, Pf0.y, Pf1.z, Pf0.w));
+                dual n0110 = corner (6, vec4 (Pf0.x, Pf1.y, Pf1.z, Pf0.w));
+                dual n1110 = corner (7, vec4 (Pf1.x, Pf1.y, Pf1.z, Pf0.w));
+                dual n0001 = corner (8, vec4 (Pf0.x, Pf0.y, Pf0.z, Pf1.w));
+                dual n1001 = corner (9, vec4 (Pf1.x, Pf0.y, Pf0.z, Pf1.w));
+                dual n0101 = corner (10, vec4 (Pf0.x, Pf1.y, Pf0.z, Pf1.w));
+                dual n1101 = corner (11, vec4 (Pf1.x, Pf1.y, Pf0.z, Pf1.w));
+                dual n0011 = corner (12, vec4 (Pf0.x, Pf0.y, Pf1.z, Pf1.w));
+                dual n1011 = corner (13, vec4 (Pf1.x, Pf0.y, Pf1.z, Pf1.w));
+                dual n0111 = corner (14, vec4 (Pf0.x, Pf1.y, Pf1.z, Pf1.w));
+                dual n1111 = corner (15, Pf1);
+
+                // fade is 6t^5 - 15t^4 + 10t^3, whose derivative is 30t^2 (t - 1)^2; w is fixed
+                vec4 f = fade (Pf0);
+                vec4 t = Pf0;
+                vec3 df (30.0f * t.x * t.x * (t.x - 1.0f) * (t.x - 1.0f), 30.0f * t.y * t.y * (t.y - 1.0f) * (t.y - 1.0f), 30.0f * t.z * t.z * (t.z - 1.0f) * (t.z - 1.0f));
+                dual fx (f.x, vec3 (df.x, 0.0f, 0.0f)), fy (f.y, vec3 (0.0f, df.y, 0.0f)), fz (f.z, vec3 (0.0f, 0.0f, df.z)), fw (f.w);
+
+                dual n_0w [4] = { mix (n0000, n0001, fw), mix (n1000, n1001, fw), mix (n0100, n0101, fw), mix (n1100, n1101, fw) };
+                dual n_1w [4] = { mix (n0010, n0011, fw), mix (n1010, n1011, fw), mix (n0110, n0111, fw), mix (n1110, n1111, fw) };
+                dual n_zw [4] = { mix (n_0w [0], n_1w [0], fz), mix (n_0w [1], n_1w [1], fz), mix (n_0w [2], n_1w [2], fz), mix (n_0w [3], n_1w [3], fz) };
+                dual n_yzw_x = mix (n_zw [0], n_zw [2], fy);
+                dual n_yzw_y = mix (n_zw [1], n_zw [3], fy);
+                dual n_xyzw = mix (n_yzw_x, n_yzw_y, fx);
+                dual result = 2.2f * n_xyzw;
+                return dual (result.v, chain (n, result.d));
+            }
+
+            // simplex noise at (n, w), with its gradient through n
+            inline dual snoise (const dvec3& n, const float& w) {
+                vec4 x [5], p [5];
+                snoiseCorners (vec4 (n.x.v, n.y.v, n.z.v, w), x, p);
+
+                // each corner contributes m^4 (p . x), where m = max (0.6 - x . x, 0) and x moves with the point
+                float m [5], term [5];
+                vec3 gradient;
+                for (int i = 0; i < 5; i++) {
+                    m [i] = std::max (0.6f - dot (x [i], x [i]), 0.0f);
+                    float m2 = m [i] * m [i];
+                    float px = dot (p [i], x [i]);
+                    term [i] = m2 * m2 * px;
+                    gradient = gradient + vec3 (p [i].x, p [i].y, p [i].z) * (m2 * m2) - vec3 (x [i].x, x [i].y, x [i].z) * (8.0f * m2 * m [i] * px);
+                }
+                float v = 49.0f * ((term [0] + term [1] + term [2]) + (term [3] + term [4]));
+                return dual (v, chain (n, gradient * 49.0f));
+            }
+
+            inline dual cubicInterpolate (const float& n0, const float& n1, const float& n2, const float& n3, const dual& a) {
+                float p = (n3 - n2) - (n0 - n1);
+                float q = (n0 - n1) - p;
+                float r = n2 - n0;
+                float s = n1;
+                return p * a * a * a + q * a * a + r * a + s;
+            }
+
+            inline dvec3 rotate (dvec3 pos, const dvec3& degrees) {
+                dual rz = degrees.z * M_PI_F / 180.0f, ry = degrees.y * M_PI_F / 180.0f, rx = degrees.x * M_PI_F / 180.0f;
+                dual c = cos (rz), s = sin (rz);
+                pos = dvec3 (c * pos.x - s * pos.y, s * pos.x + c * pos.y, pos.z);
+                c = cos (ry); s = sin (ry);
+                pos = dvec3 (c * pos.x + s * pos.z, pos.y, - s * pos.x + c * pos.z);
+                c = cos (rx); s = sin (rx);
+                pos = dvec3 (pos.x, c * pos.y - s * pos.z, s * pos.y + c * pos.z);
+                return pos;
+            }
+
+            // The value is voronoi's own. For the gradient, the two nearest feature points are found again as
+            // cellular finds them, keeping where they are: the distance to each moves with the sample point, and with
+            // the displacement, which moves the feature points along their jitter.
+            inline dual voronoi (const dvec3& cartesian, const dual& frequency, const dual& displacement, const float& voronoiScale, const int& seed) {
+                float v = voronoi (value (cartesian), frequency.v, displacement.v, voronoiScale, seed);
+
+                const float K = 0.142857142857f;     // 1/7
+                const float Ko = 0.428571428571f;    // 1/2-K/2
+                const float K2 = 0.020408163265306f; // 1/(7*7)
+                const float Kz = 0.166666666667f;    // 1/6
+                const float Kzo = 0.416666666667f;   // 1/2-1/6*2
+
+                dvec3 P = cartesian * frequency;
+                vec3 c = value (P) + (float) seed;
+                vec3 Pi = mod (floor (c), 289.0f);
+                vec3 Pf = fract (c) - 0.5f;
+                float pfx [3] = { Pf.x + 1.0f, Pf.x, Pf.x - 1.0f };
+                float pfy [3] = { Pf.y + 1.0f, Pf.y, Pf.y - 1.0f };
+                float pfz [3] = { Pf.z + 1.0f, Pf.z, Pf.z - 1.0f };
+                float jitter = displacement.v;
+
+                float nearest [2] = { std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+                vec3 delta [2], offset [2];
+                vec3 p = permute (Pi.x + vec3 (-1.0f, 0.0f, 1.0f));
+                for (int a = 0; a < 3; a++) {
+                    vec3 pa = permute (p + Pi.y + (float) (a - 1));
+                    for (int b = 0; b < 3; b++) {
+                        vec3 pab = permute (pa + Pi.z + (float) (b - 1));
+                        vec3 ox = fract (pab * K) - Ko;
+                        vec3 oy = mod (floor (pab * K), 7.0f) * K - Ko;
+                        vec3 oz = floor (pab * K2) * Kz - Kzo;
+                        float oxs [3] = { ox.x, ox.y, ox.z }, oys [3] = { oy.x, oy.y, oy.z }, ozs [3] = { oz.x, oz.y, oz.z };
+                        for (int l = 0; l < 3; l++) {
+                            vec3 o (oxs [l], oys [l], ozs [l]);
+                            vec3 d (pfx [l] + jitter * o.x, pfy [a] + jitter * o.y, pfz [b] + jitter * o.z);
+                            float d2 = dot (d, d);
+                            if (d2 < nearest [0]) {
+                                nearest [1] = nearest [0]; delta [1] = delta [0]; offset [1] = offset [0];
+                                nearest [0] = d2; delta [0] = d; offset [0] = o;
+                            } else if (d2 < nearest [1]) {
+                                nearest [1] = d2; delta [1] = d; offset [1] = o;
+                            }
+                        }
+                    }
+                }
+
+                // d (|delta|) = delta . d (delta) / |delta|, and delta moves with P and with the jitter
+                vec3 gradient [2];
+                for (int k = 0; k < 2; k++) {
+                    float distance = std::sqrt (nearest [k]);
+                    if (distance > 0.0f) {
+                        const vec3& d = delta [k];
+                        const vec3& o = offset [k];
+                        vec3 moved = P.x.d * d.x + P.y.d * d.y + P.z.d * d.z + displacement.d * dot (d, o);
+                        gradient [k] = moved * (1.0f / distance);
+                    }
+                }
+                return dual (v, (gradient [1] - gradient [0]) * (VORONOI_SCALE * voronoiScale));
+            }
+
+            inline dual noise (const dvec3& cartesian, const dual& frequency, const dual& lacunarity, const dual& persistence, const int& octaves, int seed) {
+                dual value (0.0f);
+                dual curPersistence (1.0f);
+                dvec3 n = cartesian * frequency;
+                for (int curOctave = 0; curOctave < octaves; curOctave++) {
+                    seed = seed + curOctave;
+                    dual signal = snoise (n, (float) seed);
+                    value = value + signal * curPersistence;
+                    n = n * lacunarity;
+                    curPersistence = curPersistence * persistence;
+                }
+                return value;
+            }
+
+            inline dual perlin (const dvec3& cartesian, const dual& frequency, const dual& lacunarity, const dual& persistence, const int& octaves, const int& seed) {
+                return (noise (cartesian, frequency, lacunarity, persistence, octaves, seed) + PERLIN_BIAS) * PERLIN_SCALE;
+            }
+
+            inline dual simplex (const dvec3& cartesian, const dual& frequency, const dual& lacunarity, const dual& persistence, const int& octaves, const int& seed) {
+                return noise (cartesian, frequency, lacunarity, persistence, octaves, seed) * SIMPLEX_SCALE;
+            }
+
+            inline dual billow (const dvec3& cartesian, const dual& frequency, const dual& lacunarity, const dual& persistence, const int& octaves, int seed) {
+                dual value (0.0f);
+                dual curPersistence (1.0f);
+                dvec3 n = cartesian * frequency;
+                for (int curOctave = 0; curOctave < octaves; curOctave++) {
+                    seed = seed + curOctave;
+                    dual signal = cnoise (n, (float) seed);
+                    signal = 2.0f * abs (signal) - 1.0f;
+                    value = value + signal * curPersistence;
+                    n = n * lacunarity;
+                    curPersistence = curPersistence * persistence;
+                }
+                return (value + 0.5f + BILLOW_BIAS) * BILLOW_SCALE;
+            }
+
+            inline dvec3 turbulence (const dvec3& cartesian, const dual& frequency, const dual& power, const int& roughness, const int& seed) {
+                dvec3 pos (
+                    (12414.0f * cartesian.x + 65124.0f * cartesian.y + 31337.0f * cartesian.z) / 65536.0f,
+                    (26519.0f * cartesian.x + 18128.0f * cartesian.y + 60493.0f * cartesian.z) / 65536.0f,
+                    (53820.0f * cartesian.x + 11213.0f * cartesian.y + 44845.0f * cartesian.z) / 65536.0f);
+                return dvec3 (
+                    cartesian.x + noise (pos, frequency, 2.0f, 0.5f, roughness, seed) * power,
+                    cartesian.y + noise (pos, frequency, 2.0f, 0.5f, roughness, seed + 1) * power,
+                    cartesian.z + noise (pos, frequency, 2.0f, 0.5f, roughness, seed + 2) * power);
+            }
+
+            inline dual ridgedmulti (dvec3 cartesian, const dual& frequency, const dual& lacunarity, const int& octaves, const int& seed,
+                                     const float& exponent, const float& offset, const float& gain, const float& sharpness) {
+                dual pSpectralWeights [30];
+                dual f (1.0f);
+                for (int i = 0; i < 30; i++) {
+                    pSpectralWeights [i] = pow (f, - exponent);
+                    f = f * lacunarity;
+                }
+                cartesian = cartesian * frequency;
+                dual value (0.0f);
+                dual weight (1.0f);
+                for (int curOctave = 0; curOctave < octaves && curOctave < 30; curOctave++) {
+                    int octaveSeed = (seed + curOctave) & 0x7fffffff;
+                    dual signal = cnoise (cartesian, (float) octaveSeed);
+                    signal = abs (signal);
+                    signal = offset - signal;
+                    signal = pow (signal, sharpness);
+                    signal = signal * weight;
+
+                    // as in ridgedmulti, clamp (0.0, 1.0, signal * gain) comes to min (1.0, signal * gain)
+                    weight = min (1.0f, signal * gain);
+                    value = value + (signal * pSpectralWeights [curOctave]);
+                    cartesian = cartesian * lacunarity;
+                }
+                return (((value) - 1.0f + RIDGED_MULTI_BIAS) * RIDGED_MULTI_SCALE) - 1.0f;
+            }
+
+            inline dual cylinders (const dvec3& cartesian, const dual& frequency) {
+                dual x = cartesian.x * frequency;
+                dual z = cartesian.z * frequency;
+                dual distFromCenter = sqrt (x * x + z * z);
+                dual distFromSmallerSphere = distFromCenter - std::floor (distFromCenter.v);
+                dual distFromLargerSphere = 1.0f - distFromSmallerSphere;
+                dual nearestDist = min (distFromSmallerSphere, distFromLargerSphere);
+                return 1.0f - (nearestDist * 4.0f);
+            }
+
+            inline dual spheres (const dvec3& cartesian, const dual& frequency) {
+                dvec3 c = cartesian * frequency;
+                dual distFromCenter = sqrt (c.x * c.x + c.y * c.y + c.z * c.z);
+                dual distFromSmallerSphere = distFromCenter - std::floor (distFromCenter.v);
+                dual distFromLargerSphere = 1.0f - distFromSmallerSphere;
+                dual nearestDist = min (distFromSmallerSphere, distFromLargerSphere);
+                return 1.0f - (nearestDist * 4.0f);
+            }
+
+            inline dual select (const dual& control, const dual& in0, const dual& in1, const float& lowerBound, const float& upperBound, const float& edgeFalloff) {
+                dual alpha = smoothstep (-1.0f + edgeFalloff, 1.0f - edgeFalloff, control);
+                return mix (in0, in1, alpha);
+            }
+        }
+    }
+}
+
+#endif //CALENHAD_CPUGRADIENTS_H
@@ -0,0 +1,317 @@
+#include "GradientEvaluator.h"
+#include <limits>
+#include "CpuEvaluator.h"
+#include "../icosphere/Dataset.h"
+
+using namespace calenhad::graph;
+using namespace calenhad::graph::cpu;
+
+GradientEvaluator::GradientEvaluator (const ComputeGraph* graph) : _graph (graph) {
+    if (! _graph -> isValid()) {
+        _error = _graph -> error();
+        return;
+    }
+    for (const ComputeNode& node : _graph -> nodes()) {
+        if (! supports (node.operation)) {
+            _error = "Module " + node.name + " has no gradient";
+            return;
+        }
+    }
+}
+
+GradientEvaluator::~GradientEvaluator() {
+
+}
+
+const ComputeGraph* GradientEvaluator::graph() const {
+    return _graph;
+}
+
+bool GradientEvaluator::isValid() const {
+    return _error.isEmpty();
+}
+
+QString GradientEvaluator::error() const {
+    return _error;
+}
+
+bool GradientEvaluator::supports (const ComputeOperation& operation) {
+    switch (operation) {
+        case OpConstant: case OpAbs: case OpInvert: case OpAdd: case OpMax: case OpMin: case OpMultiply: case OpPower:
+        case OpDiff: case OpBlend: case OpTranslate: case OpRotate: case OpScalePoint: case OpCylinders: case OpSpheres:
+        case OpClamp: case OpPerlin: case OpSimplex: case OpBillow: case OpRidgedMulti: case OpScaleAndBias: case OpSelect:
+        case OpTurbulence: case OpVoronoi: case OpAltitudeMap: case OpRaster: case OpBiome:
+            return true;
+        default:
+            return false;
+    }
+}
+
+float GradientEvaluator::evaluate (const float& x, const float& y, const float& z, float* gradient) const {
+    float xyz [3] = { x, y, z };
+    float out;
+    evaluate (xyz, &out, gradient, 1);
+    return out;
+}
+
+void GradientEvaluator::evaluate (const float* xyz, float* out, float* gradients, const size_t& n) const {
+    if (! isValid()) {
+        std::fill (out, out + n, 0.0f);
+        std::fill (gradients, gradients + n * 3, 0.0f);
+        return;
+    }
+    for (size_t start = 0; start < n; start += BatchSize) {
+        Frame frame;
+        frame.n = std::min (BatchSize, n - start);
+        frame.coordinates.resize (frame.n);
+        for (size_t i = 0; i < frame.n; i++) {
+            const float* p = xyz + (start + i) * 3;
+            frame.coordinates [i] = origin (vec3 (p [0], p [1], p [2]));
+        }
+        frame.values.resize (_graph -> nodes().size());
+        const dual* result = value (frame, _graph -> output());
+        for (size_t i = 0; i < frame.n; i++) {
+            out [start + i] = result [i].v;
+            gradients [(start + i) * 3] = result [i].d.x;
+            gradients [(start + i) * 3 + 1] = result [i].d.y;
+            gradients [(start + i) * 3 + 2] = result [i].d.z;
+        }
+    }
+}
+
+// Heights are measured along the radius, so only the gradient's component along the surface tilts it.
+void GradientEvaluator::tangential (const float* xyz, const float* gradient, float* out) {
+    float r2 = xyz [0] * xyz [0] + xyz [1] * xyz [1] + xyz [2] * xyz [2];
+    float radial = r2 > 0.0f ? (gradient [0] * xyz [0] + gradient [1] * xyz [1] + gradient [2] * xyz [2]) / r2 : 0.0f;
+    for (int k = 0; k < 3; k++) {
+        out [k] = gradient [k] - radial * xyz [k];
+    }
+}
+
+float GradientEvaluator::slope (const float* xyz, const float* gradient, const float& scale) {
+    float t [3];
+    tangential (xyz, gradient, t);
+    return scale * std::sqrt (t [0] * t [0] + t [1] * t [1] + t [2] * t [2]);
+}
+
+void GradientEvaluator::normal (const float* xyz, const float* gradient, const float& scale, float* out) {
+    float t [3];
+    tangential (xyz, gradient, t);
+    float r = std::sqrt (xyz [0] * xyz [0] + xyz [1] * xyz [1] + xyz [2] * xyz [2]);
+    float length = 0.0f;
+    for (int k = 0; k < 3; k++) {
+        out [k] = (r > 0.0f ? xyz [k] / r : 0.0f) - scale * t [k];
+        length += out [k] * out [k];
+    }
+    length = std::sqrt (length);
+    if (length > 0.0f) {
+        for (int k = 0; k < 3; k++) { out [k] /= length; }
+    }
+}
+
+const dual* GradientEvaluator::value (Frame& frame, const int& node) const {
+    std::vector<dual>& values = frame.values [node];
+    if (values.empty()) {
+        values.resize (frame.n);
+        compute (frame, node, values.data());
+    }
+    return values.data();
+}
+
+GradientEvaluator::Frame* GradientEvaluator::transformed (Frame& frame, const int& index) const {
+    auto found = frame.children.find (index);
+    if (found != frame.children.end()) { return found -> second.get(); }
+
+    const ComputeNode& node = _graph -> nodes().at (index);
+    size_t n = frame.n;
+    std::unique_ptr<Frame> child (new Frame());
+    child -> n = n;
+    child -> coordinates.resize (n);
+    child -> values.resize (_graph -> nodes().size());
+
+    // the transform's own inputs are sampled at the untransformed point, as they are in the shader
+    std::vector<dual> constants [4];
+    const dual* in [4] = { nullptr, nullptr, nullptr, nullptr };
+    for (int k = 1; k < std::min (4, (int) node.inputs.size()); k++) {
+        const ComputeInput& input = node.inputs.at (k);
+        if (input.node >= 0) {
+            in [k] = value (frame, input.node);
+        } else {
+            constants [k].assign (n, dual (input.value));
+            in [k] = constants [k].data();
+        }
+    }
+
+    // the transformed point carries its own gradient, so whatever is evaluated there differentiates through the transform
+    for (size_t i = 0; i < n; i++) {
+        dvec3 p = frame.coordinates [i];
+        switch (node.operation) {
+            case OpTranslate: p = p + dvec3 (in [1][i], in [2][i], in [3][i]); break;
+            case OpRotate: p = rotate (p, dvec3 (in [1][i], in [2][i], in [3][i])); break;
+            case OpScalePoint: p = p * dvec3 (in [1][i], in [2][i], in [3][i]); break;
+            case OpTurbulence: p = turbulence (p, in [1][i], in [2][i], (int) in [3][i].v, (int) node.parameters [0]); break;
+            default: break;
+        }
+        child -> coordinates [i] = p;
+    }
+
+    Frame* result = child.get();
+    frame.children [index] = std::move (child);
+    return result;
+}
+
+void GradientEvaluator::compute (Frame& frame, const int& index, dual* out) const {
+    const ComputeNode& node = _graph -> nodes().at (index);
+    size_t n = frame.n;
+
+    if (ComputeGraph::isCoordinateTransform (node.operation)) {
+        Frame* child = transformed (frame, index);
+        const dual* source = value (*child, node.inputs.first().node);
+        std::copy (source, source + n, out);
+        return;
+    }
+
+    std::vector<dual> constants [4];
+    const dual* in [4] = { nullptr, nullptr, nullptr, nullptr };
+    for (int k = 0; k < std::min (4, (int) node.inputs.size()); k++) {
+        const ComputeInput& input = node.inputs.at (k);
+        if (input.node >= 0) {
+            in [k] = value (frame, input.node);
+        } else {
+            constants [k].assign (n, dual (input.value));
+            in [k] = constants [k].data();
+        }
+    }
+    const std::vector<dvec3>& xyz = frame.coordinates;
+    const QVector<float>& p = node.parameters;
+
+    switch (node.operation) {
+        case OpConstant: std::fill (out, out + n, dual (p [0])); break;
+        case OpAbs: for (size_t i = 0; i < n; i++) { out [i] = abs (in [0][i]); } break;
+        case OpInvert: for (size_t i = 0; i < n; i++) { out [i] = - in [0][i]; } break;
+        case OpAdd: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] + in [1][i]; } break;
+        case OpMax: for (size_t i = 0; i < n; i++) { out [i] = max (in [0][i], in [1][i]); } break;
+        case OpMin: for (size_t i = 0; i < n; i++) { out [i] = min (in [0][i], in [1][i]); } break;
+        case OpMultiply: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] * in [1][i]; } break;
+        case OpPower: for (size_t i = 0; i < n; i++) { out [i] = pow (in [0][i], in [1][i]); } break;
+        case OpDiff: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] - in [1][i]; } break;
+        case OpBlend: for (size_t i = 0; i < n; i++) { out [i] = mix (in [0][i], in [1][i], in [2][i]); } break;
+        case OpClamp: for (size_t i = 0; i < n; i++) { out [i] = clamp (in [0][i], in [1][i], in [2][i]); } break;
+        case OpScaleAndBias: for (size_t i = 0; i < n; i++) { out [i] = in [0][i] * in [1][i] + in [2][i]; } break;
+        case OpSelect:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = select (in [0][i], in [1][i], in [2][i], p [0], p [1], p [2]);
+            }
+            break;
+        case OpCylinders: for (size_t i = 0; i < n; i++) { out [i] = cylinders (xyz [i], in [0][i]); } break;
+        case OpSpheres: for (size_t i = 0; i < n; i++) { out [i] = spheres (xyz [i], in [0][i]); } break;
+        case OpPerlin:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = perlin (xyz [i], in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpSimplex:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = simplex (xyz [i], in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpBillow:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = billow (xyz [i], in [0][i], in [1][i], in [2][i], (int) p [0], (int) p [1]);
+            }
+            break;
+        case OpRidgedMulti:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = ridgedmulti (xyz [i], in [0][i], in [1][i], (int) p [0], (int) p [1], p [2], p [3], p [4], p [5]);
+            }
+            break;
+        case OpVoronoi:
+            for (size_t i = 0; i < n; i++) {
+                out [i] = voronoi (xyz [i], in [0][i], in [1][i], p [0], (int) p [1]);
+            }
+            break;
+        case OpAltitudeMap: {
+            const ComputeCurve& curve = _graph -> curve (node.table);
+            for (size_t i = 0; i < n; i++) {
+                out [i] = mapAltitude (curve, in [0][i]);
+            }
+            break;
+        }
+        case OpRaster: {
+            const ComputeRaster& raster = _graph -> raster (node.table);
+            for (size_t i = 0; i < n; i++) {
+                out [i] = sampleRaster (raster, xyz [i], in [0][i]);
+            }
+            break;
+        }
+        case OpBiome: {
+            // the classes are constant between boundaries, so the gradient is zero wherever it is defined
+            const ComputeBiome& b = _graph -> biome (node.table);
+            for (size_t i = 0; i < n; i++) {
+                out [i] = dual (biome (in [0][i].v, in [1][i].v, b.heights.constData(), b.heights.size(), b.moistures.constData(), b.moistures.size(), b.values.constData()));
+            }
+            break;
+        }
+        default:
+            // not reached: the constructor turns down graphs with any other operation
+            std::fill (out, out + n, dual (std::numeric_limits<float>::quiet_NaN()));
+    }
+}
+
+// follows CpuEvaluator::mapAltitude, with the interpolation parameter carrying the input's gradient
+dual GradientEvaluator::mapAltitude (const ComputeCurve& curve, const dual& value) const {
+    const QVector<QPointF>& e = curve.entries;
+    int last = e.size() - 1;
+    if (value.v < e.first().x()) { return dual ((float) e.first().y()); }
+    for (int j = 0; j < e.size(); j++) {
+        if (curve.terrace) {
+            const QPointF& e0 = e.at (std::min (std::max (j - 1, 0), last));
+            const QPointF& e1 = e.at (std::min (j, last));
+            if (value.v > e0.x() && value.v <= e1.x()) {
+                dual alpha = (value - (float) e0.x()) / (float) (e1.x() - e0.x());
+                if (curve.inverted) { alpha = 1.0f - alpha; }
+                alpha = alpha * alpha;
+                return curve.inverted ? mix ((float) e1.y(), (float) e0.y(), alpha) : mix ((float) e0.y(), (float) e1.y(), alpha);
+            }
+        } else {
+            const QPointF& e0 = e.at (std::min (std::max (j - 2, 0), last));
+            const QPointF& e1 = e.at (std::min (std::max (j - 1, 0), last));
+            const QPointF& e2 = e.at (std::min (j, last));
+            const QPointF& e3 = e.at (std::min (j + 1, last));
+            if (value.v > e1.x() && value.v <= e2.x()) {
+                dual alpha = (value - (float) e1.x()) / (float) (e2.x() - e1.x());
+                return cubicInterpolate ((float) e0.y(), (float) e1.y(), (float) e2.y(), (float) e3.y(), alpha);
+            }
+        }
+    }
+    if (value.v > e.last().x()) { return dual ((float) e.last().y()); }
+    return dual ((float) e.first().y());
+}
+
+// A raster is interpolated linearly between texels, so its slope is differenced across about a texel, on the sphere;
+// a field's dataset is interpolated across the triangles of its icosphere, so across about the distance between vertices.
+// The sample falls back on the default value in proportion to the raster's transparency, and so does its gradient.
+dual GradientEvaluator::sampleRaster (const ComputeRaster& raster, const dvec3& p, const dual& defaultValue) const {
+    if (raster.image.isNull() && raster.values.isEmpty() && ! raster.dataset) { return defaultValue; }
+    vec3 c = cpu::value (p);
+    float v = CpuEvaluator::sampleRaster (raster, c.x, c.y, c.z, defaultValue.v);
+
+    float h;
+    if (raster.dataset) {
+        h = std::sqrt (4.0f * M_PI_F / std::max (raster.dataset -> size(), 1u));
+    } else {
+        h = M_PI_F / (raster.values.isEmpty() ? raster.image.width() : raster.height);
+    }
+    float g [3];
+    for (int k = 0; k < 3; k++) {
+        vec3 a = c, b = c;
+        float* ak = k == 0 ? &a.x : k == 1 ? &a.y : &a.z;
+        float* bk = k == 0 ? &b.x : k == 1 ? &b.y : &b.z;
+        *ak += h; *bk -= h;
+        float la = std::sqrt (a.x * a.x + a.y * a.y + a.z * a.z), lb = std::sqrt (b.x * b.x + b.y * b.y + b.z * b.z);
+        a = a * (1.0f / la); b = b * (1.0f / lb);
+        g [k] = (CpuEvaluator::sampleRaster (raster, a.x, a.y, a.z, defaultValue.v) - CpuEvaluator::sampleRaster (raster, b.x, b.y, b.z, defaultValue.v)) / (2.0f * h);
+    }
+    float transparency = CpuEvaluator::sampleRaster (raster, c.x, c.y, c.z, 1.0f) - CpuEvaluator::sampleRaster (raster, c.x, c.y, c.z, 0.0f);
+    return dual (v, chain (p, vec3 (g [0], g [1], g [2])) + defaultValue.d * transparency);
+}
@@ -0,0 +1,76 @@
+#ifndef CALENHAD_GRADIENTEVALUATOR_H
+#define CALENHAD_GRADIENTEVALUATOR_H
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+#include "ComputeGraph.h"
+#include "CpuGradients.h"
+
+namespace calenhad {
+    namespace graph {
+
+        // Evaluates a ComputeGraph on the CPU together with the gradient of its output with respect to the sample
+        // point, carrying derivatives through every node as dual numbers (see CpuGradients.h). A slope or a surface
+        // normal then costs about one evaluation, where finite differences take four, and does not depend on a step
+        // size. Values are the same as CpuEvaluator gives.
+        //
+        // Noise generators and arithmetic differentiate exactly. Biome lookups are stepwise, so their gradient is zero;
+        // rasters are differenced across a texel since their samples interpolate linearly. Where a module has a crease
+        // (abs, max, min, the edge of a voronoi cell) the gradient is that of the side the point falls on.
+        //
+        // A graph with an operation that has no derivative here is rejected: isValid is false, error says which module
+        // it was, and evaluate gives zeros rather than a value without its gradient.
+        //
+        // Like CpuEvaluator, an evaluator holds no state between calls and the graph must outlive it.
+        class GradientEvaluator {
+        public:
+            GradientEvaluator (const ComputeGraph* graph);
+            ~GradientEvaluator();
+
+            // xyz holds n cartesian points (x0, y0, z0, x1, y1, z1 ...); out receives n values and gradients receives
+            // n gradients (dx0, dy0, dz0, dx1 ...), with respect to x, y and z
+            void evaluate (const float* xyz, float* out, float* gradients, const size_t& n) const;
+            float evaluate (const float& x, const float& y, const float& z, float* gradient) const;
+
+            const ComputeGraph* graph () const;
+            bool isValid () const;
+            QString error () const;
+
+            // whether an operation's gradient can be evaluated
+            static bool supports (const ComputeOperation& operation);
+
+            // the part of a gradient along the sphere's surface at a point, which is what a slope follows
+            static void tangential (const float* xyz, const float* gradient, float* out);
+
+            // the steepness of the surface at a point, as rise over run, where the output is a height scaled by scale
+            static float slope (const float* xyz, const float* gradient, const float& scale = 1.0f);
+
+            // the unit normal to the surface at a point, where the output is a height scaled by scale
+            static void normal (const float* xyz, const float* gradient, const float& scale, float* out);
+
+            static constexpr size_t BatchSize = 256;
+
+        protected:
+            struct Frame {
+                size_t n;
+                std::vector<cpu::dvec3> coordinates;
+                std::vector<std::vector<cpu::dual>> values;
+                std::map<int, std::unique_ptr<Frame>> children;
+            };
+
+            const ComputeGraph* _graph;
+            QString _error;
+
+            const cpu::dual* value (Frame& frame, const int& node) const;
+            void compute (Frame& frame, const int& index, cpu::dual* out) const;
+            Frame* transformed (Frame& frame, const int& index) const;
+            cpu::dual mapAltitude (const ComputeCurve& curve, const cpu::dual& value) const;
+            cpu::dual sampleRaster (const ComputeRaster& raster, const cpu::dvec3& p, const cpu::dual& defaultValue) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_GRADIENTEVALUATOR_H
@@ -0,0 +1,25 @@
+#ifndef CALENHAD_INTERVAL_H
+#define CALENHAD_INTERVAL_H
+
+namespace calenhad {
+    namespace graph {
+
+        // A closed range of values. An empty input or a NaN anywhere gives the unbounded interval.
+        struct Interval {
+            double lo, hi;
+
+            Interval ();
+            Interval (const double& value);
+            Interval (const double& lo, const double& hi);
+
+            static Interval unbounded ();
+            static Interval hull (const Interval& a, const Interval& b);
+
+            bool isBounded () const;
+            bool contains (const double& value) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_INTERVAL_H
@@ -0,0 +1,561 @@
+#include "NativeCompiler.h"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+#include <CalenhadServices.h>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPair>
+#include <QtCore/QProcess>
+#include <QtCore/QSaveFile>
+#include "preferences/preferences.h"
+#include "ComputeGraph.h"
+#include "CpuEvaluator.h"
+
+using namespace calenhad;
+using namespace calenhad::graph;
+
+QMutex NativeCompiler::_mutex;
+QMap<QString, std::weak_ptr<NativeModule>> NativeCompiler::_loaded;
+
+namespace {
+
+    // the floating point flags must leave the arithmetic alone, so that the results match the interpreter's, and the
+    // noise has to come from the same place as the interpreter's (see CpuFunctions.h)
+    const QStringList CompilerFlags = { "-std=c++17", "-O3", "-march=native", "-ffp-contract=off", "-fno-fast-math", "-fPIC", "-shared"
+#ifdef CALENHAD_NOISE_COMPATIBLE
+                                        , "-DCALENHAD_NOISE_COMPATIBLE"
+#endif
+    };
+
+    // exact literals, written in hexadecimal so that nothing is lost in the round trip through the source
+    QString literal (const float& value) {
+        if (std::isnan (value)) { return "std::numeric_limits<float>::quiet_NaN()"; }
+        if (std::isinf (value)) { return value > 0 ? "std::numeric_limits<float>::infinity()" : "(- std::numeric_limits<float>::infinity())"; }
+        char text [64];
+        std::snprintf (text, sizeof (text), "(%af)", (double) value);
+        return QString (text);
+    }
+
+    QString literal (const double& value) {
+        char text [64];
+        std::snprintf (text, sizeof (text), "(%a)", value);
+        return QString (text);
+    }
+
+    // Writes the statements for a batch. As in CpuEvaluator, each node is evaluated for the whole batch in turn and
+    // each (node, coordinate set) pair is computed only once; a coordinate transform opens a new coordinate set
+    // for its source.
+    //
+    // As the shader does, each of the graph's functions is written once, by a writer of its own, as a function of a
+    // batch of coordinates and its arguments - batches for inputs from other nodes, single values for port values.
+    class SourceWriter {
+    public:
+        SourceWriter (const ComputeGraph& graph, const int& function = -1) : _graph (graph), _frames (1), _function (function) {
+            if (function >= 0) {
+                const ComputeFunction& f = graph.functions().at (function);
+                const ComputeCall& first = graph.calls().at (firstCall (graph, function));
+                for (int j = 0; j < f.arguments.size(); j++) {
+                    QString a = "a" + QString::number (j);
+                    _arguments.insert (QPair<int, int> (f.nodes.at (f.arguments.at (j).first), f.arguments.at (j).second), first.arguments.at (j).node >= 0 ? a + " [i]" : a);
+                }
+            }
+        }
+
+        QString function() {
+            const ComputeFunction& f = _graph.functions().at (_function);
+            const ComputeCall& first = _graph.calls().at (firstCall (_graph, _function));
+            QString result = value (0, f.nodes.first());
+            QStringList parameters { "const size_t n", "const float* x0", "const float* y0", "const float* z0" };
+            for (int j = 0; j < f.arguments.size(); j++) {
+                parameters << (first.arguments.at (j).node >= 0 ? "const float* a" : "const float a") + QString::number (j);
+            }
+            parameters << "float* out";
+            QString code = "// " + f.name + "\n";
+            code += "static void f" + QString::number (_function) + " (" + parameters.join (", ") + ") {\n" + _code;
+            code += "    for (size_t i = 0; i < n; i++) { out [i] = " + result + " [i]; }\n}\n\n";
+            return code;
+        }
+
+        QString functions() {
+            QString code;
+            for (int f = 0; f < _graph.functions().size(); f++) {
+                code += SourceWriter (_graph, f).function();
+            }
+            return code;
+        }
+
+        // every layer is written from the same batch, so nodes they share are computed once for all of them
+        QString statements() {
+            int layers = _graph.layerCount();
+            for (int k = 0; k < layers; k++) {
+                QString result = value (0, _graph.outputs().at (k));
+                QString index = layers == 1 ? "i" : "i * " + QString::number (layers) + " + " + QString::number (k);
+                _code += "    for (size_t i = 0; i < n; i++) { out [" + index + "] = " + result + " [i]; }\n";
+            }
+            return _code;
+        }
+
+        QString curves() {
+            QString code;
+            for (int i = 0; i < _graph.nodes().size(); i++) {
+                const ComputeNode& node = _graph.nodes().at (i);
+                if (node.operation == OpAltitudeMap) {
+                    code += curve (node.table);
+                }
+                if (node.operation == OpBiome) {
+                    code += biomeTable (node.table);
+                }
+            }
+            return code;
+        }
+
+    protected:
+        const ComputeGraph& _graph;
+        QString _code;
+        QMap<QPair<int, int>, QString> _names;
+        QMap<QPair<int, int>, int> _children;
+        QMap<QPair<int, int>, QString> _arguments;
+        int _frames;
+        int _function;
+
+        static QString coordinates (const int& frame) {
+            QString f = QString::number (frame);
+            return "vec3 (x" + f + " [i], y" + f + " [i], z" + f + " [i])";
+        }
+
+        // every call of a function passes the same kinds of arguments, so the first shows which are batches
+        static int firstCall (const ComputeGraph& graph, const int& function) {
+            for (int c = 0; c < graph.calls().size(); c++) {
+                if (graph.calls().at (c).function == function) { return c; }
+            }
+            return -1;
+        }
+
+        QString input (const int& frame, const int& index, const int& k) {
+            QPair<int, int> argument (index, k);
+            if (_arguments.contains (argument)) { return _arguments.value (argument); }
+            const ComputeInput& input = _graph.nodes().at (index).inputs.at (k);
+            return input.node >= 0 ? value (frame, input.node) + " [i]" : literal (input.value);
+        }
+
+        QString call (const int& frame, const int& index, const ComputeCall& call) {
+            QString f = QString::number (frame);
+            QStringList arguments { "n", "x" + f, "y" + f, "z" + f };
+            for (const ComputeInput& input : call.arguments) {
+                arguments << (input.node >= 0 ? value (frame, input.node) : literal (input.value));
+            }
+            QString name = "v" + f + "_" + QString::number (index);
+            arguments << name;
+            _code += "    float " + name + " [BatchSize];  // " + _graph.functions().at (call.function).name + "\n";
+            _code += "    f" + QString::number (call.function) + " (" + arguments.join (", ") + ");\n";
+            return name;
+        }
+
+        // mirrors CpuEvaluator::mapAltitude
+        QString curve (const int& table) {
+            const ComputeCurve& c = _graph.curve (table);
+            const QVector<QPointF>& e = c.entries;
+            int last = e.size() - 1;
+            QString code = "static inline float curve" + QString::number (table) + " (const float value) {\n";
+            code += "    if (value < " + literal (e.first().x()) + ") { return (float) " + literal (e.first().y()) + "; }\n";
+            for (int j = 0; j < e.size(); j++) {
+                if (c.terrace) {
+                    const QPointF& e0 = e.at (std::min (std::max (j - 1, 0), last));
+                    const QPointF& e1 = e.at (std::min (j, last));
+                    code += "    if (value > " + literal (e0.x()) + " && value <= " + literal (e1.x()) + ") {\n";
+                    code += "        float alpha = (float) ((value - " + literal (e0.x()) + ") / (" + literal (e1.x()) + " - " + literal (e0.x()) + "));\n";
+                    if (c.inverted) { code += "        alpha = 1.0f - alpha;\n"; }
+                    code += "        alpha *= alpha;\n";
+                    const QPointF& from = c.inverted ? e1 : e0;
+                    const QPointF& to = c.inverted ? e0 : e1;
+                    code += "        return glslMix ((float) " + literal (from.y()) + ", (float) " + literal (to.y()) + ", alpha);\n    }\n";
+                } else {
+                    const QPointF& e0 = e.at (std::min (std::max (j - 2, 0), last));
+                    const QPointF& e1 = e.at (std::min (std::max (j - 1, 0), last));
+                    const QPointF& e2 = e.at (std::min (j, last));
+                    const QPointF& e3 = e.at (std::min (j + 1, last));
+                    code += "    if (value > " + literal (e1.x()) + " && value <= " + literal (e2.x()) + ") {\n";
+                    code += "        float alpha = (float) ((value - " + literal (e1.x()) + ") / (" + literal (e2.x()) + " - " + literal (e1.x()) + "));\n";
+                    code += "        return cubicInterpolate ((float) " + literal (e0.y()) + ", (float) " + literal (e1.y()) + ", (float) "
+                            + literal (e2.y()) + ", (float) " + literal (e3.y()) + ", alpha);\n    }\n";
+                }
+            }
+            code += "    if (value > " + literal (e.last().x()) + ") { return (float) " + literal (e.last().y()) + "; }\n";
+            code += "    return (float) " + literal (e.first().y()) + ";\n}\n\n";
+            return code;
+        }
+
+        static QString array (const QString& name, const QVector<float>& values) {
+            QStringList items;
+            for (float v : values) {
+                items << literal (v);
+            }
+            // no zero length arrays, so a table with a single band gets a placeholder that the lookup never reads
+            if (items.isEmpty()) { items << "0.0f"; }
+            return "static const float " + name + " [" + QString::number (items.size()) + "] = { " + items.join (", ") + " };\n";
+        }
+
+        QString biomeTable (const int& table) {
+            const ComputeBiome& b = _graph.biome (table);
+            QString t = QString::number (table);
+            QString code = array ("biomeHeights" + t, b.heights) + array ("biomeMoistures" + t, b.moistures) + array ("biomeValues" + t, b.values);
+            code += "static inline float biome" + t + " (const float height, const float moisture) {\n";
+            code += "    return biome (height, moisture, biomeHeights" + t + ", " + QString::number (b.heights.size()) + ", biomeMoistures" + t + ", "
+                    + QString::number (b.moistures.size()) + ", biomeValues" + t + ");\n}\n\n";
+            return code;
+        }
+
+        // a warp's steps each make coordinates of their own, and the node's source is evaluated at the last of them
+        int transformed (const int& frame, const int& index) {
+            QPair<int, int> key (frame, index);
+            if (_children.contains (key)) { return _children.value (key); }
+
+            int child = frame;
+            int w = _graph.warpAt (index);
+            if (w >= 0) {
+                for (const ComputeWarpStep& step : _graph.warps().at (w).steps) {
+                    child = declare (step.turbulence >= 0 ? transform (child, step.turbulence) : affine (child, step));
+                }
+            } else {
+                child = declare (transform (frame, index));
+            }
+            _children.insert (key, child);
+            return child;
+        }
+
+        int declare (const QString& expression) {
+            int child = _frames++;
+            QString f = QString::number (child);
+            _code += "    float x" + f + " [BatchSize], y" + f + " [BatchSize], z" + f + " [BatchSize];\n";
+            _code += "    for (size_t i = 0; i < n; i++) { vec3 p = " + expression + "; x" + f + " [i] = p.x; y" + f + " [i] = p.y; z" + f + " [i] = p.z; }\n";
+            return child;
+        }
+
+        QString transform (const int& frame, const int& index) {
+            const ComputeNode& node = _graph.nodes().at (index);
+            QString a = input (frame, index, 1), b = input (frame, index, 2), c = input (frame, index, 3);
+            switch (node.operation) {
+                case OpTranslate: return coordinates (frame) + " + vec3 (" + a + ", " + b + ", " + c + ")";
+                case OpRotate: return "rotate (" + coordinates (frame) + ", vec3 (" + a + ", " + b + ", " + c + "))";
+                case OpScalePoint: return coordinates (frame) + " * vec3 (" + a + ", " + b + ", " + c + ")";
+                default: return "turbulence (" + coordinates (frame) + ", " + a + ", " + b + ", (int) " + c + ", " + QString::number ((int) node.parameters [0]) + ")";
+            }
+        }
+
+        // the same terms as the shader's, with the zeros left out
+        QString affine (const int& frame, const ComputeWarpStep& step) {
+            QString f = QString::number (frame);
+            const QStringList axes { "x" + f + " [i]", "y" + f + " [i]", "z" + f + " [i]" };
+            QStringList rows;
+            for (int r = 0; r < 3; r++) {
+                QStringList terms;
+                for (int k = 0; k < 3; k++) {
+                    double m = step.matrix [r * 3 + k];
+                    if (m == 1.0) { terms << axes [k]; }
+                    else if (m != 0.0) { terms << axes [k] + " * " + literal ((float) m); }
+                }
+                if (step.offset [r] != 0.0 || terms.isEmpty()) { terms << literal ((float) step.offset [r]); }
+                rows << terms.join (" + ");
+            }
+            return "vec3 (" + rows.join (", ") + ")";
+        }
+
+        QString value (const int& frame, const int& index) {
+            QPair<int, int> key (frame, index);
+            if (_names.contains (key)) { return _names.value (key); }
+
+            // within a function, its own output is not a call to it
+            int called = _function < 0 ? _graph.callAt (index) : -1;
+            if (called >= 0) {
+                QString name = call (frame, index, _graph.calls().at (called));
+                _names.insert (key, name);
+                return name;
+            }
+
+            const ComputeNode& node = _graph.nodes().at (index);
+            if (ComputeGraph::isCoordinateTransform (node.operation)) {
+                int w = _graph.warpAt (index);
+                QString name = value (transformed (frame, index), w >= 0 ? _graph.warps().at (w).source : node.inputs.first().node);
+                _names.insert (key, name);
+                return name;
+            }
+
+            QStringList in;
+            for (int k = 0; k < node.inputs.size(); k++) {
+                in << input (frame, index, k);
+            }
+            const QVector<float>& p = node.parameters;
+            QString c = coordinates (frame);
+            QString octaves = p.size() > 1 ? QString::number ((int) p [0]) : QString();
+            QString seed = p.size() > 1 ? QString::number ((int) p [1]) : QString();
+            QString expression;
+            switch (node.operation) {
+                case OpConstant: expression = literal (p [0]); break;
+                case OpAbs: expression = "std::fabs (" + in [0] + ")"; break;
+                case OpInvert: expression = "- " + in [0]; break;
+                case OpAdd: expression = in [0] + " + " + in [1]; break;
+                case OpMax: expression = "std::max (" + in [0] + ", " + in [1] + ")"; break;
+                case OpMin: expression = "std::min (" + in [0] + ", " + in [1] + ")"; break;
+                case OpMultiply: expression = in [0] + " * " + in [1]; break;
+                case OpPower: expression = "std::pow (" + in [0] + ", " + in [1] + ")"; break;
+                case OpDiff: expression = in [0] + " - " + in [1]; break;
+                case OpBlend: expression = "glslMix (" + in [0] + ", " + in [1] + ", " + in [2] + ")"; break;
+                case OpClamp: expression = "glslClamp (" + in [0] + ", " + in [1] + ", " + in [2] + ")"; break;
+                case OpScaleAndBias: expression = in [0] + " * " + in [1] + " + " + in [2]; break;
+                case OpSelect: expression = "select (" + in [0] + ", " + in [1] + ", " + in [2] + ", " + literal (p [0]) + ", " + literal (p [1]) + ", " + literal (p [2]) + ")"; break;
+                case OpCylinders: expression = "cylinders (" + c + ", " + in [0] + ")"; break;
+                case OpSpheres: expression = "spheres (" + c + ", " + in [0] + ")"; break;
+                case OpPerlin: expression = "perlin (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpSimplex: expression = "simplex (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpBillow: expression = "billow (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpRidgedMulti: expression = "ridgedmulti (" + c + ", " + in [0] + ", " + in [1] + ", " + octaves + ", " + seed + ", "
+                        + literal (p [2]) + ", " + literal (p [3]) + ", " + literal (p [4]) + ", " + literal (p [5]) + ")"; break;
+                case OpVoronoi: expression = "voronoi (" + c + ", " + in [0] + ", " + in [1] + ", " + literal (p [0]) + ", " + QString::number ((int) p [1]) + ")"; break;
+                case OpAltitudeMap: expression = "curve" + QString::number (node.table) + " (" + in [0] + ")"; break;
+                case OpBiome: expression = "biome" + QString::number (node.table) + " (" + in [0] + ", " + in [1] + ")"; break;
+                case OpRaster: {
+                    // as CpuEvaluator::sampleRaster reads a bake; load () turns down rasters of any other kind
+                    const ComputeRaster& r = _graph.raster (node.table);
+                    expression = r.scale > 0.0f ? "(sampleGrid (rasters [" + QString::number (node.table) + "], " + QString::number (r.width) + ", " + QString::number (r.height)
+                            + ", " + c + ") - " + literal (r.bias) + ") / " + literal (r.scale) : literal (-1.0f);
+                    break;
+                }
+                default: expression = "0.0f"; break;
+            }
+
+            QString name = "v" + QString::number (frame) + "_" + QString::number (index);
+            _code += "    float " + name + " [BatchSize];  // " + node.name + "\n";
+            _code += "    for (size_t i = 0; i < n; i++) { " + name + " [i] = " + expression + "; }\n";
+            _names.insert (key, name);
+            return name;
+        }
+    };
+}
+
+NativeModule::NativeModule (const QString& path, EvaluateFunction function, const int& layers, const QVector<QVector<float>>& rasters) :
+    _library (path), _function (function), _layers (layers), _rasters (rasters) {
+
+}
+
+NativeModule::~NativeModule() {
+    _library.unload();
+}
+
+void NativeModule::evaluate (const float* xyz, float* out, const size_t& n) const {
+    _function (xyz, out, n);
+}
+
+QString NativeModule::path() const {
+    return _library.fileName();
+}
+
+int NativeModule::layerCount() const {
+    return _layers;
+}
+
+const float* NativeModule::raster (const int& index) const {
+    return _rasters.at (index).constData();
+}
+
+QString NativeCompiler::source (const ComputeGraph& graph) {
+    SourceWriter writer (graph);
+    QString statements = writer.statements();
+
+    QString code;
+    code += "// Generated by calenhad from module " + graph.layerNames().join (", ") + ". Do not edit.\n\n";
+    code += "#include <cstddef>\n#include <limits>\n#include \"CpuFunctions.h\"\n\n";
+    code += "using namespace calenhad::graph::cpu;\n\n";
+    code += "static const size_t BatchSize = " + QString::number (CpuEvaluator::BatchSize) + ";\n\n";
+    code += "static const float* rasters [" + QString::number (std::max (1, graph.rasterCount())) + "];\n\n";
+    code += writer.curves();
+    code += writer.functions();
+    code += "static void batch (const float* xyz, float* out, const size_t n) {\n";
+    code += "    float x0 [BatchSize], y0 [BatchSize], z0 [BatchSize];\n";
+    code += "    for (size_t i = 0; i < n; i++) { x0 [i] = xyz [i * 3]; y0 [i] = xyz [i * 3 + 1]; z0 [i] = xyz [i * 3 + 2]; }\n";
+    code += statements;
+    code += "}\n\n";
+    code += "extern \"C\" int calenhad_abi_version() { return " + QString::number (AbiVersion) + "; }\n\n";
+    code += "extern \"C\" int calenhad_layer_count() { return " + QString::number (graph.layerCount()) + "; }\n\n";
+    code += "extern \"C\" void calenhad_set_raster (int index, const float* values) { rasters [index] = values; }\n\n";
+    code += "extern \"C\" void calenhad_evaluate (const float* xyz, float* out, size_t n) {\n";
+    code += "    for (size_t start = 0; start < n; start += BatchSize) {\n";
+    code += "        batch (xyz + start * 3, out + start * " + QString::number (graph.layerCount()) + ", n - start < BatchSize ? n - start : BatchSize);\n";
+    code += "    }\n";
+    code += "}\n";
+    return code;
+}
+
+// the library depends on the graph, the evaluation functions and how they are compiled
+QString NativeCompiler::key (const ComputeGraph& graph) {
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    hash.addData (graph.hash());
+    QFile functions (":/graph/CpuFunctions.h");
+    if (functions.open (QIODevice::ReadOnly)) {
+        hash.addData (functions.readAll());
+    }
+    hash.addData (CalenhadServices::preferences() -> calenhad_native_compiler.toUtf8());
+    hash.addData (CompilerFlags.join (" ").toUtf8());
+    hash.addData (QByteArray::number (AbiVersion));
+    return hash.result().toHex();
+}
+
+std::shared_ptr<NativeModule> NativeCompiler::load (const ComputeGraph& graph, QString* error) {
+    QString message;
+    if (! error) { error = &message; }
+    if (! graph.isValid()) {
+        *error = graph.error();
+        return nullptr;
+    }
+    QVector<QVector<float>> rasters;
+    for (int i = 0; i < graph.rasterCount(); i++) {
+        if (graph.raster (i).dataset) {
+            *error = "Graphs with fields can't be compiled";
+            return nullptr;
+        }
+        if (graph.raster (i).values.isEmpty()) {
+            *error = "Graphs with raster modules can't be compiled";
+            return nullptr;
+        }
+        rasters.append (graph.raster (i).values);
+    }
+    if (CalenhadServices::preferences() -> calenhad_native_compiler.isEmpty()) {
+        *error = "Native compilation is switched off";
+        return nullptr;
+    }
+
+    // one compilation at a time, so that two threads asking for the same graph don't both compile it
+    QMutexLocker locker (&_mutex);
+    QString name = key (graph);
+    std::shared_ptr<NativeModule> module = _loaded.value (name).lock();
+    if (module) { return module; }
+
+    QDir cache (CalenhadServices::preferences() -> calenhad_native_cache);
+    if (! cache.mkpath (".")) {
+        *error = "Couldn't create cache directory " + cache.path();
+        return nullptr;
+    }
+    QString libraryFile = cache.absoluteFilePath ("calenhad_" + name + ".so");
+    if (! QFileInfo::exists (libraryFile)) {
+        QString sourceFile = cache.absoluteFilePath ("calenhad_" + name + ".cpp");
+        QSaveFile out (sourceFile);
+        QByteArray code = source (graph).toUtf8();
+        if (! out.open (QIODevice::WriteOnly) || out.write (code) != code.size() || ! out.commit()) {
+            *error = "Couldn't write " + sourceFile;
+            return nullptr;
+        }
+        if (! compile (sourceFile, libraryFile, error)) {
+            return nullptr;
+        }
+    }
+
+    QLibrary library (libraryFile);
+    typedef int (*IntFunction) ();
+    IntFunction version = (IntFunction) library.resolve ("calenhad_abi_version");
+    IntFunction layers = (IntFunction) library.resolve ("calenhad_layer_count");
+    NativeModule::EvaluateFunction function = (NativeModule::EvaluateFunction) library.resolve ("calenhad_evaluate");
+    NativeModule::RasterFunction setRaster = (NativeModule::RasterFunction) library.resolve ("calenhad_set_raster");
+    if (! version || ! layers || ! function || ! setRaster || version() != AbiVersion || layers() != graph.layerCount()) {
+        *error = "Couldn't load " + libraryFile + ": " + library.errorString();
+        library.unload();
+        return nullptr;
+    }
+
+    module = std::make_shared<NativeModule> (libraryFile, function, layers(), rasters);
+    for (int i = 0; i < rasters.size(); i++) {
+        setRaster (i, module -> raster (i));
+    }
+    _loaded.insert (name, module);
+    return module;
+}
+
+bool NativeCompiler::compile (const QString& sourceFile, const QString& libraryFile, QString* error) {
+    // CpuFunctions.h goes alongside the source, from the copy built into the application
+    QFileInfo info (sourceFile);
+    QString header = info.absoluteDir().absoluteFilePath ("CpuFunctions.h");
+    QFile::remove (header);
+    if (! QFile::copy (":/graph/CpuFunctions.h", header)) {
+        *error = "Couldn't write " + header;
+        return false;
+    }
+
+    // build to a temporary name and rename, so that a library in the cache is always complete
+    QString temporary = libraryFile + ".part";
+    QProcess compiler;
+    compiler.setProcessChannelMode (QProcess::MergedChannels);
+    QStringList arguments = CompilerFlags;
+    arguments << "-I" << info.absolutePath() << "-o" << temporary << sourceFile;
+    QElapsedTimer timer;
+    timer.start();
+    compiler.start (CalenhadServices::preferences() -> calenhad_native_compiler, arguments);
+    if (! compiler.waitForFinished (CompileTimeout) || compiler.exitStatus() != QProcess::NormalExit || compiler.exitCode() != 0) {
+        *error = "Compiling " + sourceFile + " failed: " + QString::fromUtf8 (compiler.readAll());
+        compiler.kill();
+        QFile::remove (temporary);
+        return false;
+    }
+    QFile::remove (libraryFile);
+    if (! QFile::rename (temporary, libraryFile)) {
+        *error = "Couldn't write " + libraryFile;
+        return false;
+    }
+    std::cout << "Compiled " << sourceFile.toStdString() << " in " << timer.elapsed() << " ms\n";
+    return true;
+}
+
+bool NativeCompiler::benchmark (const ComputeGraph& graph, const int& points) {
+    QString error;
+    QElapsedTimer timer;
+    timer.start();
+    std::shared_ptr<NativeModule> native = load (graph, &error);
+    if (! native) {
+        std::cout << "Couldn't compile module " << graph.moduleName().toStdString() << ": " << error.toStdString() << "\n";
+        return false;
+    }
+    std::cout << "Module " << graph.moduleName().toStdString() << " compiled or loaded in " << timer.elapsed() << " ms\n";
+
+    // points spread uniformly over the sphere
+    std::mt19937 random (1);
+    std::normal_distribution<float> normal;
+    std::vector<float> xyz (points * 3);
+    for (int i = 0; i < points; i++) {
+        float x = normal (random), y = normal (random), z = normal (random);
+        float r = std::sqrt (x * x + y * y + z * z);
+        xyz [i * 3] = x / r;
+        xyz [i * 3 + 1] = y / r;
+        xyz [i * 3 + 2] = z / r;
+    }
+
+    size_t values = (size_t) points * graph.layerCount();
+    std::vector<float> interpreted (values), compiled (values);
+    CpuEvaluator evaluator (&graph);
+    timer.restart();
+    evaluator.evaluateLayers (xyz.data(), interpreted.data(), points);
+    qint64 interpreterTime = timer.nsecsElapsed();
+    timer.restart();
+    native -> evaluate (xyz.data(), compiled.data(), points);
+    qint64 nativeTime = timer.nsecsElapsed();
+
+    float difference = 0.0f;
+    int mismatches = 0;
+    for (size_t i = 0; i < values; i++) {
+        bool same = interpreted [i] == compiled [i] || (std::isnan (interpreted [i]) && std::isnan (compiled [i]));
+        if (! same) {
+            mismatches++;
+            difference = std::max (difference, std::fabs (interpreted [i] - compiled [i]));
+        }
+    }
+
+    std::cout << points << " points, " << graph.layerCount() << " layers: interpreter " << interpreterTime / 1000000.0 << " ms, native " << nativeTime / 1000000.0 << " ms";
+    std::cout << " (" << (double) interpreterTime / std::max ((qint64) 1, nativeTime) << " times faster)\n";
+    std::cout << mismatches << " values differ";
+    if (mismatches) { std::cout << ", by up to " << difference; }
+    std::cout << "\n";
+    return mismatches == 0;
+}
@@ -0,0 +1,80 @@
+#ifndef CALENHAD_NATIVECOMPILER_H
+#define CALENHAD_NATIVECOMPILER_H
+
+#include <cstddef>
+#include <memory>
+#include <QtCore/QLibrary>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace calenhad {
+    namespace graph {
+        class ComputeGraph;
+
+        // A module graph compiled to native code and loaded from a shared library. Like CpuEvaluator, it holds no
+        // state between calls and can be used from any number of threads at once.
+        class NativeModule {
+        public:
+            typedef void (*EvaluateFunction) (const float* xyz, float* out, size_t n);
+            typedef void (*RasterFunction) (int index, const float* values);
+
+            // rasters are the values of the graph's bakes, which the module holds on to for the library to read
+            NativeModule (const QString& path, EvaluateFunction function, const int& layers, const QVector<QVector<float>>& rasters);
+            ~NativeModule();
+
+            // xyz holds n cartesian points (x0, y0, z0, x1, y1, z1 ...) on the unit sphere; out receives n values for
+            // each layer, laid out as CpuEvaluator::evaluateLayers lays them out
+            void evaluate (const float* xyz, float* out, const size_t& n) const;
+            QString path () const;
+            int layerCount () const;
+            const float* raster (const int& index) const;
+
+        protected:
+            QLibrary _library;
+            EvaluateFunction _function;
+            int _layers;
+            QVector<QVector<float>> _rasters;
+        };
+
+        // Translates a ComputeGraph into C++ and builds it with the system compiler into a shared library, for
+        // modules which are evaluated at a great many points, such as for exports and the tile server. The generated
+        // code does the same thing as CpuEvaluator does - a batch of points at a time, each node's result computed
+        // once per batch - but with the graph's structure and constant values compiled in, it leaves the compiler
+        // free to inline the noise functions and vectorise the loops.
+        //
+        // Libraries are kept in the cache directory under the graph's hash, so that a graph is only compiled once
+        // however many times it is loaded, and libraries already loaded are shared. Frozen modules' bakes are handed
+        // to the library when it is loaded, and read as CpuEvaluator reads them; graphs containing raster modules or
+        // fields (see FieldModule), whose values are read from their datasets, are not compiled, so use a CpuEvaluator
+        // for those.
+        class NativeCompiler {
+        public:
+            // returns nullptr, with a reason in error, if the graph can't be compiled
+            static std::shared_ptr<NativeModule> load (const ComputeGraph& graph, QString* error = nullptr);
+
+            // C++ source for the graph
+            static QString source (const ComputeGraph& graph);
+
+            // checks a compiled graph against the interpreter at the given number of random points, and reports
+            // how long each takes and the largest difference between them on std::cout. Returns false if the
+            // graph couldn't be compiled or the results differ.
+            static bool benchmark (const ComputeGraph& graph, const int& points);
+
+            static const int AbiVersion = 3;
+
+            // how long to let the compiler run, in milliseconds
+            static const int CompileTimeout = 120000;
+
+        protected:
+            static QString key (const ComputeGraph& graph);
+            static bool compile (const QString& sourceFile, const QString& libraryFile, QString* error);
+            static QMutex _mutex;
+            static QMap<QString, std::weak_ptr<NativeModule>> _loaded;
+        };
+    }
+}
+
+
+#endif //CALENHAD_NATIVECOMPILER_H
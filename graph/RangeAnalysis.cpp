@@ -0,0 +1,310 @@
+#include "RangeAnalysis.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "CpuFunctions.h"
+
+using namespace calenhad::graph;
+
+Interval::Interval () : Interval (unbounded()) {
+
+}
+
+Interval::Interval (const double& value) : Interval (value, value) {
+
+}
+
+Interval::Interval (const double& lo, const double& hi) : lo (std::min (lo, hi)), hi (std::max (lo, hi)) {
+    if (std::isnan (lo) || std::isnan (hi)) {
+        this -> lo = - std::numeric_limits<double>::infinity();
+        this -> hi = std::numeric_limits<double>::infinity();
+    }
+}
+
+Interval Interval::unbounded () {
+    return Interval (- std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+}
+
+Interval Interval::hull (const Interval& a, const Interval& b) {
+    return Interval (std::min (a.lo, b.lo), std::max (a.hi, b.hi));
+}
+
+bool Interval::isBounded () const {
+    return std::isfinite (lo) && std::isfinite (hi);
+}
+
+bool Interval::contains (const double& value) const {
+    return value >= lo && value <= hi;
+}
+
+Interval RangeAnalysis::range (const ComputeGraph& graph, const ComputeNode& node, const QVector<Interval>& inputs) {
+    auto in = [&inputs] (const int& k) { return inputs.value (k, Interval::unbounded()); };
+    const QVector<float>& p = node.parameters;
+
+    if (ComputeGraph::isCoordinateTransform (node.operation)) {
+        // the source is sampled somewhere else, but its bounds hold everywhere
+        return in (0);
+    }
+
+    switch (node.operation) {
+        case OpConstant: return Interval (p [0]);
+        case OpAbs: {
+            Interval x = in (0);
+            if (x.lo >= 0.0) { return x; }
+            if (x.hi <= 0.0) { return Interval (- x.hi, - x.lo); }
+            return Interval (0.0, std::max (- x.lo, x.hi));
+        }
+        case OpInvert: return Interval (- in (0).hi, - in (0).lo);
+        case OpAdd: return add (in (0), in (1));
+        case OpMax: return Interval (std::max (in (0).lo, in (1).lo), std::max (in (0).hi, in (1).hi));
+        case OpMin: return Interval (std::min (in (0).lo, in (1).lo), std::min (in (0).hi, in (1).hi));
+        case OpMultiply: return multiply (in (0), in (1));
+        case OpPower: return power (in (0), in (1));
+        case OpDiff: return add (in (0), Interval (- in (1).hi, - in (1).lo));
+        case OpBlend: return mix (in (0), in (1), in (2));
+        case OpClamp: {
+            Interval x = in (0), l = in (1), h = in (2);
+            return Interval (std::min (std::max (x.lo, l.lo), h.lo), std::min (std::max (x.hi, l.hi), h.hi));
+        }
+        case OpScaleAndBias: return add (multiply (in (0), in (1)), in (2));
+        case OpSelect: return mix (in (1), in (2), smoothstep (-1.0f + p [2], 1.0f - p [2], in (0)));
+        case OpCylinders:
+        case OpSpheres: return Interval (-1.0, 1.0);
+        case OpPerlin: return multiply (add (fractal (in (2), (int) p [0], SimplexNoiseBound), cpu::PERLIN_BIAS), cpu::PERLIN_SCALE);
+        case OpSimplex: return multiply (fractal (in (2), (int) p [0], SimplexNoiseBound), cpu::SIMPLEX_SCALE);
+        case OpBillow: {
+            // each octave is 2 |n| - 1 for classic noise n, which is at least -1 but can go over 1 where |n| does
+            double amplitude = std::max (1.0, 2.0 * ClassicNoiseBound - 1.0);
+            return multiply (add (fractal (in (2), (int) p [0], amplitude), 0.5 + cpu::BILLOW_BIAS), cpu::BILLOW_SCALE);
+        }
+        case OpRidgedMulti: return ridged (node, in (1));
+        case OpVoronoi: {
+            // Each feature point is jittered by up to 3/7 of a cell on each axis. The nearer of the point in the sample's
+            // cell and the one in the neighbouring cell on the sample's side bounds the distance to the second nearest.
+            Interval jitter = in (1);
+            if (! jitter.isBounded()) { return Interval::unbounded(); }
+            double a = (3.0 / 7.0) * std::max (std::fabs (jitter.lo), std::fabs (jitter.hi));
+            Interval d (0.0, std::sqrt ((1.0 + a) * (1.0 + a) + 2.0 * (0.5 + a) * (0.5 + a)));
+            return multiply (add (multiply (add (d, cpu::VORONOI_BIAS), cpu::VORONOI_SCALE), -1.0), p [0]);
+        }
+        case OpAltitudeMap: return curve (graph.curve (node.table), in (0));
+        case OpRaster: {
+            // the raster's own values are in [-1, 1], and where it is transparent it gives way to the default
+            const ComputeRaster& raster = graph.raster (node.table);
+            return raster.image.isNull() ? in (0) : Interval::hull (Interval (-1.0, 1.0), in (0));
+        }
+        case OpBiome: return biome (graph.biome (node.table), in (0), in (1));
+        default: return Interval::unbounded();
+    }
+}
+
+int RangeAnalysis::passThrough (const ComputeNode& node, const QVector<Interval>& inputs, const QVector<bool>& proven) {
+    if (inputs.size() < 2) { return -1; }
+    const Interval& a = inputs.at (0), & b = inputs.at (1);
+    switch (node.operation) {
+        case OpMax:
+            if (! proven.at (0) || ! proven.at (1)) { return -1; }
+            if (a.lo >= b.hi) { return 0; }
+            if (b.lo >= a.hi) { return 1; }
+            return -1;
+        case OpMin:
+            if (! proven.at (0) || ! proven.at (1)) { return -1; }
+            if (a.hi <= b.lo) { return 0; }
+            if (b.hi <= a.lo) { return 1; }
+            return -1;
+        default: break;
+    }
+    if (inputs.size() < 3) { return -1; }
+    const Interval& c = inputs.at (2);
+    switch (node.operation) {
+        case OpSelect: {
+            // mix (in0, in1, 0) is only in0 while in1 is finite, and the other way round. Only the control's bounds
+            // decide which; noise is finite whether or not its bounds are proven.
+            if (! proven.at (0)) { return -1; }
+            Interval alpha = smoothstep (-1.0f + node.parameters [2], 1.0f - node.parameters [2], a);
+            if (alpha.hi <= 0.0 && c.isBounded()) { return 1; }
+            if (alpha.lo >= 1.0 && b.isBounded()) { return 2; }
+            return -1;
+        }
+        case OpBlend:
+            if (! proven.at (2)) { return -1; }
+            if (c.lo == 0.0 && c.hi == 0.0 && b.isBounded()) { return 0; }
+            if (c.lo == 1.0 && c.hi == 1.0 && a.isBounded()) { return 1; }
+            return -1;
+        case OpClamp:
+            // clamp (x, l, h) is min (max (x, l), h)
+            if (! proven.at (0) || ! proven.at (1) || ! proven.at (2)) { return -1; }
+            if (a.lo >= b.hi && a.hi <= c.lo) { return 0; }
+            if (a.hi <= b.lo && b.hi <= c.lo) { return 1; }
+            if (a.lo >= c.hi || b.lo >= c.hi) { return 2; }
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+bool RangeAnalysis::isMeasured (const ComputeOperation& operation) {
+    return operation == OpPerlin || operation == OpSimplex || operation == OpBillow || operation == OpRidgedMulti;
+}
+
+Interval RangeAnalysis::add (const Interval& a, const Interval& b) {
+    return Interval (a.lo + b.lo, a.hi + b.hi);
+}
+
+Interval RangeAnalysis::multiply (const Interval& a, const Interval& b) {
+    // zero times infinity is zero here: a bound of zero is exact, an infinite one only says there is no bound
+    auto product = [] (const double& x, const double& y) { return x == 0.0 || y == 0.0 ? 0.0 : x * y; };
+    double corners [4] = { product (a.lo, b.lo), product (a.lo, b.hi), product (a.hi, b.lo), product (a.hi, b.hi) };
+    return Interval (* std::min_element (corners, corners + 4), * std::max_element (corners, corners + 4));
+}
+
+Interval RangeAnalysis::power (const Interval& a, const Interval& b) {
+    // pow is undefined for a negative base in glsl; for a non-negative one it is monotonic in each argument
+    if (a.lo < 0.0) { return Interval::unbounded(); }
+    double corners [4] = { std::pow (a.lo, b.lo), std::pow (a.lo, b.hi), std::pow (a.hi, b.lo), std::pow (a.hi, b.hi) };
+    for (double corner : corners) {
+        if (std::isnan (corner)) { return Interval::unbounded(); }
+    }
+    return Interval (* std::min_element (corners, corners + 4), * std::max_element (corners, corners + 4));
+}
+
+Interval RangeAnalysis::mix (const Interval& a, const Interval& b, const Interval& t) {
+    if (t.lo >= 0.0 && t.hi <= 1.0) {
+        // increasing in a and b, and linear in t, so the extremes are at the ends of t
+        double lo = std::min (a.lo * (1.0 - t.lo) + b.lo * t.lo, a.lo * (1.0 - t.hi) + b.lo * t.hi);
+        double hi = std::max (a.hi * (1.0 - t.lo) + b.hi * t.lo, a.hi * (1.0 - t.hi) + b.hi * t.hi);
+        return Interval (lo, hi);
+    }
+    return add (multiply (a, add (Interval (1.0), Interval (- t.hi, - t.lo))), multiply (b, t));
+}
+
+Interval RangeAnalysis::smoothstep (const double& e0, const double& e1, const Interval& x) {
+    if (! (e0 < e1)) { return Interval (0.0, 1.0); }
+    auto step = [e0, e1] (const double& v) {
+        double t = std::min (std::max ((v - e0) / (e1 - e0), 0.0), 1.0);
+        return t * t * (3.0 - 2.0 * t);
+    };
+    return Interval (step (x.lo), step (x.hi));
+}
+
+// the sum of octaves of noise in [-amplitude, amplitude], each weighted by the persistence to the power of the octave
+// (and by a fade weight in [0, 1] where octaves are culled, which doesn't widen the sum)
+Interval RangeAnalysis::fractal (const Interval& persistence, const int& octaves, const double& amplitude) {
+    if (! persistence.isBounded()) { return Interval::unbounded(); }
+    double p = std::max (std::fabs (persistence.lo), std::fabs (persistence.hi));
+    double sum = 0.0, weight = 1.0;
+    for (int i = 0; i < octaves; i++) {
+        sum += weight;
+        weight *= p;
+    }
+    return Interval (- sum * amplitude, sum * amplitude);
+}
+
+// follows ridgedmulti octave by octave, with the noise within ClassicNoiseBound. Where the offset is smaller than that,
+// the signal can go negative, pow of it is undefined and so is the result
+Interval RangeAnalysis::ridged (const ComputeNode& node, const Interval& lacunarity) {
+    const QVector<float>& p = node.parameters;
+    int octaves = std::min ((int) p [0], 30);
+    double exponent = p [2], offset = p [3], gain = p [4], sharpness = p [5];
+    Interval frequency (1.0), weight (1.0), value (0.0);
+    for (int i = 0; i < octaves; i++) {
+        Interval signal = power (Interval (offset - ClassicNoiseBound, offset), Interval (sharpness));
+        signal = multiply (signal, weight);
+        Interval g = multiply (signal, gain);
+        weight = Interval (std::min (1.0, g.lo), std::min (1.0, g.hi));
+        value = add (value, multiply (signal, power (frequency, Interval (- exponent))));
+        frequency = multiply (frequency, lacunarity);
+    }
+    return add (multiply (add (value, -1.0 + cpu::RIDGED_MULTI_BIAS), cpu::RIDGED_MULTI_SCALE), -1.0);
+}
+
+// follows the decision tree of CpuEvaluator::mapAltitude, segment by segment
+Interval RangeAnalysis::curve (const ComputeCurve& curve, const Interval& x) {
+    const QVector<QPointF>& e = curve.entries;
+    int last = e.size() - 1;
+    bool sorted = true;
+    for (int j = 1; j < e.size(); j++) {
+        sorted = sorted && e.at (j - 1).x() <= e.at (j).x();
+    }
+
+    // values below the first entry, and any that no segment covers, get the first entry's value
+    Interval result (e.first().y());
+    bool found = x.lo <= e.first().x() || ! sorted;
+    auto include = [&result, &found] (const Interval& i) {
+        result = found ? Interval::hull (result, i) : i;
+        found = true;
+    };
+    if (x.hi > e.last().x()) { include (Interval (e.last().y())); }
+
+    for (int j = 0; j < e.size(); j++) {
+        const QPointF& from = e.at (std::min (std::max (j - 1, 0), last));
+        const QPointF& to = e.at (std::min (j, last));
+
+        // each segment covers (from.x, to.x]
+        double a = std::max (x.lo, from.x()), b = std::min (x.hi, to.x());
+        if (! (b > from.x() && a <= b)) { continue; }
+        double a0 = (a - from.x()) / (to.x() - from.x());
+        double a1 = (b - from.x()) / (to.x() - from.x());
+        if (curve.terrace) {
+            auto terrace = [&] (double alpha) {
+                if (curve.inverted) { alpha = 1.0 - alpha; }
+                alpha *= alpha;
+                return curve.inverted ? to.y() * (1.0 - alpha) + from.y() * alpha : from.y() * (1.0 - alpha) + to.y() * alpha;
+            };
+            include (Interval (terrace (a0), terrace (a1)));
+        } else {
+            const QPointF& before = e.at (std::min (std::max (j - 2, 0), last));
+            const QPointF& after = e.at (std::min (j + 1, last));
+            include (cubic (before.y(), from.y(), to.y(), after.y(), a0, a1));
+        }
+    }
+    return result;
+}
+
+// range of cubicInterpolate over alpha in [a0, a1]: the ends and any turning points between them
+Interval RangeAnalysis::cubic (const double& n0, const double& n1, const double& n2, const double& n3, const double& a0, const double& a1) {
+    double p = (n3 - n2) - (n0 - n1);
+    double q = (n0 - n1) - p;
+    double r = n2 - n0;
+    double s = n1;
+    auto f = [=] (const double& a) { return p * a * a * a + q * a * a + r * a + s; };
+    Interval result (f (a0), f (a1));
+
+    // turning points where 3pa^2 + 2qa + r = 0
+    QVector<double> roots;
+    if (p == 0.0) {
+        if (q != 0.0) { roots.append (- r / (2.0 * q)); }
+    } else {
+        double discriminant = 4.0 * q * q - 12.0 * p * r;
+        if (discriminant >= 0.0) {
+            roots.append ((-2.0 * q + std::sqrt (discriminant)) / (6.0 * p));
+            roots.append ((-2.0 * q - std::sqrt (discriminant)) / (6.0 * p));
+        }
+    }
+    for (double root : roots) {
+        if (root > a0 && root < a1) {
+            result = Interval::hull (result, Interval (f (root)));
+        }
+    }
+    return result;
+}
+
+// the values in every cell of the table which the two ranges reach
+Interval RangeAnalysis::biome (const ComputeBiome& biome, const Interval& height, const Interval& moisture) {
+    auto band = [] (const QVector<float>& boundaries, const double& value) {
+        int band = 0;
+        while (band < boundaries.size() && value >= boundaries [band]) { band++; }
+        return band;
+    };
+    int columns = biome.moistures.size() + 1;
+    Interval result;
+    bool found = false;
+    for (int row = band (biome.heights, height.lo); row <= band (biome.heights, height.hi); row++) {
+        for (int column = band (biome.moistures, moisture.lo); column <= band (biome.moistures, moisture.hi); column++) {
+            Interval value (biome.values.value (row * columns + column));
+            result = found ? Interval::hull (result, value) : value;
+            found = true;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef CALENHAD_RANGEANALYSIS_H
+#define CALENHAD_RANGEANALYSIS_H
+
+#include <QtCore/QVector>
+#include "ComputeGraph.h"
+#include "Interval.h"
+
+namespace calenhad {
+    namespace graph {
+
+        // Works out bounds for the output of each node in a ComputeGraph from its parameters and the bounds of its
+        // inputs, without evaluating anything. Coherent noise is not quite in the [-1, 1] which libnoise documents for
+        // it, so each octave is taken to be within the bounds below, which are the extremes found by hill climbing from
+        // a few hundred thousand random points with a margin on top; everything downstream of the generators is
+        // bounded by interval arithmetic. The measured bounds err wide, but ComputeGraph::prune and CpuEvaluator only
+        // rely on bounds which are proven (see isMeasured). They are not always tight either: an input feeding both sides of a sum, for instance, is counted as if
+        // its two appearances were independent.
+        class RangeAnalysis {
+        public:
+            // bounds for the node given bounds for each of its inputs (in the same order as node.inputs)
+            static Interval range (const ComputeGraph& graph, const ComputeNode& node, const QVector<Interval>& inputs);
+
+            // the input which a select, blend, clamp, max or min node always passes on unchanged, given bounds for its
+            // inputs and whether each of those is proven, or -1 if the node has to be evaluated. Measured bounds never
+            // decide it.
+            static int passThrough (const ComputeNode& node, const QVector<Interval>& inputs, const QVector<bool>& proven);
+
+            // whether the operation's bounds rest on the measured extremes of coherent noise rather than on a proof
+            static bool isMeasured (const ComputeOperation& operation);
+
+        protected:
+            // simplexNoise reaches about 1.08 and classicNoise about 1.21 in magnitude
+            static constexpr double SimplexNoiseBound = 1.25;
+            static constexpr double ClassicNoiseBound = 1.4;
+
+            static Interval add (const Interval& a, const Interval& b);
+            static Interval multiply (const Interval& a, const Interval& b);
+            static Interval power (const Interval& a, const Interval& b);
+            static Interval mix (const Interval& a, const Interval& b, const Interval& t);
+            static Interval smoothstep (const double& e0, const double& e1, const Interval& x);
+            static Interval fractal (const Interval& persistence, const int& octaves, const double& amplitude);
+            static Interval ridged (const ComputeNode& node, const Interval& lacunarity);
+            static Interval curve (const ComputeCurve& curve, const Interval& x);
+            static Interval cubic (const double& n0, const double& n1, const double& n2, const double& n3, const double& a0, const double& a1);
+            static Interval biome (const ComputeBiome& biome, const Interval& height, const Interval& moisture);
+        };
+    }
+}
+
+
+#endif //CALENHAD_RANGEANALYSIS_H
@@ -20,8 +20,13 @@
 #include <QList>
 #include <qmodule/AltitudeMap.h>
 #include <qmodule/RasterModule.h>
+#include <qmodule/BiomeModule.h>
 #include "../messages/QNotificationHost.h"
 #include "../controls/altitudemap/AltitudeMapping.h"
+#include "ComputeGraph.h"
+#include "Bake.h"
+#include <cmath>
+#include <QtCore/QPair>
 
 using namespace calenhad;
 using namespace calenhad::nodeedit;
@@ -34,6 +39,283 @@ using namespace icosphere;
 using namespace calenhad::expressions;
 using namespace calenhad::controls::altitudemap;
 using namespace exprtk;
+
+namespace {
+
+    // float literals for glsl, with enough digits to give back the same float
+    QString literal (const double& value) {
+        if (std::isnan (value)) { return "uintBitsToFloat (0x7fc00000u)"; }
+        if (std::isinf (value)) { return value > 0 ? "uintBitsToFloat (0x7f800000u)" : "uintBitsToFloat (0xff800000u)"; }
+        QString text = QString::number (value, 'g', 9);
+        if (! text.contains ('.') && ! text.contains ('e')) { text += ".0"; }
+        return value < 0 ? "(" + text + ")" : text;
+    }
+
+    // a biome module's table lookup, as constant arrays, which the shader can index with the row and column
+    QString biomeFunction (const QString& name, const ComputeBiome& biome) {
+        auto array = [] (const QString& arrayName, const QVector<float>& values) -> QString {
+            QStringList items;
+            for (float v : values) { items << literal (v); }
+            QString size = QString::number (items.size());
+            return "    const float " + arrayName + " [" + size + "] = float [" + size + "] (" + items.join (", ") + ");\n";
+        };
+        QString h = QString::number (biome.heights.size());
+        QString m = QString::number (biome.moistures.size());
+        QString code = "float " + name + " (float height, float moisture) {\n";
+        code += array ("values", biome.values);
+        code += "    int row = 0;\n";
+        if (! biome.heights.isEmpty()) {
+            code += array ("heights", biome.heights);
+            code += "    while (row < " + h + " && height >= heights [row]) { row++; }\n";
+        }
+        code += "    int column = 0;\n";
+        if (! biome.moistures.isEmpty()) {
+            code += array ("moistures", biome.moistures);
+            code += "    while (column < " + m + " && moisture >= moistures [column]) { column++; }\n";
+        }
+        code += "    return values [row * " + QString::number (biome.moistures.size() + 1) + " + column];\n";
+        code += "}\n";
+        return code;
+    }
+
+    // Writes the shader code for several modules at once. Instead of a function per module, as Graph::glsl does it,
+    // each node becomes a local variable in one function, layers (), so a node which feeds more than one layer is
+    // still only computed once for each texel. A coordinate transform declares new coordinates, c1, c2 ..., and its
+    // source is written out again at those; a warp declares coordinates for each of its steps, with its matrices
+    // written in as constants. This follows the same plan as the native code in NativeCompiler.
+    //
+    // Each of the graph's functions is written once, by a writer of its own, as a function of the coordinates and its
+    // arguments, and a call's output is a call to it.
+    class LayerWriter {
+    public:
+        LayerWriter (const ComputeGraph& graph, const int& function = -1) : _graph (graph), _frames (1), _function (function) {
+            if (function >= 0) {
+                const ComputeFunction& f = graph.functions().at (function);
+                for (int j = 0; j < f.arguments.size(); j++) {
+                    _arguments.insert (QPair<int, int> (f.nodes.at (f.arguments.at (j).first), f.arguments.at (j).second), "a" + QString::number (j));
+                }
+            }
+        }
+
+        QString function() {
+            const ComputeFunction& f = _graph.functions().at (_function);
+            QString result = value (0, f.nodes.first());
+            QStringList parameters { "vec3 c0" };
+            for (int j = 0; j < f.arguments.size(); j++) {
+                parameters << "float a" + QString::number (j);
+            }
+            return "float f" + QString::number (_function) + " (" + parameters.join (", ") + ") {    // " + f.name + "\n" + _code + "    return " + result + ";\n}\n\n";
+        }
+
+        QString code() {
+            QString outputs;
+            for (int k = 0; k < _graph.layerCount(); k++) {
+                outputs += "    layer [" + QString::number (k) + "] = " + value (0, _graph.outputs().at (k)) + ";\n";
+            }
+
+            QString code;
+            for (int i = 0; i < _graph.nodes().size(); i++) {
+                if (_graph.nodes().at (i).operation == OpAltitudeMap) {
+                    code += curve (_graph.nodes().at (i).table);
+                }
+                if (_graph.nodes().at (i).operation == OpBiome) {
+                    code += biomeFunction ("biome" + QString::number (_graph.nodes().at (i).table), _graph.biome (_graph.nodes().at (i).table)) + "\n";
+                }
+            }
+            for (int f = 0; f < _graph.functions().size(); f++) {
+                code += LayerWriter (_graph, f).function();
+            }
+            code += "const int LAYER_COUNT = " + QString::number (_graph.layerCount()) + ";\n\n";
+            code += "void layers (vec3 c0, vec2 geolocation, out float layer [LAYER_COUNT]) {\n" + _code + outputs + "}\n\n";
+            code += "float value (vec3 cartesian, vec2 geolocation) {\n";
+            code += "    float layer [LAYER_COUNT];\n";
+            code += "    layers (cartesian, geolocation, layer);\n";
+            code += "    return layer [0];\n";
+            code += "}\n";
+            return code;
+        }
+
+    protected:
+        const ComputeGraph& _graph;
+        QString _code;
+        QMap<QPair<int, int>, QString> _names;
+        QMap<QPair<int, int>, int> _children;
+        QMap<QPair<int, int>, QString> _arguments;
+        int _frames;
+        int _function;
+
+        QString input (const int& frame, const int& index, const int& k) {
+            QPair<int, int> argument (index, k);
+            if (_arguments.contains (argument)) { return _arguments.value (argument); }
+            const ComputeInput& input = _graph.nodes().at (index).inputs.at (k);
+            return input.node >= 0 ? value (frame, input.node) : literal (input.value);
+        }
+
+        QString call (const int& frame, const int& index, const ComputeCall& call) {
+            QStringList arguments { "c" + QString::number (frame) };
+            for (const ComputeInput& input : call.arguments) {
+                arguments << (input.node >= 0 ? value (frame, input.node) : literal (input.value));
+            }
+            QString name = "v" + QString::number (frame) + "_" + QString::number (index);
+            _code += "    float " + name + " = f" + QString::number (call.function) + " (" + arguments.join (", ") + ");    // "
+                    + _graph.functions().at (call.function).name + "\n";
+            return name;
+        }
+
+        // the same decision tree as Graph::glsl writes for an altitude map
+        QString curve (const int& table) {
+            const ComputeCurve& c = _graph.curve (table);
+            const QVector<QPointF>& e = c.entries;
+            int last = e.size() - 1;
+            QString code = "float curve" + QString::number (table) + " (float value) {\n";
+            code += "  if (value < " + literal (e.first().x()) + ") { return " + literal (e.first().y()) + "; }\n";
+            for (int j = 0; j < e.size(); j++) {
+                if (c.terrace) {
+                    const QPointF& e0 = e.at (std::min (std::max (j - 1, 0), last));
+                    const QPointF& e1 = e.at (std::min (j, last));
+                    code += "  if (value > " + literal (e0.x()) + " && value <= " + literal (e1.x()) + ") {\n";
+                    code += "        float alpha = ((value - " + literal (e0.x()) + ") / " + literal (e1.x() - e0.x()) + ");\n";
+                    if (c.inverted) { code += "        alpha = 1 - alpha;\n"; }
+                    code += "        alpha *= alpha;\n";
+                    code += "        return mix (" + literal (c.inverted ? e1.y() : e0.y()) + ", " + literal (c.inverted ? e0.y() : e1.y()) + ", alpha);\n   }\n";
+                } else {
+                    const QPointF& e0 = e.at (std::min (std::max (j - 2, 0), last));
+                    const QPointF& e1 = e.at (std::min (std::max (j - 1, 0), last));
+                    const QPointF& e2 = e.at (std::min (j, last));
+                    const QPointF& e3 = e.at (std::min (j + 1, last));
+                    code += "  if (value > " + literal (e1.x()) + " && value <= " + literal (e2.x()) + ") {\n";
+                    code += "        float alpha = ((value - " + literal (e1.x()) + ") / " + literal (e2.x() - e1.x()) + ");\n";
+                    code += "        return cubicInterpolate (" + literal (e0.y()) + ", " + literal (e1.y()) + ", " + literal (e2.y()) + ", " + literal (e3.y()) + ", alpha);\n   }\n";
+                }
+            }
+            code += "  if (value > " + literal (e.last().x()) + ") { return " + literal (e.last().y()) + "; }\n";
+            code += "  return " + literal (e.first().y()) + ";\n}\n\n";
+            return code;
+        }
+
+        // a warp's steps each declare coordinates of their own, and the node's source is evaluated at the last of them
+        int transformed (const int& frame, const int& index) {
+            QPair<int, int> key (frame, index);
+            if (_children.contains (key)) { return _children.value (key); }
+
+            int child = frame;
+            int w = _graph.warpAt (index);
+            if (w >= 0) {
+                for (const ComputeWarpStep& step : _graph.warps().at (w).steps) {
+                    child = declare (step.turbulence >= 0 ? transform (child, step.turbulence) : affine (child, step));
+                }
+            } else {
+                child = declare (transform (frame, index));
+            }
+            _children.insert (key, child);
+            return child;
+        }
+
+        int declare (const QString& expression) {
+            int child = _frames++;
+            _code += "    vec3 c" + QString::number (child) + " = " + expression + ";\n";
+            return child;
+        }
+
+        QString transform (const int& frame, const int& index) {
+            const ComputeNode& node = _graph.nodes().at (index);
+            QString a = input (frame, index, 1), b = input (frame, index, 2), c = input (frame, index, 3);
+            QString from = "c" + QString::number (frame);
+            switch (node.operation) {
+                case OpTranslate: return from + " + vec3 (" + a + ", " + b + ", " + c + ")";
+                case OpRotate: return "rotate (" + from + ", vec3 (" + a + ", " + b + ", " + c + "))";
+                case OpScalePoint: return from + " * vec3 (" + a + ", " + b + ", " + c + ")";
+                default: return "turbulence (" + from + ", " + a + ", " + b + ", int (" + c + "), " + QString::number ((int) node.parameters [0]) + ")";
+            }
+        }
+
+        // written out term by term, leaving out the zeros, so that a translation or a scale costs no more than before
+        QString affine (const int& frame, const ComputeWarpStep& step) {
+            QString from = "c" + QString::number (frame);
+            const QStringList axes { ".x", ".y", ".z" };
+            QStringList rows;
+            for (int r = 0; r < 3; r++) {
+                QStringList terms;
+                for (int k = 0; k < 3; k++) {
+                    double m = step.matrix [r * 3 + k];
+                    if (m == 1.0) { terms << from + axes [k]; }
+                    else if (m != 0.0) { terms << from + axes [k] + " * " + literal ((float) m); }
+                }
+                if (step.offset [r] != 0.0 || terms.isEmpty()) { terms << literal ((float) step.offset [r]); }
+                rows << terms.join (" + ");
+            }
+            return "vec3 (" + rows.join (", ") + ")";
+        }
+
+        QString value (const int& frame, const int& index) {
+            QPair<int, int> key (frame, index);
+            if (_names.contains (key)) { return _names.value (key); }
+
+            // within a function, its own output is not a call to it
+            int called = _function < 0 ? _graph.callAt (index) : -1;
+            if (called >= 0) {
+                QString name = call (frame, index, _graph.calls().at (called));
+                _names.insert (key, name);
+                return name;
+            }
+
+            const ComputeNode& node = _graph.nodes().at (index);
+            if (ComputeGraph::isCoordinateTransform (node.operation)) {
+                int w = _graph.warpAt (index);
+                QString name = value (transformed (frame, index), w >= 0 ? _graph.warps().at (w).source : node.inputs.first().node);
+                _names.insert (key, name);
+                return name;
+            }
+
+            QStringList in;
+            for (int k = 0; k < node.inputs.size(); k++) {
+                in << input (frame, index, k);
+            }
+            const QVector<float>& p = node.parameters;
+            QString c = "c" + QString::number (frame);
+            QString octaves = p.size() > 1 ? QString::number ((int) p [0]) : QString();
+            QString seed = p.size() > 1 ? QString::number ((int) p [1]) : QString();
+            QString expression;
+            switch (node.operation) {
+                case OpConstant: expression = literal (p [0]); break;
+                case OpAbs: expression = "abs (" + in [0] + ")"; break;
+                case OpInvert: expression = "- " + in [0]; break;
+                case OpAdd: expression = in [0] + " + " + in [1]; break;
+                case OpMax: expression = "max (" + in [0] + ", " + in [1] + ")"; break;
+                case OpMin: expression = "min (" + in [0] + ", " + in [1] + ")"; break;
+                case OpMultiply: expression = in [0] + " * " + in [1]; break;
+                case OpPower: expression = "pow (" + in [0] + ", " + in [1] + ")"; break;
+                case OpDiff: expression = in [0] + " - " + in [1]; break;
+                case OpBlend: expression = "mix (" + in [0] + ", " + in [1] + ", " + in [2] + ")"; break;
+                case OpClamp: expression = "clamp (" + in [0] + ", " + in [1] + ", " + in [2] + ")"; break;
+                case OpScaleAndBias: expression = in [0] + " * " + in [1] + " + " + in [2]; break;
+                case OpSelect: expression = "select (" + in [0] + ", " + in [1] + ", " + in [2] + ", " + literal (p [0]) + ", " + literal (p [1]) + ", " + literal (p [2]) + ")"; break;
+                case OpCylinders: expression = "cylinders (" + c + ", " + in [0] + ")"; break;
+                case OpSpheres: expression = "spheres (" + c + ", " + in [0] + ")"; break;
+                case OpPerlin: expression = "perlin (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpSimplex: expression = "simplex (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpBillow: expression = "billow (" + c + ", " + in [0] + ", " + in [1] + ", " + in [2] + ", " + octaves + ", " + seed + ")"; break;
+                case OpRidgedMulti: expression = "ridgedmulti (" + c + ", " + in [0] + ", " + in [1] + ", " + octaves + ", " + seed + ", "
+                        + literal (p [2]) + ", " + literal (p [3]) + ", " + literal (p [4]) + ", " + literal (p [5]) + ")"; break;
+                case OpVoronoi: expression = "voronoi (" + c + ", " + in [0] + ", " + in [1] + ", " + literal (p [0]) + ", " + QString::number ((int) p [1]) + ")"; break;
+                case OpAltitudeMap: expression = "curve" + QString::number (node.table) + " (" + in [0] + ")"; break;
+                case OpBiome: expression = "biome" + QString::number (node.table) + " (" + in [0] + ", " + in [1] + ")"; break;
+                case OpRaster: {
+                    const ComputeRaster& r = _graph.raster (node.table);
+                    expression = "raster (" + c + ", " + QString::number (node.table) + "u, vec2 (" + literal (r.west) + ", " + literal (r.north) + "), vec2 ("
+                            + literal (r.east) + ", " + literal (r.south) + "), " + in [0] + ")";
+                    break;
+                }
+                default: expression = "0.0"; break;
+            }
+
+            QString name = "v" + QString::number (frame) + "_" + QString::number (index);
+            _code += "    float " + name + " = " + expression + ";    // " + node.name + "\n";
+            _names.insert (key, name);
+            return name;
+        }
+    };
+}
 /*
 Graph::Graph (const QString& xml, const QString& nodeName) : _xml (xml), _nodeName (nodeName), _colorMapBuffer (nullptr), _parser (new parser<double>()), _rasterId = 0; {
     _doc.setContent (_xml);
@@ -45,7 +327,11 @@ Graph::Graph (const QDomDocument& doc, const QString& nodeName): _doc (doc), _no
 }
 */
 
-Graph::Graph (calenhad::qmodule::Module* module) : _module (module), _nodeName (module -> name()), _colorMapBuffer (nullptr), _parser (new parser<double>()), _rasterId (0) {
+Graph::Graph (calenhad::qmodule::Module* module) : _module (module), _modules ({ module }), _nodeName (module -> name()), _colorMapBuffer (nullptr), _parser (new parser<double>()), _rasterId (0) {
+
+}
+
+Graph::Graph (const QList<calenhad::qmodule::Module*>& modules) : _module (modules.first()), _modules (modules), _nodeName (modules.first() -> name()), _colorMapBuffer (nullptr), _parser (new parser<double>()), _rasterId (0) {
 
 }
 
@@ -63,6 +349,16 @@ Graph::~Graph () {
 }
 
 QString Graph::glsl() {
+    // several layers are written from the graph as a whole, so that what they share is computed once; a single
+    // module is written module by module from the templates in modules.xml
+    if (_modules.size() > 1) {
+        _code = layersGlsl (ComputeGraph (_modules));
+        if (_code != QString::null) {
+            parseLegend();
+        }
+        return _code;
+    }
+
     _code =  glsl (_module);
     std::cout << "Module " << _module -> name().toStdString () << "\n";
 
@@ -71,6 +367,12 @@ QString Graph::glsl() {
         _code.append ("    return _" + _nodeName + " (cartesian);\n");
         _code.append ("}\n");
 
+        // the shader reads values through layers (), of which a single module has just the one
+        _code.append ("\nconst int LAYER_COUNT = 1;\n\n");
+        _code.append ("void layers (vec3 cartesian, vec2 geolocation, out float layer [LAYER_COUNT]) {\n");
+        _code.append ("    layer [0] = value (cartesian, geolocation);\n");
+        _code.append ("}\n");
+
         parseLegend ();
     }
     std::cout << _code.toStdString () << "\n\n";
@@ -78,6 +380,19 @@ QString Graph::glsl() {
 };
 
 QString Graph::glsl (Module* module) {
+    // a frozen module reads its bake back from a raster, in place of everything upstream of it
+    const Bake* bake = module -> bake();
+    if (bake) {
+        QString name = module -> name ();
+        if (! _code.contains ("float _" + name)) {
+            int size = CalenhadServices::preferences() -> calenhad_globe_texture_height;
+            _rasters.insert (_rasterId++, new QImage (bake -> image (size)));
+            _code += "float _" + name + " (vec3 c) { return raster (c, " + QString::number (_rasterId - 1) + "u, vec2 (" + literal (- M_PI) + ", " + literal (M_PI / 2)
+                    + "), vec2 (" + literal (M_PI) + ", " + literal (- M_PI / 2) + "), 0.0) * " + literal (bake -> scale()) + " + " + literal (bake -> bias()) + "; }\n";
+        }
+        return _code;
+    }
+
     if (module -> isComplete()) {
         QString name = module -> name ();
         if (! _code.contains ("float _" + name)) {
@@ -168,6 +483,10 @@ QString Graph::glsl (Module* module) {
                     _code += "  if (value > " + QString::number (entries.last ().x ()) + ") { return " + QString::number (entries.last ().y ()) + "; }\n";
                     _code += "}\n";
                 } else {
+                    // a biome module's template calls its table lookup, which has to come first
+                    if (type == CalenhadServices::preferences ()->calenhad_module_biome) {
+                        _code += biomeFunction ("_" + name + "_biome", ComputeGraph::biomeTable (static_cast<BiomeModule*> (qm)));
+                    }
                     QString func = qm->glsl ();
                     _code.append ("float _" + name + " (vec3 c) { return " + func);
                     _code.append ("; }\n");
@@ -223,6 +542,20 @@ QString Graph::glsl (Module* module) {
     }
 }
 
+QString Graph::layersGlsl (const ComputeGraph& graph) {
+    if (! graph.isValid()) {
+        std::cout << "Can't render modules together: " << graph.error().toStdString() << "\n";
+        return QString::null;
+    }
+
+    // the graph has its own copies of the rasters, in the same order as it numbers them
+    for (int i = 0; i < graph.rasterCount(); i++) {
+        _rasters.insert (_rasterId++, new QImage (graph.raster (i).image));
+    }
+    LayerWriter writer (graph);
+    return writer.code();
+}
+
 float* Graph::colorMapBuffer () {
     return _colorMapBuffer;
 }
@@ -258,3 +591,7 @@ int Graph::rasterCount() {
 QImage* Graph::raster (const int& index) {
     return _rasters.value (index);
 }
+
+int Graph::layerCount() {
+    return _modules.size();
+}
@@ -2,6 +2,7 @@
 #define CALENHAD_GLOBE_LIBRARY_H
 
 #include <QtCore/QString>
+#include <QtCore/QList>
 #include "../exprtk/exprtk.hpp"
 
 namespace calenhad {
@@ -12,22 +13,30 @@ namespace calenhad {
         class Module;
     }
     namespace graph {
+        class ComputeGraph;
 
         class Graph {
         public:
             //Graph (const QString& xml, const QString& nodeName);
             //Graph (const QDomDocument& doc, const QString& nodeName);
             Graph (calenhad::qmodule::Module* module);
+
+            // several modules rendered in one pass, each to its own layer of the shader's layer buffer. The colours
+            // and the height map come from the first of them.
+            Graph (const QList<calenhad::qmodule::Module*>& modules);
             ~Graph();
             QString glsl();
             float* colorMapBuffer();
             int colorMapBufferSize ();
             int rasterCount ();
             QImage* raster (const int& index);
+            int layerCount ();
         protected:
             QString glsl (calenhad::qmodule::Module* node);
+            QString layersGlsl (const ComputeGraph& graph);
             void parseLegend ();
             calenhad::qmodule::Module* _module;
+            QList<calenhad::qmodule::Module*> _modules;
             pipeline::CalenhadModel* _model;
             QString _code;
             QString _nodeName;
@@ -0,0 +1,38 @@
+#include "TileCache.h"
+
+using namespace calenhad::httpserver;
+
+// capacity is in kilobytes
+TileCache::TileCache (const int& capacity) : _tiles (std::max (1, capacity)) {
+
+}
+
+TileCache::~TileCache() {
+
+}
+
+QByteArray TileCache::find (const QString& key) {
+    QMutexLocker locker (&_mutex);
+    QByteArray* tile = _tiles.object (key);
+    return tile ? *tile : QByteArray();
+}
+
+void TileCache::insert (const QString& key, const QByteArray& tile) {
+    QMutexLocker locker (&_mutex);
+    _tiles.insert (key, new QByteArray (tile), std::max (1, tile.size() / 1024));
+}
+
+void TileCache::invalidate (const QString& module) {
+    QMutexLocker locker (&_mutex);
+    QString prefix = module + "/";
+    for (const QString& key : _tiles.keys()) {
+        if (key.startsWith (prefix)) {
+            _tiles.remove (key);
+        }
+    }
+}
+
+void TileCache::clear() {
+    QMutexLocker locker (&_mutex);
+    _tiles.clear();
+}
@@ -0,0 +1,33 @@
+#ifndef CALENHAD_TILECACHE_H
+#define CALENHAD_TILECACHE_H
+
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+
+namespace calenhad {
+    namespace httpserver {
+
+        // Encoded tiles (PNG images or raw heights) ready to send, least recently used first out when the cache is
+        // full. Keys begin with the module's name followed by a slash, so that all of a module's tiles can be thrown
+        // away at once when it changes. Safe to use from any thread.
+        class TileCache {
+        public:
+            TileCache (const int& capacity);
+            ~TileCache();
+
+            // returns an empty array if the tile isn't cached
+            QByteArray find (const QString& key);
+            void insert (const QString& key, const QByteArray& tile);
+            void invalidate (const QString& module);
+            void clear ();
+
+        protected:
+            QCache<QString, QByteArray> _tiles;
+            QMutex _mutex;
+        };
+    }
+}
+
+#endif //CALENHAD_TILECACHE_H
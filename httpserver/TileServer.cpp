@@ -0,0 +1,381 @@
+#include "TileServer.h"
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <QtCore/QBuffer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRunnable>
+#include <QtCore/QSettings>
+#include <QtCore/QThread>
+#include <QtCore/QUrl>
+#include <QtGui/QImage>
+#include <httplistener.h>
+#include "../graph/ComputeGraph.h"
+#include "../graph/CpuEvaluator.h"
+#include "../graph/CpuFunctions.h"
+#include "../graph/GradientEvaluator.h"
+#include "../graph/NativeCompiler.h"
+#include "../pipeline/CalenhadModel.h"
+#include "../qmodule/Module.h"
+
+using namespace calenhad;
+using namespace calenhad::httpserver;
+using namespace calenhad::graph;
+using namespace calenhad::pipeline;
+using namespace calenhad::qmodule;
+
+namespace {
+    class TileTask : public QRunnable {
+    public:
+        TileTask (std::function<void()> work) : _work (work) { }
+        void run() override { _work(); }
+    protected:
+        std::function<void()> _work;
+    };
+}
+
+TileServer::TileServer (QObject* parent) : HttpRequestHandler (parent),
+    _model (nullptr),
+    _settings (nullptr),
+    _listener (nullptr),
+    _cache (64 * 1024),
+    _generation (0),
+    _stopping (false) {
+}
+
+TileServer::~TileServer() {
+    stop();
+}
+
+bool TileServer::start (const QString& settingsFile) {
+    stop();
+    _stopping = false;
+    if (! QFileInfo (settingsFile).isReadable()) {
+        std::cout << "Tile server settings file " << settingsFile.toStdString() << " not found\n";
+        return false;
+    }
+    QSettings file (settingsFile, QSettings::IniFormat);
+    file.beginGroup ("listener");
+
+    // the listener is given a copy of the settings, so that filling in the host doesn't write to the user's file
+    if (! _settingsFile.open()) {
+        std::cout << "Couldn't create temporary settings for the tile server\n";
+        return false;
+    }
+    _settings = new QSettings (_settingsFile.fileName(), QSettings::IniFormat, this);
+    _settings -> clear();
+    for (const QString& key : file.childKeys()) {
+        _settings -> setValue (key, file.value (key));
+    }
+    if (_settings -> value ("host").toString().isEmpty()) {
+        _settings -> setValue ("host", "127.0.0.1");
+    }
+    _allowOrigin = _settings -> value ("allowOrigin").toString().toUtf8();
+    _listener = new HttpListener (_settings, this, this);
+    if (! _listener -> isListening()) {
+        std::cout << "Tile server couldn't listen on port " << _settings -> value ("port").toString().toStdString() << "\n";
+        stop();
+        return false;
+    }
+    std::cout << "Tile server listening on " << _settings -> value ("host").toString().toStdString() << " port " << _settings -> value ("port").toString().toStdString() << "\n";
+    return true;
+}
+
+void TileServer::stop() {
+    {
+        QMutexLocker locker (&_mutex);
+        _stopping = true;
+        _made.wakeAll();
+    }
+    if (_listener) {
+        delete _listener;
+        _listener = nullptr;
+    }
+    if (_settings) {
+        delete _settings;
+        _settings = nullptr;
+    }
+    _pool.waitForDone();
+}
+
+bool TileServer::isRunning() {
+    return _listener != nullptr;
+}
+
+void TileServer::setModel (CalenhadModel* model) {
+    _model = model;
+    invalidateAll();
+}
+
+void TileServer::invalidate (const QString& module) {
+    {
+        QMutexLocker locker (&_mutex);
+        _sources.remove (module);
+    }
+    _cache.invalidate (module);
+}
+
+void TileServer::invalidateAll() {
+    {
+        QMutexLocker locker (&_mutex);
+        _sources.clear();
+    }
+    _cache.clear();
+}
+
+std::shared_ptr<TileSource> TileServer::source (const QString& module) {
+    {
+        QMutexLocker locker (&_mutex);
+        if (_sources.contains (module)) { return _sources.value (module); }
+    }
+    if (QThread::currentThread() == thread()) {
+        makeSource (module);
+        QMutexLocker locker (&_mutex);
+        return _sources.value (module);
+    }
+
+    // modules can only be read on the GUI thread, so ask it to make the source and wait. This doesn't block the
+    // GUI thread's way, so that stop() can shut the listener's threads down while they are waiting here.
+    QMutexLocker locker (&_mutex);
+    if (_sources.contains (module)) { return _sources.value (module); }
+    quint64 attempt = _attempts.value (module);
+    QMetaObject::invokeMethod (this, "makeSource", Qt::QueuedConnection, Q_ARG (QString, module));
+    while (! _stopping && _attempts.value (module) == attempt) {
+        if (! _made.wait (&_mutex, SourceTimeout)) { break; }
+    }
+    return _sources.value (module);
+}
+
+void TileServer::makeSource (const QString& name) {
+    Module* module = _model ? _model -> findModule (name) : nullptr;
+    std::shared_ptr<ComputeGraph> graph = module ? std::make_shared<ComputeGraph> (module) : nullptr;
+    if (! graph || ! graph -> isValid()) {
+        if (graph) {
+            std::cout << "Tile server can't serve module " << name.toStdString() << ": " << graph -> error().toStdString() << "\n";
+        }
+        QMutexLocker locker (&_mutex);
+        _attempts [name]++;
+        _made.wakeAll();
+        return;
+    }
+
+    std::shared_ptr<TileSource> source = std::make_shared<TileSource>();
+    source -> graph = graph;
+    source -> evaluator = std::make_shared<CpuEvaluator> (graph.get());
+    source -> gradients = std::make_shared<GradientEvaluator> (graph.get());
+
+    // a module emits nodeChanged when it or anything upstream of it changes
+    if (! _watched.contains (name)) {
+        _watched.insert (name);
+        connect (module, &Node::nodeChanged, this, [=] () { invalidate (name); });
+        connect (module, &Node::nameChanged, this, [=] () { invalidateAll(); });
+        connect (module, &QObject::destroyed, this, [=] () { _watched.remove (name); invalidate (name); });
+    }
+
+    QMutexLocker locker (&_mutex);
+    source -> generation = ++_generation;
+    _sources.insert (name, source);
+    _attempts [name]++;
+    _made.wakeAll();
+}
+
+void TileServer::service (HttpRequest& request, HttpResponse& response) {
+    QStringList path = QUrl::fromPercentEncoding (request.getPath()).split ("/", QString::SkipEmptyParts);
+    if (path.size() != 4) {
+        respond (response, 404, "text/plain", "Tiles are at /<module>/<z>/<x>/<y>.png, .f32 or .normal.png\n");
+        return;
+    }
+
+    QString module = path.at (0);
+    QString file = path.at (3);
+    int dot = file.indexOf (".");
+    QString format = dot >= 0 ? file.mid (dot + 1) : QString();
+    bool zOk, xOk, yOk;
+    int z = path.at (1).toInt (&zOk);
+    int x = path.at (2).toInt (&xOk);
+    int y = file.left (dot).toInt (&yOk);
+    if (! (zOk && xOk && yOk) || z < 0 || z > MaxZoom || x < 0 || y < 0 || x >= (1 << z) || y >= (1 << z)) {
+        respond (response, 400, "text/plain", "No such tile\n");
+        return;
+    }
+    bool normals = format == "normal.png";
+    if (format != "png" && format != "f32" && ! normals) {
+        respond (response, 404, "text/plain", "Tiles are available as .png, .f32 or .normal.png\n");
+        return;
+    }
+    float scale = NormalScale;
+    if (normals && ! request.getParameter ("scale").isEmpty()) {
+        bool ok;
+        scale = request.getParameter ("scale").toFloat (&ok);
+        if (! ok || ! std::isfinite (scale)) {
+            respond (response, 400, "text/plain", "Scale must be a number\n");
+            return;
+        }
+    }
+
+    std::shared_ptr<TileSource> source = this -> source (module);
+    if (! source) {
+        respond (response, 404, "text/plain", "No module called " + module.toUtf8() + " that can be served\n");
+        return;
+    }
+    if (normals && ! source -> gradients -> isValid()) {
+        respond (response, 404, "text/plain", "No normal map for module " + module.toUtf8() + ": " + source -> gradients -> error().toUtf8() + "\n");
+        return;
+    }
+
+    // the generation in the key keeps tiles made from an out of date module from being served, even if they finish
+    // after the module changed. A normal map is a job of its own for each scale.
+    QString tile = module + "/" + QString::number (source -> generation) + "/" + QString::number (z) + "/" + QString::number (x) + "/" + QString::number (y);
+    QString job = normals ? tile + "/" + QString::number (scale) + ".normal" : tile;
+    QByteArray type = format == "f32" ? "application/octet-stream" : "image/png";
+    QByteArray body = _cache.find (normals ? job + ".png" : tile + "." + format);
+
+    if (body.isEmpty()) {
+        std::shared_future<TileData> future;
+        {
+            QMutexLocker locker (&_mutex);
+            if (_pending.contains (job)) {
+                future = _pending.value (job);
+            } else {
+                std::shared_ptr<std::promise<TileData>> promise = std::make_shared<std::promise<TileData>>();
+                future = promise -> get_future().share();
+                _pending.insert (job, future);
+                _pool.start (new TileTask ([=] () {
+                    TileData data;
+                    if (normals) {
+                        data = renderNormals (source, z, x, y, scale);
+                        _cache.insert (job + ".png", data.png);
+                    } else {
+                        data = render (source, z, x, y);
+                        _cache.insert (tile + ".png", data.png);
+                        _cache.insert (tile + ".f32", data.heights);
+                    }
+                    promise -> set_value (data);
+                    QMutexLocker locker (&_mutex);
+                    _pending.remove (job);
+                }));
+            }
+        }
+        TileData data = future.get();
+        body = format == "f32" ? data.heights : data.png;
+    }
+
+    if (body.isEmpty()) {
+        respond (response, 500, "text/plain", "Couldn't render tile\n");
+    } else {
+        respond (response, 200, type, body);
+    }
+}
+
+// web mercator: longitude is linear in x, latitude comes from the inverse Gudermannian of y
+void TileServer::cartesian (const int& z, const int& x, const int& y, const double& px, const double& py, double* c) {
+    double n = (double) (1 << z);
+    double lat = std::atan (std::sinh (M_PI * (1.0 - 2.0 * (y + py / TileSize) / n)));
+    double lon = (x + px / TileSize) / n * 2 * M_PI - M_PI;
+    c [0] = std::cos (lon) * std::cos (lat);
+    c [1] = std::sin (lat);
+    c [2] = std::cos (lat) * std::sin (lon);
+}
+
+// each pixel's centre, less origin if there is one
+std::vector<float> TileServer::points (const int& z, const int& x, const int& y, const double* origin) {
+    std::vector<float> xyz (TileSize * TileSize * 3);
+    for (int py = 0; py < TileSize; py++) {
+        for (int px = 0; px < TileSize; px++) {
+            double c [3];
+            cartesian (z, x, y, px + 0.5, py + 0.5, c);
+            float* p = xyz.data() + (py * TileSize + px) * 3;
+            for (int k = 0; k < 3; k++) {
+                p [k] = (float) (origin ? c [k] - origin [k] : c [k]);
+            }
+        }
+    }
+    return xyz;
+}
+
+TileData TileServer::render (const std::shared_ptr<TileSource>& source, const int& z, const int& x, const int& y) {
+    // at deep zoom the points are offsets from the tile's centre, which is kept in double precision
+    bool precise = z >= PreciseZoom;
+    double origin [3] = { 0.0, 0.0, 0.0 };
+    if (precise) {
+        cartesian (z, x, y, TileSize / 2.0, TileSize / 2.0, origin);
+    }
+    std::vector<float> xyz = points (z, x, y, precise ? origin : nullptr);
+
+    TileData data;
+    data.heights.resize (TileSize * TileSize * sizeof (float));
+    float* heights = (float*) data.heights.data();
+    if (precise) {
+        source -> evaluator -> evaluate (origin, xyz.data(), heights, TileSize * TileSize);
+    } else {
+        std::call_once (source -> compiled, [&source] () {
+            QString error;
+            source -> native = NativeCompiler::load (*source -> graph, &error);
+            if (! source -> native) {
+                std::cout << "Tile server using the interpreter for module " << source -> graph -> moduleName().toStdString() << ": " << error.toStdString() << "\n";
+            }
+        });
+        if (source -> native) {
+            source -> native -> evaluate (xyz.data(), heights, TileSize * TileSize);
+        } else {
+            source -> evaluator -> evaluate (xyz.data(), heights, TileSize * TileSize);
+        }
+    }
+
+    QImage image (TileSize, TileSize, QImage::Format_ARGB32);
+    for (int py = 0; py < TileSize; py++) {
+        QRgb* line = (QRgb*) image.scanLine (py);
+        for (int px = 0; px < TileSize; px++) {
+            line [px] = source -> graph -> color (heights [py * TileSize + px]);
+        }
+    }
+    QBuffer buffer (&data.png);
+    buffer.open (QIODevice::WriteOnly);
+    image.save (&buffer, "PNG");
+    return data;
+}
+
+TileData TileServer::renderNormals (const std::shared_ptr<TileSource>& source, const int& z, const int& x, const int& y, const float& scale) {
+    std::vector<float> xyz = points (z, x, y, nullptr);
+    std::vector<float> heights (TileSize * TileSize), gradients (TileSize * TileSize * 3);
+    source -> gradients -> evaluate (xyz.data(), heights.data(), gradients.data(), TileSize * TileSize);
+
+    // each normal is given in the frame of east, north and up at its own point, as a tangent space normal map is
+    auto channel = [] (const float& v) { return std::min (std::max ((int) std::lround ((v + 1.0f) * 127.5f), 0), 255); };
+    TileData data;
+    QImage image (TileSize, TileSize, QImage::Format_RGB32);
+    for (int py = 0; py < TileSize; py++) {
+        QRgb* line = (QRgb*) image.scanLine (py);
+        for (int px = 0; px < TileSize; px++) {
+            int i = py * TileSize + px;
+            const float* p = xyz.data() + i * 3;
+            float normal [3];
+            GradientEvaluator::normal (p, gradients.data() + i * 3, scale, normal);
+            float lon = std::atan2 (p [2], p [0]);
+            float lat = std::asin (std::min (std::max (p [1], -1.0f), 1.0f));
+            float east [3] = { - std::sin (lon), 0.0f, std::cos (lon) };
+            float north [3] = { - std::sin (lat) * std::cos (lon), std::cos (lat), - std::sin (lat) * std::sin (lon) };
+            float e = normal [0] * east [0] + normal [1] * east [1] + normal [2] * east [2];
+            float n = normal [0] * north [0] + normal [1] * north [1] + normal [2] * north [2];
+            float u = normal [0] * p [0] + normal [1] * p [1] + normal [2] * p [2];
+            line [px] = qRgb (channel (e), channel (n), channel (u));
+        }
+    }
+    QBuffer buffer (&data.png);
+    buffer.open (QIODevice::WriteOnly);
+    image.save (&buffer, "PNG");
+    return data;
+}
+
+void TileServer::respond (HttpResponse& response, const int& status, const QByteArray& type, const QByteArray& body) {
+    static const QMap<int, QByteArray> reasons = { { 200, "OK" }, { 400, "Bad Request" }, { 404, "Not Found" }, { 500, "Internal Server Error" } };
+    response.setStatus (status, reasons.value (status));
+    response.setHeader ("Content-Type", type);
+    if (! _allowOrigin.isEmpty()) {
+        response.setHeader ("Access-Control-Allow-Origin", _allowOrigin);
+    }
+
+    // tiles change whenever the model is edited
+    response.setHeader ("Cache-Control", "no-cache");
+    response.write (body, true);
+}
@@ -0,0 +1,132 @@
+#ifndef CALENHAD_TILESERVER_H
+#define CALENHAD_TILESERVER_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <QtCore/QObject>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+#include <httplistener.h>
+#include <httprequesthandler.h>
+#include "TileCache.h"
+
+class QSettings;
+
+namespace calenhad {
+    namespace pipeline {
+        class CalenhadModel;
+    }
+    namespace graph {
+        class ComputeGraph;
+        class CpuEvaluator;
+        class GradientEvaluator;
+        class NativeModule;
+    }
+    namespace httpserver {
+
+        // QtWebApp 1.7 and later put their classes in the stefanfrings namespace
+        using stefanfrings::HttpRequest;
+        using stefanfrings::HttpResponse;
+        using stefanfrings::HttpRequestHandler;
+        using stefanfrings::HttpListener;
+
+        // A module ready to be evaluated away from the GUI thread. The first tile rendered from it compiles it to
+        // native code if it can; if it can't, tiles are evaluated by the interpreter.
+        struct TileSource {
+            std::shared_ptr<calenhad::graph::ComputeGraph> graph;
+            std::shared_ptr<calenhad::graph::CpuEvaluator> evaluator;
+            std::shared_ptr<calenhad::graph::GradientEvaluator> gradients;
+            std::shared_ptr<calenhad::graph::NativeModule> native;
+            std::once_flag compiled;
+            quint64 generation;
+        };
+
+        // Both encodings of one tile, which are made together because they come from the same evaluation.
+        struct TileData {
+            QByteArray png;
+            QByteArray heights;
+        };
+
+        // Embedded HTTP server for the open model's modules as slippy map tiles, so that a browser map or a GIS can
+        // look at a world while it is being edited. Tiles are 256 pixels square in the usual web mercator XYZ scheme:
+        //
+        //   /<module>/<z>/<x>/<y>.png   - the module coloured with its legend
+        //   /<module>/<z>/<x>/<y>.f32   - the module's raw values, as 256 x 256 32-bit floats from the north-west corner
+        //   /<module>/<z>/<x>/<y>.normal.png?scale=<s>
+        //                               - the surface's normals in east, north and up order as red, green and blue, where
+        //                                 the module is a height s times the planet's radius (NormalScale if no s is given)
+        //
+        // Tiles are evaluated on the CPU by a pool of threads, in double precision at deep zoom. Normal maps come from
+        // the gradient of the module (see GradientEvaluator), in single precision. Finished tiles are kept in a cache of encoded tiles,
+        // and when several requests arrive for a tile that is still being made, they all wait for the one evaluation.
+        // A module's tiles are discarded whenever it or anything upstream of it changes.
+        //
+        // The listener is configured from the [listener] group of an ini file such as config/webapp1.ini. It listens on
+        // 127.0.0.1 unless the group names a host, and only sends an Access-Control-Allow-Origin header if the group
+        // names an allowOrigin. (QtWebApp's request handlers are QObjects, so the server is one too.)
+        class TileServer : public HttpRequestHandler {
+        Q_OBJECT
+        public:
+            TileServer (QObject* parent = nullptr);
+            virtual ~TileServer();
+
+            bool start (const QString& settingsFile);
+            void stop ();
+            bool isRunning ();
+            void setModel (calenhad::pipeline::CalenhadModel* model);
+
+            // called by the listener's threads
+            void service (HttpRequest& request, HttpResponse& response) override;
+
+            static const int TileSize = 256;
+            static const int MaxZoom = 24;
+
+            // from this zoom on, pixels are closer together than floats on the unit sphere resolve well, so tiles are
+            // evaluated by the interpreter from double precision points (see CpuPrecise.h) instead of by native code
+            static const int PreciseZoom = 12;
+
+            // height of the module's values, as a fraction of the planet's radius, for normal maps
+            static constexpr float NormalScale = 0.01f;
+
+        public slots:
+            void invalidate (const QString& module);
+            void invalidateAll ();
+
+        protected:
+            calenhad::pipeline::CalenhadModel* _model;
+            QSettings* _settings;
+            QTemporaryFile _settingsFile;
+            QByteArray _allowOrigin;
+            HttpListener* _listener;
+            QThreadPool _pool;
+            TileCache _cache;
+            QMutex _mutex;
+            QMap<QString, std::shared_ptr<TileSource>> _sources;
+            QMap<QString, std::shared_future<TileData>> _pending;
+            QMap<QString, quint64> _attempts;
+            QWaitCondition _made;
+            QSet<QString> _watched;
+            quint64 _generation;
+            bool _stopping;
+
+            // how long a request waits for the GUI thread to prepare a module, in milliseconds
+            static const unsigned long SourceTimeout = 10000;
+
+            std::shared_ptr<TileSource> source (const QString& module);
+            Q_INVOKABLE void makeSource (const QString& module);
+            TileData render (const std::shared_ptr<TileSource>& source, const int& z, const int& x, const int& y);
+            TileData renderNormals (const std::shared_ptr<TileSource>& source, const int& z, const int& x, const int& y, const float& scale);
+            static void cartesian (const int& z, const int& x, const int& y, const double& px, const double& py, double* c);
+            static std::vector<float> points (const int& z, const int& x, const int& y, const double* origin);
+            void respond (HttpResponse& response, const int& status, const QByteArray& type, const QByteArray& body);
+        };
+    }
+}
+
+#endif //CALENHAD_TILESERVER_H
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "AdaptiveIcosphere.h"
+#include "icosphere.h"
+#include "Parallel.h"
+#include "../graph/CpuEvaluator.h"
+
+using namespace calenhad::icosphere;
+using namespace calenhad::graph;
+
+namespace {
+
+    // midpoints are evaluated in runs of this many
+    const uint64_t EvaluationChunk = 1 << 12;
+
+    uint64_t undirected (const uint32_t& p, const uint32_t& q) {
+        return p < q ? ((uint64_t) p << 32) | q : ((uint64_t) q << 32) | p;
+    }
+
+    uint64_t directed (const uint32_t& p, const uint32_t& q) {
+        return ((uint64_t) p << 32) | q;
+    }
+
+    // for each child of a node, in the order Icosphere gives them, the parent's side which each of its sides lies along,
+    // or -1 for a side inside the parent
+    const int ParentSide [4][3] = { { 0, -1, 2 }, { 1, -1, 0 }, { 2, -1, 1 }, { -1, -1, -1 } };
+}
+
+AdaptiveIcosphere::AdaptiveIcosphere (const unsigned& depth) : _depth (std::max (depth, 1u)), _tolerance (0.0f), _evaluator (nullptr),
+    _budget (std::numeric_limits<uint32_t>::max()) {
+
+}
+
+AdaptiveIcosphere::~AdaptiveIcosphere() {
+
+}
+
+void AdaptiveIcosphere::setBounds (const ::icosphere::Bounds& bounds) {
+    _bounds.reset (new ::icosphere::Bounds (bounds));
+}
+
+void AdaptiveIcosphere::setTolerance (const float& tolerance, const CpuEvaluator* evaluator) {
+    _tolerance = tolerance;
+    _evaluator = evaluator;
+}
+
+void AdaptiveIcosphere::setVertexBudget (const uint32_t& budget) {
+    _budget = budget;
+}
+
+void AdaptiveIcosphere::refine () {
+    _x.clear(); _y.clear(); _z.clear(); _heights.clear();
+    _nodes.clear();
+    _midpoints.clear();
+    _edges.clear();
+    _levels.assign (_depth, std::vector<uint32_t>());
+    _divisions.assign (_depth, 0);
+
+    Icosphere base (1);
+    for (uint32_t v = 0; v < base.vertexCount(); v++) {
+        float height = 0.0f;
+        if (_evaluator) {
+            height = _evaluator -> evaluate (base.x() [v], base.y() [v], base.z() [v]);
+        }
+        addVertex (base.x() [v], base.y() [v], base.z() [v], height);
+    }
+    for (uint32_t t = 0; t < base.triangleCount(); t++) {
+        addNode (base.triangles() [t * 3], base.triangles() [t * 3 + 1], base.triangles() [t * 3 + 2], 0, 0);
+    }
+
+    for (unsigned level = 0; level + 1 < _depth; level++) {
+
+        // a copy, since dividing a coarser neighbour adds to the level
+        std::vector<uint32_t> candidates;
+        for (uint32_t node : std::vector<uint32_t> (_levels [level])) {
+            if (! _nodes [node].children && (! _bounds || reaches (_nodes [node]))) {
+                candidates.push_back (node);
+            }
+        }
+
+        std::vector<float> errors (candidates.size(), 0.0f);
+        if (_evaluator) {
+
+            // the midpoints of the candidates' sides which aren't vertices yet, each once however many sides it is on
+            std::vector<uint64_t> keys;
+            std::vector<float> xyz;
+            for (uint32_t node : candidates) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t p = _nodes [node].vertices [k], q = _nodes [node].vertices [(k + 1) % 3];
+                    uint64_t key = undirected (p, q);
+                    if (_midpoints.count (key) || _pending.count (key)) { continue; }
+                    _pending [key] = 0.0f;
+                    keys.push_back (key);
+                    double x = (double) _x [p] + _x [q], y = (double) _y [p] + _y [q], z = (double) _z [p] + _z [q];
+                    double mag = std::sqrt (x * x + y * y + z * z);
+                    xyz.push_back ((float) (x / mag));
+                    xyz.push_back ((float) (y / mag));
+                    xyz.push_back ((float) (z / mag));
+                }
+            }
+            std::vector<float> heights (keys.size());
+            const CpuEvaluator* evaluator = _evaluator;
+            parallelFor (keys.size(), EvaluationChunk, [evaluator, &xyz, &heights] (const uint64_t& begin, const uint64_t& end) {
+                evaluator -> evaluate (xyz.data() + begin * 3, heights.data() + begin, end - begin);
+            });
+            for (size_t i = 0; i < keys.size(); i++) {
+                _pending [keys [i]] = heights [i];
+            }
+
+            parallelFor (candidates.size(), EvaluationChunk, [this, &candidates, &errors] (const uint64_t& begin, const uint64_t& end) {
+                for (uint64_t i = begin; i < end; i++) {
+                    const Node& node = _nodes [candidates [i]];
+                    for (int k = 0; k < 3; k++) {
+                        uint32_t p = node.vertices [k], q = node.vertices [(k + 1) % 3];
+                        uint64_t key = undirected (p, q);
+                        auto m = _midpoints.find (key);
+                        float height = m != _midpoints.end() ? _heights [m -> second] : _pending.at (key);
+                        errors [i] = std::max (errors [i], std::fabs (height - (_heights [p] + _heights [q]) * 0.5f));
+                    }
+                }
+            });
+        }
+
+        // worst first, so that a budget that runs out leaves the least important triangles undivided
+        std::vector<size_t> order;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (! _evaluator || errors [i] > _tolerance) {
+                order.push_back (i);
+            }
+        }
+        std::stable_sort (order.begin(), order.end(), [&errors] (const size_t& a, const size_t& b) { return errors [a] > errors [b]; });
+        bool full = false;
+        for (size_t i : order) {
+            if (_x.size() >= _budget) {
+                full = true;
+                break;
+            }
+            divide (candidates [i]);
+        }
+        _pending.clear();
+        if (full || order.empty()) { break; }
+    }
+}
+
+uint32_t AdaptiveIcosphere::addVertex (const double& x, const double& y, const double& z, const float& height) {
+    _x.push_back ((float) x);
+    _y.push_back ((float) y);
+    _z.push_back ((float) z);
+    if (_evaluator) {
+        _heights.push_back (height);
+    }
+    return (uint32_t) (_x.size() - 1);
+}
+
+uint32_t AdaptiveIcosphere::addNode (const uint32_t& a, const uint32_t& b, const uint32_t& c, const uint32_t& parent, const uint8_t& level) {
+    Node node;
+    node.vertices [0] = a;
+    node.vertices [1] = b;
+    node.vertices [2] = c;
+    node.parent = parent;
+    node.children = 0;
+    node.level = level;
+    uint32_t index = (uint32_t) _nodes.size();
+    _nodes.push_back (node);
+    _levels [level].push_back (index);
+    for (int k = 0; k < 3; k++) {
+        _edges [directed (node.vertices [k], node.vertices [(k + 1) % 3])] = index;
+    }
+    return index;
+}
+
+uint32_t AdaptiveIcosphere::midpoint (const uint32_t& p, const uint32_t& q) {
+    uint64_t key = undirected (p, q);
+    auto m = _midpoints.find (key);
+    if (m != _midpoints.end()) { return m -> second; }
+    double x = (double) _x [p] + _x [q], y = (double) _y [p] + _y [q], z = (double) _z [p] + _z [q];
+    double mag = std::sqrt (x * x + y * y + z * z);
+    x /= mag; y /= mag; z /= mag;
+    float height = 0.0f;
+    if (_evaluator) {
+        auto pending = _pending.find (key);
+        height = pending != _pending.end() ? pending -> second : _evaluator -> evaluate ((float) x, (float) y, (float) z);
+    }
+    uint32_t vertex = addVertex (x, y, z, height);
+    _midpoints [key] = vertex;
+    return vertex;
+}
+
+// A side with no node on the other side of it going the other way lies along a side of the parent, and the node on the
+// other side of that is one level coarser; it is divided first.
+void AdaptiveIcosphere::divide (const uint32_t& index) {
+    Node node = _nodes [index];
+    if (node.children) { return; }
+    if (node.level > 0) {
+        Node parent = _nodes [node.parent];
+        int child = (int) (index - parent.children);
+        for (int k = 0; k < 3; k++) {
+            uint32_t p = node.vertices [k], q = node.vertices [(k + 1) % 3];
+            if (_edges.count (directed (q, p)) || ParentSide [child][k] < 0) { continue; }
+            int side = ParentSide [child][k];
+            auto neighbour = _edges.find (directed (parent.vertices [(side + 1) % 3], parent.vertices [side]));
+            if (neighbour != _edges.end()) {
+                divide (neighbour -> second);
+            }
+        }
+    }
+
+    uint32_t a = node.vertices [0], b = node.vertices [1], c = node.vertices [2];
+    uint32_t ab = midpoint (a, b), bc = midpoint (b, c), ca = midpoint (c, a);
+    uint8_t level = node.level + 1;
+    uint32_t first = addNode (a, ab, ca, index, level);
+    addNode (b, bc, ab, index, level);
+    addNode (c, ca, bc, index, level);
+    addNode (ab, bc, ca, index, level);
+    _nodes [index].children = first;
+    _divisions [node.level]++;
+}
+
+bool AdaptiveIcosphere::inside (const double& x, const double& y, const double& z) const {
+    double lat = std::asin (std::max (-1.0, std::min (1.0, y / std::sqrt (x * x + y * y + z * z))));
+    double lon = std::atan2 (z, x);
+    if (lat < _bounds -> south() || lat > _bounds -> north()) { return false; }
+    if (_bounds -> west() <= _bounds -> east()) {
+        return lon >= _bounds -> west() && lon <= _bounds -> east();
+    }
+    return lon >= _bounds -> west() || lon <= _bounds -> east();
+}
+
+// whether a triangle reaches into the bounds: any of its corners or the midpoints of its sides is inside them, or the
+// bounds' centre is inside the triangle
+bool AdaptiveIcosphere::reaches (const Node& node) const {
+    for (int k = 0; k < 3; k++) {
+        uint32_t p = node.vertices [k], q = node.vertices [(k + 1) % 3];
+        if (inside (_x [p], _y [p], _z [p]) || inside ((double) _x [p] + _x [q], (double) _y [p] + _y [q], (double) _z [p] + _z [q])) {
+            return true;
+        }
+    }
+    geoutils::Geolocation centre = _bounds -> center();
+    double cx = std::cos (centre.latitude()) * std::cos (centre.longitude());
+    double cy = std::sin (centre.latitude());
+    double cz = std::cos (centre.latitude()) * std::sin (centre.longitude());
+    for (int k = 0; k < 3; k++) {
+        uint32_t p = node.vertices [k], q = node.vertices [(k + 1) % 3];
+        double ax = _x [p], ay = _y [p], az = _z [p], bx = _x [q], by = _y [q], bz = _z [q];
+        if (cx * (ay * bz - az * by) + cy * (az * bx - ax * bz) + cz * (ax * by - ay * bx) > 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned AdaptiveIcosphere::depth () const {
+    return _depth;
+}
+
+uint32_t AdaptiveIcosphere::vertexCount () const {
+    return (uint32_t) _x.size();
+}
+
+const float* AdaptiveIcosphere::x () const {
+    return _x.data();
+}
+
+const float* AdaptiveIcosphere::y () const {
+    return _y.data();
+}
+
+const float* AdaptiveIcosphere::z () const {
+    return _z.data();
+}
+
+const float* AdaptiveIcosphere::heights () const {
+    return _evaluator ? _heights.data() : nullptr;
+}
+
+std::vector<uint32_t> AdaptiveIcosphere::divisions () const {
+    return _divisions;
+}
+
+// A leaf with a vertex in the middle of one or two of its sides is a polygon of four or five corners, all of them on the
+// triangle's sides, and is made into triangles fanning out from one of the middle vertices, none of which can then have
+// all three corners along one side. A leaf with a vertex in the middle of every side is split as a division would.
+std::vector<uint32_t> AdaptiveIcosphere::triangles () const {
+    std::vector<uint32_t> triangles;
+    for (const Node& node : _nodes) {
+        if (node.children) { continue; }
+        uint32_t polygon [6];
+        int corners = 0, middle = -1, middles = 0;
+        for (int k = 0; k < 3; k++) {
+            polygon [corners++] = node.vertices [k];
+            auto m = _midpoints.find (undirected (node.vertices [k], node.vertices [(k + 1) % 3]));
+            if (m != _midpoints.end()) {
+                middle = corners;
+                middles++;
+                polygon [corners++] = m -> second;
+            }
+        }
+        if (middles == 0) {
+            triangles.insert (triangles.end(), node.vertices, node.vertices + 3);
+        } else if (middles == 3) {
+            uint32_t children [12] = { polygon [0], polygon [1], polygon [5], polygon [2], polygon [3], polygon [1],
+                                       polygon [4], polygon [5], polygon [3], polygon [1], polygon [3], polygon [5] };
+            triangles.insert (triangles.end(), children, children + 12);
+        } else {
+            for (int i = 1; i < corners - 1; i++) {
+                triangles.push_back (polygon [middle]);
+                triangles.push_back (polygon [(middle + i) % corners]);
+                triangles.push_back (polygon [(middle + i + 1) % corners]);
+            }
+        }
+    }
+    return triangles;
+}
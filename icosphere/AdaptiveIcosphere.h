@@ -0,0 +1,86 @@
+#ifndef CALENHAD_ADAPTIVEICOSPHERE_H
+#define CALENHAD_ADAPTIVEICOSPHERE_H
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Bounds.h"
+
+namespace calenhad {
+    namespace graph {
+        class CpuEvaluator;
+    }
+    namespace icosphere {
+
+        // An icosphere divided, level by level down to its depth, only inside the bounds and where the module strays from
+        // a flat triangle by more than the tolerance; midpoints are evaluated in parallel, and the mesh has no cracks.
+        class AdaptiveIcosphere {
+        public:
+            AdaptiveIcosphere (const unsigned& depth);
+            ~AdaptiveIcosphere();
+
+            // divide only triangles which reach into the bounds
+            void setBounds (const ::icosphere::Bounds& bounds);
+
+            // divide only triangles whose error, in the evaluator's values, is greater than the tolerance
+            void setTolerance (const float& tolerance, const calenhad::graph::CpuEvaluator* evaluator);
+
+            // stop dividing once there are this many vertices (forced divisions may go a few over)
+            void setVertexBudget (const uint32_t& budget);
+
+            void refine ();
+
+            unsigned depth () const;
+            uint32_t vertexCount () const;
+            const float* x () const;
+            const float* y () const;
+            const float* z () const;
+
+            // the evaluator's value at each vertex, or null if there is no evaluator
+            const float* heights () const;
+
+            // number of triangles divided at each level
+            std::vector<uint32_t> divisions () const;
+
+            // the mesh, three vertex ids to a triangle, running clockwise seen from outside as in Icosphere
+            std::vector<uint32_t> triangles () const;
+
+        protected:
+            struct Node {
+                uint32_t vertices [3];
+                uint32_t parent;
+                uint32_t children;      // first of four, or zero for a leaf
+                uint8_t level;
+            };
+
+            unsigned _depth;
+            std::unique_ptr<::icosphere::Bounds> _bounds;
+            float _tolerance;
+            const calenhad::graph::CpuEvaluator* _evaluator;
+            uint32_t _budget;
+            std::vector<float> _x, _y, _z, _heights;
+            std::vector<Node> _nodes;
+            std::vector<std::vector<uint32_t>> _levels;
+            std::vector<uint32_t> _divisions;
+
+            // the vertex in the middle of each edge which has one, by the edge's ends, lower id first; and the node with
+            // each directed edge, by its start and end
+            std::unordered_map<uint64_t, uint32_t> _midpoints;
+            std::unordered_map<uint64_t, uint32_t> _edges;
+
+            // heights evaluated for midpoints not yet made into vertices
+            std::unordered_map<uint64_t, float> _pending;
+
+            uint32_t addVertex (const double& x, const double& y, const double& z, const float& height);
+            uint32_t addNode (const uint32_t& a, const uint32_t& b, const uint32_t& c, const uint32_t& parent, const uint8_t& level);
+            uint32_t midpoint (const uint32_t& p, const uint32_t& q);
+            void divide (const uint32_t& node);
+            bool reaches (const Node& node) const;
+            bool inside (const double& x, const double& y, const double& z) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_ADAPTIVEICOSPHERE_H
@@ -36,7 +36,7 @@ bool Bounds::operator!= (const Bounds& other) const {
 }
 
 double Bounds::width () const {
-    return _east > _west ? _east - _west : M_2_PI - (_west - _east);
+    return _east > _west ? _east - _west : 2 * M_PI - (_west - _east);
 }
 
 double Bounds::height() const {
@@ -60,8 +60,10 @@ double Bounds::west () const {
 }
 
 Geolocation Bounds::center() const {
-    double lon = _east > _west ? _east + _west / 2 : M_2_PI - (_east + _west / 2);
-    double lat = _north + _south / 2;
+    double lon = _west + width() / 2;
+    if (lon > M_PI) { lon -= 2 * M_PI; }
+    double lat = (_north + _south) / 2;
+    return Geolocation (lat, lon, Units::Radians);
 }
 
 bool Bounds::crossesDateline () {
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <limits>
+#include "Dataset.h"
+#include "Parallel.h"
+#include "../graph/CpuEvaluator.h"
+
+using namespace calenhad::icosphere;
+using namespace calenhad::graph;
+
+namespace {
+
+    // vertices are handed out to threads in runs of this many
+    const uint64_t VertexChunk = 1 << 16;
+
+    // each run of the column gets its own summary, and the runs' summaries are put together at the end; the loop over a
+    // run does nothing but compare and add, so that the compiler can vectorise it
+    template <typename T> Dataset::Summary summarise (const T* values, const uint64_t& n) {
+        Dataset::Summary summary;
+        if (n == 0) { return summary; }
+        uint64_t runs = (n + VertexChunk - 1) / VertexChunk;
+        std::vector<Dataset::Summary> partial (runs);
+        parallelFor (n, VertexChunk, [values, &partial] (const uint64_t& begin, const uint64_t& end) {
+            T minimum = values [begin], maximum = values [begin];
+            double sum = 0.0;
+            for (uint64_t i = begin; i < end; i++) {
+                minimum = std::min (minimum, values [i]);
+                maximum = std::max (maximum, values [i]);
+                sum += values [i];
+            }
+            Dataset::Summary& s = partial [begin / VertexChunk];
+            s.minimum = minimum;
+            s.maximum = maximum;
+            s.sum = sum;
+        });
+        summary = partial [0];
+        for (uint64_t r = 1; r < runs; r++) {
+            summary.minimum = std::min (summary.minimum, partial [r].minimum);
+            summary.maximum = std::max (summary.maximum, partial [r].maximum);
+            summary.sum += partial [r].sum;
+        }
+        summary.mean = summary.sum / n;
+        return summary;
+    }
+}
+
+Dataset::Dataset (std::shared_ptr<Icosphere> icosphere) : _icosphere (icosphere) {
+
+}
+
+Dataset::~Dataset() {
+
+}
+
+std::shared_ptr<Icosphere> Dataset::icosphere () const {
+    return _icosphere;
+}
+
+uint32_t Dataset::size () const {
+    return _icosphere -> vertexCount();
+}
+
+bool Dataset::contains (const QString& name) const {
+    return _columns.contains (name);
+}
+
+QStringList Dataset::names () const {
+    return _columns.keys();
+}
+
+ColumnType Dataset::type (const QString& name) const {
+    return _columns.value (name).type;
+}
+
+void Dataset::remove (const QString& name) {
+    _columns.remove (name);
+}
+
+void* Dataset::add (const QString& name, const ColumnType& type) {
+    Column& column = _columns [name];
+    column.type = type;
+    column.data = std::shared_ptr<char> (new char [size() * columnTypeSize (type)] (), std::default_delete<char []>());
+    return column.data.get();
+}
+
+void* Dataset::data (const QString& name, const ColumnType& type) {
+    auto i = _columns.find (name);
+    return i == _columns.end() || i -> type != type ? nullptr : i -> data.get();
+}
+
+const void* Dataset::data (const QString& name, const ColumnType& type) const {
+    auto i = _columns.find (name);
+    return i == _columns.end() || i -> type != type ? nullptr : i -> data.get();
+}
+
+void Dataset::fill (const QString& name, const CpuEvaluator& evaluator) {
+    float* out = add<float> (name);
+    const Icosphere* sphere = _icosphere.get();
+    parallelFor (size(), VertexChunk, [sphere, out, &evaluator] (const uint64_t& begin, const uint64_t& end) {
+        std::vector<float> xyz ((end - begin) * 3);
+        for (uint64_t v = begin; v < end; v++) {
+            xyz [(v - begin) * 3] = sphere -> x() [v];
+            xyz [(v - begin) * 3 + 1] = sphere -> y() [v];
+            xyz [(v - begin) * 3 + 2] = sphere -> z() [v];
+        }
+        evaluator.evaluate (xyz.data(), out + begin, end - begin);
+    });
+}
+
+Dataset::Summary Dataset::summarise (const QString& name) const {
+    auto i = _columns.find (name);
+    if (i == _columns.end()) { return Summary(); }
+    switch (i -> type) {
+        case Float32: return ::summarise ((const float*) i -> data.get(), size());
+        case Int32: return ::summarise ((const int32_t*) i -> data.get(), size());
+        default: return ::summarise ((const uint8_t*) i -> data.get(), size());
+    }
+}
+
+QVector<uint64_t> Dataset::histogram (const QString& name) const {
+    QVector<uint64_t> counts (256, 0);
+    const uint8_t* values = column<uint8_t> (name);
+    if (! values) { return counts; }
+    for (uint32_t v = 0; v < size(); v++) {
+        counts [values [v]]++;
+    }
+    return counts;
+}
+
+float Dataset::value (const Column& column, const Location& location) const {
+    if (column.type == Float32) {
+        const float* values = (const float*) column.data.get();
+        return values [location.vertices [0]] * location.weights [0]
+             + values [location.vertices [1]] * location.weights [1]
+             + values [location.vertices [2]] * location.weights [2];
+    }
+    if (column.type == Int32) {
+        return (float) ((const int32_t*) column.data.get()) [location.nearest];
+    }
+    return (float) ((const uint8_t*) column.data.get()) [location.nearest];
+}
+
+float Dataset::sample (const QString& name, const Location& location) const {
+    auto i = _columns.find (name);
+    return i == _columns.end() ? 0.0f : value (*i, location);
+}
+
+void Dataset::sample (const QString& name, const float* xyz, float* out, const size_t& n) const {
+    auto i = _columns.find (name);
+    if (i == _columns.end()) {
+        std::fill (out, out + n, 0.0f);
+        return;
+    }
+    for (size_t p = 0; p < n; p++) {
+        out [p] = value (*i, _icosphere -> locate (Cartesian { xyz [p * 3], xyz [p * 3 + 1], xyz [p * 3 + 2] }));
+    }
+}
+
+size_t Dataset::memoryUsed () const {
+    size_t bytes = 0;
+    for (const Column& column : _columns) {
+        bytes += (size_t) size() * columnTypeSize (column.type);
+    }
+    return bytes;
+}
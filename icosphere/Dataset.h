@@ -0,0 +1,114 @@
+#ifndef CALENHAD_DATASET_H
+#define CALENHAD_DATASET_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include "icosphere.h"
+
+namespace calenhad {
+    namespace graph {
+        class CpuEvaluator;
+    }
+    namespace icosphere {
+
+        enum ColumnType {
+            Float32, Int32, UInt8
+        };
+
+        template <typename T> struct ColumnTraits;
+        template <> struct ColumnTraits<float> { static constexpr ColumnType type = Float32; };
+        template <> struct ColumnTraits<int32_t> { static constexpr ColumnType type = Int32; };
+        template <> struct ColumnTraits<uint8_t> { static constexpr ColumnType type = UInt8; };
+
+        inline size_t columnTypeSize (const ColumnType& type) {
+            return type == Float32 ? sizeof (float) : type == Int32 ? sizeof (int32_t) : sizeof (uint8_t);
+        }
+
+        // Values attached to the vertices of an icosphere, a named column for each quantity: heights, plate ids, biome
+        // classes and so on. Each column holds one value per vertex of the sphere, indexed by vertex id, in a single
+        // array of floats, 32 bit integers or bytes, so that a pass over a column is a pass over contiguous memory,
+        // and looking a column up by name happens once per pass rather than once per value.
+        //
+        // Columns are read and written through the pointers column () gives, which stay valid until the column is
+        // removed or replaced. A dataset may be read from any number of threads at once, but adding or removing
+        // columns must not overlap with anything else. A dataset read from a file (see IcosphereFile) uses the
+        // columns in place in the mapped file; writing to one copies only the pages written to, and leaves the file
+        // as it was.
+        class Dataset {
+        public:
+            Dataset (std::shared_ptr<Icosphere> icosphere);
+            ~Dataset();
+
+            std::shared_ptr<Icosphere> icosphere () const;
+
+            // number of values in each column
+            uint32_t size () const;
+
+            bool contains (const QString& name) const;
+            QStringList names () const;
+            ColumnType type (const QString& name) const;
+            void remove (const QString& name);
+
+            // a new column, filled with zeros, in place of any column of the same name
+            template <typename T> T* add (const QString& name) {
+                return static_cast<T*> (add (name, ColumnTraits<T>::type));
+            }
+
+            // the named column, or null if there is none of that type
+            template <typename T> T* column (const QString& name) {
+                return static_cast<T*> (data (name, ColumnTraits<T>::type));
+            }
+
+            template <typename T> const T* column (const QString& name) const {
+                return static_cast<const T*> (data (name, ColumnTraits<T>::type));
+            }
+
+            // evaluate the evaluator's graph at every vertex, in parallel, into a float column of the given name
+            void fill (const QString& name, const calenhad::graph::CpuEvaluator& evaluator);
+
+            // Minimum, maximum, sum and mean of a column of any type, worked out in parallel. Histogram counts the
+            // vertices with each of the 256 values of a column of bytes.
+            struct Summary {
+                double minimum = 0.0, maximum = 0.0, sum = 0.0, mean = 0.0;
+            };
+            Summary summarise (const QString& name) const;
+            QVector<uint64_t> histogram (const QString& name) const;
+
+            // The column's value at a point found by Icosphere::locate. A float column is interpolated between the
+            // corners of the triangle holding the point; an integer column, which holds identifiers or classes that
+            // can't be averaged, gives the value at the nearest vertex.
+            float sample (const QString& name, const Location& location) const;
+
+            // same, for n points given as x, y and z together for each point
+            void sample (const QString& name, const float* xyz, float* out, const size_t& n) const;
+
+            // bytes held by the columns
+            size_t memoryUsed () const;
+
+        protected:
+            friend class IcosphereFile;
+
+            // the values, in memory of their own or in a mapped file, which data then keeps open
+            struct Column {
+                ColumnType type = Float32;
+                std::shared_ptr<char> data;
+            };
+
+            std::shared_ptr<Icosphere> _icosphere;
+            QMap<QString, Column> _columns;
+
+            void* add (const QString& name, const ColumnType& type);
+            void* data (const QString& name, const ColumnType& type);
+            const void* data (const QString& name, const ColumnType& type) const;
+            float value (const Column& column, const Location& location) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_DATASET_H
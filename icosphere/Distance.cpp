@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include "Distance.h"
+#include "icosphere.h"
+#include "Parallel.h"
+
+using namespace calenhad::icosphere;
+
+namespace {
+
+    // vertices are handed out to threads in runs of this many
+    const uint64_t VertexChunk = 1 << 16;
+
+    const float Infinity = std::numeric_limits<float>::infinity();
+}
+
+Distance::Distance (std::shared_ptr<Icosphere> icosphere, const float* values) : _icosphere (icosphere),
+    _values (values, values + icosphere -> vertexCount()),
+    _distances (icosphere -> vertexCount(), Infinity),
+    _nearest (icosphere -> vertexCount(), -1),
+    _threshold (std::numeric_limits<float>::quiet_NaN()) {
+
+}
+
+Distance::~Distance() {
+
+}
+
+const float* Distance::distances() const {
+    return _distances.data();
+}
+
+const int32_t* Distance::nearest() const {
+    return _nearest.data();
+}
+
+float Distance::threshold() const {
+    return _threshold;
+}
+
+void Distance::update (const float& threshold) {
+    if (threshold == _threshold) { return; }
+    uint64_t n = _values.size();
+    const uint32_t* neighbours = _icosphere -> neighbours();
+    std::vector<std::vector<uint32_t>> found ((n + VertexChunk - 1) / VertexChunk);
+    float previous = _threshold;
+
+    if (std::isnan (previous) || threshold > previous) {
+        // new features start at no distance from themselves; the rest keep their distances, which the new features
+        // can only shorten. The first time, every vertex is cleared first.
+        bool first = std::isnan (previous);
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            std::vector<uint32_t>& sources = found [begin / VertexChunk];
+            for (uint64_t v = begin; v < end; v++) {
+                if (_values [v] < threshold && (first || _values [v] >= previous)) {
+                    _distances [v] = 0.0f;
+                    _nearest [v] = (int32_t) v;
+                    sources.push_back ((uint32_t) v);
+                } else if (first) {
+                    _distances [v] = Infinity;
+                    _nearest [v] = -1;
+                }
+            }
+        });
+    } else {
+        // vertices nearest a feature which is no longer one are cleared...
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                if (_nearest [v] >= 0 && ! (_values [_nearest [v]] < threshold)) {
+                    _distances [v] = Infinity;
+                    _nearest [v] = -1;
+                }
+            }
+        });
+        // ... and reached again from the vertices around them which weren't
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            std::vector<uint32_t>& edge = found [begin / VertexChunk];
+            for (uint64_t v = begin; v < end; v++) {
+                if (_nearest [v] < 0) { continue; }
+                for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                    if (_nearest [neighbours [k]] < 0) {
+                        edge.push_back ((uint32_t) v);
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    _threshold = threshold;
+
+    std::vector<uint32_t> queued;
+    for (const std::vector<uint32_t>& vertices : found) {
+        queued.insert (queued.end(), vertices.begin(), vertices.end());
+    }
+    spread (queued);
+}
+
+// Dijkstra's algorithm, except that a vertex's distance is to the feature its neighbour was nearest rather than
+// through its neighbour. It takes vertices strictly nearest first, so this part is done on a single thread.
+void Distance::spread (std::vector<uint32_t>& queued) {
+    typedef std::pair<float, uint32_t> Entry;
+    std::vector<Entry> entries;
+    entries.reserve (queued.size());
+    for (uint32_t v : queued) {
+        entries.push_back (Entry (_distances [v], v));
+    }
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue (std::greater<Entry>(), std::move (entries));
+    const uint32_t* neighbours = _icosphere -> neighbours();
+    while (! queue.empty()) {
+        Entry e = queue.top();
+        queue.pop();
+        uint32_t v = e.second;
+        if (e.first > _distances [v]) { continue; }
+        uint32_t feature = (uint32_t) _nearest [v];
+        for (uint64_t k = Icosphere::neighbourOffset (v); k < Icosphere::neighbourOffset (v + 1); k++) {
+            uint32_t u = neighbours [k];
+            float d = (float) arc (u, feature);
+            if (d < _distances [u]) {
+                _distances [u] = d;
+                _nearest [u] = (int32_t) feature;
+                queue.push (Entry (d, u));
+            }
+        }
+    }
+}
+
+// from the cross and dot products rather than the arc cosine alone, which loses precision over short distances
+double Distance::arc (const uint32_t& a, const uint32_t& b) const {
+    const float* x = _icosphere -> x();
+    const float* y = _icosphere -> y();
+    const float* z = _icosphere -> z();
+    double ax = x [a], ay = y [a], az = z [a], bx = x [b], by = y [b], bz = z [b];
+    double cx = ay * bz - az * by, cy = az * bx - ax * bz, cz = ax * by - ay * bx;
+    return std::atan2 (std::sqrt (cx * cx + cy * cy + cz * cz), ax * bx + ay * by + az * bz);
+}
@@ -0,0 +1,46 @@
+#ifndef CALENHAD_DISTANCE_H
+#define CALENHAD_DISTANCE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace calenhad {
+    namespace icosphere {
+        class Icosphere;
+
+        // Great circle distance, in radians, from each vertex of an icosphere to the nearest vertex whose value is below
+        // a threshold; changing the threshold updates only the vertices it affects.
+        class Distance {
+        public:
+            // values, one for each vertex, are copied
+            Distance (std::shared_ptr<Icosphere> icosphere, const float* values);
+            ~Distance();
+
+            void update (const float& threshold);
+
+            // distance from each vertex to the nearest feature, or infinity if there are none
+            const float* distances () const;
+
+            // the feature vertex nearest each vertex, or -1 if there are none
+            const int32_t* nearest () const;
+
+            // the threshold of the last update, or NaN before the first
+            float threshold () const;
+
+        protected:
+            std::shared_ptr<Icosphere> _icosphere;
+            std::vector<float> _values, _distances;
+            std::vector<int32_t> _nearest;
+            float _threshold;
+
+            // spreads distances out from the vertices queued
+            void spread (std::vector<uint32_t>& queued);
+
+            double arc (const uint32_t& a, const uint32_t& b) const;
+        };
+    }
+}
+
+
+#endif //CALENHAD_DISTANCE_H
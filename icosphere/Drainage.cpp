@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <QtCore/QMutex>
+#include "Drainage.h"
+#include "Dataset.h"
+#include "Parallel.h"
+
+using namespace calenhad::icosphere;
+
+namespace {
+
+    // vertices are handed out to threads in runs of this many
+    const uint64_t VertexChunk = 1 << 16;
+
+    // vertices of a wave of the accumulation are handed out to threads in runs of this many
+    const uint64_t FrontierChunk = 1 << 12;
+
+    // how much higher than the vertex it was reached from a vertex in a filled depression is raised, relative to its
+    // height, so that the filled surface still runs downhill to where the depression spills over
+    const double Epsilon = 1e-9;
+
+    // Runs work (vertex, next) on each vertex of the frontier, in parallel, each run with a vector of its own to which
+    // to add the vertices of the next wave; then makes those the frontier, in the order of the runs, so that the waves
+    // are the same whatever the threads.
+    void waves (std::vector<uint32_t>& frontier, const std::function<void (const uint32_t&, std::vector<uint32_t>&)>& work) {
+        while (! frontier.empty()) {
+            uint64_t runs = (frontier.size() + FrontierChunk - 1) / FrontierChunk;
+            std::vector<std::vector<uint32_t>> next (runs);
+            parallelFor (frontier.size(), FrontierChunk, [&frontier, &next, &work] (const uint64_t& begin, const uint64_t& end) {
+                std::vector<uint32_t>& found = next [begin / FrontierChunk];
+                for (uint64_t i = begin; i < end; i++) {
+                    work (frontier [i], found);
+                }
+            });
+            frontier.clear();
+            for (std::vector<uint32_t>& found : next) {
+                frontier.insert (frontier.end(), found.begin(), found.end());
+            }
+        }
+    }
+}
+
+Drainage::Drainage (std::shared_ptr<Dataset> dataset) : _dataset (dataset) {
+
+}
+
+Drainage::~Drainage() {
+
+}
+
+bool Drainage::run (const QString& height, const float& seaLevel) {
+    const float* h = _dataset -> column<float> (height);
+    if (! h) { return false; }
+    const Icosphere& sphere = *_dataset -> icosphere();
+    const uint32_t* neighbours = sphere.neighbours();
+    uint32_t n = sphere.vertexCount();
+
+    // Priority flood. The queue orders vertices of the same height by id, so that the filled surface doesn't depend
+    // on the order in which they were queued. This is the one part done on a single thread: it takes vertices strictly
+    // lowest first.
+    typedef std::pair<double, uint32_t> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    std::vector<double> filled (h, h + n);
+    std::vector<uint8_t> closed (n, 0);
+    uint32_t lowest = 0;
+    for (uint32_t v = 0; v < n; v++) {
+        if (h [v] < seaLevel) {
+            closed [v] = 1;
+            queue.push (Entry (filled [v], v));
+        }
+        if (h [v] < h [lowest]) { lowest = v; }
+    }
+    if (queue.empty()) {
+        closed [lowest] = 1;
+        queue.push (Entry (filled [lowest], lowest));
+    }
+    while (! queue.empty()) {
+        Entry e = queue.top();
+        queue.pop();
+        for (uint64_t k = Icosphere::neighbourOffset (e.second); k < Icosphere::neighbourOffset (e.second + 1); k++) {
+            uint32_t u = neighbours [k];
+            if (! closed [u]) {
+                closed [u] = 1;
+                filled [u] = std::max (filled [u], e.first + Epsilon * (1.0 + std::abs (e.first)));
+                queue.push (Entry (filled [u], u));
+            }
+        }
+    }
+
+    // each land vertex drains to its lowest neighbour, which the flood guarantees is lower than it is; the sea, and
+    // the lowest vertex of a planet without any, drains nowhere
+    float* f = _dataset -> add<float> ("filled");
+    int32_t* receiver = _dataset -> add<int32_t> ("receiver");
+    std::vector<std::atomic<int32_t>> donors (n);
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            donors [v].store (0, std::memory_order_relaxed);
+        }
+    });
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            f [v] = (float) filled [v];
+            int32_t r = -1;
+            if (h [v] >= seaLevel && v != lowest) {
+                double d = filled [v];
+                for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                    uint32_t u = neighbours [k];
+                    if (filled [u] < d) {
+                        d = filled [u];
+                        r = (int32_t) u;
+                    }
+                }
+            }
+            receiver [v] = r;
+            if (r >= 0) { donors [r].fetch_add (1, std::memory_order_relaxed); }
+        }
+    });
+
+    // accumulation, from the vertices nothing drains into down to the sea
+    std::vector<std::atomic<int32_t>> count (n);
+    std::vector<uint32_t> frontier;
+    QMutex mutex;
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        std::vector<uint32_t> found;
+        for (uint64_t v = begin; v < end; v++) {
+            count [v].store (1, std::memory_order_relaxed);
+            if (donors [v].load (std::memory_order_relaxed) == 0) { found.push_back ((uint32_t) v); }
+        }
+        mutex.lock();
+        frontier.insert (frontier.end(), found.begin(), found.end());
+        mutex.unlock();
+    });
+    // the order of the first wave depends on the threads, though the counts don't; sort it so that the waves don't either
+    std::sort (frontier.begin(), frontier.end());
+    waves (frontier, [&] (const uint32_t& v, std::vector<uint32_t>& next) {
+        int32_t r = receiver [v];
+        if (r < 0) { return; }
+        count [r].fetch_add (count [v].load (std::memory_order_relaxed), std::memory_order_relaxed);
+        // the last donor to finish passes the receiver on to the next wave
+        if (donors [r].fetch_sub (1, std::memory_order_acq_rel) == 1) { next.push_back ((uint32_t) r); }
+    });
+
+    int32_t* accumulation = _dataset -> add<int32_t> ("accumulation");
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            accumulation [v] = count [v].load (std::memory_order_relaxed);
+        }
+    });
+    return true;
+}
+
+std::vector<std::vector<uint32_t>> Drainage::rivers (const uint32_t& threshold) const {
+    std::vector<std::vector<uint32_t>> rivers;
+    const int32_t* receiver = _dataset -> column<int32_t> ("receiver");
+    const int32_t* accumulation = _dataset -> column<int32_t> ("accumulation");
+    if (! receiver || ! accumulation) { return rivers; }
+    const Icosphere& sphere = *_dataset -> icosphere();
+    const uint32_t* neighbours = sphere.neighbours();
+    uint32_t n = sphere.vertexCount();
+    int32_t least = (int32_t) std::max (threshold, 1u);
+
+    // sources: vertices draining enough, into which nothing draining enough drains, found a run at a time and kept in
+    // the order of the runs
+    uint64_t runs = (n + VertexChunk - 1) / VertexChunk;
+    std::vector<std::vector<uint32_t>> found (runs);
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            if (accumulation [v] < least || receiver [v] < 0) { continue; }
+            bool source = true;
+            for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1) && source; k++) {
+                uint32_t u = neighbours [k];
+                source = ! (receiver [u] == (int32_t) v && accumulation [u] >= least);
+            }
+            if (source) { found [begin / VertexChunk].push_back ((uint32_t) v); }
+        }
+    });
+
+    // follow each downstream until it reaches the sea or a river already followed
+    std::vector<uint8_t> visited (n, 0);
+    for (const std::vector<uint32_t>& sources : found) {
+        for (uint32_t v : sources) {
+            std::vector<uint32_t> river { v };
+            visited [v] = 1;
+            for (int32_t r = receiver [v]; r >= 0; r = receiver [r]) {
+                river.push_back ((uint32_t) r);
+                if (visited [r]) { break; }
+                visited [r] = 1;
+            }
+            rivers.push_back (river);
+        }
+    }
+    return rivers;
+}
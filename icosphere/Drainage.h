@@ -0,0 +1,35 @@
+#ifndef CALENHAD_DRAINAGE_H
+#define CALENHAD_DRAINAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <QtCore/QString>
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+
+        // Fills depressions in a height field on an icosphere's vertices and routes drainage, in parallel, into columns
+        // "filled" (Float32), "receiver" (Int32, -1 for the sea) and "accumulation" (Int32, vertices draining through each).
+        class Drainage {
+        public:
+            Drainage (std::shared_ptr<Dataset> dataset);
+            ~Drainage();
+
+            // vertices of the height column lower than sea level are sea
+            bool run (const QString& height, const float& seaLevel);
+
+            // Rivers as runs of vertex ids, following the water down from every vertex draining at least threshold
+            // vertices into which no other such vertex drains, to the sea or to the river it joins, so that a
+            // tributary's last vertex is one of the river it flows into. Rivers are in order of their source vertex.
+            std::vector<std::vector<uint32_t>> rivers (const uint32_t& threshold) const;
+
+        protected:
+            std::shared_ptr<Dataset> _dataset;
+        };
+    }
+}
+
+
+#endif //CALENHAD_DRAINAGE_H
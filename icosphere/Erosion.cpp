@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Erosion.h"
+#include "Dataset.h"
+#include "Parallel.h"
+
+using namespace calenhad::icosphere;
+
+namespace {
+
+    // vertices are handed out to threads in runs of this many
+    const uint64_t VertexChunk = 1 << 14;
+
+    // angle subtended by an edge of the icosahedron, in degrees
+    const double IcosahedronEdge = 63.434948822922;
+
+    float unit (const uint32_t& seed, const uint32_t& vertex, const uint32_t& iteration) {
+        uint64_t h = ((uint64_t) seed * 0x9E3779B97F4A7C15ull) ^ ((uint64_t) vertex * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t) iteration * 0x165667B19E3779F9ull);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return (float) ((uint32_t) h / 4294967296.0);
+    }
+}
+
+Erosion::Erosion (std::shared_ptr<Dataset> dataset) : _dataset (dataset) {
+
+}
+
+Erosion::~Erosion() {
+
+}
+
+bool Erosion::run (const QString& from, const QString& to, const Settings& settings) {
+    const float* source = _dataset -> column<float> (from);
+    if (! source) { return false; }
+    const Icosphere& sphere = *_dataset -> icosphere();
+    const uint32_t* neighbours = sphere.neighbours();
+    uint64_t n = sphere.vertexCount();
+    uint32_t seed = (uint32_t) settings.seed;
+    float rain = settings.rain, evaporation = settings.evaporation;
+    float talus = (float) (settings.talus * IcosahedronEdge / std::pow (2.0, sphere.depth() - 1));
+    float shed = settings.weathering * 0.125f;
+
+    // height, water and sediment, each with a second array for the next iteration's values; and what each vertex
+    // sends downhill, and the total by which its neighbours are lower, for its neighbours to gather their share from
+    std::vector<float> h (source, source + n), h2 (n), w (n), w2 (n), s (n, 0.0f), s2 (n), outWater (n), outSediment (n), drop (n);
+
+    auto rainOn = [rain, seed] (const uint64_t& v, const int& iteration) {
+        return rain * 2.0f * unit (seed, (uint32_t) v, (uint32_t) iteration);
+    };
+    parallelFor (n, VertexChunk, [&w, &rainOn] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            w [v] = rainOn (v, 0);
+        }
+    });
+
+    for (int iteration = 0; iteration < settings.iterations; iteration++) {
+
+        // water moves downhill, at most halfway to level with the lowest neighbour so that it doesn't slosh back and
+        // forth, taking up or dropping soil on the way
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                float level = h [v] + w [v], total = 0.0f, steepest = 0.0f, lowest = h [v];
+                for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                    uint32_t u = neighbours [k];
+                    float d = level - h [u] - w [u];
+                    if (d > 0.0f) {
+                        total += d;
+                        steepest = std::max (steepest, d);
+                    }
+                    lowest = std::min (lowest, h [u]);
+                }
+                float moved = std::min (w [v], steepest * 0.5f);
+                float capacity = settings.capacity * moved * steepest;
+                float height = h [v], sediment = s [v];
+                if (sediment > capacity) {
+                    float dropped = settings.deposition * (sediment - capacity);
+                    height += dropped;
+                    sediment -= dropped;
+                } else {
+                    // never deeper than halfway to the lowest neighbour, so that water doesn't dig itself a pit
+                    float taken = std::min (settings.solubility * (capacity - sediment), (h [v] - lowest) * 0.5f);
+                    height -= taken;
+                    sediment += taken;
+                }
+                float carried = w [v] > 0.0f ? sediment * moved / w [v] : 0.0f;
+                h2 [v] = height;
+                w2 [v] = w [v] - moved;
+                s2 [v] = sediment - carried;
+                outWater [v] = moved;
+                outSediment [v] = carried;
+                drop [v] = total;
+            }
+        });
+
+        // each vertex gathers its share of what its higher neighbours sent, then loses some water to the air and
+        // gets the next iteration's rain
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                float level = h [v] + w [v], water = w2 [v], sediment = s2 [v];
+                for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                    uint32_t u = neighbours [k];
+                    float d = h [u] + w [u] - level;
+                    if (d > 0.0f && drop [u] > 0.0f) {
+                        float share = d / drop [u];
+                        water += outWater [u] * share;
+                        sediment += outSediment [u] * share;
+                    }
+                }
+                w2 [v] = water * (1.0f - evaporation) + rainOn (v, iteration + 1);
+                s2 [v] = sediment;
+            }
+        });
+        h.swap (h2);
+        w.swap (w2);
+        s.swap (s2);
+
+        // slopes steeper than the talus shed some of the excess downhill; each pair of neighbours exchanges the same
+        // amount in opposite directions, so no soil is made or lost
+        parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                float change = 0.0f;
+                for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                    float d = h [neighbours [k]] - h [v];
+                    if (d > talus) {
+                        change += shed * (d - talus);
+                    } else if (d < - talus) {
+                        change += shed * (d + talus);
+                    }
+                }
+                h2 [v] = h [v] + change;
+            }
+        });
+        h.swap (h2);
+    }
+
+    // whatever the water still carries settles where it is
+    float* result = from == to ? _dataset -> column<float> (to) : _dataset -> add<float> (to);
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            result [v] = h [v] + s [v];
+        }
+    });
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef CALENHAD_EROSION_H
+#define CALENHAD_EROSION_H
+
+#include <memory>
+#include <QtCore/QString>
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+
+        // Erodes a height field on an icosphere's vertices by water and talus, in parallel and deterministically for a
+        // given seed. Needs nine floats of working memory a vertex.
+        class Erosion {
+        public:
+            struct Settings {
+                int iterations = 100;
+                int seed = 0;
+                float rain = 0.01f;             // water falling on each vertex, on average, each iteration
+                float evaporation = 0.05f;      // fraction of water evaporating each iteration
+                float capacity = 4.0f;          // soil carried by a unit of water falling a unit of height
+                float solubility = 0.1f;        // fraction of the spare capacity taken up from the ground each iteration
+                float deposition = 0.3f;        // fraction of the excess over capacity dropped each iteration
+                float talus = 0.05f;            // steepest stable slope, as height per degree of arc
+                float weathering = 0.5f;        // fraction of the excess over the talus slope shed each iteration
+            };
+
+            Erosion (std::shared_ptr<Dataset> dataset);
+            ~Erosion();
+
+            // erodes the float column from into a float column to, which may be the same one
+            bool run (const QString& from, const QString& to, const Settings& settings);
+
+        protected:
+            std::shared_ptr<Dataset> _dataset;
+        };
+    }
+}
+
+
+#endif //CALENHAD_EROSION_H
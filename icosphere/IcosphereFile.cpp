@@ -0,0 +1,281 @@
+#include "IcosphereFile.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <CalenhadServices.h>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include "preferences/preferences.h"
+
+using namespace calenhad;
+using namespace calenhad::icosphere;
+
+QMutex IcosphereFile::_mutex;
+QMap<unsigned, std::weak_ptr<Icosphere>> IcosphereFile::_loaded;
+
+namespace {
+
+    const char Magic [8] = { 'C', 'A', 'L', 'I', 'C', 'O', 'S', 'P' };
+    const uint32_t ByteOrder = 0x01020304;
+    const uint64_t Alignment = 64;
+
+    // deeper than this and vertex ids no longer fit in 32 bits
+    const uint32_t MaximumDepth = 15;
+
+    enum SectionKind : uint32_t {
+        LevelSection, XSection, YSection, ZSection, TriangleSection, NeighbourSection, ColumnSection
+    };
+
+    struct Header {
+        char magic [8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t depth;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+        uint32_t sectionCount;
+        uint64_t size;
+    };
+
+    // type and name are for columns only
+    struct Section {
+        uint32_t kind;
+        uint32_t type;
+        uint64_t offset;
+        uint64_t bytes;
+        char name [40];
+    };
+
+    // a file mapped into memory, for as long as anything using it is alive
+    struct Mapping {
+        QFile file;
+        uchar* data = nullptr;
+        ~Mapping() { if (data) { file.unmap (data); } }
+    };
+
+    uint64_t aligned (const uint64_t& n) {
+        return (n + Alignment - 1) / Alignment * Alignment;
+    }
+
+    bool fail (QString* error, const QString& message) {
+        if (error) { *error = message; }
+        return false;
+    }
+}
+
+bool IcosphereFile::save (const QString& path, const Icosphere& icosphere, QString* error) {
+    return save (path, icosphere, nullptr, error);
+}
+
+bool IcosphereFile::save (const QString& path, const Dataset& dataset, QString* error) {
+    return save (path, *dataset.icosphere(), &dataset, error);
+}
+
+bool IcosphereFile::save (const QString& path, const Icosphere& icosphere, const Dataset* dataset, QString* error) {
+    std::vector<uint32_t> levels;
+    for (unsigned level = 0; level < icosphere.depth(); level++) {
+        levels.push_back (Icosphere::vertexCount (level));
+    }
+    uint64_t vertices = icosphere.vertexCount();
+    std::vector<Section> sections;
+    std::vector<const char*> contents;
+    auto add = [&sections, &contents] (const SectionKind& kind, const void* data, const uint64_t& bytes) -> Section& {
+        Section section;
+        std::memset (&section, 0, sizeof (section));
+        section.kind = kind;
+        section.bytes = bytes;
+        sections.push_back (section);
+        contents.push_back ((const char*) data);
+        return sections.back();
+    };
+    add (LevelSection, levels.data(), levels.size() * sizeof (uint32_t));
+    add (XSection, icosphere.x(), vertices * sizeof (float));
+    add (YSection, icosphere.y(), vertices * sizeof (float));
+    add (ZSection, icosphere.z(), vertices * sizeof (float));
+    add (TriangleSection, icosphere.triangles(), (uint64_t) icosphere.triangleCount() * 3 * sizeof (uint32_t));
+    add (NeighbourSection, icosphere.neighbours(), Icosphere::neighbourOffset (icosphere.vertexCount()) * sizeof (uint32_t));
+    if (dataset) {
+        for (const QString& name : dataset -> names()) {
+            QByteArray utf8 = name.toUtf8();
+            if (utf8.size() >= (int) sizeof (Section::name)) {
+                return fail (error, "Column name " + name + " is too long to save");
+            }
+            ColumnType type = dataset -> type (name);
+            const void* data = type == Float32 ? (const void*) dataset -> column<float> (name)
+                             : type == Int32 ? (const void*) dataset -> column<int32_t> (name) : (const void*) dataset -> column<uint8_t> (name);
+            Section& section = add (ColumnSection, data, vertices * columnTypeSize (type));
+            section.type = type;
+            std::memcpy (section.name, utf8.constData(), utf8.size());
+        }
+    }
+
+    uint64_t offset = aligned (sizeof (Header) + sections.size() * sizeof (Section));
+    for (Section& section : sections) {
+        section.offset = offset;
+        offset = aligned (offset + section.bytes);
+    }
+
+    Header header;
+    std::memset (&header, 0, sizeof (header));
+    std::memcpy (header.magic, Magic, sizeof (Magic));
+    header.version = Version;
+    header.byteOrder = ByteOrder;
+    header.depth = icosphere.depth();
+    header.vertexCount = icosphere.vertexCount();
+    header.triangleCount = icosphere.triangleCount();
+    header.sectionCount = (uint32_t) sections.size();
+    header.size = offset;
+
+    // written to a temporary file and renamed, so that a file in the cache is always complete
+    QSaveFile out (path);
+    if (! out.open (QIODevice::WriteOnly)) {
+        return fail (error, "Couldn't write " + path + ": " + out.errorString());
+    }
+    bool ok = out.write ((const char*) &header, sizeof (header)) == sizeof (header);
+    ok = ok && out.write ((const char*) sections.data(), sections.size() * sizeof (Section)) == (qint64) (sections.size() * sizeof (Section));
+    uint64_t written = sizeof (header) + sections.size() * sizeof (Section);
+    const QByteArray padding (Alignment, '\0');
+    for (size_t i = 0; ok && i < sections.size(); i++) {
+        ok = out.write (padding.constData(), sections [i].offset - written) == (qint64) (sections [i].offset - written);
+        ok = ok && out.write (contents [i], sections [i].bytes) == (qint64) sections [i].bytes;
+        written = sections [i].offset + sections [i].bytes;
+    }
+    ok = ok && out.write (padding.constData(), header.size - written) == (qint64) (header.size - written);
+    if (! ok || ! out.commit()) {
+        return fail (error, "Couldn't write " + path + ": " + out.errorString());
+    }
+    return true;
+}
+
+std::shared_ptr<Dataset> IcosphereFile::load (const QString& path, QString* error) {
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+    mapping -> file.setFileName (path);
+    if (! mapping -> file.open (QIODevice::ReadOnly)) {
+        fail (error, "Couldn't open " + path + ": " + mapping -> file.errorString());
+        return nullptr;
+    }
+    uint64_t size = (uint64_t) mapping -> file.size();
+    if (size < sizeof (Header)) {
+        fail (error, path + " is not an icosphere file");
+        return nullptr;
+    }
+
+    // mapped privately, so that writing to a column copies the page rather than changing the file
+    mapping -> data = mapping -> file.map (0, size, QFileDevice::MapPrivateOption);
+    if (! mapping -> data) {
+        fail (error, "Couldn't map " + path + ": " + mapping -> file.errorString());
+        return nullptr;
+    }
+    char* data = (char*) mapping -> data;
+    Header header;
+    std::memcpy (&header, data, sizeof (header));
+    if (std::memcmp (header.magic, Magic, sizeof (Magic)) != 0) {
+        fail (error, path + " is not an icosphere file");
+        return nullptr;
+    }
+    if (header.version != Version || header.byteOrder != ByteOrder) {
+        fail (error, path + " is from another version or another kind of machine");
+        return nullptr;
+    }
+    if (header.size != size || header.depth < 1 || header.depth > MaximumDepth
+        || header.vertexCount != Icosphere::vertexCount (header.depth - 1)
+        || header.triangleCount != Icosphere::triangleCount (header.depth - 1)
+        || sizeof (Header) + (uint64_t) header.sectionCount * sizeof (Section) > size) {
+        fail (error, path + " is incomplete or damaged");
+        return nullptr;
+    }
+
+    std::shared_ptr<Icosphere> sphere (new Icosphere());
+    sphere -> _depth = header.depth;
+    sphere -> _vertexCount = header.vertexCount;
+    sphere -> _triangleCount = header.triangleCount;
+    sphere -> _mapping = mapping;
+    std::shared_ptr<Dataset> dataset = std::make_shared<Dataset> (sphere);
+    uint64_t vertices = header.vertexCount;
+    const uint32_t* levels = nullptr;
+    int found = 0;
+    for (uint32_t i = 0; i < header.sectionCount; i++) {
+        Section section;
+        std::memcpy (&section, data + sizeof (Header) + i * sizeof (Section), sizeof (section));
+        if (section.offset % Alignment != 0 || section.offset > size || section.bytes > size - section.offset) {
+            fail (error, path + " is incomplete or damaged");
+            return nullptr;
+        }
+        char* contents = data + section.offset;
+        uint64_t expected = 0;
+        switch (section.kind) {
+            case LevelSection: levels = (const uint32_t*) contents; expected = header.depth * sizeof (uint32_t); break;
+            case XSection: sphere -> _x = (const float*) contents; expected = vertices * sizeof (float); break;
+            case YSection: sphere -> _y = (const float*) contents; expected = vertices * sizeof (float); break;
+            case ZSection: sphere -> _z = (const float*) contents; expected = vertices * sizeof (float); break;
+            case TriangleSection: sphere -> _triangles = (const uint32_t*) contents; expected = (uint64_t) header.triangleCount * 3 * sizeof (uint32_t); break;
+            case NeighbourSection: sphere -> _neighbours = (const uint32_t*) contents; expected = Icosphere::neighbourOffset (header.vertexCount) * sizeof (uint32_t); break;
+            case ColumnSection: {
+                if (section.type > UInt8 || section.name [sizeof (section.name) - 1] != '\0') {
+                    fail (error, path + " is incomplete or damaged");
+                    return nullptr;
+                }
+                Dataset::Column column;
+                column.type = (ColumnType) section.type;
+                column.data = std::shared_ptr<char> (mapping, contents);
+                dataset -> _columns.insert (QString::fromUtf8 (section.name), column);
+                expected = vertices * columnTypeSize (column.type);
+                break;
+            }
+            default: continue;
+        }
+        if (section.bytes != expected) {
+            fail (error, path + " is incomplete or damaged");
+            return nullptr;
+        }
+        found |= 1 << section.kind;
+    }
+
+    int required = (1 << LevelSection) | (1 << XSection) | (1 << YSection) | (1 << ZSection) | (1 << TriangleSection) | (1 << NeighbourSection);
+    if ((found & required) != required) {
+        fail (error, path + " is incomplete or damaged");
+        return nullptr;
+    }
+    for (unsigned level = 0; level < header.depth; level++) {
+        if (levels [level] != Icosphere::vertexCount (level)) {
+            fail (error, path + " is incomplete or damaged");
+            return nullptr;
+        }
+    }
+    return dataset;
+}
+
+std::shared_ptr<Icosphere> IcosphereFile::cached (const unsigned& depth) {
+
+    // one at a time, so that two threads asking for the same depth don't both build it
+    QMutexLocker locker (&_mutex);
+    std::shared_ptr<Icosphere> sphere = _loaded.value (depth).lock();
+    if (sphere) { return sphere; }
+
+    QElapsedTimer timer;
+    timer.start();
+    QDir cache (CalenhadServices::preferences() -> calenhad_icosphere_cache);
+    QString file = cache.absoluteFilePath (QString ("icosphere_%1.bin").arg (depth));
+    QString error;
+    if (QFile::exists (file)) {
+        std::shared_ptr<Dataset> dataset = load (file, &error);
+        if (dataset) {
+            sphere = dataset -> icosphere();
+        } else {
+            std::cout << "Couldn't load icosphere from cache: " << error.toStdString() << "\n";
+        }
+    }
+    if (! sphere) {
+        sphere = std::make_shared<Icosphere> (depth);
+        if (! cache.mkpath (".")) {
+            std::cout << "Couldn't create cache directory " << cache.path().toStdString() << "\n";
+        } else if (! save (file, *sphere, &error)) {
+            std::cout << "Couldn't save icosphere to cache: " << error.toStdString() << "\n";
+        }
+        std::cout << "Built icosphere of depth " << depth << " in " << timer.elapsed() << " ms\n";
+    }
+    _loaded.insert (depth, sphere);
+    return sphere;
+}
@@ -0,0 +1,53 @@
+#ifndef CALENHAD_ICOSPHEREFILE_H
+#define CALENHAD_ICOSPHEREFILE_H
+
+#include <memory>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include "icosphere.h"
+#include "Dataset.h"
+
+namespace calenhad {
+    namespace icosphere {
+
+        // Saves an icosphere, with the columns of a dataset on it if there is one, in a file which is mapped into memory
+        // rather than read. A sphere loaded from a file uses its arrays where they lie in the mapping, so loading one
+        // takes about as long as checking the file's header and section table, whatever the sphere's depth, and only
+        // the pages that are actually used are ever read from the disk.
+        //
+        // A file is a header, a table of sections and the sections themselves, each starting on a 64 byte boundary:
+        // the number of vertices up to each level, the x, y and z arrays, the last level's triangles, the neighbours,
+        // and a section for each column. Numbers are in the byte order of the machine that wrote the file. A file with
+        // another byte order or version, or whose sections don't match its depth, is refused; Version must go up
+        // whenever the layout changes.
+        //
+        // Spheres are kept in the cache directory by depth, so that each depth is built only once, and spheres
+        // already loaded are shared.
+        class IcosphereFile {
+        public:
+            static bool save (const QString& path, const Icosphere& icosphere, QString* error = nullptr);
+            static bool save (const QString& path, const Dataset& dataset, QString* error = nullptr);
+
+            // returns nullptr, with a reason in error, if the file can't be used; the dataset's sphere is
+            // dataset -> icosphere ()
+            static std::shared_ptr<Dataset> load (const QString& path, QString* error = nullptr);
+
+            // a sphere of the given depth, from the cache directory if it is there, or else built and saved there
+            static std::shared_ptr<Icosphere> cached (const unsigned& depth);
+
+            // the deepest sphere anything asks the cache for, with 10 * 4^11 + 2 (about 42 million) vertices
+            static const unsigned MaxDepth = 12;
+
+            static const uint32_t Version = 1;
+
+        protected:
+            static bool save (const QString& path, const Icosphere& icosphere, const Dataset* dataset, QString* error);
+            static QMutex _mutex;
+            static QMap<unsigned, std::weak_ptr<Icosphere>> _loaded;
+        };
+    }
+}
+
+
+#endif //CALENHAD_ICOSPHEREFILE_H
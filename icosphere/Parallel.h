@@ -0,0 +1,39 @@
+#ifndef CALENHAD_PARALLEL_H
+#define CALENHAD_PARALLEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+
+namespace calenhad {
+    namespace icosphere {
+
+        class ParallelTask : public QRunnable {
+        public:
+            ParallelTask (std::function<void()> work) : _work (work) { }
+            void run() override { _work(); }
+        protected:
+            std::function<void()> _work;
+        };
+
+        // Calls work (begin, end) for each range of up to chunk indices in [0, n), each range on whichever thread of a
+        // pool of its own is free, and returns once they are all done. A pool of its own rather than the global one, so
+        // that work can itself run in the global pool without waiting on it. Less than one chunk is done on this thread.
+        inline void parallelFor (const uint64_t& n, const uint64_t& chunk, const std::function<void (const uint64_t&, const uint64_t&)>& work) {
+            if (n <= chunk) {
+                if (n > 0) { work (0, n); }
+                return;
+            }
+            QThreadPool pool;
+            for (uint64_t begin = 0; begin < n; begin += chunk) {
+                uint64_t end = std::min (n, begin + chunk);
+                pool.start (new ParallelTask ([&work, begin, end] () { work (begin, end); }));
+            }
+            pool.waitForDone();
+        }
+    }
+}
+
+#endif //CALENHAD_PARALLEL_H
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include "Tectonics.h"
+#include "Dataset.h"
+#include "Parallel.h"
+
+using namespace calenhad::icosphere;
+
+namespace {
+
+    // frontiers are handed out to threads in runs of FrontierChunk vertices, and whole columns in runs of VertexChunk
+    const uint64_t FrontierChunk = 1 << 12;
+    const uint64_t VertexChunk = 1 << 16;
+
+    const uint64_t NoBid = std::numeric_limits<uint64_t>::max();
+
+    uint32_t hash (const uint32_t& a, const uint32_t& b, const uint32_t& c) {
+        uint64_t h = ((uint64_t) a * 0x9E3779B97F4A7C15ull) ^ ((uint64_t) b * 0xC2B2AE3D27D4EB4Full) ^ ((uint64_t) c * 0x165667B19E3779F9ull);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return (uint32_t) h;
+    }
+
+    // a number in [0, 1) decided by a, b and c
+    double unit (const uint32_t& a, const uint32_t& b, const uint32_t& c) {
+        return hash (a, b, c) / 4294967296.0;
+    }
+
+    // Grows a region from each of the sources at once, a ring of neighbours at a time, until every vertex belongs to
+    // one, and gives each vertex's region (the index of its source) in owner. A region grows on a ring only if grows
+    // (region, ring) says so. Each ring is claimed in two parallel passes over the frontier: in the first, every
+    // frontier vertex whose region grows on the ring bids for each of its unclaimed neighbours, keeping the lowest bid
+    // for each; in the second, each of those neighbours goes to the region which made the lowest bid, ties going to
+    // the lowest region. The lowest bid doesn't depend on the order the bids were made in, so neither does the result.
+    void flood (const Icosphere& sphere, const std::vector<uint32_t>& sources, std::vector<int32_t>& owner,
+                const std::function<bool (const int32_t&, const uint32_t&)>& grows,
+                const std::function<uint32_t (const uint32_t&, const int32_t&)>& bid) {
+        uint32_t n = sphere.vertexCount();
+        const uint32_t* neighbours = sphere.neighbours();
+        std::vector<std::atomic<int32_t>> owners (n);
+        std::vector<std::atomic<uint64_t>> bids (n);
+        parallelFor (n, VertexChunk, [&owners, &bids] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                owners [v].store (-1, std::memory_order_relaxed);
+                bids [v].store (NoBid, std::memory_order_relaxed);
+            }
+        });
+
+        std::vector<uint32_t> frontier;
+        for (size_t i = 0; i < sources.size(); i++) {
+            owners [sources [i]].store ((int32_t) i, std::memory_order_relaxed);
+            frontier.push_back (sources [i]);
+        }
+
+        for (uint32_t ring = 1; ! frontier.empty(); ring++) {
+            parallelFor (frontier.size(), FrontierChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+                for (uint64_t i = begin; i < end; i++) {
+                    uint32_t w = frontier [i];
+                    int32_t region = owners [w].load (std::memory_order_relaxed);
+                    if (! grows (region, ring)) { continue; }
+                    for (uint64_t k = Icosphere::neighbourOffset (w); k < Icosphere::neighbourOffset (w + 1); k++) {
+                        uint32_t u = neighbours [k];
+                        if (owners [u].load (std::memory_order_relaxed) >= 0) { continue; }
+                        uint64_t offer = ((uint64_t) bid (u, region) << 32) | (uint32_t) region;
+                        uint64_t current = bids [u].load (std::memory_order_relaxed);
+                        while (offer < current && ! bids [u].compare_exchange_weak (current, offer, std::memory_order_relaxed)) { }
+                    }
+                }
+            });
+
+            // the next frontier is the vertices claimed on this ring, and those of regions which didn't grow on it
+            std::vector<std::vector<uint32_t>> next ((frontier.size() + FrontierChunk - 1) / FrontierChunk);
+            parallelFor (frontier.size(), FrontierChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+                std::vector<uint32_t>& claimed = next [begin / FrontierChunk];
+                for (uint64_t i = begin; i < end; i++) {
+                    uint32_t w = frontier [i];
+                    if (! grows (owners [w].load (std::memory_order_relaxed), ring)) {
+                        claimed.push_back (w);
+                        continue;
+                    }
+                    for (uint64_t k = Icosphere::neighbourOffset (w); k < Icosphere::neighbourOffset (w + 1); k++) {
+                        uint32_t u = neighbours [k];
+                        uint64_t b = bids [u].load (std::memory_order_relaxed);
+                        int32_t unowned = -1;
+                        if (b != NoBid && owners [u].compare_exchange_strong (unowned, (int32_t) (b & 0xFFFFFFFFu), std::memory_order_relaxed)) {
+                            claimed.push_back (u);
+                        }
+                    }
+                }
+            });
+            frontier.clear();
+            for (const std::vector<uint32_t>& claimed : next) {
+                frontier.insert (frontier.end(), claimed.begin(), claimed.end());
+            }
+        }
+
+        owner.resize (n);
+        parallelFor (n, VertexChunk, [&owners, &owner] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                owner [v] = owners [v].load (std::memory_order_relaxed);
+            }
+        });
+    }
+}
+
+Tectonics::Tectonics (std::shared_ptr<Dataset> dataset) : _dataset (dataset) {
+
+}
+
+Tectonics::~Tectonics() {
+
+}
+
+void Tectonics::generate (const int& plates, const int& seed, const double& width) {
+    const Icosphere& sphere = *_dataset -> icosphere();
+    uint32_t n = sphere.vertexCount();
+    uint32_t s = (uint32_t) seed;
+    uint32_t count = (uint32_t) std::min<int64_t> (std::max (plates, 1), n);
+
+    // seeds at distinct vertices, and a pole, speed and growth rate for each plate
+    _plates.clear();
+    std::vector<uint32_t> seeds;
+    std::vector<double> rates;
+    std::vector<bool> taken (n, false);
+    for (uint32_t i = 0; seeds.size() < count; i++) {
+        uint32_t v = hash (s, 0, i) % n;
+        if (taken [v]) { continue; }
+        taken [v] = true;
+        uint32_t p = (uint32_t) seeds.size();
+        double z = 2.0 * unit (s, p, 1) - 1.0, a = 2.0 * M_PI * unit (s, p, 2), r = std::sqrt (1.0 - z * z);
+        Plate plate;
+        plate.seed = v;
+        plate.pole = { r * std::cos (a), r * std::sin (a), z };
+        plate.speed = 0.2 + 0.8 * unit (s, p, 3);
+        _plates.push_back (plate);
+        rates.push_back (0.25 + 0.75 * unit (s, p, 4));
+        seeds.push_back (v);
+    }
+
+    std::vector<int32_t> owner;
+    flood (sphere, seeds, owner,
+           [s, &rates] (const int32_t& region, const uint32_t& ring) { return unit (s, (uint32_t) region, ring + 5) < rates [region]; },
+           [s] (const uint32_t& vertex, const int32_t& region) { return hash (s, vertex, (uint32_t) region); });
+    int32_t* plate = _dataset -> add<int32_t> ("plate");
+    std::copy (owner.begin(), owner.end(), plate);
+
+    // Each boundary vertex's closing speed with each neighbour on another plate, as a fraction of the fastest those two
+    // plates could close, which is the sum of their speeds, averaged over the neighbours. Boundary vertices are gathered
+    // run by run and the runs put together in order, so that they are in order of vertex id.
+    const float* x = sphere.x(), * y = sphere.y(), * z = sphere.z();
+    const uint32_t* neighbours = sphere.neighbours();
+    const std::vector<Plate>& motions = _plates;
+    auto velocity = [&motions, x, y, z] (const int32_t& p, const uint32_t& v, double* out) {
+        const Cartesian& pole = motions [p].pole;
+        double speed = motions [p].speed;
+        out [0] = speed * (pole.y * z [v] - pole.z * y [v]);
+        out [1] = speed * (pole.z * x [v] - pole.x * z [v]);
+        out [2] = speed * (pole.x * y [v] - pole.y * x [v]);
+    };
+    std::vector<float> closing (n, 0.0f);
+    std::vector<std::vector<uint32_t>> runs ((n + VertexChunk - 1) / VertexChunk);
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        std::vector<uint32_t>& boundary = runs [begin / VertexChunk];
+        for (uint64_t v = begin; v < end; v++) {
+            double sum = 0.0, vv [3], vu [3];
+            int across = 0;
+            velocity (owner [v], (uint32_t) v, vv);
+            for (uint64_t k = Icosphere::neighbourOffset ((uint32_t) v); k < Icosphere::neighbourOffset ((uint32_t) v + 1); k++) {
+                uint32_t u = neighbours [k];
+                if (owner [u] == owner [v]) { continue; }
+                velocity (owner [u], u, vu);
+                double d [3] = { (double) x [u] - x [v], (double) y [u] - y [v], (double) z [u] - z [v] };
+                double length = std::sqrt (d [0] * d [0] + d [1] * d [1] + d [2] * d [2]);
+                double limit = motions [owner [v]].speed + motions [owner [u]].speed;
+                if (limit > 0.0) {
+                    sum += ((vv [0] - vu [0]) * d [0] + (vv [1] - vu [1]) * d [1] + (vv [2] - vu [2]) * d [2]) / (length * limit);
+                }
+                across++;
+            }
+            if (across) {
+                closing [v] = (float) (sum / across);
+                boundary.push_back ((uint32_t) v);
+            }
+        }
+    });
+    std::vector<uint32_t> boundary;
+    for (const std::vector<uint32_t>& run : runs) {
+        boundary.insert (boundary.end(), run.begin(), run.end());
+    }
+
+    // carried inland from the boundary vertex each vertex is nearest to, a ring at a time, fading with the angle from it
+    float* stress = _dataset -> add<float> ("stress");
+    if (boundary.empty()) { return; }
+    std::vector<int32_t> nearest;
+    flood (sphere, boundary, nearest,
+           [] (const int32_t&, const uint32_t&) { return true; },
+           [] (const uint32_t&, const int32_t&) { return 0u; });
+    parallelFor (n, VertexChunk, [&] (const uint64_t& begin, const uint64_t& end) {
+        for (uint64_t v = begin; v < end; v++) {
+            uint32_t b = boundary [nearest [v]];
+            double dot = ((double) x [v] * x [b] + (double) y [v] * y [b] + (double) z [v] * z [b])
+                / std::sqrt (((double) x [v] * x [v] + (double) y [v] * y [v] + (double) z [v] * z [v]) * ((double) x [b] * x [b] + (double) y [b] * y [b] + (double) z [b] * z [b]));
+            double angle = std::acos (std::min (1.0, std::max (-1.0, dot)));
+            double fade = width > 0.0 ? std::exp (- (angle / width) * (angle / width)) : (v == b ? 1.0 : 0.0);
+            stress [v] = (float) (closing [b] * fade);
+        }
+    });
+}
+
+const std::vector<Plate>& Tectonics::plates () const {
+    return _plates;
+}
+
+std::shared_ptr<Dataset> Tectonics::dataset () const {
+    return _dataset;
+}
@@ -0,0 +1,42 @@
+#ifndef CALENHAD_TECTONICS_H
+#define CALENHAD_TECTONICS_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "icosphere.h"
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+
+        // A plate's motion, as a rotation about an axis through the centre of the planet (its Euler pole): a point p on
+        // the plate moves at speed * (pole x p). Seed is the vertex the plate grew from.
+        struct Plate {
+            uint32_t seed;
+            Cartesian pole;
+            double speed;
+        };
+
+        // Grows plates over a dataset's icosphere and writes columns "plate" (Int32) and "stress" (Float32, -1 to 1,
+        // positive where plates converge). Runs in parallel; the same seed gives the same result on any machine.
+        class Tectonics {
+        public:
+            Tectonics (std::shared_ptr<Dataset> dataset);
+            ~Tectonics();
+
+            void generate (const int& plates, const int& seed, const double& width);
+
+            const std::vector<Plate>& plates () const;
+
+            std::shared_ptr<Dataset> dataset () const;
+
+        protected:
+            std::shared_ptr<Dataset> _dataset;
+            std::vector<Plate> _plates;
+        };
+    }
+}
+
+
+#endif //CALENHAD_TECTONICS_H
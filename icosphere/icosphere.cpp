@@ -7,13 +7,26 @@
 // Public License v. 2.0. If a copy of the MPL was not distributed
 // with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
-#include <unordered_map>
-#include <bits/unordered_map.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include "icosphere.h"
+#include "Parallel.h"
 
 using namespace calenhad::icosphere;
 
-    Icosphere::Icosphere (const unsigned int& depth) : _depth (depth), _count (0), _initial (true) {
+namespace {
+    // edges are handed out to threads in runs of this many; triangles by base face
+    const uint64_t EdgeChunk = 1 << 16;
+}
+
+    Icosphere::Icosphere () : _depth (0), _x (nullptr), _y (nullptr), _z (nullptr), _triangles (nullptr), _neighbours (nullptr),
+        _vertexCount (0), _triangleCount (0) {
+
+    }
+
+    Icosphere::Icosphere (const unsigned int& depth) : Icosphere() {
+        _depth = std::max (depth, 1u);
 
         //--------------------------------------------------------------------------------
         // icosahedron data
@@ -32,259 +45,295 @@ using namespace calenhad::icosphere;
                 {6,1,10}, {9,0,11}, {9,11,2}, {9,2,5}, {7,2,11} };
         //--------------------------------------------------------------------------------
 
-        _triangles.reserve (depth);
-        uint32_t capacity = 10 * pow (4, depth - 1) + 2;
-        _vertices.reserve (capacity);
-
-        _gc = new GeographicLib::Geocentric (1, 0);
-
-
-        // init with an icosahedron
+        uint32_t capacity = vertexCount (_depth - 1);
+        _arrays.x.reserve (capacity);
+        _arrays.y.reserve (capacity);
+        _arrays.z.reserve (capacity);
         for (int i = 0; i < 12; i++) {
-            Cartesian c;
-            c.x = vdata [i][0];
-            c.y = vdata [i][1];
-            c.z = vdata [i][2];
-            addVertex (c, 0);
+            _arrays.x.push_back ((float) vdata [i][0]);
+            _arrays.y.push_back ((float) vdata [i][1]);
+            _arrays.z.push_back ((float) vdata [i][2]);
         }
-        _lastVisited = _vertices [0];
-        _triangles.push_back (std::vector<Triangle*>());
-        _triangles.back();
+
+        // edges are pairs of vertex ids; sides gives the edge along each side of each triangle, from its corner k to
+        // its corner k + 1
+        std::vector<uint32_t> edges, sides (60);
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> ids;
+        _arrays.triangles.reserve (60);
         for (int i = 0; i < 20; i++) {
-            Triangle* t = new Triangle();
             for (int k = 0; k < 3; k++) {
-                t -> vertices [k] = _vertices [tindices [i] [k]];
+                _arrays.triangles.push_back (tindices [i][k]);
+                uint32_t p = tindices [i][k], q = tindices [i][(k + 1) % 3];
+                std::pair<uint32_t, uint32_t> key = std::make_pair (std::min (p, q), std::max (p, q));
+                auto it = ids.find (key);
+                if (it == ids.end()) {
+                    it = ids.insert (std::make_pair (key, (uint32_t) (edges.size() / 2))).first;
+                    edges.push_back (p);
+                    edges.push_back (q);
+                }
+                sides [i * 3 + k] = it -> second;
             }
-            t -> level = 0;
-            t -> parent = nullptr;
-            _triangles.back().push_back (t);
         }
 
-        for (int i = 0; i < 20; i++) {
-            makeNeighbours (_triangles.back() [i] -> vertices [1], _triangles.back() [i] -> vertices [2]);
-            makeNeighbours (_triangles.back() [i] -> vertices [2], _triangles.back() [i] -> vertices [0]);
-            makeNeighbours (_triangles.back() [i] -> vertices [1], _triangles.back() [i] -> vertices [0]);
-
+        for (unsigned level = 1; level < _depth; level++) {
+            subdivide (level, edges, sides, level == _depth - 1);
         }
-
-        while(_triangles.size()<_depth) {
-            subdivide (_triangles.size());
-        }
-        _initial = false;
+        makeNeighbours (edges);
+
+        _x = _arrays.x.data();
+        _y = _arrays.y.data();
+        _z = _arrays.z.data();
+        _triangles = _arrays.triangles.data();
+        _neighbours = _arrays.neighbours.data();
+        _vertexCount = (uint32_t) _arrays.x.size();
+        _triangleCount = (uint32_t) (_arrays.triangles.size() / 3);
     }
 
     Icosphere::~Icosphere() {
-        delete _gc;
-        std::for_each (_triangles.begin(), _triangles.end(), [] (std::vector<Triangle*> list) {
-            std::for_each (list.begin(), list.end(), [] (Triangle* t) { delete t; }); });
-        std::for_each (_vertices.begin(), _vertices.end(), [] (Vertex* p) { delete p; });
-    }
 
-    void Icosphere::subdivide (const unsigned int& level) {
-        while (_triangles.size() <= level) {
-            _triangles.push_back (std::vector<Triangle*> ());
-            _triangles.reserve (_triangles [_triangles.size() - 2].size() * 4);
-        }
-
-        for (uint32_t i = 0; i < _triangles [level - 1].size(); i ++) {
-            Triangle* t = _triangles [level - 1] [i];
-            divideTriangle (t);
-        }
     }
 
-    void Icosphere::divideTriangle (Triangle* t) {
-        unsigned level = t -> level + 1;
-        for (k = 0; k < 3; ++k) {
-
-            ids0[k] = t -> vertices [k];
-            e1 = t -> vertices [(k + 1) % 3];
-
-            edgeKey = makeKey (e1 -> id, ids0 [k] -> id);
-            it = edgeMap.find (edgeKey);
-            if (it == edgeMap.end()) {
-                mid (ids0[k]-> cartesian, e1-> cartesian, c);
-                ids1[k] = addVertex (c, level);;
-                edgeMap[edgeKey] = ids1[k];
-            } else {
-                ids1[k] = it -> second;
+    // Makes level from the one before it. The new vertices are the midpoints of the old edges, in the same order, and
+    // edge e splits into edges 2e (the half at its first vertex) and 2e + 1; the edges inside triangle t, between the
+    // midpoints of its sides, follow them.
+    void Icosphere::subdivide (const unsigned int& level, std::vector<uint32_t>& edges, std::vector<uint32_t>& sides, const bool& last) {
+        uint32_t first = vertexCount (level - 1);
+        uint64_t edgeCount = edges.size() / 2;
+        uint64_t triangleCount = Icosphere::triangleCount (level - 1);
+        _arrays.x.resize (first + edgeCount);
+        _arrays.y.resize (first + edgeCount);
+        _arrays.z.resize (first + edgeCount);
+        std::vector<uint32_t> newEdges ((edgeCount * 2 + triangleCount * 3) * 2);
+        std::vector<uint32_t> newTriangles (triangleCount * 12);
+        std::vector<uint32_t> newSides (last ? 0 : triangleCount * 12);
+
+        parallelFor (edgeCount, EdgeChunk, [this, &edges, &newEdges, first] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t e = begin; e < end; e++) {
+                uint32_t p = edges [e * 2], q = edges [e * 2 + 1], m = first + (uint32_t) e;
+                double x = (double) _arrays.x [p] + _arrays.x [q], y = (double) _arrays.y [p] + _arrays.y [q], z = (double) _arrays.z [p] + _arrays.z [q];
+                double mag = std::sqrt (x * x + y * y + z * z);
+                _arrays.x [m] = (float) (x / mag);
+                _arrays.y [m] = (float) (y / mag);
+                _arrays.z [m] = (float) (z / mag);
+                newEdges [e * 4] = p;
+                newEdges [e * 4 + 1] = m;
+                newEdges [e * 4 + 2] = m;
+                newEdges [e * 4 + 3] = q;
             }
-        }
-
-        // The three members of ids0 are the triangles of the three vertices of the parent (outer) triangle
-        // The three members of ids1 are the triangles of the three midpoints of the parent triangle's edges
+        });
+
+        parallelFor (triangleCount, triangleCount / 20, [&] (const uint64_t& begin, const uint64_t& end) {
+
+            // the half of edge e which ends at vertex v
+            auto half = [&edges] (const uint32_t& e, const uint32_t& v) -> uint32_t {
+                return edges [e * 2] == v ? e * 2 : e * 2 + 1;
+            };
+
+            for (uint64_t t = begin; t < end; t++) {
+                const uint32_t* corners = &_arrays.triangles [t * 3];
+                const uint32_t* side = &sides [t * 3];
+                uint32_t a = corners [0], b = corners [1], c = corners [2];
+                uint32_t ab = first + side [0], bc = first + side [1], ca = first + side [2];
+                uint32_t children [12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+                std::copy (children, children + 12, &newTriangles [t * 12]);
+
+                // inside edges, each opposite a corner
+                uint64_t inside = edgeCount * 2 + t * 3;
+                uint32_t ends [6] = { ab, ca, bc, ab, ca, bc };
+                std::copy (ends, ends + 6, &newEdges [inside * 2]);
+
+                if (! last) {
+                    uint32_t childSides [12] = {
+                            half (side [0], a), (uint32_t) inside, half (side [2], a),
+                            half (side [1], b), (uint32_t) inside + 1, half (side [0], b),
+                            half (side [2], c), (uint32_t) inside + 2, half (side [1], c),
+                            (uint32_t) inside + 1, (uint32_t) inside + 2, (uint32_t) inside };
+                    std::copy (childSides, childSides + 12, &newSides [t * 12]);
+                }
+            }
+        });
 
-        makeTriangle (ids0[0], ids1[0], ids1[2], t);
-        makeTriangle (ids0[1], ids1[1], ids1[0], t);
-        makeTriangle (ids0[2], ids1[2], ids1[1], t);
-        makeTriangle (ids1[0], ids1[1], ids1[2], t);
+        edges.swap (newEdges);
+        sides.swap (newSides);
+        _arrays.triangles.swap (newTriangles);
+    }
 
-        makeNeighbours (ids0[0], ids1[0]);
-        makeNeighbours (ids0[0], ids1[2]);
+    void Icosphere::makeNeighbours (const std::vector<uint32_t>& edges) {
+        uint32_t count = (uint32_t) _arrays.x.size();
+        _arrays.neighbours.resize (neighbourOffset (count));
+        std::vector<uint8_t> filled (count, 0);
+        for (uint64_t e = 0; e < edges.size() / 2; e++) {
+            uint32_t p = edges [e * 2], q = edges [e * 2 + 1];
+            _arrays.neighbours [neighbourOffset (p) + filled [p]++] = q;
+            _arrays.neighbours [neighbourOffset (q) + filled [q]++] = p;
+        }
 
-        makeNeighbours (ids0[1], ids1[1]);
-        makeNeighbours (ids0[1], ids1[0]);
+        // in order of id, so that a pass over a vertex's neighbours moves forward through any array indexed by vertex
+        parallelFor (count, EdgeChunk, [this] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                std::sort (&_arrays.neighbours [neighbourOffset (v)], &_arrays.neighbours [0] + neighbourOffset (v + 1));
+            }
+        });
+    }
 
-        makeNeighbours (ids0[2], ids1[2]);
-        makeNeighbours (ids0[2], ids1[1]);
+    unsigned Icosphere::depth () const {
+        return _depth;
+    }
 
-        makeNeighbours (ids1[1], ids1[2]);
-        makeNeighbours (ids1[0], ids1[2]);
-        makeNeighbours (ids1[1], ids1[0]);
+    uint32_t Icosphere::vertexCount (const unsigned& level) {
+        return 10 * (uint32_t (1) << (level * 2)) + 2;
     }
 
-    uint64_t Icosphere::makeKey (const uint32_t& v1, const uint32_t& v2) {
-        if (v1 > v2) {
-            return v1 | (uint64_t (v2) << 32);
-        } else {
-            return v2 | (uint64_t (v1) << 32);
-        }
+    uint32_t Icosphere::triangleCount (const unsigned& level) {
+        return 20 * (uint32_t (1) << (level * 2));
+    }
 
+    uint32_t Icosphere::vertexCount () const {
+        return _vertexCount;
     }
 
-    void Icosphere::removeTriangle (Triangle* t) {
+    uint32_t Icosphere::triangleCount () const {
+        return _triangleCount;
+    }
 
-        // remove child triangles
-        if (! t -> children.empty()) {
-            std::for_each (t->children.begin (), t->children.end (), [=] (Triangle* t) {
-                removeTriangle (t);
-            });
+    unsigned Icosphere::level (const uint32_t& vertex) const {
+        unsigned level = 0;
+        while (vertex >= vertexCount (level)) {
+            level++;
         }
+        return level;
+    }
 
-        for (int i = 0; i < 3; i++) {
-
-            // remove from edge list
-            uint64_t key = makeKey (t -> vertices [i] -> id, t -> vertices [(i + 1) % 3] -> id);
-            edgeMap.erase (key);
+    const float* Icosphere::x () const {
+        return _x;
+    }
 
-            // disconnect from neighbours
-            t -> vertices [i] -> neighbours.remove (t -> vertices [i]);
+    const float* Icosphere::y () const {
+        return _y;
+    }
 
+    const float* Icosphere::z () const {
+        return _z;
+    }
 
-            // remove vertex if it has no neighbours left
-            if (t -> vertices [i] -> neighbours.empty()) {
-                std::vector<Vertex*>::iterator v = std::find (_vertices.begin(), _vertices.end(), t -> vertices [i]);
-                if (v != _vertices.end()) {
-                    _vertices.erase (v);
-                    delete *v;
-                }
-            }
+    Cartesian Icosphere::cartesian (const uint32_t& vertex) const {
+        return Cartesian { _x [vertex], _y [vertex], _z [vertex] };
+    }
 
+    const uint32_t* Icosphere::triangles () const {
+        return _triangles;
+    }
 
+    // Each corner of a triangle is the first corner of its child at that corner, and so of that child's first child,
+    // and so on down to the last level.
+    void Icosphere::triangle (const unsigned& level, const uint32_t& index, uint32_t* vertices) const {
+        unsigned last = _depth - 1;
+        if (level >= last) {
+            std::copy (_triangles + (uint64_t) index * 3, _triangles + (uint64_t) index * 3 + 3, vertices);
+            return;
         }
-
-        // can't remove a triangle below minimum level
-        if (t -> level > 3) {
-
-            // remove the triangle we were given
-            std::vector<Triangle*>::iterator v = std::find (_triangles[t->level].begin (), _triangles[t->level].end (), t);
-            if (v != _triangles[t->level].end ()) {
-                _triangles[t->level].erase (v);
-                delete t;
-            }
+        unsigned shift = (last - level - 1) * 2;
+        for (int k = 0; k < 3; k++) {
+            uint64_t descendant = ((uint64_t) index * 4 + k) << shift;
+            vertices [k] = _triangles [descendant * 3];
         }
     }
 
-
-
-    void Icosphere::mid (const Cartesian& c1, const Cartesian& c2, Cartesian& c) {
-        c.x = c1.x + c2.x;
-        c.y = c1.y + c2.y;
-        c.z = c1.z + c2.z;
-        double mag = sqrt (c.x * c.x + c.y * c.y + c.z * c.z);
-        c.x /= mag;
-        c.y /= mag;
-        c.z /= mag;
+    const uint32_t* Icosphere::neighbours () const {
+        return _neighbours;
     }
 
-    Vertex* Icosphere::addVertex (const Cartesian& c, int level) {
-        Vertex* v = new Vertex();
-        v -> id = ++ _count;
-        v -> cartesian = c;
-        v -> level = level;
-        _vertices.push_back (v);
-        return v;
+    uint64_t Icosphere::neighbourOffset (const uint32_t& vertex) {
+        return (uint64_t) vertex * 6 - std::min (vertex, 12u);
     }
 
-    void Icosphere::makeTriangle (Vertex* a, Vertex* b, Vertex* c, Triangle* parent) {
+    unsigned Icosphere::neighbourCount (const uint32_t& vertex) {
+        return vertex < 12 ? 5 : 6;
+    }
 
-        Triangle* t = new Triangle();
-        t -> vertices [0] = a;
-        t -> vertices [1] = b;
-        t -> vertices [2] = c;
-        t -> parent = parent;
-        if (parent) {
-            parent->children.emplace_front (t);
-        }
-        t -> level = parent ? parent -> level + 1 : 0;;
-        _triangles [t -> level].push_back (t);
+    size_t Icosphere::memoryUsed () const {
+        return (size_t) _vertexCount * 3 * sizeof (float)
+               + ((size_t) _triangleCount * 3 + neighbourOffset (_vertexCount)) * sizeof (uint32_t);
     }
 
-    void Icosphere::makeNeighbours (Vertex* p, Vertex* q) {
-        if (_initial || std::find (p -> neighbours.begin (), p->neighbours.end(), q) == p -> neighbours.end()) {
-            p -> neighbours.emplace_front (q);
-            q -> neighbours.emplace_front (p);
+    // Triangles run clockwise seen from outside, so a point is inside the side from p to q of a triangle when it is
+    // behind the plane through p, q and the centre.
+    void Icosphere::locate (const float* xyz, Location* out, const size_t& n, const int& level) const {
+        for (size_t i = 0; i < n; i++) {
+            out [i] = locate (Cartesian { xyz [i * 3], xyz [i * 3 + 1], xyz [i * 3 + 2] }, level);
         }
     }
 
-    Vertex* Icosphere::operator [] (const uint32_t& id) {
-        return _vertices [id];
-    }
+    Location Icosphere::locate (const Cartesian& point, const int& level) const {
+        unsigned last = level < 0 || level >= (int) _depth ? _depth - 1 : (unsigned) level;
+
+        // how far the point is outside the side from p to q
+        auto outside = [this, &point] (const uint32_t& p, const uint32_t& q) -> double {
+            Cartesian a = cartesian (p), b = cartesian (q);
+            return point.x * (a.y * b.z - a.z * b.y) + point.y * (a.z * b.x - a.x * b.z) + point.z * (a.x * b.y - a.y * b.x);
+        };
 
-    Vertex* Icosphere::nearest (const Geolocation& target, const unsigned int& depth)  {
-        double d, dist;
-        Vertex* pV;
-        _lastVisited = _vertices [0];
-        for (int i = 1; i < 12; i++) {
-            pV = _vertices [i];
-            Cartesian c;
-            toCartesian (target, c);
-            d = distSquared (c, pV -> cartesian);
-            if (i == 1 || d < dist) {
-                _lastVisited = pV;
-                dist = d;
+        // the base face the point is furthest inside, so that a point on an edge, or in a gap left by rounding, still
+        // finds one
+        uint32_t t = 0;
+        double best = 0.0;
+        for (uint32_t f = 0; f < 20; f++) {
+            uint32_t c [3];
+            triangle (0, f, c);
+            double inside = - std::max (outside (c [0], c [1]), std::max (outside (c [1], c [2]), outside (c [2], c [0])));
+            if (f == 0 || inside > best) {
+                t = f;
+                best = inside;
             }
         }
 
-        // walk over the Delaunay triangulation until a point is reached that is nearer the key than any connected point
-        return walkTowards (target, depth);
+        // The middle child's corners are the midpoints of the sides opposite the corners of the triangle, so a point
+        // outside its side opposite a corner child is in that child, and a point outside none of them is in the middle.
+        for (unsigned l = 0; l < last; l++) {
+            uint32_t m [3];
+            triangle (l + 1, t * 4 + 3, m);
+            double beyond [3] = { outside (m [2], m [0]), outside (m [0], m [1]), outside (m [1], m [2]) };
+            uint32_t child = 3;
+            double most = 0.0;
+            for (uint32_t k = 0; k < 3; k++) {
+                if (beyond [k] > most) {
+                    child = k;
+                    most = beyond [k];
+                }
+            }
+            t = t * 4 + child;
+        }
+
+        // each corner's weight is the volume of the tetrahedron made by the centre, the point and the other two corners
+        Location location;
+        location.triangle = t;
+        triangle (last, t, location.vertices);
+        double w [3], sum = 0.0, nearest = 0.0;
+        double r = std::sqrt (point.x * point.x + point.y * point.y + point.z * point.z);
+        Cartesian onSphere { point.x / r, point.y / r, point.z / r };
+        for (int k = 0; k < 3; k++) {
+            w [k] = std::max (0.0, - outside (location.vertices [(k + 1) % 3], location.vertices [(k + 2) % 3]));
+            sum += w [k];
+            double d = distSquared (onSphere, cartesian (location.vertices [k]));
+            if (k == 0 || d < nearest) {
+                location.nearest = location.vertices [k];
+                nearest = d;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            location.weights [k] = sum > 0.0 ? (float) (w [k] / sum) : (location.vertices [k] == location.nearest ? 1.0f : 0.0f);
+        }
+        return location;
     }
 
-    void Icosphere::visit (Vertex* pV) {
-        _lastVisited = pV;
+    uint32_t Icosphere::nearest (const Cartesian& point, const int& level) const {
+        return locate (point, level).nearest;
     }
 
-    Vertex* Icosphere::walkTowards (const Geolocation& target, const unsigned int& depth) {
+    uint32_t Icosphere::nearest (const Geolocation& target, const int& level) const {
         Cartesian c;
         toCartesian (target, c);
-        return walkTowards (c, depth);
-    }
-
-    Vertex* Icosphere::walkTowards (const Cartesian& target, const unsigned int& depth) const {
-        if (depth == 0 || depth > _depth - 1) { return walkTowards (target, _depth - 1); }
-        double dist = distSquared (_lastVisited -> cartesian, target);
-
-        std::forward_list<Vertex*>::const_iterator i  = _lastVisited -> neighbours.begin();
-        Vertex* next;
-
-        bool found = false;
-        while (i != _lastVisited -> neighbours.end()) {
-            if ((*i) -> level <= depth) {
-                double d = distSquared ((*i) -> cartesian, target);
-                if (d < dist && (*i) -> level >= (_lastVisited -> level)) {
-                    next = *i;
-                    dist = d;
-                    found = true;
-                }
-            }
-            i++;
-        }
-
-        if (found) {
-            _lastVisited = next;
-            return walkTowards (target, depth);
-        } else {
-            return _lastVisited;
-        }
+        return nearest (c, level);
     }
 
     double Icosphere::distSquared (const Cartesian& a, const Cartesian& b) {
@@ -296,25 +345,14 @@ using namespace calenhad::icosphere;
     }
 
     void Icosphere::toGeolocation (const Cartesian& c, Geolocation& g) {
-        _gc -> Reverse (c.x, c.y, c.z, g.lat, g.lon, g.height);
-    }
-
-    Cartesian Icosphere::toCartesian (const Geolocation& g, Cartesian& c) {
-        _gc -> Forward (g.lat, g.lon, 0, c.x, c.y, c.z);
-
+        double r = std::sqrt (c.x * c.x + c.y * c.y + c.z * c.z);
+        g.lon = std::atan2 (c.z, c.x);
+        g.lat = std::asin (c.y / r);
+        g.height = r - 1.0;
     }
 
-    std::pair<std::vector<Triangle*>::iterator, std::vector<Triangle*>::iterator> Icosphere::triangles (const unsigned& level) {
-        return std::make_pair (_triangles [level].begin(), _triangles [level].end());
+    void Icosphere::toCartesian (const Geolocation& g, Cartesian& c) {
+        c.x = std::cos (g.lat) * std::cos (g.lon);
+        c.y = std::sin (g.lat);
+        c.z = std::cos (g.lat) * std::sin (g.lon);
     }
-
-    std::pair<std::vector<Vertex*>::iterator, std::vector<Vertex*>::iterator> Icosphere::vertices() {
-        return std::make_pair (_vertices .begin(), _vertices.end());
-    }
-
-    unsigned long Icosphere::vertexCount () {
-        return _vertices.size();
-    }
-
-
-
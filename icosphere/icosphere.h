@@ -1,13 +1,9 @@
 #ifndef ICOSPHERE_H
 #define ICOSPHERE_H
-#include <iostream>
-#include <GeographicLib/Geocentric.hpp>
-#include <GeographicLib/Geodesic.hpp>
-#include <GeographicLib/Rhumb.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
 #include <vector>
-#include <forward_list>
-#include <list>
-#include <unordered_map>
 
 
 
@@ -20,27 +16,49 @@ namespace icosphere {
         double x, y, z;
     };
 
+    // latitude and longitude in radians
     struct Geolocation {
     public:
         double lat, lon, height;
     };
 
-    struct Vertex {
-    public:
-        Cartesian cartesian;
-        std::forward_list<Vertex*> neighbours;              // neighbouring vertices
-        uint32_t id;
-        unsigned level;
-    };
-
-    struct Triangle {
-    public:
-        Vertex* vertices[3];
-        std::forward_list<Triangle*> children;
-        Triangle* parent;
-        unsigned level;
+    // Where a point falls on the sphere (see Icosphere::locate): the triangle of a level which holds it, that triangle's
+    // corners, and a weight for each corner, so that the point is in the direction of the corners' weighted sum. The
+    // weights are at least zero and add up to one. Nearest is the corner closest to the point, which is also the
+    // closest vertex in the level, since every triangle of an icosphere is acute.
+    struct Location {
+        uint32_t triangle;
+        uint32_t vertices [3];
+        float weights [3];
+        uint32_t nearest;
     };
 
+    // A geodesic sphere made by subdividing an icosahedron, held in flat arrays rather than as objects linked together,
+    // so that a sphere of ten million vertices is a few arrays of plain numbers rather than tens of millions of small
+    // allocations.
+    //
+    // Level 0 is the icosahedron, and each level splits every triangle of the one before into four, with a new vertex at
+    // the middle of each edge; a sphere of depth d has levels 0 to d - 1. Vertices are numbered level by level, so those
+    // of levels 0 to l are the first vertexCount (l) and a vertex's id gives its level. Positions are held as separate x,
+    // y and z arrays of floats, in the same coordinates as the evaluators use (see calenhad::graph::cpu::toCartesian).
+    //
+    // Only the last level's triangles are stored, as three vertex ids each. Triangle t of level l has children 4t to
+    // 4t + 3 in level l + 1: the first three at its corners, in order, each with that corner first, and the fourth in the
+    // middle. So a triangle of any level is found from its descendants by index arithmetic (see triangle()), and the
+    // triangles which descend from the base face f in level l are those from f * 4^l up to (f + 1) * 4^l.
+    //
+    // Neighbours are those of the last level, in compressed rows: vertex v's are neighbours() [neighbourOffset (v)] up
+    // to neighbours() [neighbourOffset (v + 1)]. Every vertex has six neighbours except the icosahedron's twelve, which
+    // have five, so the offsets are worked out rather than stored.
+    //
+    // Each level is built by one pass over the edges of the level before, which places the new vertices, and one pass
+    // over its triangles, which divides them, each pass split among threads (the triangles by base face). Memory comes to
+    // about 60 bytes a vertex: 12 for its position, 24 for two triangles and 24 for six neighbours. That is about 160MB
+    // at depth 10 and 630MB at depth 11 (four times as much at each level), with a peak some 40% higher while the last
+    // level's edges are being made into neighbour lists.
+    //
+    // Once built, a sphere is never modified, so any number of threads can use it at once. A sphere can also be read
+    // from a file (see IcosphereFile), in which case its arrays are the file's contents, mapped into memory.
     class Icosphere {
     public:
 
@@ -51,68 +69,72 @@ namespace icosphere {
 
         ~Icosphere ();
 
-        unsigned long vertexCount ();
+        unsigned depth () const;
 
-        Vertex* operator[] (const uint32_t& id);
+        // number of vertices in levels 0 to level, and number of triangles in a level
+        static uint32_t vertexCount (const unsigned& level);
+        static uint32_t triangleCount (const unsigned& level);
 
-        void visit (Vertex* vertex);
+        uint32_t vertexCount () const;
+        uint32_t triangleCount () const;
 
-        Vertex* walkTowards (const Geolocation& target, const unsigned int& depth);
+        // the level at which a vertex first appears
+        unsigned level (const uint32_t& vertex) const;
 
-        Vertex* walkTowards (const Cartesian& target, const unsigned int& depth) const;
+        const float* x () const;
+        const float* y () const;
+        const float* z () const;
+        Cartesian cartesian (const uint32_t& vertex) const;
 
-        Vertex* nearest (const Geolocation& target, const unsigned int& depth = 0);
+        // the last level's triangles, three vertex ids each
+        const uint32_t* triangles () const;
 
-        void toGeolocation (const Cartesian& c, Geolocation& g);
+        // the vertices of a triangle in any level
+        void triangle (const unsigned& level, const uint32_t& index, uint32_t* vertices) const;
 
-        Cartesian toCartesian (const Geolocation& g, Cartesian& c);
+        const uint32_t* neighbours () const;
+        static uint64_t neighbourOffset (const uint32_t& vertex);
+        static unsigned neighbourCount (const uint32_t& vertex);
 
-        static double distSquared (const Cartesian& a, const Cartesian& b);
+        // bytes in the sphere's arrays, whether built or mapped from a file
+        size_t memoryUsed () const;
 
+        // Finds the triangles of a level (by default the last) holding n points, given as x, y and z together for each
+        // point, by descending from the base face holding each point to the child holding it at each level in turn.
+        // The points need not be on the unit sphere: each is located by its direction from the centre.
+        void locate (const float* xyz, Location* out, const size_t& n, const int& level = -1) const;
+        Location locate (const Cartesian& point, const int& level = -1) const;
 
-        inline void divideTriangle (Triangle* t);
+        // the vertex of a level (by default the last) closest to a point
+        uint32_t nearest (const Cartesian& point, const int& level = -1) const;
+        uint32_t nearest (const Geolocation& target, const int& level = -1) const;
 
-        void removeTriangle (Triangle* t);
+        static void toGeolocation (const Cartesian& c, Geolocation& g);
 
-        std::pair<std::vector<Triangle*>::iterator, std::vector<Triangle*>::iterator> triangles (const unsigned& level);
+        static void toCartesian (const Geolocation& g, Cartesian& c);
 
-        std::pair<std::vector<Vertex*>::iterator, std::vector<Vertex*>::iterator> vertices ();
+        static double distSquared (const Cartesian& a, const Cartesian& b);
 
     protected:
-        unsigned _depth;
-        uint32_t _count;
+        Icosphere ();
+        friend class IcosphereFile;
 
-        inline void subdivide (const unsigned int& level);
-
-        std::vector<Vertex*> _vertices;
-        std::vector<std::vector<Triangle*>> _triangles;
-        mutable Vertex* _lastVisited;
-
-        inline void makeTriangle (Vertex* a, Vertex* b, Vertex* c, Triangle* parent);
-
-        inline void makeNeighbours (Vertex* p, Vertex* q);
-
-        inline Vertex* addVertex (const Cartesian& c, int level);
-
-        inline void mid (const Cartesian& c1, const Cartesian& c2, Cartesian& c);
-
-        GeographicLib::Geocentric* _gc;
+        unsigned _depth;
 
-        // these are working variables for triangle subdivision
-        uint32_t k;
-        Vertex* e1;
-        uint64_t edgeKey;
-        bool _initial;
-        std::unordered_map<uint64_t, Vertex*> edgeMap;
-        std::unordered_map<uint64_t, Vertex*>::iterator it;
+        // the arrays: those built by the constructor, or those in a mapped file, which mapping keeps open
+        const float* _x, * _y, * _z;
+        const uint32_t* _triangles, * _neighbours;
+        uint32_t _vertexCount, _triangleCount;
+        std::shared_ptr<void> _mapping;
 
-        Vertex* ids0[3];  // triangles of outer vertices
-        Vertex* ids1[3];  // triangles of edge vertices
+        struct Arrays {
+            std::vector<float> x, y, z;
+            std::vector<uint32_t> triangles, neighbours;
+        } _arrays;
 
-        Cartesian c;
-        unsigned level;
+        void subdivide (const unsigned int& level, std::vector<uint32_t>& edges, std::vector<uint32_t>& sides, const bool& last);
 
-        inline uint64_t makeKey (const uint32_t& v1, const uint32_t& v2);
+        void makeNeighbours (const std::vector<uint32_t>& edges);
     };
 }
 } // namespace
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <cmath>
+#include <limits>
 #include <QApplication>
 #include <QtCore/QFile>
 #include "nodeedit/Calenhad.h"
@@ -13,6 +15,18 @@
 #include "legend/LegendRoster.h"
 #include "mapping/projection/ProjectionService.h"
 #include "pipeline/ModuleFactory.h"
+#include "mapping/RenderJob.h"
+#include "mapping/RenderFarm.h"
+#include "mapping/RenderWorker.h"
+#include "mapping/MeshExport.h"
+#include "icosphere/IcosphereFile.h"
+#include "graph/ComputeGraph.h"
+#include "graph/NativeCompiler.h"
+#include "graph/CostModel.h"
+#include "qmodule/Module.h"
+#include "qmodule/FieldModule.h"
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QTimer>
 
 #include "icosphere/icosphere.h"
 
@@ -31,7 +45,9 @@ using namespace calenhad::legend;
 using namespace calenhad::pipeline;
 using namespace calenhad::expressions;
 using namespace calenhad::notification;
+using namespace calenhad::mapping;
 using namespace calenhad::mapping::projection;
+using namespace calenhad::graph;
 
 Q_DECLARE_METATYPE (std::shared_ptr<QImage>)
 Q_DECLARE_METATYPE (std::shared_ptr<calenhad::icosphere::Icosphere>)
@@ -85,6 +101,176 @@ int main (int argc, char **argv) {
     Calculator* calculator = new Calculator();
     CalenhadServices::provideCalculator (calculator);
 
+    // command line options for rendering exports without the user interface
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption workerOption ("render-worker", "Run as a render farm worker for the job whose manifest is <manifest>.", "manifest");
+    QCommandLineOption exportOption ("export", "Export a module to an image and height map in <directory>, resuming the job there if there is one.", "directory");
+    QCommandLineOption modelOption ("model", "Model file containing the module to export.", "file");
+    QCommandLineOption moduleOption ("module", "Name of the module to export.", "name");
+    QCommandLineOption boundsOption ("bounds", "Region to export as north,south,east,west in degrees, twice as wide as it is high.", "bounds", "90,-90,180,-180");
+    QCommandLineOption resolutionOption ("resolution", "Height of the exported image in pixels; the width is twice this.", "pixels", "2048");
+    QCommandLineOption workersOption ("workers", "Number of worker processes to render with.", "count", QString::number (preferences -> calenhad_export_workers));
+    QCommandLineOption layersOption ("layers", "Further modules, separated by commas, to export as height maps in the same pass as the --module.", "names");
+    QCommandLineOption benchmarkOption ("benchmark-native", "Compile the --module and any --layers in the --model to native code and compare it with the interpreter at <points> points.", "points");
+    parser.addOption (workerOption);
+    parser.addOption (exportOption);
+    parser.addOption (modelOption);
+    parser.addOption (moduleOption);
+    parser.addOption (boundsOption);
+    parser.addOption (resolutionOption);
+    parser.addOption (workersOption);
+    parser.addOption (layersOption);
+    QCommandLineOption meshOption ("mesh", "Export the --module in the --model as a planet mesh to <file>, binary PLY or, if the name ends in .obj, OBJ.", "file");
+    QCommandLineOption depthOption ("depth", "Depth, up to 12, of the icosphere whose vertices a --mesh has.", "depth", "8");
+    QCommandLineOption displacementOption ("displacement", "How far a --mesh's vertices are moved out from the unit sphere per unit of the module's value.", "scale", "0.05");
+    parser.addOption (benchmarkOption);
+    parser.addOption (meshOption);
+    parser.addOption (depthOption);
+    QCommandLineOption toleranceOption ("tolerance", "Divide a --mesh's triangles, down to the --depth, only where the module's value strays more than this from a flat triangle's.", "value");
+    QCommandLineOption budgetOption ("budget", "Most vertices an adaptive --mesh (see --tolerance) may have.", "vertices");
+    parser.addOption (displacementOption);
+    parser.addOption (toleranceOption);
+    parser.addOption (budgetOption);
+
+    // the editor itself is also given Qt's own arguments and a project file, so only a batch run is held to the options above
+    parser.parse (app.arguments());
+    bool batch = parser.isSet (workerOption) || parser.isSet (exportOption) || parser.isSet (benchmarkOption) || parser.isSet (meshOption);
+    if (batch || parser.isSet ("help")) {
+        parser.process (app);
+    }
+
+    if (parser.isSet (workerOption)) {
+        RenderWorker worker (parser.value (workerOption));
+        return worker.run();
+    }
+
+    if (parser.isSet (benchmarkOption)) {
+        CalenhadModel* model = new CalenhadModel();
+        model -> inflate (parser.value (modelOption));
+        model -> suppressRender (true);
+        qmodule::FieldModule::generateAll (model -> modules());
+        QList<qmodule::Module*> modules;
+        for (const QString& name : QStringList (parser.value (moduleOption)) + parser.value (layersOption).split (",", QString::SkipEmptyParts)) {
+            qmodule::Module* module = model -> findModule (name);
+            if (! module) {
+                std::cout << "No module called " << name.toStdString() << " in " << parser.value (modelOption).toStdString() << "\n";
+                return 1;
+            }
+            modules.append (module);
+        }
+        ComputeGraph graph (modules);
+        return NativeCompiler::benchmark (graph, std::max (1, parser.value (benchmarkOption).toInt())) ? 0 : 1;
+    }
+
+    if (parser.isSet (meshOption)) {
+        CalenhadModel* model = new CalenhadModel();
+        model -> inflate (parser.value (modelOption));
+        model -> suppressRender (true);
+        qmodule::FieldModule::generateAll (model -> modules());
+        qmodule::Module* module = model -> findModule (parser.value (moduleOption));
+        if (! module) {
+            std::cout << "No module called " << parser.value (moduleOption).toStdString() << " in " << parser.value (modelOption).toStdString() << "\n";
+            return 1;
+        }
+        ComputeGraph graph (module);
+        MeshExport mesh (&graph, std::max (1, std::min (parser.value (depthOption).toInt(), (int) calenhad::icosphere::IcosphereFile::MaxDepth)));
+        mesh.setDisplacement (parser.value (displacementOption).toFloat());
+        if (parser.isSet (toleranceOption) || parser.isSet (budgetOption)) {
+            mesh.setAdaptive (parser.value (toleranceOption).toFloat(),
+                              parser.isSet (budgetOption) ? parser.value (budgetOption).toUInt() : std::numeric_limits<uint32_t>::max());
+        }
+        QString error;
+        if (! mesh.write (parser.value (meshOption), MeshExport::format (parser.value (meshOption)), &error)) {
+            std::cout << error.toStdString() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet (exportOption)) {
+        // the graph's estimated cost per pixel picks the tile size for a new job and, unless it is given, the number of
+        // workers, and predicts how long the job will take
+        double perPoint;
+        RenderJob* job = new RenderJob (parser.value (exportOption));
+        if (job -> load()) {
+            // a job's finished tiles are only any use if the rest are rendered from the same model with the same arguments
+            if (RenderJob::hashModel (job -> modelFile()) != job -> modelHash()) {
+                std::cout << "The model " << job -> modelFile().toStdString() << " has changed since the render job in "
+                          << job -> directory().toStdString() << " was started; export to a new directory\n";
+                return 1;
+            }
+            if (parser.isSet (modelOption) || parser.isSet (moduleOption) || parser.isSet (boundsOption) || parser.isSet (resolutionOption) || parser.isSet (layersOption)) {
+                QStringList b = parser.value (boundsOption).split (",");
+                ::icosphere::Bounds bounds = job -> bounds();
+                if (parser.isSet (boundsOption) && b.size() == 4) {
+                    bounds = ::icosphere::Bounds (b [0].toDouble(), b [1].toDouble(), b [2].toDouble(), b [3].toDouble(), geoutils::Units::Degrees);
+                }
+                RenderJob requested (job -> directory(),
+                                     parser.isSet (modelOption) ? parser.value (modelOption) : job -> modelFile(),
+                                     parser.isSet (moduleOption) ? parser.value (moduleOption) : job -> module(), bounds,
+                                     parser.isSet (resolutionOption) ? parser.value (resolutionOption).toInt() : job -> imageHeight(), job -> tileSize());
+                requested.setLayers (parser.isSet (layersOption) ? parser.value (layersOption).split (",", QString::SkipEmptyParts) : job -> layers());
+                QString difference = job -> difference (requested);
+                if (! difference.isEmpty()) {
+                    std::cout << "The render job in " << job -> directory().toStdString() << " was started with a different "
+                              << difference.toStdString() << "; export to a new directory\n";
+                    return 1;
+                }
+            }
+            std::cout << "Resuming render job in " << job -> directory().toStdString() << "\n";
+            perPoint = RenderFarm::estimate (job -> modelFile(), job -> module(), job -> layers());
+        } else {
+            QStringList b = parser.value (boundsOption).split (",");
+            if (! parser.isSet (modelOption) || ! parser.isSet (moduleOption) || b.size() != 4) {
+                std::cout << "A new export needs --model, --module and --bounds north,south,east,west\n";
+                return 1;
+            }
+            ::icosphere::Bounds bounds (b [0].toDouble(), b [1].toDouble(), b [2].toDouble(), b [3].toDouble(), geoutils::Units::Degrees);
+            if (! RenderJob::hasImageAspect (bounds)) {
+                std::cout << "The exported image is twice as wide as it is high, so --bounds must span twice as many degrees east to west as north to south\n";
+                return 1;
+            }
+            QStringList layers = parser.value (layersOption).split (",", QString::SkipEmptyParts);
+            perPoint = RenderFarm::estimate (parser.value (modelOption), parser.value (moduleOption), layers);
+            int tileSize = preferences -> calenhad_export_tilesize;
+            if (perPoint >= 0.0) { tileSize = CostModel::tileSize (perPoint, tileSize); }
+            delete job;
+            job = new RenderJob (parser.value (exportOption), parser.value (modelOption), parser.value (moduleOption), bounds,
+                                 parser.value (resolutionOption).toInt(), tileSize);
+            job -> setLayers (layers);
+        }
+
+        int workers = parser.value (workersOption).toInt();
+        if (perPoint >= 0.0) {
+            int pending = job -> pendingTiles().size();
+            double total = perPoint * pending * job -> tileSize() * job -> tileSize();
+            double throughput = preferences -> calenhad_export_throughput;
+            if (! parser.isSet (workersOption)) {
+                workers = CostModel::workers (total, pending, throughput, preferences -> calenhad_export_workers);
+            }
+            std::cout << "Estimated cost " << CostModel::describe (perPoint).toStdString() << " in " << job -> tileSize() << " pixel tiles; "
+                      << "about " << (int) std::ceil (total / (throughput * std::max (1, workers)) + CostModel::WorkerStartup)
+                      << " seconds for " << pending << " tiles with " << workers << " workers\n";
+        }
+
+        RenderFarm* farm = new RenderFarm (job, workers);
+        farm -> setCost (perPoint);
+        QObject::connect (farm, &RenderFarm::progress, [] (const int& done, const int& total) {
+            std::cout << "Rendered " << done << " of " << total << " tiles\n";
+        });
+        QObject::connect (farm, &RenderFarm::finished, &app, [&app, farm, preferences] (const bool& success) {
+            // what this job actually achieved calibrates the next one's estimate
+            if (success && farm -> throughput() > 0.0) {
+                preferences -> calenhad_export_throughput = farm -> throughput();
+                preferences -> saveSettings();
+            }
+            app.exit (success ? 0 : 1);
+        });
+        QTimer::singleShot (0, farm, &RenderFarm::start);
+        return app.exec();
+    }
+
 
     // Calenhad model - the arrangement of modules and connections between them
     Calenhad* window = new Calenhad();
@@ -363,6 +363,10 @@ void CalenhadMapWidget::paintGL() {
             _graticule -> drawGraticule (p);
         }
 
+        if (_source) {
+            _source -> drawOverlay (p, this);
+        }
+
 
        // emit rendered (true);
     }
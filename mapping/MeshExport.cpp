@@ -0,0 +1,198 @@
+#include "MeshExport.h"
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSysInfo>
+#include "../graph/ComputeGraph.h"
+#include "../graph/CpuEvaluator.h"
+#include "../icosphere/AdaptiveIcosphere.h"
+#include "../icosphere/IcosphereFile.h"
+#include "../icosphere/Parallel.h"
+
+using namespace calenhad::mapping;
+using namespace calenhad::graph;
+using namespace calenhad::icosphere;
+
+namespace {
+
+    // records are formatted in runs of RunLength, RunsPerRound runs at a time
+    const uint64_t RunLength = 1 << 14;
+    const uint64_t RunsPerRound = 64;
+
+    // Writes count records, each formatted by record into the buffer it is given. The runs in a round are formatted in
+    // parallel, each into its own buffer, and written in order once they are all done.
+    bool stream (QIODevice& out, const uint64_t& count, const std::function<void (const uint64_t&, QByteArray&)>& record) {
+        for (uint64_t round = 0; round < count; round += RunLength * RunsPerRound) {
+            uint64_t n = std::min (count - round, RunLength * RunsPerRound);
+            std::vector<QByteArray> runs ((n + RunLength - 1) / RunLength);
+            parallelFor (n, RunLength, [round, &runs, &record] (const uint64_t& begin, const uint64_t& end) {
+                QByteArray& buffer = runs [begin / RunLength];
+                for (uint64_t i = begin; i < end; i++) {
+                    record (round + i, buffer);
+                }
+            });
+            for (const QByteArray& run : runs) {
+                if (out.write (run) != run.size()) { return false; }
+            }
+        }
+        return true;
+    }
+
+    template <typename T> void append (QByteArray& buffer, const T& value) {
+        buffer.append ((const char*) &value, sizeof (T));
+    }
+}
+
+MeshExport::MeshExport (const ComputeGraph* graph, const unsigned& depth) : _graph (graph),
+    _depth (depth),
+    _displacement (0.05f),
+    _adaptive (false),
+    _tolerance (0.0f),
+    _budget (0) {
+
+}
+
+MeshExport::~MeshExport() {
+
+}
+
+void MeshExport::setDisplacement (const float& displacement) {
+    _displacement = displacement;
+}
+
+void MeshExport::setAdaptive (const float& tolerance, const uint32_t& budget) {
+    _adaptive = true;
+    _tolerance = tolerance;
+    _budget = budget;
+}
+
+std::shared_ptr<Dataset> MeshExport::dataset () const {
+    return _dataset;
+}
+
+void MeshExport::evaluate () {
+    if (_dataset || _adaptiveSphere) { return; }
+    QElapsedTimer timer;
+    timer.start();
+    _evaluator.reset (new CpuEvaluator (_graph));
+    uint32_t vertices;
+    if (_adaptive) {
+        _adaptiveSphere.reset (new AdaptiveIcosphere (_depth));
+        _adaptiveSphere -> setTolerance (_tolerance, _evaluator.get());
+        _adaptiveSphere -> setVertexBudget (_budget);
+        _adaptiveSphere -> refine();
+        vertices = _adaptiveSphere -> vertexCount();
+    } else {
+        _dataset = std::make_shared<Dataset> (IcosphereFile::cached (_depth));
+        _dataset -> fill ("height", *_evaluator);
+        vertices = _dataset -> size();
+    }
+    std::cout << "Evaluated " << _graph -> moduleName().toStdString() << " at " << vertices << " vertices in " << timer.elapsed() << " ms\n";
+}
+
+MeshExport::Format MeshExport::format (const QString& path) {
+    return QFileInfo (path).suffix().toLower() == "obj" ? ObjFormat : PlyFormat;
+}
+
+bool MeshExport::write (const QString& path, const Format& format, QString* error) {
+    if (! _graph -> isValid()) {
+        if (error) { *error = "Module " + _graph -> moduleName() + " can't be evaluated: " + _graph -> error(); }
+        return false;
+    }
+    evaluate();
+    QElapsedTimer timer;
+    timer.start();
+    const float* x, * y, * z, * heights;
+    const uint32_t* triangles;
+    uint32_t vertices, faces;
+    std::vector<uint32_t> adaptiveTriangles;
+    QString sphere;
+    if (_adaptiveSphere) {
+        x = _adaptiveSphere -> x(); y = _adaptiveSphere -> y(); z = _adaptiveSphere -> z();
+        heights = _adaptiveSphere -> heights();
+        adaptiveTriangles = _adaptiveSphere -> triangles();
+        triangles = adaptiveTriangles.data();
+        vertices = _adaptiveSphere -> vertexCount();
+        faces = (uint32_t) (adaptiveTriangles.size() / 3);
+        sphere = QString ("an adaptive icosphere of depth %1, tolerance %2").arg (_depth).arg (_tolerance);
+    } else {
+        const Icosphere* uniform = _dataset -> icosphere().get();
+        x = uniform -> x(); y = uniform -> y(); z = uniform -> z();
+        heights = _dataset -> column<float> ("height");
+        triangles = uniform -> triangles();
+        vertices = uniform -> vertexCount();
+        faces = uniform -> triangleCount();
+        sphere = QString ("an icosphere of depth %1").arg (uniform -> depth());
+    }
+    const ComputeGraph* graph = _graph;
+    float displacement = _displacement;
+
+    // triangles run clockwise seen from outside, and meshes' faces the other way
+    const int order [3] = { 0, 2, 1 };
+
+    QSaveFile out (path);
+    if (! out.open (QIODevice::WriteOnly)) {
+        if (error) { *error = "Couldn't write " + path + ": " + out.errorString(); }
+        return false;
+    }
+
+    bool ok;
+    if (format == PlyFormat) {
+        QByteArray header = QString ("ply\n"
+            "format %1 1.0\n"
+            "comment Calenhad module %2 on %3\n"
+            "element vertex %4\n"
+            "property float x\nproperty float y\nproperty float z\nproperty float height\n"
+            "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+            "element face %5\n"
+            "property list uchar uint vertex_indices\n"
+            "end_header\n")
+            .arg (QSysInfo::ByteOrder == QSysInfo::LittleEndian ? "binary_little_endian" : "binary_big_endian")
+            .arg (_graph -> moduleName()).arg (sphere).arg (vertices).arg (faces).toUtf8();
+        ok = out.write (header) == header.size();
+        ok = ok && stream (out, vertices, [x, y, z, heights, graph, displacement] (const uint64_t& v, QByteArray& buffer) {
+            float r = 1.0f + displacement * heights [v];
+            QRgb color = graph -> color (heights [v]);
+            append (buffer, x [v] * r);
+            append (buffer, y [v] * r);
+            append (buffer, z [v] * r);
+            append (buffer, heights [v]);
+            append (buffer, (uint8_t) qRed (color));
+            append (buffer, (uint8_t) qGreen (color));
+            append (buffer, (uint8_t) qBlue (color));
+        });
+        ok = ok && stream (out, faces, [triangles, &order] (const uint64_t& t, QByteArray& buffer) {
+            append (buffer, (uint8_t) 3);
+            for (int k : order) {
+                append (buffer, triangles [t * 3 + k]);
+            }
+        });
+    } else {
+        QByteArray header = QString ("# Calenhad module %1 on %2\n").arg (_graph -> moduleName()).arg (sphere).toUtf8();
+        ok = out.write (header) == header.size();
+        ok = ok && stream (out, vertices, [x, y, z, heights, graph, displacement] (const uint64_t& v, QByteArray& buffer) {
+            float r = 1.0f + displacement * heights [v];
+            QRgb color = graph -> color (heights [v]);
+            char line [128];
+            int n = std::snprintf (line, sizeof (line), "v %.7g %.7g %.7g %.4g %.4g %.4g\n", x [v] * r, y [v] * r, z [v] * r,
+                                   qRed (color) / 255.0, qGreen (color) / 255.0, qBlue (color) / 255.0);
+            buffer.append (line, n);
+        });
+        ok = ok && stream (out, faces, [triangles, &order] (const uint64_t& t, QByteArray& buffer) {
+            char line [48];
+            int n = std::snprintf (line, sizeof (line), "f %u %u %u\n", triangles [t * 3 + order [0]] + 1, triangles [t * 3 + order [1]] + 1, triangles [t * 3 + order [2]] + 1);
+            buffer.append (line, n);
+        });
+    }
+
+    if (! ok || ! out.commit()) {
+        if (error) { *error = "Couldn't write " + path + ": " + out.errorString(); }
+        return false;
+    }
+    std::cout << "Wrote " << vertices << " vertices and " << faces << " faces to " << path.toStdString() << " in " << timer.elapsed() << " ms\n";
+    return true;
+}
@@ -0,0 +1,75 @@
+#ifndef CALENHAD_MESHEXPORT_H
+#define CALENHAD_MESHEXPORT_H
+
+#include <cstdint>
+#include <memory>
+#include <QtCore/QString>
+#include "../icosphere/Dataset.h"
+
+namespace calenhad {
+    namespace graph {
+        class ComputeGraph;
+        class CpuEvaluator;
+    }
+    namespace icosphere {
+        class AdaptiveIcosphere;
+    }
+    namespace mapping {
+
+        // Exports a module as a 3D planet: a mesh whose vertices are those of an icosphere, each moved out from the
+        // centre by the module's value there and coloured from the module's legend. Unlike an equirectangular height
+        // map, which crowds ever more pixels together towards the poles, the vertices of an icosphere are spread
+        // almost evenly over the planet, so every part of it gets the same detail for the same cost.
+        //
+        // The module is evaluated at every vertex in parallel by a CpuEvaluator, and the values are kept, four bytes a
+        // vertex, as the "height" column of dataset (). The mesh itself is never built in memory: vertices and then
+        // faces are formatted a run at a time, runs on as many threads as there are, and written out in order, a round
+        // of runs at a time. Faces are the last level's triangles, in the order of their descent from the base faces,
+        // read from the sphere as they are written.
+        //
+        // PLY files are binary, and each vertex has its height and colour as well as its position. OBJ has no place
+        // for a vertex's height, so an OBJ file has positions and colours (as the widely read "v x y z r g b") only.
+        //
+        // An adaptive export is made from an AdaptiveIcosphere instead, divided down to the depth only where the module
+        // needs it, and dataset () is then null.
+        class MeshExport {
+        public:
+            enum Format { PlyFormat, ObjFormat };
+
+            MeshExport (const calenhad::graph::ComputeGraph* graph, const unsigned& depth);
+            ~MeshExport();
+
+            // radius of a vertex is 1 + displacement * height
+            void setDisplacement (const float& displacement);
+
+            // divide only triangles across which the module's value strays more than the tolerance from a flat
+            // triangle's, up to the given number of vertices
+            void setAdaptive (const float& tolerance, const uint32_t& budget);
+
+            // evaluates the graph at every vertex, if that hasn't already been done
+            void evaluate ();
+
+            // PLY or OBJ, from the file's suffix
+            static Format format (const QString& path);
+
+            bool write (const QString& path, const Format& format, QString* error = nullptr);
+
+            // the sphere with its heights, once evaluated, unless the export is adaptive
+            std::shared_ptr<calenhad::icosphere::Dataset> dataset () const;
+
+        protected:
+            const calenhad::graph::ComputeGraph* _graph;
+            unsigned _depth;
+            std::shared_ptr<calenhad::icosphere::Dataset> _dataset;
+            float _displacement;
+            bool _adaptive;
+            float _tolerance;
+            uint32_t _budget;
+            std::unique_ptr<calenhad::graph::CpuEvaluator> _evaluator;
+            std::unique_ptr<calenhad::icosphere::AdaptiveIcosphere> _adaptiveSphere;
+        };
+    }
+}
+
+
+#endif //CALENHAD_MESHEXPORT_H
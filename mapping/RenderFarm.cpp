@@ -0,0 +1,342 @@
+#include "RenderFarm.h"
+#include "RenderJob.h"
+#include "RenderWorker.h"
+#include <csetjmp>
+#include <cstring>
+#include <iostream>
+#include <png.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtGui/QImage>
+#include "../graph/ComputeGraph.h"
+#include "../graph/CostModel.h"
+#include "../pipeline/CalenhadModel.h"
+#include "../qmodule/Module.h"
+
+using namespace calenhad;
+using namespace calenhad::mapping;
+using namespace calenhad::graph;
+using namespace calenhad::pipeline;
+using namespace calenhad::qmodule;
+
+RenderFarm::RenderFarm (RenderJob* job, const int& workers, QObject* parent) : QObject (parent),
+    _job (job),
+    _workerCount (std::max (1, workers)),
+    _restarts (0),
+    _done (0),
+    _cancelled (false),
+    _finished (false),
+    _cost (-1.0),
+    _rendered (0),
+    _started (0) {
+
+}
+
+RenderFarm::~RenderFarm() {
+    for (QProcess* worker : _workers) {
+        worker -> disconnect (this);
+        worker -> kill();
+        worker -> waitForFinished (1000);
+    }
+}
+
+RenderJob* RenderFarm::job() {
+    return _job;
+}
+
+void RenderFarm::setCost (const double& perPoint) {
+    _cost = perPoint;
+}
+
+double RenderFarm::throughput() const {
+    double seconds = _timer.isValid() ? _timer.elapsed() / 1000.0 : 0.0;
+    if (_cost <= 0.0 || _rendered == 0 || seconds <= 0.0 || _started == 0) { return 0.0; }
+    double pixels = (double) _rendered * _job -> tileSize() * _job -> tileSize();
+    return pixels * _cost / seconds / _started;
+}
+
+double RenderFarm::estimate (const QString& modelFile, const QString& module, const QStringList& layers) {
+    CalenhadModel* model = new CalenhadModel();
+    model -> inflate (modelFile);
+    model -> suppressRender (true);
+    QList<Module*> modules;
+    double cost = -1.0;
+    for (const QString& name : QStringList (module) + layers) {
+        Module* m = model -> findModule (name);
+        if (! m) { modules.clear(); break; }
+        modules.append (m);
+    }
+    if (! modules.isEmpty()) {
+        ComputeGraph graph (modules);
+        if (graph.isValid()) {
+            cost = CostModel (&graph).perPoint();
+        }
+    }
+    delete model;
+    return cost;
+}
+
+void RenderFarm::start() {
+    if (! _job -> save()) {
+        fail ("Couldn't write the job manifest to " + _job -> directory());
+        return;
+    }
+
+    _queue.clear();
+    for (int i : _job -> pendingTiles()) {
+        _queue.enqueue (i);
+    }
+    _done = _job -> tileCount() - _queue.size();
+    std::cout << "Render job " << _job -> module().toStdString() << ": " << _done << " of " << _job -> tileCount() << " tiles already rendered\n";
+    emit progress (_done, _job -> tileCount());
+
+    _started = std::min (_workerCount, _queue.size());
+    _rendered = 0;
+    _timer.start();
+    for (int i = 0; i < _started; i++) {
+        startWorker();
+    }
+    checkFinished();
+}
+
+void RenderFarm::cancel() {
+    // leave the manifest as it is so that the job can be resumed
+    _cancelled = true;
+    for (QProcess* worker : _workers) {
+        worker -> kill();
+    }
+}
+
+void RenderFarm::startWorker() {
+    QProcess* worker = new QProcess (this);
+    worker -> setProcessChannelMode (QProcess::ForwardedErrorChannel);
+    connect (worker, &QProcess::readyReadStandardOutput, this, [=] () { readWorker (worker); });
+    connect (worker, static_cast<void (QProcess::*) (int, QProcess::ExitStatus)> (&QProcess::finished), this, [=] () { workerFinished (worker); });
+    _workers.append (worker);
+    worker -> start (QCoreApplication::applicationFilePath(), QStringList() << "--render-worker" << _job -> manifestFile());
+}
+
+void RenderFarm::dispatch (QProcess* worker) {
+    if (_cancelled) { return; }
+    if (_queue.isEmpty()) {
+        worker -> write ("quit\n");
+        worker -> closeWriteChannel();
+    } else {
+        int tile = _queue.dequeue();
+        _inFlight.insert (worker, tile);
+        worker -> write (QString ("tile " + QString::number (tile) + "\n").toUtf8());
+    }
+}
+
+void RenderFarm::readWorker (QProcess* worker) {
+    while (worker -> canReadLine()) {
+        QString line = QString::fromUtf8 (worker -> readLine()).trimmed();
+
+        // anything without the prefix is the worker's own diagnostics
+        if (! line.startsWith (RenderWorker::Prefix)) { continue; }
+        QStringList message = line.mid (RenderWorker::Prefix.length()).trimmed().split (" ");
+        QString verb = message.takeFirst();
+
+        if (verb == "ready") {
+            dispatch (worker);
+        }
+
+        if (verb == "done") {
+            int tile = message.value (0).toInt();
+            _inFlight.remove (worker);
+            _job -> setTileState (tile, TileState::TileDone);
+            _job -> save();
+            _done++;
+            _rendered++;
+            emit progress (_done, _job -> tileCount());
+            dispatch (worker);
+        }
+
+        if (verb == "failed") {
+            int tile = message.takeFirst().toInt();
+            _inFlight.remove (worker);
+            std::cout << "Tile " << tile << " failed: " << message.join (" ").toStdString() << "\n";
+            _failures [tile]++;
+            if (_failures [tile] >= MaxTileFailures) {
+                fail ("Tile " + QString::number (tile) + " failed " + QString::number (MaxTileFailures) + " times");
+                return;
+            }
+            _queue.enqueue (tile);
+            dispatch (worker);
+        }
+
+        if (verb == "error") {
+            // a worker that can't load the model or compile the shader means every worker will fail in the same way
+            fail (message.join (" "));
+            return;
+        }
+    }
+    checkFinished();
+}
+
+void RenderFarm::workerFinished (QProcess* worker) {
+    _workers.removeAll (worker);
+    worker -> deleteLater();
+    if (_inFlight.contains (worker)) {
+        // the worker died part way through a tile, so put the tile back at the front of the queue for someone else
+        _queue.prepend (_inFlight.take (worker));
+    }
+    if (_cancelled || _finished) { return; }
+
+    int wanted = std::min (_workerCount, _queue.size() + _inFlight.size());
+    if (_workers.size() < wanted) {
+        if (_restarts < MaxRestarts) {
+            _restarts++;
+            std::cout << "Render worker exited with code " << worker -> exitCode() << "; starting a replacement\n";
+            startWorker();
+        } else if (_workers.isEmpty()) {
+            fail ("Render workers keep exiting; giving up. Run the job again to resume it.");
+            return;
+        }
+    }
+    checkFinished();
+}
+
+void RenderFarm::checkFinished() {
+    if (_finished || _cancelled) { return; }
+    if (_job -> isComplete()) {
+        _finished = true;
+        bool success = merge();
+        emit finished (success);
+    }
+}
+
+void RenderFarm::fail (const QString& message) {
+    std::cout << "Render job failed: " << message.toStdString() << "\n";
+    cancel();
+    if (! _finished) {
+        _finished = true;
+        emit finished (false);
+    }
+}
+
+bool RenderFarm::merge() {
+    if (! mergeImage()) {
+        return false;
+    }
+    if (! mergeValues ([this] (const int& index) { return _job -> tileHeightFile (index); }, _job -> heightFile())) {
+        return false;
+    }
+    for (const QString& layer : _job -> layers()) {
+        if (! mergeValues ([this, layer] (const int& index) { return _job -> tileLayerFile (index, layer); }, _job -> layerFile (layer))) {
+            return false;
+        }
+    }
+    std::cout << "Render job " << _job -> module().toStdString() << " merged into " << _job -> imageFile().toStdString() << " and " << _job -> heightFile().toStdString() << "\n";
+    return true;
+}
+
+namespace {
+    void writePng (png_structp png, png_bytep data, png_size_t length) {
+        QIODevice* out = (QIODevice*) png_get_io_ptr (png);
+        if (out -> write ((const char*) data, (qint64) length) != (qint64) length) {
+            png_error (png, "write failed");
+        }
+    }
+
+    void flushPng (png_structp) {
+
+    }
+}
+
+bool RenderFarm::mergeImage() {
+    int size = _job -> tileSize();
+    int columns = _job -> columns();
+    int rows = _job -> rows();
+    int width = columns * size;
+    QSaveFile out (_job -> imageFile());
+    if (! out.open (QIODevice::WriteOnly)) {
+        std::cout << "Couldn't write merged image to " << _job -> imageFile().toStdString() << "\n";
+        return false;
+    }
+    png_structp png = png_create_write_struct (PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct (png) : nullptr;
+    if (! info) {
+        png_destroy_write_struct (&png, nullptr);
+        std::cout << "Couldn't start writing merged image\n";
+        return false;
+    }
+
+    // declared before the jump point, so that they are destroyed properly if libpng gives up part way through
+    QVector<QImage> strip (columns);
+    QVector<uchar> line (width * 4);
+    if (setjmp (png_jmpbuf (png))) {
+        png_destroy_write_struct (&png, &info);
+        std::cout << "Couldn't write merged image to " << _job -> imageFile().toStdString() << "\n";
+        return false;
+    }
+    png_set_write_fn (png, &out, writePng, flushPng);
+    png_set_IHDR (png, info, (png_uint_32) width, (png_uint_32) (rows * size), 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info (png, info);
+
+    // tile rows are numbered from the south but the outputs run from the north. Only one strip of tiles is held in
+    // memory at once, and its lines are written out before the next strip is read.
+    for (int r = 0; r < rows; r++) {
+        int y = rows - 1 - r;
+        for (int x = 0; x < columns; x++) {
+            int index = y * columns + x;
+            strip [x] = QImage (_job -> tileImageFile (index));
+            if (strip [x].isNull() || strip [x].width() < size || strip [x].height() < size) {
+                png_destroy_write_struct (&png, &info);
+                std::cout << "Missing tile image " << _job -> tileImageFile (index).toStdString() << "\n";
+                return false;
+            }
+            strip [x] = strip [x].convertToFormat (QImage::Format_RGBA8888);
+        }
+        for (int l = 0; l < size; l++) {
+            for (int x = 0; x < columns; x++) {
+                std::memcpy (line.data() + x * size * 4, strip [x].constScanLine (l), (size_t) size * 4);
+            }
+            png_write_row (png, line.data());
+        }
+    }
+    png_write_end (png, nullptr);
+    png_destroy_write_struct (&png, &info);
+
+    if (! out.commit()) {
+        std::cout << "Couldn't write merged image to " << _job -> imageFile().toStdString() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool RenderFarm::mergeValues (const std::function<QString (const int&)>& tileFile, const QString& file) {
+    int size = _job -> tileSize();
+    int columns = _job -> columns();
+    int rows = _job -> rows();
+    QSaveFile out (file);
+    if (! out.open (QIODevice::WriteOnly)) {
+        std::cout << "Couldn't write height map " << file.toStdString() << "\n";
+        return false;
+    }
+
+    // work through the tile rows backwards as for the image. Only one strip of tiles' values is held in memory at once.
+    QVector<float> strip (columns * size * size);
+    for (int r = 0; r < rows; r++) {
+        int y = rows - 1 - r;
+        for (int x = 0; x < columns; x++) {
+            QFile tile (tileFile (y * columns + x));
+            qint64 bytes = size * size * sizeof (float);
+            if (! tile.open (QIODevice::ReadOnly) || tile.read ((char*) (strip.data() + x * size * size), bytes) != bytes) {
+                std::cout << "Missing tile heights " << tile.fileName().toStdString() << "\n";
+                return false;
+            }
+        }
+        for (int line = 0; line < size; line++) {
+            for (int x = 0; x < columns; x++) {
+                out.write ((const char*) (strip.constData() + x * size * size + line * size), size * sizeof (float));
+            }
+        }
+    }
+    if (! out.commit()) {
+        std::cout << "Couldn't write height map " << file.toStdString() << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef CALENHAD_RENDERFARM_H
+#define CALENHAD_RENDERFARM_H
+
+#include <functional>
+#include <QtCore/QObject>
+#include <QtCore/QProcess>
+#include <QtCore/QQueue>
+#include <QtCore/QMap>
+#include <QtCore/QElapsedTimer>
+
+namespace calenhad {
+    namespace mapping {
+        class RenderJob;
+
+        // Coordinates a local render farm: a pool of worker processes (this executable run with --render-worker) which
+        // take tiles of a RenderJob from a shared queue until none are left, after which the tiles are merged into
+        // a single image and height map. Every finished tile is recorded in the job's manifest straight away, so
+        // a job that is killed can be restarted and will only render the tiles that are still missing. If a worker
+        // dies, its tile goes back on the queue and a replacement worker is started.
+        class RenderFarm : public QObject {
+        Q_OBJECT
+        public:
+            RenderFarm (RenderJob* job, const int& workers, QObject* parent = nullptr);
+
+            virtual ~RenderFarm();
+
+            RenderJob* job ();
+
+            // assemble the finished tiles into the job's image and height map files, and a file for each of its layers,
+            // a strip of tiles at a time, so that the whole image is never held in memory
+            bool merge ();
+
+            // the job's estimated cost for each pixel (see CostModel), from which the farm measures its throughput
+            void setCost (const double& perPoint);
+
+            // cost rendered per second by each worker so far, or 0 if nothing has been rendered or the cost is unknown
+            double throughput () const;
+
+            // estimated cost per pixel of rendering a module and any further layers from a model file, or a negative
+            // value if the model can't be loaded or evaluated on the CPU. Fields (see FieldModule) aren't generated for the
+            // estimate, since that can take longer than the rest of it, so a module with one upstream has no estimate.
+            static double estimate (const QString& modelFile, const QString& module, const QStringList& layers);
+
+        public slots:
+            void start ();
+            void cancel ();
+
+        signals:
+            void progress (const int& done, const int& total);
+            void finished (const bool& success);
+
+        protected:
+            RenderJob* _job;
+            int _workerCount;
+            int _restarts;
+            int _done;
+            QQueue<int> _queue;
+            QList<QProcess*> _workers;
+            QMap<QProcess*, int> _inFlight;
+            QMap<int, int> _failures;
+            bool _cancelled;
+            bool _finished;
+            double _cost;
+            int _rendered;
+            int _started;
+            QElapsedTimer _timer;
+
+            static const int MaxRestarts = 8;
+            static const int MaxTileFailures = 3;
+
+            void startWorker ();
+            void dispatch (QProcess* worker);
+            void readWorker (QProcess* worker);
+            void workerFinished (QProcess* worker);
+            void checkFinished ();
+            void fail (const QString& message);
+
+            // join the tile images into a single PNG, written a line at a time
+            bool mergeImage ();
+
+            // join one value per pixel tile files, as the heights and layers are, into a single file for the whole image
+            bool mergeValues (const std::function<QString (const int&)>& tileFile, const QString& file);
+        };
+    }
+}
+
+
+#endif //CALENHAD_RENDERFARM_H
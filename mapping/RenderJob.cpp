@@ -0,0 +1,293 @@
+#include "RenderJob.h"
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtMath>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTextStream>
+#include <iostream>
+#include "../CalenhadServices.h"
+
+using namespace calenhad;
+using namespace calenhad::mapping;
+using namespace icosphere;
+using namespace geoutils;
+
+RenderJob::RenderJob (const QString& directory) : _directory (directory), _projection ("Equirectangular"), _imageHeight (0), _tileSize (0) {
+
+}
+
+RenderJob::RenderJob (const QString& directory, const QString& modelFile, const QString& module, const Bounds& bounds, const int& imageHeight, const int& tileSize) :
+    _directory (directory),
+    _modelFile (QFileInfo (modelFile).absoluteFilePath()),
+    _module (module),
+    _modelHash (hashModel (modelFile)),
+    _projection ("Equirectangular"),
+    _bounds (bounds),
+    // the compute shader works in 32 x 32 blocks
+    _tileSize (std::max (32, (tileSize + 31) / 32 * 32)) {
+
+    // round the height up to a whole number of tiles; the image is always twice as wide as it is high
+    _imageHeight = std::max (1, (imageHeight + _tileSize - 1) / _tileSize) * _tileSize;
+    initialiseTiles();
+}
+
+void RenderJob::initialiseTiles() {
+    _tiles.clear();
+    _tiles.fill (TileState::TilePending, columns() * rows());
+}
+
+bool RenderJob::load() {
+    QDomDocument doc;
+    if (! QFile::exists (manifestFile()) || ! CalenhadServices::readXml (manifestFile(), doc)) {
+        return false;
+    }
+    QDomElement root = doc.documentElement();
+    if (root.tagName() != "renderjob") {
+        std::cout << "Not a render job manifest: " << manifestFile().toStdString() << "\n";
+        return false;
+    }
+    QDomElement modelElement = root.firstChildElement ("model");
+    _modelFile = modelElement.attribute ("file");
+    _module = modelElement.attribute ("module");
+    _modelHash = modelElement.attribute ("hash").toLatin1();
+    _layers.clear();
+    QDomNodeList layerNodes = modelElement.elementsByTagName ("layer");
+    for (int i = 0; i < layerNodes.size(); i++) {
+        _layers.append (layerNodes.at (i).toElement().attribute ("module"));
+    }
+    QDomElement boundsElement = root.firstChildElement ("bounds");
+    _bounds = Bounds (boundsElement.attribute ("north").toDouble(), boundsElement.attribute ("south").toDouble(),
+                      boundsElement.attribute ("east").toDouble(), boundsElement.attribute ("west").toDouble(), Units::Degrees);
+    QDomElement imageElement = root.firstChildElement ("image");
+    _imageHeight = imageElement.attribute ("height").toInt();
+    _tileSize = imageElement.attribute ("tileSize").toInt();
+    _projection = imageElement.attribute ("projection", "Equirectangular");
+    if (_tileSize <= 0 || _imageHeight <= 0 || _imageHeight % _tileSize != 0) {
+        std::cout << "Render job manifest has bad image dimensions\n";
+        return false;
+    }
+    initialiseTiles();
+
+    QDomNodeList tileNodes = root.firstChildElement ("tiles").elementsByTagName ("tile");
+    for (int i = 0; i < tileNodes.size(); i++) {
+        QDomElement tileElement = tileNodes.at (i).toElement();
+        int index = tileElement.attribute ("y").toInt() * columns() + tileElement.attribute ("x").toInt();
+        if (index >= 0 && index < _tiles.size() && tileElement.attribute ("state") == "done") {
+            // only trust a finished tile if its output files actually made it to disk
+            bool written = QFile::exists (tileImageFile (index)) && QFile::exists (tileHeightFile (index));
+            for (const QString& layer : _layers) {
+                written = written && QFile::exists (tileLayerFile (index, layer));
+            }
+            if (written) {
+                _tiles [index] = TileState::TileDone;
+            }
+        }
+    }
+    return true;
+}
+
+bool RenderJob::save() {
+    QDir().mkpath (_directory);
+    QDomDocument doc;
+    QDomElement root = doc.createElement ("renderjob");
+    root.setAttribute ("version", 1);
+    doc.appendChild (root);
+
+    QDomElement modelElement = doc.createElement ("model");
+    modelElement.setAttribute ("file", _modelFile);
+    modelElement.setAttribute ("module", _module);
+    modelElement.setAttribute ("hash", QString (_modelHash));
+    for (const QString& layer : _layers) {
+        QDomElement layerElement = doc.createElement ("layer");
+        layerElement.setAttribute ("module", layer);
+        modelElement.appendChild (layerElement);
+    }
+    root.appendChild (modelElement);
+
+    QDomElement boundsElement = doc.createElement ("bounds");
+    boundsElement.setAttribute ("north", QString::number (qRadiansToDegrees (_bounds.north()), 'g', 17));
+    boundsElement.setAttribute ("south", QString::number (qRadiansToDegrees (_bounds.south()), 'g', 17));
+    boundsElement.setAttribute ("east", QString::number (qRadiansToDegrees (_bounds.east()), 'g', 17));
+    boundsElement.setAttribute ("west", QString::number (qRadiansToDegrees (_bounds.west()), 'g', 17));
+    root.appendChild (boundsElement);
+
+    QDomElement imageElement = doc.createElement ("image");
+    imageElement.setAttribute ("height", _imageHeight);
+    imageElement.setAttribute ("tileSize", _tileSize);
+    imageElement.setAttribute ("projection", _projection);
+    root.appendChild (imageElement);
+
+    QDomElement tilesElement = doc.createElement ("tiles");
+    for (int i = 0; i < _tiles.size(); i++) {
+        QDomElement tileElement = doc.createElement ("tile");
+        QPoint p = tile (i);
+        tileElement.setAttribute ("x", p.x());
+        tileElement.setAttribute ("y", p.y());
+        tileElement.setAttribute ("state", _tiles [i] == TileState::TileDone ? "done" : "pending");
+        tilesElement.appendChild (tileElement);
+    }
+    root.appendChild (tilesElement);
+
+    QSaveFile file (manifestFile());
+    if (! file.open (QIODevice::WriteOnly)) {
+        std::cout << "Couldn't write render job manifest " << manifestFile().toStdString() << "\n";
+        return false;
+    }
+    QTextStream stream (&file);
+    stream << doc.toString();
+    stream.flush();
+    return file.commit();
+}
+
+QString RenderJob::directory () const {
+    return _directory;
+}
+
+QString RenderJob::manifestFile () const {
+    return QDir (_directory).filePath ("job.xml");
+}
+
+QString RenderJob::modelFile () const {
+    return _modelFile;
+}
+
+QString RenderJob::module () const {
+    return _module;
+}
+
+QByteArray RenderJob::modelHash () const {
+    return _modelHash;
+}
+
+QByteArray RenderJob::hashModel (const QString& modelFile) {
+    QFile file (modelFile);
+    if (! file.open (QIODevice::ReadOnly)) { return QByteArray(); }
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    hash.addData (&file);
+    return hash.result().toHex();
+}
+
+QString RenderJob::difference (const RenderJob& other) const {
+    if (_modelFile != other._modelFile) { return "model"; }
+    if (_module != other._module) { return "module"; }
+    if (_layers != other._layers) { return "set of layers"; }
+    const double epsilon = 1e-9;
+    if (std::fabs (_bounds.north() - other._bounds.north()) > epsilon || std::fabs (_bounds.south() - other._bounds.south()) > epsilon
+        || std::fabs (_bounds.east() - other._bounds.east()) > epsilon || std::fabs (_bounds.west() - other._bounds.west()) > epsilon) {
+        return "bounds";
+    }
+    if (_imageHeight != other._imageHeight) { return "resolution"; }
+    return QString();
+}
+
+QStringList RenderJob::layers () const {
+    return _layers;
+}
+
+void RenderJob::setLayers (const QStringList& layers) {
+    _layers = layers;
+}
+
+QString RenderJob::projection () const {
+    return _projection;
+}
+
+void RenderJob::setProjection (const QString& projection) {
+    _projection = projection;
+}
+
+Bounds RenderJob::bounds () const {
+    return _bounds;
+}
+
+int RenderJob::imageHeight () const {
+    return _imageHeight;
+}
+
+int RenderJob::imageWidth () const {
+    return _imageHeight * 2;
+}
+
+int RenderJob::tileSize () const {
+    return _tileSize;
+}
+
+Geolocation RenderJob::datum () const {
+    return _bounds.center();
+}
+
+bool RenderJob::hasImageAspect (const Bounds& bounds) {
+    return std::fabs (bounds.width() - 2 * bounds.height()) < 1e-9;
+}
+
+double RenderJob::scale () const {
+    // at scale 1 the map spans 2 pi radians of longitude and pi radians of latitude
+    return std::max (_bounds.width() / (2 * M_PI), _bounds.height() / M_PI);
+}
+
+int RenderJob::columns () const {
+    return _tileSize > 0 ? imageWidth() / _tileSize : 0;
+}
+
+int RenderJob::rows () const {
+    return _tileSize > 0 ? _imageHeight / _tileSize : 0;
+}
+
+int RenderJob::tileCount () const {
+    return _tiles.size();
+}
+
+QPoint RenderJob::tile (const int& index) const {
+    return QPoint (index % columns(), index / columns());
+}
+
+TileState RenderJob::tileState (const int& index) const {
+    return _tiles.value (index, TileState::TilePending);
+}
+
+void RenderJob::setTileState (const int& index, const TileState& state) {
+    if (index >= 0 && index < _tiles.size()) {
+        _tiles [index] = state;
+    }
+}
+
+QVector<int> RenderJob::pendingTiles () const {
+    QVector<int> pending;
+    for (int i = 0; i < _tiles.size(); i++) {
+        if (_tiles [i] != TileState::TileDone) { pending.append (i); }
+    }
+    return pending;
+}
+
+bool RenderJob::isComplete () const {
+    return pendingTiles().isEmpty();
+}
+
+QString RenderJob::tileImageFile (const int& index) const {
+    QPoint p = tile (index);
+    return QDir (_directory).filePath ("tile_" + QString::number (p.x()) + "_" + QString::number (p.y()) + ".png");
+}
+
+QString RenderJob::tileHeightFile (const int& index) const {
+    QPoint p = tile (index);
+    return QDir (_directory).filePath ("tile_" + QString::number (p.x()) + "_" + QString::number (p.y()) + ".f32");
+}
+
+QString RenderJob::imageFile () const {
+    return QDir (_directory).filePath (_module + ".png");
+}
+
+QString RenderJob::heightFile () const {
+    return QDir (_directory).filePath (_module + ".f32");
+}
+
+QString RenderJob::tileLayerFile (const int& index, const QString& layer) const {
+    QPoint p = tile (index);
+    return QDir (_directory).filePath ("tile_" + QString::number (p.x()) + "_" + QString::number (p.y()) + "." + layer + ".f32");
+}
+
+QString RenderJob::layerFile (const QString& layer) const {
+    return QDir (_directory).filePath (layer + ".f32");
+}
@@ -0,0 +1,95 @@
+#ifndef CALENHAD_RENDERJOB_H
+#define CALENHAD_RENDERJOB_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QPoint>
+#include <QtXml/QDomDocument>
+#include "../icosphere/Bounds.h"
+
+namespace calenhad {
+    namespace mapping {
+
+        enum TileState { TilePending, TileDone };
+
+        // A RenderJob describes an export of one module's output over given bounds at a given resolution, split into
+        // square tiles which can be rendered independently of one another. The job is persisted as a manifest in its
+        // output directory, recording which tiles are finished and a hash of the model file, so that a job which is
+        // killed can be resumed later, and only with the model it was started from.
+        class RenderJob {
+        public:
+            RenderJob (const QString& directory);
+            RenderJob (const QString& directory, const QString& modelFile, const QString& module, const icosphere::Bounds& bounds, const int& imageHeight, const int& tileSize);
+
+            // read the manifest from the output directory, returning false if there is none or it can't be parsed
+            bool load ();
+
+            // write the manifest atomically so that a kill part way through never leaves a truncated file
+            bool save ();
+
+            QString directory () const;
+            QString manifestFile () const;
+            QString modelFile () const;
+            QString module () const;
+
+            // hash of the model file's contents when the job was started, and of a model file as it is now
+            QByteArray modelHash () const;
+            static QByteArray hashModel (const QString& modelFile);
+
+            // what the other job would export differently, if anything - the model, module, layers, bounds or
+            // resolution - or an empty string if the two jobs' tiles are the same
+            QString difference (const RenderJob& other) const;
+
+            // further modules exported in the same pass as the module, as height maps only. Anything upstream of
+            // more than one of them is computed once for all of them.
+            QStringList layers () const;
+            void setLayers (const QStringList& layers);
+            QString projection () const;
+            void setProjection (const QString& projection);
+            icosphere::Bounds bounds () const;
+            int imageHeight () const;
+            int imageWidth () const;
+            int tileSize () const;
+
+            // datum (centre) and scale to pass to the compute shader so that the image covers the job's bounds. The image is
+            // always twice as wide as it is high, so this is exact only for bounds twice as wide as they are high.
+            geoutils::Geolocation datum () const;
+            double scale () const;
+            static bool hasImageAspect (const icosphere::Bounds& bounds);
+
+            int tileCount () const;
+            int columns () const;
+            int rows () const;
+            QPoint tile (const int& index) const;
+            TileState tileState (const int& index) const;
+            void setTileState (const int& index, const TileState& state);
+            QVector<int> pendingTiles () const;
+            bool isComplete () const;
+
+            QString tileImageFile (const int& index) const;
+            QString tileHeightFile (const int& index) const;
+            QString imageFile () const;
+            QString heightFile () const;
+            QString tileLayerFile (const int& index, const QString& layer) const;
+            QString layerFile (const QString& layer) const;
+
+        protected:
+            QString _directory;
+            QString _modelFile;
+            QString _module;
+            QByteArray _modelHash;
+            QStringList _layers;
+            QString _projection;
+            icosphere::Bounds _bounds;
+            int _imageHeight;
+            int _tileSize;
+            QVector<TileState> _tiles;
+
+            void initialiseTiles ();
+        };
+    }
+}
+
+
+#endif //CALENHAD_RENDERJOB_H
@@ -0,0 +1,116 @@
+#include "RenderWorker.h"
+#include "RenderJob.h"
+#include "TileRenderer.h"
+#include <iostream>
+#include <string>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include "../graph/graph.h"
+#include "../pipeline/CalenhadModel.h"
+#include "../qmodule/Module.h"
+#include "../qmodule/FieldModule.h"
+
+using namespace calenhad;
+using namespace calenhad::mapping;
+using namespace calenhad::graph;
+using namespace calenhad::pipeline;
+using namespace calenhad::qmodule;
+
+const QString RenderWorker::Prefix = "calenhad-worker:";
+
+RenderWorker::RenderWorker (const QString& manifest) : _manifest (manifest) {
+
+}
+
+void RenderWorker::report (const QString& message) {
+    std::cout << Prefix.toStdString() << " " << message.toStdString() << std::endl;
+}
+
+int RenderWorker::run() {
+    RenderJob job (QFileInfo (_manifest).absolutePath());
+    if (! job.load()) {
+        report ("error Couldn't read render job manifest " + _manifest);
+        return 1;
+    }
+
+    CalenhadModel* model = new CalenhadModel();
+    model -> inflate (job.modelFile());
+    model -> suppressRender (true);
+    FieldModule::generateAll (model -> modules());
+    Module* module = model -> findModule (job.module());
+    if (! module) {
+        report ("error No module called " + job.module() + " in " + job.modelFile());
+        return 1;
+    }
+
+    QList<Module*> modules = { module };
+    for (const QString& layer : job.layers()) {
+        Module* m = model -> findModule (layer);
+        if (! m) {
+            report ("error No module called " + layer + " in " + job.modelFile());
+            return 1;
+        }
+        modules.append (m);
+    }
+
+    TileRenderer renderer (job.tileSize());
+    Graph graph (modules);
+    if (! renderer.initialise() || ! renderer.setGraph (&graph)) {
+        report ("error Couldn't compile module " + job.module() + " for rendering");
+        return 1;
+    }
+    renderer.setImageHeight (job.imageHeight());
+    renderer.setDatum (job.datum(), job.scale());
+    renderer.setProjection (job.projection());
+    report ("ready");
+
+    std::string line;
+    while (std::getline (std::cin, line)) {
+        QStringList command = QString::fromStdString (line).trimmed().split (" ", QString::SkipEmptyParts);
+        if (command.isEmpty()) { continue; }
+        if (command.first() == "quit") { break; }
+        if (command.first() != "tile" || command.size() < 2) { continue; }
+
+        bool ok;
+        int index = command.at (1).toInt (&ok);
+        if (! ok || index < 0 || index >= job.tileCount()) {
+            report ("failed " + command.at (1) + " No such tile");
+            continue;
+        }
+
+        QImage image;
+        QVector<float> heights;
+        QVector<QVector<float>> layers;
+        QPoint tile = job.tile (index);
+        if (! renderer.render (tile.x(), tile.y(), image, heights, &layers)) {
+            report ("failed " + QString::number (index) + " Render failed");
+            continue;
+        }
+
+        // write to temporary files and rename, so that a tile's files either exist complete or not at all
+        QSaveFile heightFile (job.tileHeightFile (index));
+        QSaveFile imageFile (job.tileImageFile (index));
+        bool written = heightFile.open (QIODevice::WriteOnly)
+            && heightFile.write ((const char*) heights.constData(), heights.size() * sizeof (float)) == (qint64) (heights.size() * sizeof (float))
+            && heightFile.commit()
+            && imageFile.open (QIODevice::WriteOnly)
+            && image.save (&imageFile, "PNG")
+            && imageFile.commit();
+        for (int k = 0; written && k < job.layers().size(); k++) {
+            QSaveFile layerFile (job.tileLayerFile (index, job.layers().at (k)));
+            const QVector<float>& values = layers.value (k);
+            written = values.size() == heights.size()
+                && layerFile.open (QIODevice::WriteOnly)
+                && layerFile.write ((const char*) values.constData(), values.size() * sizeof (float)) == (qint64) (values.size() * sizeof (float))
+                && layerFile.commit();
+        }
+        if (written) {
+            report ("done " + QString::number (index));
+        } else {
+            report ("failed " + QString::number (index) + " Couldn't write tile files");
+        }
+    }
+
+    // the model is left for the process exit to clean up, since the graph shares its raster images
+    return 0;
+}
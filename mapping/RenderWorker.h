@@ -0,0 +1,30 @@
+#ifndef CALENHAD_RENDERWORKER_H
+#define CALENHAD_RENDERWORKER_H
+
+#include <QtCore/QString>
+
+namespace calenhad {
+    namespace mapping {
+
+        // Headless worker process for the render farm. It loads the job's model once, then reads tile numbers from
+        // standard input one line at a time ("tile <n>"), renders each one to the job's directory and reports back
+        // on standard output. Lines meant for the coordinator carry a prefix so that they can be told apart from
+        // the diagnostics everything else writes to std::cout.
+        class RenderWorker {
+        public:
+            RenderWorker (const QString& manifest);
+
+            // blocks until standard input is closed or the coordinator says "quit"; returns the process exit code
+            int run ();
+
+            static const QString Prefix;
+
+        protected:
+            QString _manifest;
+            void report (const QString& message);
+        };
+    }
+}
+
+
+#endif //CALENHAD_RENDERWORKER_H
@@ -0,0 +1,262 @@
+#include "TileRenderer.h"
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <iostream>
+#include "../graph/graph.h"
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "projection/ProjectionService.h"
+#include "projection/Projection.h"
+
+using namespace calenhad;
+using namespace calenhad::graph;
+using namespace calenhad::mapping;
+using namespace calenhad::mapping::projection;
+using namespace geoutils;
+
+TileRenderer::TileRenderer (const int& tileSize) :
+    _context (nullptr),
+    _surface (nullptr),
+    _computeShader (nullptr),
+    _computeProgram (nullptr),
+    _texture (nullptr),
+    _rasterTexture (nullptr),
+    _colorMap (0),
+    _heightMap (0),
+    _layerMap (0),
+    _tileSize (tileSize),
+    _layers (1),
+    _imageHeight (tileSize),
+    _datum (Geolocation (0, 0)),
+    _scale (1.0),
+    _projection (ProjectionId::ProjectioonEquirectangular) {
+
+    QFile csFile (":/shaders/map_cs.glsl");
+    csFile.open (QIODevice::ReadOnly);
+    QTextStream csTextStream (&csFile);
+    _shaderTemplate = csTextStream.readAll();
+}
+
+TileRenderer::~TileRenderer() {
+    if (_context) {
+        _context -> makeCurrent (_surface);
+        if (_colorMap) { glDeleteBuffers (1, &_colorMap); }
+        if (_heightMap) { glDeleteBuffers (1, &_heightMap); }
+        if (_layerMap) { glDeleteBuffers (1, &_layerMap); }
+        if (_texture) { delete _texture; }
+        if (_rasterTexture) { delete _rasterTexture; }
+        if (_computeProgram) { delete _computeProgram; }
+        if (_computeShader) { delete _computeShader; }
+        _context -> doneCurrent();
+        delete _context;
+    }
+    if (_surface) { delete _surface; }
+}
+
+bool TileRenderer::initialise() {
+    QSurfaceFormat format;
+    format.setVersion (4, 3);
+    format.setProfile (QSurfaceFormat::CoreProfile);
+
+    _surface = new QOffscreenSurface();
+    _surface -> setFormat (format);
+    _surface -> create();
+
+    _context = new QOpenGLContext();
+    _context -> setFormat (format);
+    if (! _context -> create() || ! _context -> makeCurrent (_surface)) {
+        std::cout << "Couldn't create an OpenGL 4.3 context for tile rendering\n";
+        return false;
+    }
+    if (! initializeOpenGLFunctions()) {
+        std::cout << "OpenGL 4.3 functions unavailable for tile rendering\n";
+        return false;
+    }
+
+    // output texture and height buffer need only be the size of one tile
+    _texture = new QOpenGLTexture (QOpenGLTexture::Target2D);
+    _texture -> create();
+    _texture -> setFormat (QOpenGLTexture::RGBA8_UNorm);
+    _texture -> setSize (_tileSize, _tileSize);
+    _texture -> allocateStorage();
+
+    glGenBuffers (1, &_heightMap);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, _heightMap);
+    glBufferData (GL_SHADER_STORAGE_BUFFER, sizeof (GLfloat) * _tileSize * _tileSize, NULL, GL_DYNAMIC_READ);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+bool TileRenderer::setGraph (Graph* graph) {
+    QString code = graph -> glsl();
+    if (code == QString::null) {
+        std::cout << "No render code for compute shader\n";
+        return false;
+    }
+
+    _context -> makeCurrent (_surface);
+    QString shader = _shaderTemplate;
+    shader.replace ("// inserted code //", code);
+    shader.replace ("// inserted inverse //", CalenhadServices::projections() -> glslInverse());
+    shader.replace ("// inserted forward //", CalenhadServices::projections() -> glslForward());
+
+    if (_computeProgram) { delete _computeProgram; }
+    if (_computeShader) { delete _computeShader; }
+    _computeShader = new QOpenGLShader (QOpenGLShader::Compute);
+    if (! _computeShader -> compileSourceCode (shader)) {
+        std::cout << "Compute shader would not compile\n";
+        return false;
+    }
+    _computeProgram = new QOpenGLShaderProgram();
+    _computeProgram -> addShader (_computeShader);
+    if (! _computeProgram -> link()) {
+        std::cout << "Compute shader would not link\n";
+        return false;
+    }
+
+    // colour map
+    if (! _colorMap) { glGenBuffers (1, &_colorMap); }
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, _colorMap);
+    glBufferData (GL_SHADER_STORAGE_BUFFER, graph -> colorMapBufferSize(), graph -> colorMapBuffer(), GL_DYNAMIC_COPY);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+    // layer buffer, only needed if there is more than the one layer which goes to the height buffer
+    _layers = graph -> layerCount();
+    if (_layers > 1) {
+        if (! _layerMap) { glGenBuffers (1, &_layerMap); }
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, _layerMap);
+        glBufferData (GL_SHADER_STORAGE_BUFFER, sizeof (GLfloat) * _tileSize * _tileSize * _layers, NULL, GL_DYNAMIC_READ);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // input rasters
+    if (_rasterTexture) {
+        _rasterTexture -> destroy();
+        delete _rasterTexture;
+        _rasterTexture = nullptr;
+    }
+    int rasters = graph -> rasterCount();
+    if (rasters > 0) {
+        int resolution = CalenhadServices::preferences() -> calenhad_globe_texture_height;
+        glActiveTexture (GL_TEXTURE1);
+        _rasterTexture = new QOpenGLTexture (QOpenGLTexture::Target2DArray);
+        _rasterTexture -> create();
+        _rasterTexture -> setFormat (QOpenGLTexture::RGBA8_UNorm);
+        _rasterTexture -> setSize (resolution, resolution);
+        _rasterTexture -> setLayers (rasters);
+        _rasterTexture -> setMinificationFilter (QOpenGLTexture::Linear);
+        _rasterTexture -> setMagnificationFilter (QOpenGLTexture::Linear);
+        _rasterTexture -> allocateStorage();
+        for (int i = 0; i < rasters; i++) {
+            QImage raster = graph -> raster (i) -> convertToFormat (QImage::Format_RGBA8888).scaled (resolution, resolution);
+            _rasterTexture -> setData (0, i, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, (const void*) raster.constBits());
+        }
+        glActiveTexture (GL_TEXTURE0);
+    }
+    return true;
+}
+
+void TileRenderer::setImageHeight (const int& height) {
+    _imageHeight = height;
+}
+
+void TileRenderer::setDatum (const Geolocation& datum, const double& scale) {
+    _datum = datum;
+    _scale = scale;
+}
+
+void TileRenderer::setProjection (const QString& projection) {
+    Projection* p = CalenhadServices::projections() -> fetch (projection);
+    if (p) {
+        _projection = p -> id();
+    }
+}
+
+int TileRenderer::tileSize () const {
+    return _tileSize;
+}
+
+int TileRenderer::layerCount () const {
+    return _layers;
+}
+
+bool TileRenderer::render (const int& x, const int& y, QImage& image, QVector<float>& heights, QVector<QVector<float>>* layers) {
+    if (! _computeProgram) { return false; }
+    _context -> makeCurrent (_surface);
+    _computeProgram -> bind();
+    GLuint id = _computeProgram -> programId();
+
+    glBindImageTexture (0, _texture -> textureId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    if (_rasterTexture) {
+        glActiveTexture (GL_TEXTURE1);
+        _rasterTexture -> bind();
+        glActiveTexture (GL_TEXTURE0);
+    }
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 2, _colorMap);
+    glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 3, _heightMap);
+    bool writeLayers = layers && _layers > 1;
+    if (writeLayers) {
+        glBindBufferBase (GL_SHADER_STORAGE_BUFFER, 4, _layerMap);
+    }
+
+    glUniform1i (glGetUniformLocation (id, "destTex"), 0);
+    glUniform1i (glGetUniformLocation (id, "rasters"), 1);
+    glUniform1i (glGetUniformLocation (id, "colorMapBufferSize"), CalenhadServices::preferences() -> calenhad_colormap_buffersize);
+    glUniform1i (glGetUniformLocation (id, "imageHeight"), _imageHeight);
+    glUniform1i (glGetUniformLocation (id, "projection"), _projection);
+    glUniform3f (glGetUniformLocation (id, "datum"), (GLfloat) _datum.longitude(), (GLfloat) _datum.latitude(), (GLfloat) _scale);
+    glUniform1i (glGetUniformLocation (id, "insetHeight"), 0);
+    glUniform1i (glGetUniformLocation (id, "rasterResolution"), CalenhadServices::preferences() -> calenhad_globe_texture_height);
+    glUniform3i (glGetUniformLocation (id, "tile"), x, y, _tileSize);
+    glUniform1i (glGetUniformLocation (id, "tileLocal"), GL_TRUE);
+    glUniform1i (glGetUniformLocation (id, "writeLayers"), writeLayers ? GL_TRUE : GL_FALSE);
+    glUniform1i (glGetUniformLocation (id, "cullOctaves"), GL_FALSE);
+
+    glDispatchCompute (_tileSize / 32, _tileSize / 32, 1);
+    glMemoryBarrier (GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    // the shader's rows run from south to north, so flip both outputs to put north at the top
+    QImage texels (_tileSize, _tileSize, QImage::Format_RGBA8888);
+    _texture -> bind();
+    glGetTexImage (GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.bits());
+    image = texels.mirrored (false, true);
+
+    heights.resize (_tileSize * _tileSize);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, _heightMap);
+    GLfloat* heightData = (GLfloat*) glMapBuffer (GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+    if (! heightData) {
+        std::cout << "No height data obtained for tile (" << x << ", " << y << ")\n";
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+        return false;
+    }
+    for (int row = 0; row < _tileSize; row++) {
+        memcpy (heights.data() + row * _tileSize, heightData + (_tileSize - 1 - row) * _tileSize, _tileSize * sizeof (GLfloat));
+    }
+    glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+    glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (writeLayers) {
+        // the shader writes each texel's layers together; pull them apart into one array per layer
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, _layerMap);
+        GLfloat* layerData = (GLfloat*) glMapBuffer (GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+        if (! layerData) {
+            std::cout << "No layer data obtained for tile (" << x << ", " << y << ")\n";
+            glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+            return false;
+        }
+        layers -> resize (_layers - 1);
+        for (int k = 1; k < _layers; k++) {
+            QVector<float>& values = (*layers) [k - 1];
+            values.resize (_tileSize * _tileSize);
+            for (int row = 0; row < _tileSize; row++) {
+                const GLfloat* from = layerData + (_tileSize - 1 - row) * _tileSize * _layers;
+                for (int column = 0; column < _tileSize; column++) {
+                    values [row * _tileSize + column] = from [column * _layers + k];
+                }
+            }
+        }
+        glUnmapBuffer (GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    return true;
+}
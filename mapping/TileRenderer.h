@@ -0,0 +1,67 @@
+#ifndef CALENHAD_TILERENDERER_H
+#define CALENHAD_TILERENDERER_H
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLShader>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QtGui/QImage>
+#include <QtCore/QVector>
+#include "../geoutils.h"
+
+namespace calenhad {
+    namespace graph {
+        class Graph;
+    }
+    namespace mapping {
+
+        // Renders single tiles of a module's map without a window, using the same compute shader as CalenhadMapWidget.
+        // Only one tile's worth of texture and height buffer is allocated on the GPU however large the whole image is,
+        // so this is what the exporters use to produce images bigger than the card could hold at once.
+        class TileRenderer : protected QOpenGLFunctions_4_3_Core {
+        public:
+            TileRenderer (const int& tileSize);
+
+            virtual ~TileRenderer();
+
+            // create the offscreen context - returns false if there is no OpenGL 4.3 available
+            bool initialise ();
+
+            // compile the graph into the compute shader and upload its colour map and rasters
+            bool setGraph (calenhad::graph::Graph* graph);
+
+            void setImageHeight (const int& height);
+            void setDatum (const geoutils::Geolocation& datum, const double& scale);
+            void setProjection (const QString& projection);
+            int tileSize () const;
+
+            // number of modules the graph renders at once; see Graph (const QList<Module*>&)
+            int layerCount () const;
+
+            // render tile (x, y) of the whole image. The image is returned with north at the top; heights are returned in the
+            // same order, row by row from the top. If layers is given, it receives the values of each of the graph's layers
+            // after the first (which are the heights), in the same order.
+            bool render (const int& x, const int& y, QImage& image, QVector<float>& heights, QVector<QVector<float>>* layers = nullptr);
+
+        protected:
+            QOpenGLContext* _context;
+            QOffscreenSurface* _surface;
+            QOpenGLShader* _computeShader;
+            QOpenGLShaderProgram* _computeProgram;
+            QOpenGLTexture* _texture, * _rasterTexture;
+            GLuint _colorMap, _heightMap, _layerMap;
+            QString _shaderTemplate;
+            int _tileSize;
+            int _layers;
+            int _imageHeight;
+            geoutils::Geolocation _datum;
+            double _scale;
+            int _projection;
+        };
+    }
+}
+
+
+#endif //CALENHAD_TILERENDERER_H
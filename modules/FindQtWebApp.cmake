@@ -0,0 +1,32 @@
+###############################################################################
+# CMake module to search for the QtWebApp HTTP server library
+# (http://stefanfrings.de/qtwebapp/), built and installed as a shared library.
+#
+# On success, the module sets the following variables:
+# QtWebApp_FOUND        = if the library was found
+# QtWebApp_INCLUDE_DIRS = where to find httplistener.h and the other headers
+# QtWebApp_LIBRARIES    = full path to the library
+#
+# Set QtWebApp_ROOT to the installation prefix if it is not in a standard place.
+###############################################################################
+
+find_path(QtWebApp_INCLUDE_DIR httplistener.h
+        HINTS ${QtWebApp_ROOT} $ENV{QtWebApp_ROOT}
+        PATH_SUFFIXES include include/qtwebapp include/QtWebApp include/httpserver qtwebapp/httpserver httpserver
+        DOC "Path to the QtWebApp include directory")
+
+find_library(QtWebApp_LIBRARY
+        NAMES QtWebApp qtwebapp QtWebAppd
+        HINTS ${QtWebApp_ROOT} $ENV{QtWebApp_ROOT}
+        PATH_SUFFIXES lib lib64
+        DOC "Path to the QtWebApp library")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(QtWebApp DEFAULT_MSG QtWebApp_LIBRARY QtWebApp_INCLUDE_DIR)
+
+if (QtWebApp_FOUND)
+    set(QtWebApp_INCLUDE_DIRS ${QtWebApp_INCLUDE_DIR})
+    set(QtWebApp_LIBRARIES ${QtWebApp_LIBRARY})
+endif()
+
+mark_as_advanced(QtWebApp_INCLUDE_DIR QtWebApp_LIBRARY)
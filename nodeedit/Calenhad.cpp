@@ -52,6 +52,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include <QtWidgets/QMessageBox>
 #include <controls/SplashDialog.h>
 #include "../pipeline/ModuleFactory.h"
+#ifdef CALENHAD_HTTPSERVER
+#include "../httpserver/TileServer.h"
+#endif
 
 
 using namespace icosphere;
@@ -63,6 +66,9 @@ using namespace calenhad::qmodule;
 using namespace calenhad::legend;
 using namespace calenhad::expressions;
 using namespace calenhad::notification;
+#ifdef CALENHAD_HTTPSERVER
+using namespace calenhad::httpserver;
+#endif
 
 
 
@@ -104,6 +110,14 @@ Calenhad::Calenhad (QWidget* parent) : QNotificationHost (parent),
     // Legends
     initialiseLegends();
 
+#ifdef CALENHAD_HTTPSERVER
+    // serve the model's modules as map tiles
+    _tileServer = new TileServer (this);
+    if (CalenhadServices::preferences() -> calenhad_tileserver_enabled) {
+        _tileServer -> start (CalenhadServices::preferences() -> calenhad_tileserver_settings);
+    }
+#endif
+
     // Tools
 
     CalenhadToolBar* viewToolbar = makeToolbar ("View");
@@ -426,6 +440,9 @@ void Calenhad::setModel (CalenhadModel* model) {
     _controller -> addView (_view);
     connect (_view, &CalenhadView::viewZoomed, this, &Calenhad::updateZoomActions);
     connect (_model, &CalenhadModel::titleChanged, this, &Calenhad::titleChanged);
+#ifdef CALENHAD_HTTPSERVER
+    _tileServer -> setModel (_model);
+#endif
 }
 
 CalenhadModel* Calenhad::model() {
@@ -608,6 +625,9 @@ void Calenhad::closeProject() {
                 }
             }
             _model -> suppressRender (true);   // otherwise destructing the model's contents will keep making it try to rerender
+#ifdef CALENHAD_HTTPSERVER
+            _tileServer -> setModel (nullptr);
+#endif
             delete _model;
             _model = nullptr;
         }
@@ -61,6 +61,9 @@ namespace calenhad {
     namespace qmodule {
         class Node;
     }
+    namespace httpserver {
+        class TileServer;
+    }
     namespace nodeedit {
         class CalenhadController;
         class CalenhadView;
@@ -103,6 +106,9 @@ namespace calenhad {
             calenhad::expressions::VariablesDialog* _variablesDialog;
             QString _lastFile;
             QMap<QString, calenhad::legend::Legend*> _legends;
+#ifdef CALENHAD_HTTPSERVER
+            calenhad::httpserver::TileServer* _tileServer;
+#endif
 
             //void readMetadata (const QDomDocument& doc, QNotificationFactory* messages);
 
@@ -40,15 +40,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "../pipeline/CalenhadModel.h"
 #include "NodeNameValidator.h"
 #include "../exprtk/Calculator.h"
+#include "../graph/CostModel.h"
 #include <QApplication>
 
 using namespace calenhad::controls;
 using namespace calenhad::nodeedit;
 using namespace calenhad::qmodule;
+using namespace calenhad::graph;
 
 
 
 NodeBlock::NodeBlock (Node* node, QGraphicsItem* parent) : QGraphicsPathItem (parent), _node (node), _label (nullptr), _icon (nullptr), _expression (QString::null),
+    _cost (-1.0),
     _size (QSizeF (0, 0)),
    _endorsementOrright (QPixmap (":/appicons/status/orright.png")),
    _endorsementGoosed (QPixmap (":/appicons/status/goosed.png")) {
@@ -99,6 +102,8 @@ void NodeBlock::initialise() {
     }
 
     connect (_node, &Node::nameChanged, this, [=] () { _label -> setText (_node -> name()); });
+    connect (_node, &Node::nodeChanged, this, &NodeBlock::updateCost);
+    updateCost();
     setPath (makePath ());
 }
 
@@ -153,6 +158,14 @@ void NodeBlock::paint (QPainter* painter, const QStyleOptionGraphicsItem* option
             painter -> drawPixmap ((int) _size.width() - pix.height(), (int) _size.height() -  pix.height(), pix);
             painter -> drawPixmap ((int) _size.width() + _margin - endorsement.width(), (int) _size.height() + _margin - endorsement.height(), endorsement);
         }
+
+        // estimated cost per point of the module and everything feeding it, as at the last change (see updateCost)
+        if (_cost >= 0.0) {
+            QFont f = painter -> font();
+            f.setPointSize (6);
+            painter -> setFont (f);
+            painter -> drawText (_margin, _margin + 6, QString::number (_cost, 'g', _cost < 10.0 ? 2 : 3));
+        }
     }
 }
 
@@ -287,6 +300,14 @@ void NodeBlock::nodeChanged () {
     _node -> invalidate();
 }
 
+void NodeBlock::updateCost() {
+    Module* module = dynamic_cast<Module*> (_node);
+    if (! module) { return; }
+    _cost = module -> cost();
+    setToolTip (_cost >= 0.0 ? "Estimated cost: " + CostModel::describe (_cost) : QString());
+    update();
+}
+
 void NodeBlock::setText (const QString& text) {
     _expression = text;
 }
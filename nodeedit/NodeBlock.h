@@ -83,6 +83,9 @@ namespace calenhad {
 
 			virtual void nodeChanged();
 
+			// works out the module's estimated cost again, for paint to show, when it or anything upstream of it changes
+			void updateCost();
+
 			void mousePressEvent (QGraphicsSceneMouseEvent* event) override;
 
 			void mouseReleaseEvent (QGraphicsSceneMouseEvent* event) override;
@@ -112,6 +115,7 @@ namespace calenhad {
 			QPixmap _iconImage;
             const QPixmap _endorsementOrright, _endorsementGoosed;
             QString _expression;
+            double _cost;
 
             calenhad::nodeedit::NodeNameValidator* _nameValidator;
 
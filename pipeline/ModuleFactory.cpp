@@ -11,6 +11,11 @@
 #include "../CalenhadServices.h"
 #include <QList>
 #include <qmodule/RasterModule.h>
+#include <qmodule/BiomeModule.h>
+#include <qmodule/TectonicsModule.h>
+#include <qmodule/ErosionModule.h>
+#include <qmodule/RiversModule.h>
+#include <qmodule/DistanceModule.h>
 #include <nodeedit/Port.h>
 #include "../noiseconstants.h"
 
@@ -103,6 +108,11 @@ Node* ModuleFactory::inflateModule (const QString& type, CalenhadModel* model) {
         Module* qm = nullptr;
         if (type == "altitudemap") { AltitudeMap* am = new AltitudeMap(); qm = am; n = qm; }
         if (type == "raster") { RasterModule* rm = new RasterModule(); qm = rm; n = qm; }
+        if (type == "biome") { BiomeModule* bm = new BiomeModule(); qm = bm; n = qm; }
+        if (type == "tectonics") { TectonicsModule* tm = new TectonicsModule(); qm = tm; n = qm; }
+        if (type == "erosion") { ErosionModule* em = new ErosionModule(); qm = em; n = qm; }
+        if (type == "rivers") { RiversModule* rm = new RiversModule(); qm = rm; n = qm; }
+        if (type == "distance") { DistanceModule* dm = new DistanceModule(); qm = dm; n = qm; }
 
         if (! n) {
             qm = new Module (type, suppressRender);
@@ -126,11 +126,38 @@ namespace calenhad {
             double calenhad_desktop_nodegroup_width_default;
             double calenhad_model_extent;
 
+            // Export
+
+            int calenhad_export_tilesize;
+            int calenhad_export_workers;
+
+            // estimated cost (see CostModel) one worker renders per second, updated after each export
+            double calenhad_export_throughput;
+
+            // Tile server
+
+            bool calenhad_tileserver_enabled;
+            QString calenhad_tileserver_settings;
+
+            // Native compilation
+
+            QString calenhad_native_compiler;
+            QString calenhad_native_cache;
+
+            // Icospheres
+
+            QString calenhad_icosphere_cache;
+
             // Modules
 
             QString calenhad_module_icospheremap;
             QString calenhad_module_altitudemap;
             QString calenhad_module_raster;
+            QString calenhad_module_biome;
+            QString calenhad_module_tectonics;
+            QString calenhad_module_erosion;
+            QString calenhad_module_rivers;
+            QString calenhad_module_distance;
             QString calenhad_nodegroup;
             QColor calenhad_toolpalette_icon_color_normal;
             QColor calenhad_toolpalette_icon_color_mouseover;
@@ -110,6 +110,22 @@ void Preferences::loadSettings() {
     calenhad_globe_inset_height = _settings -> value ("calenhad/globe/inset/height", 64).toUInt (&ok);
     calenhad_globe_texture_height = _settings -> value ("calenhad/globe/texture/height", 1024).toUInt (&ok);
 
+    // Export
+    calenhad_export_tilesize = _settings -> value ("calenhad/export/tilesize", 512).toInt (&ok);
+    calenhad_export_workers = _settings -> value ("calenhad/export/workers", 4).toInt (&ok);
+    calenhad_export_throughput = _settings -> value ("calenhad/export/throughput", 2.0e8).toDouble (&ok);
+
+    // Tile server
+    calenhad_tileserver_enabled = _settings -> value ("calenhad/tileserver/enabled", false).toBool();
+    calenhad_tileserver_settings = _settings -> value ("calenhad/tileserver/settings", "/home/martin/.config/calenhad/webapp1.ini").toString();
+
+    // Native compilation - an empty compiler switches it off
+    calenhad_native_compiler = _settings -> value ("calenhad/native/compiler", "c++").toString();
+    calenhad_native_cache = _settings -> value ("calenhad/native/cache", "/home/martin/.cache/calenhad/native").toString();
+
+    // Icospheres, built once for each depth and kept as files to map
+    calenhad_icosphere_cache = _settings -> value ("calenhad/icosphere/cache", "/home/martin/.cache/calenhad/icosphere").toString();
+
     // Scale bar
     calenhad_globe_scale_background_color = _settings -> value ("calenhad/globe/scale/background/color", "#C0C0C0").value<QColor>();
     calenhad_globe_scale_width = _settings -> value ("calenhad/globe/scale/width", 200).toUInt();
@@ -177,6 +193,11 @@ void Preferences::loadSettings() {
     calenhad_module_icospheremap = _settings -> value ("calenhad/module/icospheremap", "icospheremap").toString();
     calenhad_module_altitudemap = _settings -> value ("calenhad/module/altitudemap", "altitudemap").toString();
     calenhad_module_raster = _settings -> value ("calenhad/module/raster", "raster").toString();
+    calenhad_module_biome = _settings -> value ("calenhad/module/biome", "biome").toString();
+    calenhad_module_tectonics = _settings -> value ("calenhad/module/tectonics", "tectonics").toString();
+    calenhad_module_erosion = _settings -> value ("calenhad/module/erosion", "erosion").toString();
+    calenhad_module_rivers = _settings -> value ("calenhad/module/rivers", "rivers").toString();
+    calenhad_module_distance = _settings -> value ("calenhad/module/distance", "distance").toString();
     calenhad_nodegroup = _settings -> value ("calenhad/nodegroup", "nodegroup").toString();
 
 
@@ -299,6 +320,14 @@ void Preferences::saveSettings() {
     _settings -> setValue ("calenhad/globe/zoom/max", calenhad_globe_zoom_max);
     _settings -> setValue ("calenhad/globe/inset/height", calenhad_globe_inset_height);
     _settings -> setValue ("calenhad/globe/texture/height", calenhad_globe_texture_height);
+    _settings -> setValue ("calenhad/export/tilesize", calenhad_export_tilesize);
+    _settings -> setValue ("calenhad/export/workers", calenhad_export_workers);
+    _settings -> setValue ("calenhad/export/throughput", calenhad_export_throughput);
+    _settings -> setValue ("calenhad/tileserver/enabled", calenhad_tileserver_enabled);
+    _settings -> setValue ("calenhad/tileserver/settings", calenhad_tileserver_settings);
+    _settings -> setValue ("calenhad/native/compiler", calenhad_native_compiler);
+    _settings -> setValue ("calenhad/native/cache", calenhad_native_cache);
+    _settings -> setValue ("calenhad/icosphere/cache", calenhad_icosphere_cache);
     _settings -> setValue ("calenhad/desktop/zoomlimit/zoomin", calenhad_desktop_zoom_limit_zoomin);
     _settings -> setValue ("calenhad/desktop/zoomlimit/zoomout", calenhad_desktop_zoom_limit_zoomout);
     _settings -> setValue ("calenhad/desktop/zoom/default", calenhad_desktop_zoom_default);
@@ -311,6 +340,11 @@ void Preferences::saveSettings() {
     _settings -> setValue ("calenhad/module/icospheremap", calenhad_module_icospheremap);
     _settings -> setValue ("calenhad/module/altitudemap", calenhad_module_altitudemap);
     _settings -> setValue ("calenhad/module/raster", calenhad_module_raster);
+    _settings -> setValue ("calenhad/module/biome", calenhad_module_biome);
+    _settings -> setValue ("calenhad/module/tectonics", calenhad_module_tectonics);
+    _settings -> setValue ("calenhad/module/erosion", calenhad_module_erosion);
+    _settings -> setValue ("calenhad/module/rivers", calenhad_module_rivers);
+    _settings -> setValue ("calenhad/module/distance", calenhad_module_distance);
     _settings -> setValue ("calenhad/nodegroup", calenhad_nodegroup);
 
 }
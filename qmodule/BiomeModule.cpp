@@ -0,0 +1,181 @@
+#include "BiomeModule.h"
+#include <QtWidgets/QPushButton>
+#include "../controls/biome/BiomeEditor.h"
+#include "../pipeline/CalenhadModel.h"
+#include "../actions/XmlCommand.h"
+#include "../nodeedit/CalenhadController.h"
+#include "../legend/Legend.h"
+#include "../legend/LegendService.h"
+#include "../CalenhadServices.h"
+#include "preferences/preferences.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::controls::biome;
+using namespace calenhad::actions;
+using namespace calenhad::legend;
+
+BiomeModule::BiomeModule (QWidget* parent) : Module (CalenhadServices::preferences() -> calenhad_module_biome),
+    _editor (nullptr),
+    _table (BiomeTable::whittaker()),
+    _colorOutput (true),
+    _classLegend (new Legend ("Biomes")),
+    _valueLegend (nullptr) {
+
+    addContentPanel();
+    _editor = new BiomeEditor (this);
+    connect (_editor, &QDialog::accepted, this, &BiomeModule::updateTable);
+
+    _outputCombo = new QComboBox (this);
+    _outputCombo -> addItem ("Colour");
+    _outputCombo -> addItem ("Class");
+    _outputCombo -> setToolTip ("Colour shows each class in its own colour; class gives the index of the class, for use by other modules");
+    connect (_outputCombo, static_cast<void (QComboBox::*) (int)> (&QComboBox::currentIndexChanged), this, [=] (int index) {
+        preserve();
+        setColorOutput (index == 0);
+        QDomDocument doc;
+        QDomElement root = doc.createElement ("calenhad");
+        doc.appendChild (root);
+        serialize (root);
+        XmlCommand* c = new XmlCommand (_model, _oldXml);
+        _model -> controller() -> doCommand (c);
+        c -> setNewXml (doc.toString());
+    });
+    _contentLayout -> addRow ("Output", _outputCombo);
+
+    QPushButton* editButton = new QPushButton (this);
+    editButton -> setText ("Edit biomes");
+    connect (editButton, &QPushButton::pressed, this, &BiomeModule::editTable);
+    _contentLayout -> addRow ("", editButton);
+
+    updateLegend();
+}
+
+BiomeModule::~BiomeModule() {
+    if (_editor) { delete _editor; }
+    delete _classLegend;
+}
+
+const BiomeTable& BiomeModule::table() const {
+    return _table;
+}
+
+void BiomeModule::setTable (const BiomeTable& table) {
+    if (table.isValid()) {
+        _table = table;
+        updateLegend();
+        invalidate();
+    }
+}
+
+bool BiomeModule::isColorOutput() const {
+    return _colorOutput;
+}
+
+void BiomeModule::setColorOutput (const bool& color) {
+    _colorOutput = color;
+    _outputCombo -> blockSignals (true);
+    _outputCombo -> setCurrentIndex (color ? 0 : 1);
+    _outputCombo -> blockSignals (false);
+    updateLegend();
+    invalidate();
+}
+
+float BiomeModule::colorValue (const int& index, const int& classCount) {
+    return (float) (-1.0 + 2.0 * (index + 0.5) / std::max (1, classCount));
+}
+
+QVector<float> BiomeModule::cellValues() const {
+    QVector<float> values;
+    int classes = _table.classes().size();
+    for (int row = 0; row < _table.rows(); row++) {
+        for (int column = 0; column < _table.columns(); column++) {
+            int index = _table.classAt (row, column);
+            values.append (_colorOutput ? colorValue (index, classes) : (float) index);
+        }
+    }
+    return values;
+}
+
+// In colour mode, the module shows in a stepwise legend made from its classes; otherwise it goes back to the legend
+// it had before.
+void BiomeModule::updateLegend() {
+    int classes = _table.classes().size();
+    QVector<LegendEntry> entries;
+    for (int i = 0; i < classes; i++) {
+        entries.append (LegendEntry (-1.0 + 2.0 * i / classes, _table.classes().at (i).color()));
+    }
+    _classLegend -> setEntries (entries);
+    _classLegend -> setInterpolated (false);
+
+    if (_colorOutput) {
+        if (_legend != _classLegend) {
+            _valueLegend = _legend;
+            setLegend (_classLegend);
+        }
+    } else if (_legend == _classLegend) {
+        setLegend (_valueLegend ? _valueLegend : CalenhadServices::legends() -> defaultLegend());
+    }
+}
+
+QString BiomeModule::glsl() {
+    // Graph writes the table lookup as a function of this name ahead of the module's own function
+    return "_" + name() + "_biome (%0, %1)";
+}
+
+void BiomeModule::editTable() {
+    preserve();
+    _editor -> setTable (_table);
+    _editor -> setModal (false);
+    _editor -> show();
+}
+
+void BiomeModule::updateTable() {
+    setTable (_editor -> table());
+
+    // preserve the change for undo purposes
+    QDomDocument doc;
+    QDomElement root = doc.createElement ("calenhad");
+    doc.appendChild (root);
+    QDomElement element = doc.documentElement();
+    serialize (element);
+    QString newXml = doc.toString();
+
+    XmlCommand* c = new XmlCommand (_model, _oldXml);
+    _model -> controller() -> doCommand (c);
+    c -> setNewXml (newXml);
+}
+
+void BiomeModule::inflate (const QDomElement& element) {
+    Module::inflate (element);
+    _valueLegend = _legend;
+    QDomElement biomesElement = element.firstChildElement ("biomes");
+    if (! biomesElement.isNull()) {
+        BiomeTable table;
+        table.inflate (biomesElement);
+        _table = table;
+        _colorOutput = biomesElement.attribute ("output", "color") == "color";
+    }
+    setColorOutput (_colorOutput);
+}
+
+void BiomeModule::serialize (QDomElement& element) {
+    Module::serialize (element);
+
+    // the class legend is made up from the table, so keep the legend the module had otherwise
+    if (_legend == _classLegend && _valueLegend) {
+        _element.setAttribute ("legend", _valueLegend -> name());
+    }
+    QDomElement biomesElement = _document.createElement ("biomes");
+    biomesElement.setAttribute ("output", _colorOutput ? "color" : "class");
+    _table.serialize (_document, biomesElement);
+    _element.appendChild (biomesElement);
+}
+
+void BiomeModule::preserve() {
+    QDomDocument doc;
+    QDomElement root = doc.createElement ("calenhad");
+    doc.appendChild (root);
+    QDomElement element = doc.documentElement();
+    serialize (element);
+    _oldXml = doc.toString();
+}
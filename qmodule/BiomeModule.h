@@ -0,0 +1,74 @@
+#ifndef CALENHAD_BIOMEMODULE_H
+#define CALENHAD_BIOMEMODULE_H
+
+#include <QtCore/QString>
+#include <QtXml/QDomElement>
+#include <QtWidgets/QComboBox>
+#include "Module.h"
+#include "../controls/biome/BiomeTable.h"
+
+namespace calenhad {
+    namespace controls {
+        namespace biome {
+            class BiomeEditor;
+        }
+    }
+    namespace qmodule {
+
+        // Classifies each point by its height and moisture, given by the module's two inputs, looking both up in a
+        // two dimensional table of biome classes. However many classes there are, this costs the two inputs and one
+        // lookup, where a chain of select modules would evaluate every branch. The output is either the class's index
+        // (0, 1, 2 ...) for use downstream, or a value which the module's own legend shows in the class's colour.
+        class BiomeModule : public Module {
+        Q_OBJECT
+        public:
+
+            BiomeModule (QWidget* parent = 0);
+
+            virtual ~BiomeModule ();
+
+            const calenhad::controls::biome::BiomeTable& table () const;
+
+            void setTable (const calenhad::controls::biome::BiomeTable& table);
+
+            bool isColorOutput () const;
+
+            void setColorOutput (const bool& color);
+
+            // the module's output for each cell of the table, row by row from the lowest height band
+            QVector<float> cellValues () const;
+
+            // output in colour mode for a class; the class legend has a step at the bottom of each class's interval
+            static float colorValue (const int& index, const int& classCount);
+
+            QString glsl () override;
+
+            void inflate (const QDomElement& element) override;
+
+            void serialize (QDomElement& element) override;
+
+        public slots:
+
+            void editTable ();
+
+            void updateTable ();
+
+        protected:
+            calenhad::controls::biome::BiomeEditor* _editor;
+            calenhad::controls::biome::BiomeTable _table;
+            bool _colorOutput;
+            QComboBox* _outputCombo;
+            calenhad::legend::Legend* _classLegend;
+            calenhad::legend::Legend* _valueLegend;
+            QString _oldXml;
+
+            void preserve ();
+
+            void updateLegend ();
+
+        };
+    }
+}
+
+
+#endif //CALENHAD_BIOMEMODULE_H
@@ -0,0 +1,57 @@
+#include "DistanceModule.h"
+#include <cmath>
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "../graph/ComputeGraph.h"
+#include "../graph/CpuEvaluator.h"
+#include "../icosphere/Dataset.h"
+#include "../icosphere/Distance.h"
+#include "../icosphere/Parallel.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::graph;
+using namespace calenhad::icosphere;
+
+DistanceModule::DistanceModule (QWidget* parent) : FieldModule (CalenhadServices::preferences() -> calenhad_module_distance, parent),
+    _measure (std::make_shared<Measure>()) {
+
+}
+
+DistanceModule::~DistanceModule() {
+
+}
+
+FieldModule::Job DistanceModule::job() {
+    Job job;
+    std::shared_ptr<ComputeGraph> graph = sourceGraph (0);
+    if (! graph) { return job; }
+    QByteArray key = graph -> hash() + QByteArray::number (depth());
+    float threshold = (float) parameterValue ("threshold");
+    std::shared_ptr<Measure> measure = _measure;
+
+    job.generate = [graph, key, threshold, measure] (std::shared_ptr<Dataset> dataset) {
+        // the input is evaluated again only if it or the depth has changed since last time
+        if (! measure -> distance || key != measure -> key) {
+            CpuEvaluator evaluator (graph.get());
+            dataset -> fill ("height", evaluator);
+            measure -> distance.reset (new Distance (dataset -> icosphere(), dataset -> column<float> ("height")));
+            measure -> key = key;
+        }
+        measure -> distance -> update (threshold);
+
+        uint32_t n = dataset -> size();
+        const float* distances = measure -> distance -> distances();
+        float* result = dataset -> add<float> ("distance");
+        parallelFor (n, 1 << 16, [distances, result] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                result [v] = std::isinf (distances [v]) ? (float) M_PI : distances [v];
+            }
+        });
+        return true;
+    };
+    return job;
+}
+
+QString DistanceModule::column() const {
+    return "distance";
+}
@@ -0,0 +1,46 @@
+#ifndef CALENHAD_DISTANCEMODULE_H
+#define CALENHAD_DISTANCEMODULE_H
+
+#include <memory>
+#include <QtCore/QByteArray>
+#include "FieldModule.h"
+
+namespace calenhad {
+    namespace icosphere {
+        class Distance;
+    }
+    namespace qmodule {
+
+        // Great circle distance, in radians, from each point to the nearest point where the module's input is below
+        // its threshold (see icosphere::Distance): with the threshold at sea level, the distance from the sea, which is
+        // zero at sea; with the input inverted, the distance from the ridges. Points with none anywhere on the planet
+        // are given pi, the farthest any point can be from another.
+        //
+        // The input is evaluated at every vertex of the icosphere by a CpuEvaluator, so it must be a module the CPU can
+        // evaluate. It is evaluated again only when it, or the depth, changes; changing only the threshold works out
+        // again only the distances the change affects.
+        class DistanceModule : public FieldModule {
+        Q_OBJECT
+        public:
+            DistanceModule (QWidget* parent = 0);
+
+            virtual ~DistanceModule ();
+
+        protected:
+            // the distances last worked out, and the input and depth they were worked out from (key), which belong to
+            // the job generating the field while there is one
+            struct Measure {
+                std::unique_ptr<calenhad::icosphere::Distance> distance;
+                QByteArray key;
+            };
+            std::shared_ptr<Measure> _measure;
+
+            Job job () override;
+
+            QString column () const override;
+        };
+    }
+}
+
+
+#endif //CALENHAD_DISTANCEMODULE_H
@@ -0,0 +1,46 @@
+#include "ErosionModule.h"
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "../graph/ComputeGraph.h"
+#include "../graph/CpuEvaluator.h"
+#include "../icosphere/Dataset.h"
+#include "../icosphere/Erosion.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::graph;
+using namespace calenhad::icosphere;
+
+ErosionModule::ErosionModule (QWidget* parent) : FieldModule (CalenhadServices::preferences() -> calenhad_module_erosion, parent) {
+
+}
+
+ErosionModule::~ErosionModule() {
+
+}
+
+FieldModule::Job ErosionModule::job() {
+    Job job;
+    std::shared_ptr<ComputeGraph> graph = sourceGraph (0);
+    if (! graph) { return job; }
+
+    Erosion::Settings settings;
+    settings.iterations = (int) parameterValue ("iterations");
+    settings.seed = (int) parameterValue ("seed");
+    settings.rain = (float) parameterValue ("rain");
+    settings.evaporation = (float) parameterValue ("evaporation");
+    settings.capacity = (float) parameterValue ("capacity");
+    settings.solubility = (float) parameterValue ("solubility");
+    settings.deposition = (float) parameterValue ("deposition");
+    settings.talus = (float) parameterValue ("talus");
+    settings.weathering = (float) parameterValue ("weathering");
+    job.generate = [graph, settings] (std::shared_ptr<Dataset> dataset) {
+        CpuEvaluator evaluator (graph.get());
+        dataset -> fill ("height", evaluator);
+        return Erosion (dataset).run ("height", "eroded", settings);
+    };
+    return job;
+}
+
+QString ErosionModule::column() const {
+    return "eroded";
+}
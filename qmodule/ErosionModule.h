@@ -0,0 +1,28 @@
+#ifndef CALENHAD_EROSIONMODULE_H
+#define CALENHAD_EROSIONMODULE_H
+
+#include <memory>
+#include "FieldModule.h"
+
+namespace calenhad {
+    namespace qmodule {
+
+        // Erodes the height field given by the module's input (see icosphere::Erosion). The input is evaluated at every
+        // vertex of the icosphere by a CpuEvaluator, so it must be a module the CPU can evaluate.
+        class ErosionModule : public FieldModule {
+        Q_OBJECT
+        public:
+            ErosionModule (QWidget* parent = 0);
+
+            virtual ~ErosionModule ();
+
+        protected:
+            Job job () override;
+
+            QString column () const override;
+        };
+    }
+}
+
+
+#endif //CALENHAD_EROSIONMODULE_H
@@ -0,0 +1,175 @@
+#include "FieldModule.h"
+#include <algorithm>
+#include <iostream>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRunnable>
+#include "nodeedit/Port.h"
+#include "nodeedit/Connection.h"
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "../graph/Bake.h"
+#include "../graph/ComputeGraph.h"
+#include "../icosphere/Dataset.h"
+#include "../icosphere/IcosphereFile.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::nodeedit;
+using namespace calenhad::graph;
+using namespace calenhad::icosphere;
+
+namespace {
+    class FieldTask : public QRunnable {
+    public:
+        FieldTask (std::function<void()> work) : _work (work) { }
+        void run() override { _work(); }
+    protected:
+        std::function<void()> _work;
+    };
+}
+
+FieldModule::FieldModule (const QString& nodeType, QWidget* parent) : Module (nodeType, false, parent),
+    _field (nullptr),
+    _dataset (nullptr),
+    _generating (false) {
+
+    // the field is already made over the whole planet, so freezing it would gain nothing
+    _contextMenu -> removeAction (_freezeAction);
+    _pool.setMaxThreadCount (1);
+}
+
+FieldModule::~FieldModule() {
+    _pool.waitForDone();
+    if (_field) { delete _field; }
+}
+
+// checked again, like a frozen module's bake, each time the module is invalidated. A field that doesn't match the
+// module as it is now is never given out; a job is started for it instead, unless one is already running, in which
+// case the module is checked again when that job is done.
+const Bake* FieldModule::bake() {
+    if (! _bakeChecked) {
+        _bakeChecked = true;
+        _bakeCurrent = false;
+        if (Module::isComplete()) {
+            QByteArray s = signature();
+            _bakeCurrent = _field && _field -> hash() == s;
+            if (! _bakeCurrent && ! _generating && s != _attempted) {
+                start (s);
+            }
+        }
+    }
+    return _bakeCurrent ? _field : nullptr;
+}
+
+void FieldModule::start (const QByteArray& signature) {
+    // a module that can't be generated is tried again only once it or something upstream of it changes
+    _attempted = signature;
+    Job work = job();
+    if (! work.generate) { return; }
+
+    _generating = true;
+    _finish = work.finish;
+    std::shared_ptr<Result> result = std::make_shared<Result>();
+    _result = result;
+    unsigned depth = this -> depth();
+    QString column = this -> column();
+    int height = CalenhadServices::preferences() -> calenhad_globe_texture_height;
+    _pool.start (new FieldTask ([this, work, result, depth, column, height, signature] () {
+        QElapsedTimer timer;
+        timer.start();
+        std::shared_ptr<Dataset> dataset = std::make_shared<Dataset> (IcosphereFile::cached (depth));
+        if (work.generate (dataset)) {
+            result -> dataset = dataset;
+            result -> field.reset (new Bake (Bake::make (dataset, column, height, signature)));
+        }
+        result -> elapsed = timer.elapsed();
+        QMetaObject::invokeMethod (this, "generated", Qt::QueuedConnection);
+    }));
+}
+
+void FieldModule::generated() {
+    std::shared_ptr<Result> result = _result;
+    _result.reset();
+    _generating = false;
+    bool success = result && result -> field;
+    if (success) {
+        delete _field;
+        _field = result -> field.release();
+        _dataset = result -> dataset;
+        std::cout << "Generated " << name().toStdString() << " on " << _dataset -> size() << " vertices in " << result -> elapsed << " ms\n";
+    } else {
+        std::cout << "Couldn't generate " << name().toStdString() << "\n";
+    }
+    if (_finish) { _finish (success); }
+    _finish = nullptr;
+    invalidate();
+}
+
+bool FieldModule::isComplete() {
+    return Module::isComplete() && bake();
+}
+
+bool FieldModule::isGenerating() {
+    return _generating;
+}
+
+void FieldModule::generateAll (const QList<Module*>& modules) {
+    bool waiting = true;
+    while (waiting) {
+        waiting = false;
+        for (Module* module : modules) {
+            module -> invalidate();
+        }
+        for (Module* module : modules) {
+            FieldModule* field = dynamic_cast<FieldModule*> (module);
+            if (! field) { continue; }
+            field -> bake();
+            if (field -> isGenerating()) {
+                field -> _pool.waitForDone();
+                QCoreApplication::sendPostedEvents (field, QEvent::MetaCall);
+                waiting = true;
+            }
+        }
+    }
+}
+
+std::shared_ptr<Dataset> FieldModule::dataset() {
+    return _dataset;
+}
+
+unsigned FieldModule::depth() {
+    return (unsigned) std::min (std::max ((int) parameterValue ("depth"), 1), (int) IcosphereFile::MaxDepth);
+}
+
+QByteArray FieldModule::signature() {
+    QCryptographicHash hash (QCryptographicHash::Sha1);
+    hash.addData (nodeType().toUtf8());
+    for (const QString& param : parameters()) {
+        hash.addData (QString ("%1 %2\n").arg (param).arg (parameterValue (param), 0, 'g', 17).toUtf8());
+    }
+    for (unsigned index : inputs().keys()) {
+        Module* module = source (index);
+        if (module) {
+            hash.addData (ComputeGraph (module).hash());
+        }
+    }
+    return hash.result();
+}
+
+Module* FieldModule::source (const unsigned& index) {
+    Port* port = inputs().value (index);
+    if (! port || port -> connections().isEmpty()) { return nullptr; }
+    return dynamic_cast<Module*> (port -> connections() [0] -> otherEnd (port) -> owner());
+}
+
+std::shared_ptr<ComputeGraph> FieldModule::sourceGraph (const unsigned& index) {
+    Module* module = source (index);
+    if (! module) { return nullptr; }
+    std::shared_ptr<ComputeGraph> graph = std::make_shared<ComputeGraph> (module);
+    if (! graph -> isValid()) {
+        std::cout << "Can't generate " << name().toStdString() << " from " << module -> name().toStdString() << ": " << graph -> error().toStdString() << "\n";
+        return nullptr;
+    }
+    return graph;
+}
@@ -0,0 +1,91 @@
+#ifndef CALENHAD_FIELDMODULE_H
+#define CALENHAD_FIELDMODULE_H
+
+#include <functional>
+#include <memory>
+#include <QtCore/QByteArray>
+#include <QtCore/QThreadPool>
+#include "Module.h"
+
+namespace calenhad {
+    namespace icosphere {
+        class Dataset;
+    }
+    namespace graph {
+        class ComputeGraph;
+    }
+    namespace qmodule {
+
+        // A module whose values are generated over a whole icosphere at once, into a dataset column offered downstream
+        // as a bake. Generation runs on the module's own thread whenever its inputs change; until then it is incomplete.
+        class FieldModule : public Module {
+        Q_OBJECT
+        public:
+            FieldModule (const QString& nodeType, QWidget* parent = 0);
+
+            virtual ~FieldModule ();
+
+            const calenhad::graph::Bake* bake () override;
+
+            // complete only once the field has been generated
+            bool isComplete () override;
+
+            // the dataset the field was last generated into, or null if it hasn't been
+            std::shared_ptr<calenhad::icosphere::Dataset> dataset ();
+
+            unsigned depth ();
+
+            // whether a field is being generated
+            bool isGenerating ();
+
+            // Generates the fields among the modules, and waits for them, for use where there is no event loop to pick
+            // up finished fields, such as exports from the command line. Every module is invalidated, so that modules
+            // downstream of a field take it up, and so this is no use where the modules are being rendered.
+            static void generateAll (const QList<Module*>& modules);
+
+        protected:
+            // The work of generating the field. It is made on the GUI thread, from the module's parameters and inputs,
+            // and generate is run on the module's thread, to fill the dataset's column (), returning false if it can't.
+            // Finish, if there is one, is then run on the GUI thread, with whether generate succeeded, to take up
+            // anything else it made. A job with no generate means that the module can't be generated as it is.
+            struct Job {
+                std::function<bool (std::shared_ptr<calenhad::icosphere::Dataset>)> generate;
+                std::function<void (const bool&)> finish;
+            };
+
+            // what a job made, handed back to the GUI thread
+            struct Result {
+                std::unique_ptr<calenhad::graph::Bake> field;
+                std::shared_ptr<calenhad::icosphere::Dataset> dataset;
+                qint64 elapsed = 0;
+            };
+
+            calenhad::graph::Bake* _field;
+            std::shared_ptr<calenhad::icosphere::Dataset> _dataset;
+            QThreadPool _pool;
+            std::shared_ptr<Result> _result;
+            std::function<void (const bool&)> _finish;
+            QByteArray _attempted;
+            bool _generating;
+
+            virtual Job job () = 0;
+            void start (const QByteArray& signature);
+            Q_INVOKABLE void generated ();
+
+            // the column of the dataset which is the module's output
+            virtual QString column () const = 0;
+
+            // identifies the module's parameters and everything upstream of it
+            QByteArray signature ();
+
+            // the module connected to an input port, or null if there is none
+            Module* source (const unsigned& index);
+
+            // a graph of the module connected to an input port, or null if there is none or it can't be evaluated
+            std::shared_ptr<calenhad::graph::ComputeGraph> sourceGraph (const unsigned& index);
+        };
+    }
+}
+
+
+#endif //CALENHAD_FIELDMODULE_H
@@ -5,6 +5,7 @@
 #include "IcosphereModule.h"
 #include "../CalenhadServices.h"
 #include "../preferences/PreferencesService.h"
+#include "../icosphere/IcosphereFile.h"
 
 using namespace calenhad::preferences;
 using namespace calenhad::qmodule;
@@ -15,9 +16,7 @@ IcosphereModule::IcosphereModule (Module* parent) : Module  (CalenhadServices::p
 }
 
 IcosphereModule::~IcosphereModule () {
-    if (_icosphere) {
-        delete _icosphere;
-    }
+
 }
 
 void IcosphereModule::initialise () {
@@ -27,7 +26,7 @@ void IcosphereModule::initialise () {
         addContentPanel();
     }
 
-    _icosphere = new Icosphere (7);
+    _icosphere = IcosphereFile::cached (7);
 }
 
 bool IcosphereModule::isComplete () {
@@ -5,6 +5,7 @@
 #ifndef MESSAGES_ICOSPHEREMODULE_H
 #define MESSAGES_ICOSPHEREMODULE_H
 
+#include <memory>
 #include "Module.h"
 #include "../icosphere/icosphere.h"
 
@@ -26,7 +27,7 @@ namespace calenhad {
 
 
         protected:
-            icosphere::Icosphere* _icosphere;
+            std::shared_ptr<icosphere::Icosphere> _icosphere;
 
         };
     }
@@ -20,6 +20,12 @@
 #include "../nodeedit/CalenhadView.h"
 #include "../mapping/CalenhadMapWidget.h"
 #include "../nodeedit/CalenhadController.h"
+#include "../graph/ComputeGraph.h"
+#include "../graph/CostModel.h"
+#include "../graph/Bake.h"
+#include "../preferences/PreferencesService.h"
+#include <QtWidgets/QInputDialog>
+#include <QtWidgets/QApplication>
 
 using namespace icosphere;
 using namespace calenhad::qmodule;
@@ -27,6 +33,7 @@ using namespace calenhad::nodeedit;
 using namespace calenhad::controls;
 using namespace calenhad::controls::globe;
 using namespace calenhad::pipeline;
+using namespace calenhad::graph;
 using namespace calenhad::legend;
 using namespace calenhad::mapping;
 using namespace calenhad::notification;
@@ -39,7 +46,12 @@ Module::Module (const QString& nodeType, const bool& suppressRender, QWidget* pa
                                                             _shownParameter (QString::null),
                                                             _suppressRender (suppressRender),
                                                              _connectMenu (new QMenu()),
-                                                            _stats (nullptr)   {
+                                                            _stats (nullptr),
+                                                            _cost (-1.0),
+                                                            _costKnown (false),
+                                                            _bake (nullptr),
+                                                            _bakeChecked (false),
+                                                            _bakeCurrent (false) {
     _legend = CalenhadServices::legends() -> defaultLegend();
     initialise();
 }
@@ -50,6 +62,7 @@ Module::~Module () {
     if (_globe) { delete _globe; }
     if (_stats) { delete _stats; }
     if (_connectMenu) { delete _connectMenu; }
+    if (_bake) { delete _bake; }
 }
 
 /// Initialise a QModule ready for use. Creates the UI.
@@ -65,6 +78,19 @@ void Module::initialise() {
     QAction* globeAction =  new QAction (QIcon (":/appicons/controls/globe.png"), "Show globe");
     connect (globeAction, &QAction::triggered, this, &Module::showGlobe);
     _contextMenu -> addAction (globeAction);
+    _freezeAction = new QAction ("Freeze");
+    connect (_freezeAction, &QAction::triggered, this, [=] () {
+        if (_bake) {
+            unfreeze();
+        } else {
+            bool ok;
+            int height = QInputDialog::getInt (this, "Freeze " + name(), "Height of the bake in pixels",
+                                               CalenhadServices::preferences() -> calenhad_globe_texture_height, 16, 16384, 1, &ok);
+            if (ok) { freeze (height); }
+        }
+    });
+    connect (_contextMenu, &QMenu::aboutToShow, this, [=] () { _freezeAction -> setText (_bake ? "Unfreeze" : "Freeze"); });
+    _contextMenu -> addAction (_freezeAction);
 }
 
 void Module::showGlobe() {
@@ -134,6 +160,12 @@ void Module::inflate (const QDomElement& element) {
     Node::inflate (element);
     QString legendName = element.attribute ("legend", "default");
     _legend = CalenhadServices::legends() -> find (legendName);
+    Bake bake;
+    if (bake.inflate (element)) {
+        delete _bake;
+        _bake = new Bake (bake);
+        _bakeChecked = false;
+    }
     // position is retrieved in CalenhadModel
 }
 
@@ -141,6 +173,7 @@ void Module::serialize (QDomElement& element) {
     Node::serialize (element);
     QDomDocument doc = element.ownerDocument();
     _element.setAttribute ("legend", _legend -> name());
+    if (_bake) { _bake -> serialize (doc, _element); }
 }
 
 void Module::rendered (const bool& success) {
@@ -204,12 +237,33 @@ void Module::contextMenuEvent (QContextMenuEvent* e) {
 bool Module::range (double& min, double& max) {
     if (_preview) {
         Statistics statistics = _preview -> statistics ();
-        min = statistics._min;
-        max = statistics._max;
-        return true;
-    } else {
-        return false;
+        if (statistics.ok()) {
+            min = statistics._min;
+            max = statistics._max;
+            return true;
+        }
     }
+    return bounds (min, max);
+}
+
+bool Module::bounds (double& min, double& max) {
+    ComputeGraph graph (this);
+    if (! graph.isValid()) { return false; }
+    Interval bounds = graph.layerRange();
+    if (! bounds.isBounded()) { return false; }
+    min = bounds.lo;
+    max = bounds.hi;
+    return true;
+}
+
+// kept until this module or one upstream of it changes, since its block is repainted far more often than that
+double Module::cost() {
+    if (! _costKnown) {
+        ComputeGraph graph (this);
+        _cost = graph.isValid() ? CostModel (&graph).perPoint() : -1.0;
+        _costKnown = true;
+    }
+    return _cost;
 }
 
 CalenhadMapWidget* Module::preview() {
@@ -223,7 +277,50 @@ void Module::parameterChanged() {
     }
 }
 
+// a stale bake is kept rather than dropped, because while a project loads the graph upstream is only partly built
+// and its hash won't match until it is complete; it is checked again each time the module is invalidated
+const Bake* Module::bake() {
+    if (_bake && ! _bakeChecked) {
+        ComputeGraph graph (this, true);
+        _bakeCurrent = graph.isValid() && graph.hash() == _bake -> hash();
+        _bakeChecked = true;
+    }
+    return _bake && _bakeCurrent ? _bake : nullptr;
+}
+
+void Module::drawOverlay (QPainter& p, CalenhadMapWidget* map) {
+
+}
+
+bool Module::isFrozen() {
+    return bake() != nullptr;
+}
+
+void Module::freeze (const int& height) {
+    ComputeGraph graph (this, true);
+    if (! graph.isValid()) {
+        if (CalenhadServices::messages()) {
+            CalenhadServices::messages() -> message ("Cannot freeze", "Module " + name() + " can't be evaluated on the CPU: " + graph.error(), NotificationStyle::WarningNotification);
+        }
+        return;
+    }
+    QApplication::setOverrideCursor (Qt::WaitCursor);
+    Bake* bake = new Bake (Bake::make (graph, height));
+    QApplication::restoreOverrideCursor();
+    delete _bake;
+    _bake = bake;
+    invalidate();
+}
+
+void Module::unfreeze() {
+    delete _bake;
+    _bake = nullptr;
+    invalidate();
+}
+
 void Module::invalidate() {
+    _costKnown = false;
+    _bakeChecked = false;
     if (! _suppressRender) {
         Node::invalidate ();
         // if this node needs recalculating or rerendering, so do any nodes that depend on it -
@@ -18,11 +18,15 @@
 #include <mapping/CalenhadMapWidget.h>
 #include "Node.h"
 
+class QPainter;
 
 namespace calenhad {
     namespace legend {
         class Legend;
     }
+    namespace graph {
+        class Bake;
+    }
     namespace nodeedit {
         class NodeBlock;
         class Port;
@@ -68,7 +72,27 @@ namespace calenhad {
 
             void showContextMenu (const QPoint& point);
             bool isComplete() override;
+            // range of values in the preview once it has rendered, otherwise the module's bounds
             bool range (double& min, double& max);
+
+            // bounds worked out from the parameters of this module and those upstream of it, without rendering;
+            // false if they can't be (the module can't be evaluated on the CPU, or can give any value)
+            bool bounds (double& min, double& max);
+
+            // estimated cost of evaluating this module and everything upstream of it at one point (see CostModel), or
+            // a negative value if the module can't be evaluated on the CPU
+            double cost ();
+
+            // this module's bake (see graph::Bake) if it is frozen and nothing upstream of it has changed since it was
+            // baked, otherwise null. Downstream modules read a bake back from a raster instead of evaluating this one.
+            virtual const calenhad::graph::Bake* bake ();
+
+            // draws anything the module has to show over its own map, such as vector features worked out with its
+            // values, after the map and its graticule; nothing by default
+            virtual void drawOverlay (QPainter& p, calenhad::mapping::CalenhadMapWidget* map);
+            bool isFrozen ();
+            void freeze (const int& height);
+            void unfreeze ();
             QMap<unsigned, calenhad::nodeedit::Port*> inputs();
             calenhad::controls::QColoredIcon* icon ();
             void initialise () override;
@@ -110,6 +134,11 @@ namespace calenhad {
 
             QString _shownParameter;
             bool _editable;
+            double _cost;
+            bool _costKnown;
+            calenhad::graph::Bake* _bake;
+            bool _bakeChecked, _bakeCurrent;
+            QAction* _freezeAction;
 
         };
     }
@@ -0,0 +1,112 @@
+#include "RiversModule.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <QtGui/QPainter>
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "../graph/ComputeGraph.h"
+#include "../graph/CpuEvaluator.h"
+#include "../icosphere/Dataset.h"
+#include "../icosphere/Drainage.h"
+#include "../icosphere/Parallel.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::graph;
+using namespace calenhad::icosphere;
+using namespace calenhad::mapping;
+using namespace geoutils;
+
+RiversModule::RiversModule (QWidget* parent) : FieldModule (CalenhadServices::preferences() -> calenhad_module_rivers, parent),
+    _threshold (1) {
+
+}
+
+RiversModule::~RiversModule() {
+
+}
+
+FieldModule::Job RiversModule::job() {
+    Job job;
+    std::shared_ptr<ComputeGraph> graph = sourceGraph (0);
+    if (! graph) { return job; }
+    float seaLevel = (float) parameterValue ("sealevel");
+    double threshold = parameterValue ("threshold");
+
+    // the rivers are handed over to the module with the field, so that they always go with its dataset
+    struct Found {
+        std::vector<std::vector<uint32_t>> rivers;
+        uint32_t threshold = 1;
+    };
+    std::shared_ptr<Found> found = std::make_shared<Found>();
+
+    job.generate = [graph, seaLevel, threshold, found] (std::shared_ptr<Dataset> dataset) {
+        CpuEvaluator evaluator (graph.get());
+        dataset -> fill ("height", evaluator);
+        Drainage drainage (dataset);
+        if (! drainage.run ("height", seaLevel)) { return false; }
+
+        uint32_t n = dataset -> size();
+        const int32_t* accumulation = dataset -> column<int32_t> ("accumulation");
+        float* flow = dataset -> add<float> ("flow");
+        double most = std::log ((double) std::max (1, *std::max_element (accumulation, accumulation + n)));
+        parallelFor (n, 1 << 16, [accumulation, flow, most] (const uint64_t& begin, const uint64_t& end) {
+            for (uint64_t v = begin; v < end; v++) {
+                flow [v] = most > 0.0 ? (float) (2.0 * std::log ((double) accumulation [v]) / most - 1.0) : -1.0f;
+            }
+        });
+
+        found -> threshold = (uint32_t) std::max (1.0, std::ceil (threshold * n));
+        found -> rivers = drainage.rivers (found -> threshold);
+        std::cout << "Found " << found -> rivers.size() << " rivers draining at least " << found -> threshold << " vertices\n";
+        return true;
+    };
+    job.finish = [this, found] (const bool& success) {
+        if (success) {
+            _rivers = std::move (found -> rivers);
+            _threshold = found -> threshold;
+        }
+    };
+    return job;
+}
+
+QString RiversModule::column() const {
+    return "flow";
+}
+
+const std::vector<std::vector<uint32_t>>& RiversModule::rivers() {
+    bake();
+    return _rivers;
+}
+
+// each stretch of river is drawn wider the more it drains, from one pixel at the threshold to three at the largest
+void RiversModule::drawOverlay (QPainter& p, CalenhadMapWidget* map) {
+    std::shared_ptr<Dataset> d = dataset();
+    if (! d || _rivers.empty()) { return; }
+    const int32_t* accumulation = d -> column<int32_t> ("accumulation");
+    const float* x = d -> icosphere() -> x();
+    const float* y = d -> icosphere() -> y();
+    const float* z = d -> icosphere() -> z();
+    double most = std::log ((double) std::max (1, *std::max_element (accumulation, accumulation + d -> size())) / _threshold);
+    QPen pen (QColor (32, 64, 192));
+    pen.setCapStyle (Qt::RoundCap);
+    p.save();
+    p.setRenderHint (QPainter::Antialiasing);
+    for (const std::vector<uint32_t>& river : _rivers) {
+        QPointF start, end;
+        bool visible = false;
+        for (uint32_t v : river) {
+            Geolocation g (std::asin ((double) y [v]), std::atan2 ((double) z [v], (double) x [v]), Units::Radians);
+            bool next = map -> screenCoordinates (g, end);
+            // a stretch running off the edge of the map comes back on the other side, so isn't drawn across it
+            if (visible && next && std::abs (end.x() - start.x()) < map -> width() / 2) {
+                pen.setWidthF (1.0 + (most > 0.0 ? 2.0 * std::log ((double) accumulation [v] / _threshold) / most : 0.0));
+                p.setPen (pen);
+                p.drawLine (start, end);
+            }
+            start = end;
+            visible = next;
+        }
+    }
+    p.restore();
+}
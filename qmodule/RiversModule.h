@@ -0,0 +1,43 @@
+#ifndef CALENHAD_RIVERSMODULE_H
+#define CALENHAD_RIVERSMODULE_H
+
+#include <memory>
+#include <vector>
+#include "FieldModule.h"
+
+namespace calenhad {
+    namespace qmodule {
+
+        // Works out the drainage of the height field given by the module's input (see icosphere::Drainage). The
+        // module's value is the flow through each point: the logarithm of its catchment as a fraction of the largest
+        // on the planet, from -1 where nothing drains in to 1 at the mouth of the largest river, for downstream modules
+        // to cut valleys or colour water with. The rivers themselves - every run of vertices draining at least the
+        // module's threshold, a fraction of the planet's surface - are kept as lines, and drawn over the module's map.
+        //
+        // The input is evaluated at every vertex of the icosphere by a CpuEvaluator, so it must be a module the CPU can
+        // evaluate.
+        class RiversModule : public FieldModule {
+        Q_OBJECT
+        public:
+            RiversModule (QWidget* parent = 0);
+
+            virtual ~RiversModule ();
+
+            // rivers as runs of vertex ids of the icosphere of dataset (), from source to mouth
+            const std::vector<std::vector<uint32_t>>& rivers ();
+
+            void drawOverlay (QPainter& p, calenhad::mapping::CalenhadMapWidget* map) override;
+
+        protected:
+            std::vector<std::vector<uint32_t>> _rivers;
+            uint32_t _threshold;
+
+            Job job () override;
+
+            QString column () const override;
+        };
+    }
+}
+
+
+#endif //CALENHAD_RIVERSMODULE_H
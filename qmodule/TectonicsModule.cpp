@@ -0,0 +1,34 @@
+#include "TectonicsModule.h"
+#include <QtCore/QtMath>
+#include "../CalenhadServices.h"
+#include "../preferences/PreferencesService.h"
+#include "../icosphere/Dataset.h"
+#include "../icosphere/Tectonics.h"
+
+using namespace calenhad::qmodule;
+using namespace calenhad::icosphere;
+
+TectonicsModule::TectonicsModule (QWidget* parent) : FieldModule (CalenhadServices::preferences() -> calenhad_module_tectonics, parent) {
+
+}
+
+TectonicsModule::~TectonicsModule() {
+
+}
+
+FieldModule::Job TectonicsModule::job() {
+    int plates = (int) parameterValue ("plates");
+    int seed = (int) parameterValue ("seed");
+    double width = qDegreesToRadians (parameterValue ("width"));
+    Job job;
+    job.generate = [plates, seed, width] (std::shared_ptr<Dataset> dataset) {
+        Tectonics tectonics (dataset);
+        tectonics.generate (plates, seed, width);
+        return true;
+    };
+    return job;
+}
+
+QString TectonicsModule::column() const {
+    return "stress";
+}
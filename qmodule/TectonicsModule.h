@@ -0,0 +1,29 @@
+#ifndef CALENHAD_TECTONICSMODULE_H
+#define CALENHAD_TECTONICSMODULE_H
+
+#include <memory>
+#include "FieldModule.h"
+
+namespace calenhad {
+    namespace qmodule {
+
+        // A source module giving the stress along the boundaries of tectonic plates (see icosphere::Tectonics): positive
+        // where plates converge, where mountains and trenches would form, negative where they move apart, and fading to
+        // nothing away from the boundaries over the module's width, in degrees.
+        class TectonicsModule : public FieldModule {
+        Q_OBJECT
+        public:
+            TectonicsModule (QWidget* parent = 0);
+
+            virtual ~TectonicsModule ();
+
+        protected:
+            Job job () override;
+
+            QString column () const override;
+        };
+    }
+}
+
+
+#endif //CALENHAD_TECTONICSMODULE_H
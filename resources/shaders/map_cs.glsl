@@ -4,6 +4,7 @@ layout (rgba32f, binding = 0) uniform image2D destTex;          // output textur
 layout (binding = 1) uniform sampler2DArray rasters;            // array of input textures for modules that require them
 layout (std430, binding = 2) buffer colorMapBuffer { vec4 color_map_out []; };
 layout (std430, binding = 3) buffer heightMapBuffer { float height_map_out []; };
+layout (std430, binding = 4) buffer layerBuffer { float layer_out []; };          // every layer, LAYER_COUNT floats per texel
 
 layout (local_size_x = 32, local_size_y = 32) in;
 
@@ -17,6 +18,12 @@ uniform vec3 datum;
 // first element is the tile x coordinate, second element is the tile y coordinate, third element is the tile size
 uniform ivec3 tile;
 
+// if true, outputs are written relative to the tile's origin so that an exporter need only allocate one tile's worth of texture and buffer
+uniform bool tileLocal = false;
+
+// true to write all of the layers to the layer buffer as well as the first to the height map
+uniform bool writeLayers = false;
+
 // mathematical constants
 #define M_PI 3.1415926535898
 #define M_PI_2 1.57079632679
@@ -67,6 +74,14 @@ int hypsographyResolution;
 float minAltitude = 0;
 float maxAltitude = 0;
 
+// size of the texel being rendered, as a distance across the unit sphere. Fractal modules leave out octaves whose
+// wavelength is smaller than this, since they can only add aliasing. Zero means no texel, so every octave is used.
+float footprint = 0.0;
+
+// whether to work out footprints at all. Exports turn this off, so that the heights they write are the module's values
+// whatever the resolution, and the same as the CPU evaluators give (see octaveWeight in graph/CpuFunctions.h).
+uniform bool cullOctaves = true;
+
 // raster buffer parameters
 uniform int rasterResolution;                                      // number of elements in a raster = resolution * resolution * 2
 
@@ -558,22 +573,32 @@ float voronoi (vec3 cartesian, float frequency, float displacement, float vorono
 
 }
 
+// Weight for an octave of the given wavelength at the current texel: 1 while the wavelength spans at least two texels,
+// fading to 0 as it shrinks to one. Fractal loops stop at the first octave with no weight, as every later one is finer still.
+float octaveWeight (float wavelength) {
+    return footprint > 0.0 ? smoothstep (footprint, 2.0 * footprint, wavelength) : 1.0;
+}
+
 float noise (vec3 cartesian, bool simplex, float frequency, float lacunarity, float persistence, int octaves, int seed) {
   float value = 0.0;
   float signal = 0.0;
   float curPersistence = 1.0;
+  float curFrequency = frequency;
   vec3 n = cartesian; // vec3 (makeInt32Range (cartesian.x), makeInt32Range (cartesian.y), makeInt32Range (cartesian.z));
 
   n *= frequency;
 
   for (int curOctave = 0; curOctave < octaves; curOctave++) {
+    float w = octaveWeight (1.0 / curFrequency);
+    if (w <= 0.0) { break; }
     seed = (seed + curOctave) & 0xffffffff;
     //signal = simplex ? snoise (vec4 (n.xyz, seed)) : cnoise (vec4 (n.xyz, seed));
     signal = snoise (vec4 (n.xyz, seed));
-    value += signal * curPersistence;
+    value += signal * curPersistence * w;
 
     // Prepare the next octave.
     n *= lacunarity;
+    curFrequency *= lacunarity;
     curPersistence *= persistence;
   }
 
@@ -593,18 +618,22 @@ float billow (vec3 cartesian, float frequency, float lacunarity, float persisten
     float value = 0.0;
     float signal = 0.0;
     float curPersistence = 1.0;
+    float curFrequency = frequency;
     vec3 n = cartesian; // vec3 (makeInt32Range (cartesian.x), makeInt32Range (cartesian.y), makeInt32Range (cartesian.z));
 
     n *= frequency;
 
     for (int curOctave = 0; curOctave < octaves; curOctave++) {
+        float w = octaveWeight (1.0 / curFrequency);
+        if (w <= 0.0) { break; }
         seed = (seed + curOctave) & 0xffffffff;
         signal = cnoise (vec4 (n.xyz, seed));
         signal = 2.0 * abs (signal) - 1.0;
-        value += signal * curPersistence;
+        value += signal * curPersistence * w;
 
         // Prepare the next octave.
         n *= lacunarity;
+        curFrequency *= lacunarity;
         curPersistence *= persistence;
     }
     return (value + 0.5 + BILLOW_BIAS) * BILLOW_SCALE;
@@ -644,8 +673,11 @@ float ridgedmulti (vec3 cartesian, float frequency, float lacunarity, int octave
         float signal = 0.0;
         float value  = 0.0;
         float weight = 1.0;
+        float curFrequency = frequency;
 
         for (int curOctave = 0; curOctave < octaves; curOctave++) {
+          float w = octaveWeight (1.0 / curFrequency);
+          if (w <= 0.0) { break; }
 
           // Make sure that these floating-point values have the same range as a 32-
           // bit integer so that we can pass them to the coherent-noise functions.
@@ -671,10 +703,11 @@ float ridgedmulti (vec3 cartesian, float frequency, float lacunarity, int octave
           weight = clamp (0.0, 1.0, signal * gain);
 
           // Add the signal to the output value.
-          value += (signal * pSpectralWeights [curOctave]);
+          value += (signal * pSpectralWeights [curOctave] * w);
 
           // Go to the next octave.
           cartesian *= lacunarity;
+          curFrequency *= lacunarity;
         }
 
         return (((value) - 1.0 + RIDGED_MULTI_BIAS) * RIDGED_MULTI_SCALE) - 1.0;
@@ -825,6 +858,26 @@ bool inInset (ivec2 pos) {
     return pos.x < insetHeight * 2 && pos.y < insetHeight;
 }
 
+// Size of the texel at the given screen position, which shows the given point on the sphere: the greater of the distances
+// to the points shown by the next texels across and down. That covers the stretching of either axis by the projection.
+// At the rim of the globe the next texel may be off it, so the texel before is used instead, and an axis with neither
+// on the globe is left out.
+float texelFootprint (ivec2 pos, vec3 c, bool inset) {
+    if (! cullOctaves) { return 0.0; }
+    float size = 0.0;
+    for (int axis = 0; axis < 2; axis++) {
+        ivec2 next = axis == 0 ? ivec2 (1, 0) : ivec2 (0, 1);
+        vec3 g = inverse (mapPos (pos + next, inset), inset);
+        if (abs (g.z) > 1.0) {
+            g = inverse (mapPos (pos - next, inset), inset);
+        }
+        if (abs (g.z) <= 1.0) {
+            size = max (size, distance (c, toCartesian (g).xyz));
+        }
+    }
+    return size;
+}
+
 vec4 toGreyscale (vec4 color) {
     float l = sqrt (color.x * color.x + color.y * color.y + color.z * color.z);
     return vec4 (l, l, l, 1.0);
@@ -843,7 +896,10 @@ void main() {
 
     // this provides some antialiasing at the rim of the globe by fading to dark blue over the outermost 1% of the radius
     float pets = smoothstep (0.99, 1.00001, abs (c.w));
-    float v = value (c.xyz, g.xy);
+    float layer [LAYER_COUNT];
+    footprint = texelFootprint (pos, c.xyz, inset);
+    layers (c.xyz, g.xy, layer);
+    float v = layer [0];
     color = findColor (v);
     color = mix (color, vec4 (0.0, 0.0, 0.1, 1.0), pets);
 
@@ -858,14 +914,24 @@ void main() {
 
             // test functions with output in inset map here if needed
 
-            // get the value "behind" the inset for the benefit of the downloadable height map
+            // get the value "behind" the inset for the benefit of the downloadable height map, which isn't shown and
+            // so has no texel to fit
             i = mapPos (pos, false);
             g = inverse (i, false);
             c = toCartesian (g);
-            v = value (c.xyz, g.xy);
+            footprint = 0.0;
+            layers (c.xyz, g.xy, layer);
+            v = layer [0];
         }
     }
 
-    imageStore (destTex, pos, color);
-    height_map_out [pos.y * imageHeight * 2 + pos.x] = v;
+    ivec2 outPos = tileLocal ? pos - tile.z * tile.xy : pos;
+    int outWidth = tileLocal ? tile.z : imageHeight * 2;
+    imageStore (destTex, outPos, color);
+    height_map_out [outPos.y * outWidth + outPos.x] = v;
+    if (writeLayers) {
+        for (int k = 0; k < LAYER_COUNT; k++) {
+            layer_out [(outPos.y * outWidth + outPos.x) * LAYER_COUNT + k] = layer [k];
+        }
+    }
 }